@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+class Tracker.Bus.Statement : Tracker.Sparql.Statement {
+	HashTable<string,Variant> values = new HashTable<string,Variant> (str_hash, str_equal);
+
+	public Statement (Connection connection, string sparql) {
+		Object (connection: connection, sparql: sparql);
+	}
+
+	public override void bind_int (string name, int64 value) {
+		values.insert (name, new Variant.int64 (value));
+	}
+
+	public override void bind_string (string name, string value) {
+		values.insert (name, new Variant.string (value));
+	}
+
+	public override void clear_bindings () {
+		values.remove_all ();
+	}
+
+	public override Sparql.Cursor execute (Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		// use separate main context for sync operation
+		var context = new MainContext ();
+		var loop = new MainLoop (context, false);
+		context.push_thread_default ();
+		AsyncResult async_res = null;
+		execute_async.begin (cancellable, (o, res) => {
+			async_res = res;
+			loop.quit ();
+		});
+		loop.run ();
+		context.pop_thread_default ();
+		var cursor = (StreamCursor) execute_async.end (async_res);
+		cursor.sync = true;
+		return cursor;
+	}
+
+	public async override Sparql.Cursor execute_async (Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		var builder = new VariantBuilder (new VariantType ("a{sv}"));
+		var iter = HashTableIter<string,Variant> (values);
+		unowned string name;
+		unowned Variant value;
+
+		while (iter.next (out name, out value)) {
+			builder.add ("{sv}", name, value);
+		}
+
+		var bus_connection = (Connection) connection;
+		var cursor = yield bus_connection.query_internal_async (sparql, builder.end (), cancellable);
+		cursor.connection = connection;
+		return cursor;
+	}
+}
@@ -0,0 +1,755 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* D-Bus reply to a streamed query. It may arrive after the cursor is
+ * gone, so it keeps itself alive until then.
+ */
+class Tracker.Bus.StreamReply {
+	public bool received;
+	public SourceFunc? callback;
+
+	DBusMessage message;
+	IOError error;
+	StreamReply self;
+
+	public StreamReply () {
+		self = this;
+	}
+
+	public void ready (Object? source, AsyncResult res) {
+		StreamReply keep = (owned) self;
+
+		try {
+			message = ((DBusConnection) source).send_message_with_reply.end (res);
+		} catch (IOError e) {
+			error = e;
+		}
+
+		received = true;
+
+		if (callback != null) {
+			callback ();
+		}
+
+		keep = null;
+	}
+
+	public void check () throws Sparql.Error, IOError, DBusError {
+		if (error != null) {
+			throw new IOError.FAILED (error.message);
+		}
+
+		Connection.handle_error_reply (message);
+	}
+
+	// memory file of a SharedQuery reply
+	public UnixInputStream get_shared_results () throws GLib.Error {
+		int handle = message.get_body ().get_child_value (1).get_handle ();
+		return new UnixInputStream (message.get_unix_fd_list ().get (handle), true);
+	}
+}
+
+/* Cursor reading the results of a query while the store is still
+ * writing them, see Tracker.Steroids.stream_query for the formats.
+ * Rows are read from the pipe as the cursor advances and are only
+ * kept in the input buffer until the cursor moves past them, so the
+ * memory used doesn't depend on the number of results. Large results
+ * may continue in shared memory, see Tracker.Steroids.shared_query,
+ * their rows are then read in place from the mapped file.
+ *
+ * As rows are not kept, rewind () sends the query to the store again
+ * and the cursor reads the new results, which may differ from the
+ * first ones if the store was updated in between.
+ */
+class Tracker.Bus.StreamCursor : Tracker.Sparql.Cursor {
+	const int BUFFER_SIZE = 65536;
+
+	public const int RESULT_FORMAT_ROWS = 1;
+	public const int RESULT_FORMAT_BLOCKS = 2;
+	const uint8 MIXED_TYPES = 0xff;
+
+	Connection bus_connection;
+	string sparql;
+	Variant arguments;
+	int requested_format;
+
+	// set for cursors of sync queries, the reply then comes in a
+	// main context only the cursor iterates
+	internal bool sync;
+	MainContext context;
+
+	BufferedInputStream input;
+	StreamReply reply;
+	bool header_pending;
+	bool started;
+	bool finished;
+
+	// results in shared memory, once an empty block was read
+	bool shared_pending;
+	bool shared;
+	void* mapped;
+	size_t mapped_size;
+	size_t mapped_pos;
+
+	int format;
+	int _n_columns;
+	string[] variable_names;
+
+	// current frame in the input buffer, a row in format 1 and
+	// a block of rows in format 2
+	size_t frame_size;
+	int frame_rows;
+	int frame_row;
+	uint8*[] frame_types;
+	bool[] frame_mixed_types;
+	char* next_values;
+
+	// current row, pointing into the frame
+	bool has_row;
+	int[] row_types;
+	char*[] row_values;
+	long[] row_lengths;
+	string?[] row_strings;
+
+	// for debugging
+	uint64 n_bytes;
+	int n_rows;
+
+	internal StreamCursor (Connection bus_connection, string sparql, Variant arguments, int format) {
+		this.bus_connection = bus_connection;
+		this.sparql = sparql;
+		this.arguments = arguments;
+		requested_format = format;
+		context = MainContext.ref_thread_default ();
+	}
+
+	~StreamCursor () {
+		stop ();
+	}
+
+	void send (Cancellable? cancellable) throws IOError {
+		UnixInputStream pipe_input;
+		UnixOutputStream pipe_output;
+		bus_connection.pipe (out pipe_input, out pipe_output);
+
+		reply = new StreamReply ();
+
+		context.push_thread_default ();
+		bus_connection.send_query (sparql, arguments, requested_format, pipe_output, cancellable, reply.ready);
+		context.pop_thread_default ();
+
+		input = new BufferedInputStream.sized (pipe_input, BUFFER_SIZE);
+
+		header_pending = true;
+		started = false;
+		finished = false;
+		shared_pending = false;
+		shared = false;
+		mapped_pos = 0;
+		has_row = false;
+		frame_size = 0;
+		n_bytes = 0;
+		n_rows = 0;
+	}
+
+	// closing the pipe makes the store stop writing results
+	void stop () {
+		input = null;
+
+		if (mapped != null) {
+			Posix.munmap (mapped, mapped_size);
+			mapped = null;
+		}
+
+		if (sync && reply != null) {
+			while (!reply.received) {
+				context.iteration (true);
+			}
+		}
+	}
+
+	internal async void start_async (Cancellable? cancellable) throws Sparql.Error, IOError, DBusError {
+		send (cancellable);
+
+		try {
+			// the header is written once the query is translated,
+			// on errors the pipe is closed without it
+			if (yield fill_async (cancellable)) {
+				read_frame ();
+			} else {
+				yield wait_reply_async ();
+				finish ();
+			}
+		} catch (Sparql.Error e_sparql) {
+			throw e_sparql;
+		} catch (IOError e_io) {
+			throw e_io;
+		} catch (DBusError e_dbus) {
+			throw e_dbus;
+		} catch (Error e) {
+			throw new IOError.FAILED (e.message);
+		}
+	}
+
+	static inline int read_int (char* p) {
+		int value;
+		Memory.copy (&value, p, sizeof (int));
+		return value;
+	}
+
+	// returns false if the varint doesn't fit in @size bytes
+	static bool read_varint (char* p, size_t size, ref size_t pos, out uint64 value) {
+		value = 0;
+
+		for (int shift = 0; pos < size; shift += 7) {
+			uint8 byte = ((uint8*) p)[pos++];
+
+			value |= ((uint64) (byte & 0x7f)) << shift;
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// data available to read frames from
+	char* peek (out size_t available) {
+		if (shared) {
+			available = mapped_size - mapped_pos;
+			return (char*) mapped + mapped_pos;
+		}
+
+		unowned uint8[] buffer = input.peek_buffer ();
+		available = buffer.length;
+		return (char*) buffer;
+	}
+
+	/* Size of the next frame, as far as it can be told from what is
+	 * already buffered.
+	 */
+	size_t get_frame_size () {
+		size_t available;
+		char* p = peek (out available);
+
+		if (header_pending) {
+			/* header = [4 bytes for format,
+			 *           4 bytes for number of columns,
+			 *           columns x (4 bytes for length, name)]
+			 */
+			size_t size = 2 * sizeof (int);
+			if (available < size) {
+				return size;
+			}
+
+			int n_columns = read_int (p + sizeof (int));
+			for (int i = 0; i < n_columns; i++) {
+				if (available < size + sizeof (int)) {
+					return size + sizeof (int);
+				}
+				size += sizeof (int) + read_int (p + size) + 1;
+			}
+
+			return size;
+		}
+
+		if (format == RESULT_FORMAT_BLOCKS) {
+			/* block = [varint number of rows, varint size of values,
+			 *          columns x (type, or MIXED_TYPES and rows x type),
+			 *          values]
+			 */
+			size_t size = 0;
+			uint64 block_rows, values_size;
+
+			if (!read_varint (p, available, ref size, out block_rows) ||
+			    !read_varint (p, available, ref size, out values_size)) {
+				return available + 1;
+			}
+
+			for (int i = 0; i < _n_columns; i++) {
+				if (available <= size) {
+					return size + 1;
+				}
+				if (((uint8*) p)[size] == MIXED_TYPES) {
+					size += (size_t) block_rows;
+				}
+				size++;
+			}
+
+			return size + (size_t) values_size;
+		}
+
+		/* row = [4 bytes for number of columns,
+		 *        columns x 4 bytes for types
+		 *        columns x 4 bytes for offsets,
+		 *        nul terminated values]
+		 */
+		if (available < sizeof (int)) {
+			return sizeof (int);
+		}
+
+		int n_columns = read_int (p);
+		size_t size = sizeof (int) * (1 + 2 * n_columns);
+		if (n_columns == 0 || available < size) {
+			return size;
+		}
+
+		return size + read_int (p + size - sizeof (int)) + 1;
+	}
+
+	// maps the memory file the store wrote the remaining results to
+	void map_shared_results () throws GLib.Error {
+		shared_pending = false;
+		input = null;
+
+		reply.check ();
+
+		var stream = reply.get_shared_results ();
+		Posix.Stat st;
+
+		// sealed so it can't be truncated while mapped
+		if (!Memfd.is_sealed (stream.fd) || Posix.fstat (stream.fd, out st) < 0) {
+			throw new IOError.FAILED ("Invalid shared query results");
+		}
+
+		shared = true;
+		mapped_size = (size_t) st.st_size;
+		mapped_pos = 0;
+
+		if (mapped_size > 0) {
+			mapped = Posix.mmap (null, mapped_size, Posix.PROT_READ, Posix.MAP_PRIVATE, stream.fd, 0);
+			if (mapped == Posix.MAP_FAILED) {
+				mapped = null;
+				throw new IOError.FAILED ("Could not map shared query results: %s", strerror (errno));
+			}
+		}
+	}
+
+	// whether the next frame is fully mapped
+	bool has_shared_frame () {
+		return mapped_pos < mapped_size && get_frame_size () <= mapped_size - mapped_pos;
+	}
+
+	// returns false once the store closed the pipe
+	bool fill (Cancellable? cancellable) throws GLib.Error {
+		size_t size;
+
+		if (shared_pending) {
+			wait_reply ();
+			map_shared_results ();
+		}
+
+		if (shared) {
+			return has_shared_frame ();
+		}
+
+		while ((size = get_frame_size ()) > input.get_available ()) {
+			if (input.get_buffer_size () < size) {
+				input.set_buffer_size (size);
+			}
+
+			if (input.fill ((ssize_t) (size - input.get_available ()), cancellable) == 0) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	async bool fill_async (Cancellable? cancellable) throws GLib.Error {
+		size_t size;
+
+		if (shared_pending) {
+			yield wait_reply_async ();
+			map_shared_results ();
+		}
+
+		if (shared) {
+			return has_shared_frame ();
+		}
+
+		while ((size = get_frame_size ()) > input.get_available ()) {
+			if (input.get_buffer_size () < size) {
+				input.set_buffer_size (size);
+			}
+
+			if ((yield input.fill_async ((ssize_t) (size - input.get_available ()), Priority.DEFAULT, cancellable)) == 0) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// reads the buffered frame, returns true if it has rows
+	bool read_frame () throws GLib.Error {
+		size_t available;
+		char* p = peek (out available);
+
+		frame_size = get_frame_size ();
+		n_bytes += frame_size;
+
+		if (header_pending) {
+			size_t size = 2 * sizeof (int);
+
+			format = read_int (p);
+			_n_columns = read_int (p + sizeof (int));
+			variable_names = new string[_n_columns];
+			for (int i = 0; i < _n_columns; i++) {
+				variable_names[i] = (string) (p + size + sizeof (int));
+				size += sizeof (int) + read_int (p + size) + 1;
+			}
+
+			row_types = new int[_n_columns];
+			row_values = new char*[_n_columns];
+			row_lengths = new long[_n_columns];
+			row_strings = new string?[_n_columns];
+			frame_types = new uint8*[_n_columns];
+			frame_mixed_types = new bool[_n_columns];
+
+			skip_frame ();
+			header_pending = false;
+
+			return false;
+		}
+
+		frame_row = 0;
+
+		if (format == RESULT_FORMAT_BLOCKS) {
+			size_t size = 0;
+			uint64 block_rows, values_size;
+
+			read_varint (p, frame_size, ref size, out block_rows);
+			read_varint (p, frame_size, ref size, out values_size);
+			frame_rows = (int) block_rows;
+
+			for (int i = 0; i < _n_columns; i++) {
+				frame_mixed_types[i] = (((uint8*) p)[size] == MIXED_TYPES);
+				if (frame_mixed_types[i]) {
+					size++;
+					frame_types[i] = (uint8*) (p + size);
+					size += frame_rows;
+				} else {
+					frame_types[i] = (uint8*) (p + size);
+					size++;
+				}
+			}
+
+			// the rest of the results is in shared memory
+			if (frame_rows == 0) {
+				skip_frame ();
+				shared_pending = true;
+				return false;
+			}
+
+			next_values = p + size;
+			read_block_row ();
+		} else {
+			frame_rows = 1;
+			read_row (p);
+		}
+
+		started = true;
+		has_row = true;
+		n_rows++;
+
+		return true;
+	}
+
+	// reads the row of a frame in format 1
+	void read_row (char* p) {
+		int* types = (int*) (p + sizeof (int));
+		int* offsets = types + _n_columns;
+		char* data = (char*) (offsets + _n_columns);
+
+		int start = 0;
+		for (int i = 0; i < _n_columns; i++) {
+			int end = read_int ((char*) (offsets + i));
+
+			row_types[i] = read_int ((char*) (types + i));
+			row_values[i] = data + start;
+			row_lengths[i] = end - start;
+			row_strings[i] = null;
+
+			start = end + 1;
+		}
+	}
+
+	// reads the next row of a block in format 2
+	void read_block_row () {
+		char* p = next_values;
+
+		for (int i = 0; i < _n_columns; i++) {
+			int type = frame_mixed_types[i] ? frame_types[i][frame_row] : frame_types[i][0];
+
+			row_types[i] = type;
+			row_values[i] = p;
+			row_lengths[i] = 0;
+			row_strings[i] = null;
+
+			switch (type) {
+			case Sparql.ValueType.UNBOUND:
+				break;
+			case Sparql.ValueType.INTEGER:
+				p += sizeof (int64);
+				break;
+			case Sparql.ValueType.DOUBLE:
+				p += sizeof (double);
+				break;
+			case Sparql.ValueType.BOOLEAN:
+				p++;
+				break;
+			default:
+				size_t pos = 0;
+				uint64 length;
+				read_varint (p, size_t.MAX, ref pos, out length);
+				row_values[i] = p + pos;
+				row_lengths[i] = (long) length;
+				p += pos + (size_t) length + 1;
+				break;
+			}
+		}
+
+		next_values = p;
+	}
+
+	void skip_frame () throws GLib.Error {
+		if (frame_size > 0) {
+			if (shared) {
+				mapped_pos += frame_size;
+			} else {
+				input.skip (frame_size);
+			}
+			frame_size = 0;
+		}
+	}
+
+	// moves to the next row if it is in the current frame
+	bool next_in_frame () throws GLib.Error {
+		if (!has_row) {
+			return false;
+		}
+
+		if (++frame_row < frame_rows) {
+			read_block_row ();
+			n_rows++;
+			return true;
+		}
+
+		has_row = false;
+		skip_frame ();
+
+		return false;
+	}
+
+	// the store closed the pipe, the reply tells whether all results were written
+	bool finish () throws GLib.Error {
+		finished = true;
+
+		debug ("Read %d rows in %s bytes, format %d%s", n_rows, n_bytes.to_string (), format, shared ? ", in shared memory" : "");
+
+		reply.check ();
+
+		if (header_pending || (shared ? mapped_pos < mapped_size : input.get_available () > 0)) {
+			throw new Sparql.Error.INTERNAL ("Query results are incomplete");
+		}
+
+		return false;
+	}
+
+	void wait_reply () {
+		while (!reply.received) {
+			context.iteration (true);
+		}
+	}
+
+	async void wait_reply_async () {
+		if (sync) {
+			// nobody else dispatches the reply
+			wait_reply ();
+		} else if (!reply.received) {
+			reply.callback = wait_reply_async.callback;
+			yield;
+			reply.callback = null;
+		}
+	}
+
+	public override int n_columns {
+		get { return _n_columns; }
+	}
+
+	public override Sparql.ValueType get_value_type (int column)
+	requires (has_row) {
+		/* Cast from int to enum */
+		return (Sparql.ValueType) row_types[column];
+	}
+
+	public override unowned string? get_variable_name (int column)
+	requires (variable_names != null) {
+		return variable_names[column];
+	}
+
+	// true if the value of @column is sent as binary and not as a string
+	bool is_binary (int column) {
+		if (format != RESULT_FORMAT_BLOCKS) {
+			return false;
+		}
+
+		switch (row_types[column]) {
+		case Sparql.ValueType.INTEGER:
+		case Sparql.ValueType.DOUBLE:
+		case Sparql.ValueType.BOOLEAN:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	string format_value (int column) {
+		switch (row_types[column]) {
+		case Sparql.ValueType.INTEGER:
+			return get_integer (column).to_string ();
+		case Sparql.ValueType.DOUBLE:
+			// as the store would, %!.15g in sqlite
+			double value = get_double (column);
+			string str = "%.15g".printf (value);
+			if (value.is_finite () && str.index_of_char ('.') < 0 && str.index_of_char ('e') < 0) {
+				str += ".0";
+			}
+			return str;
+		default:
+			return get_boolean (column) ? "true" : "false";
+		}
+	}
+
+	public override unowned string? get_string (int column, out long length = null)
+	requires (has_row && column < n_columns) {
+		// return null instead of empty string for unbound values
+		if (row_types[column] == Sparql.ValueType.UNBOUND) {
+			length = 0;
+			return null;
+		}
+
+		if (is_binary (column)) {
+			if (row_strings[column] == null) {
+				row_strings[column] = format_value (column);
+			}
+
+			length = row_strings[column].length;
+			return row_strings[column];
+		}
+
+		length = row_lengths[column];
+		return (string) row_values[column];
+	}
+
+	public override int64 get_integer (int column)
+	requires (has_row && column < n_columns) {
+		if (is_binary (column) && row_types[column] == Sparql.ValueType.INTEGER) {
+			int64 value;
+			Memory.copy (&value, row_values[column], sizeof (int64));
+			return value;
+		}
+
+		return base.get_integer (column);
+	}
+
+	public override double get_double (int column)
+	requires (has_row && column < n_columns) {
+		if (is_binary (column) && row_types[column] == Sparql.ValueType.DOUBLE) {
+			double value;
+			Memory.copy (&value, row_values[column], sizeof (double));
+			return value;
+		}
+
+		return base.get_double (column);
+	}
+
+	public override bool get_boolean (int column)
+	requires (has_row && column < n_columns) {
+		if (is_binary (column) && row_types[column] == Sparql.ValueType.BOOLEAN) {
+			return *row_values[column] != 0;
+		}
+
+		return base.get_boolean (column);
+	}
+
+	public override bool next (Cancellable? cancellable = null) throws GLib.Error {
+		if (finished) {
+			return false;
+		}
+
+		if (next_in_frame ()) {
+			return true;
+		}
+
+		while (fill (cancellable)) {
+			if (read_frame ()) {
+				return true;
+			}
+		}
+
+		wait_reply ();
+
+		return finish ();
+	}
+
+	public override async bool next_async (Cancellable? cancellable = null) throws GLib.Error {
+		if (finished) {
+			return false;
+		}
+
+		if (next_in_frame ()) {
+			return true;
+		}
+
+		while (yield fill_async (cancellable)) {
+			if (read_frame ()) {
+				return true;
+			}
+		}
+
+		yield wait_reply_async ();
+
+		return finish ();
+	}
+
+	public override void rewind () {
+		if (!started) {
+			return;
+		}
+
+		// rows are not kept, ask the store for the results again
+		stop ();
+
+		try {
+			send (null);
+		} catch (IOError e) {
+			warning ("Could not rewind cursor: %s", e.message);
+			finished = true;
+		}
+	}
+
+	public override void close () {
+		stop ();
+
+		finished = true;
+		has_row = false;
+	}
+}
@@ -19,15 +19,29 @@
 
 public class Tracker.Bus.Connection : Tracker.Sparql.Connection {
 	DBusConnection bus;
+	int result_format = StreamCursor.RESULT_FORMAT_BLOCKS;
+	bool shared_results = true;
 
 	public Connection () throws Sparql.Error, IOError, DBusError {
 		bus = GLib.Bus.get_sync (BusType.SESSION);
 
+		// allows comparing result formats
+		string env_result_format = Environment.get_variable ("TRACKER_BUS_RESULT_FORMAT");
+		if (env_result_format != null) {
+			result_format = int.parse (env_result_format);
+		}
+
+		// large results come in shared memory unless set to "pipe"
+		string env_result_transport = Environment.get_variable ("TRACKER_BUS_RESULT_TRANSPORT");
+		if (env_result_transport == "pipe") {
+			shared_results = false;
+		}
+
 		// ensure that error domain is registered with GDBus
 		new Sparql.Error.INTERNAL ("");
 	}
 
-	void pipe (out UnixInputStream input, out UnixOutputStream output) throws IOError {
+	internal void pipe (out UnixInputStream input, out UnixOutputStream output) throws IOError {
 		int pipefd[2];
 		if (Posix.pipe (pipefd) < 0) {
 			throw new IOError.FAILED ("Pipe creation failed");
@@ -36,7 +50,7 @@ public class Tracker.Bus.Connection : Tracker.Sparql.Connection {
 		output = new UnixOutputStream (pipefd[1], true);
 	}
 
-	void handle_error_reply (DBusMessage message) throws Sparql.Error, IOError, DBusError {
+	internal static void handle_error_reply (DBusMessage message) throws Sparql.Error, IOError, DBusError {
 		try {
 			message.to_gerror ();
 		} catch (IOError e_io) {
@@ -50,10 +64,19 @@ public class Tracker.Bus.Connection : Tracker.Sparql.Connection {
 		}
 	}
 
-	void send_query (string sparql, UnixOutputStream output, Cancellable? cancellable, AsyncReadyCallback? callback) throws GLib.IOError {
-		var message = new DBusMessage.method_call (TRACKER_DBUS_SERVICE, TRACKER_DBUS_OBJECT_STEROIDS, TRACKER_DBUS_INTERFACE_STEROIDS, "Query");
+	internal void send_query (string sparql, Variant arguments, int format, UnixOutputStream output, Cancellable? cancellable, AsyncReadyCallback? callback) throws GLib.IOError {
+		// with arguments, the store keeps the translation of the
+		// query text and binds the arguments on every call
+		DBusMessage message;
 		var fd_list = new UnixFDList ();
-		message.set_body (new Variant ("(sh)", sparql, fd_list.append (output.fd)));
+		if (shared_results && format >= StreamCursor.RESULT_FORMAT_BLOCKS) {
+			// large results come back in a memory file with the reply
+			message = new DBusMessage.method_call (TRACKER_DBUS_SERVICE, TRACKER_DBUS_OBJECT_STEROIDS, TRACKER_DBUS_INTERFACE_STEROIDS, "SharedQuery");
+			message.set_body (new Variant ("(s@a{sv}h)", sparql, arguments, fd_list.append (output.fd)));
+		} else {
+			message = new DBusMessage.method_call (TRACKER_DBUS_SERVICE, TRACKER_DBUS_OBJECT_STEROIDS, TRACKER_DBUS_INTERFACE_STEROIDS, "StreamQuery");
+			message.set_body (new Variant ("(s@a{sv}ih)", sparql, arguments, format, fd_list.append (output.fd)));
+		}
 		message.set_unix_fd_list (fd_list);
 
 		bus.send_message_with_reply.begin (message, DBusSendMessageFlags.NONE, int.MAX, null, cancellable, callback);
@@ -65,48 +88,35 @@ public class Tracker.Bus.Connection : Tracker.Sparql.Connection {
 		var loop = new MainLoop (context, false);
 		context.push_thread_default ();
 		AsyncResult async_res = null;
-		query_async.begin (sparql, cancellable, (o, res) => {
+		query_internal_async.begin (sparql, null, cancellable, (o, res) => {
 			async_res = res;
 			loop.quit ();
 		});
 		loop.run ();
 		context.pop_thread_default ();
-		return query_async.end (async_res);
+		var cursor = query_internal_async.end (async_res);
+		cursor.sync = true;
+		return cursor;
 	}
 
 	public async override Sparql.Cursor query_async (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
-		UnixInputStream input;
-		UnixOutputStream output;
-		pipe (out input, out output);
-
-		// send D-Bus request
-		AsyncResult dbus_res = null;
-		bool received_result = false;
-		send_query (sparql, output, cancellable, (o, res) => {
-			dbus_res = res;
-			if (received_result) {
-				query_async.callback ();
-			}
-		});
-
-		output = null;
+		return yield query_internal_async (sparql, null, cancellable);
+	}
 
-		// receive query results via FD
-		var mem_stream = new MemoryOutputStream (null, GLib.realloc, GLib.free);
-		yield mem_stream.splice_async (input, OutputStreamSpliceFlags.CLOSE_SOURCE | OutputStreamSpliceFlags.CLOSE_TARGET, Priority.DEFAULT, cancellable);
+	public override Sparql.Statement? query_statement (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		return new Statement (this, sparql);
+	}
 
-		// wait for D-Bus reply
-		received_result = true;
-		if (dbus_res == null) {
-			yield;
+	internal async StreamCursor query_internal_async (string sparql, Variant? arguments, Cancellable? cancellable) throws Sparql.Error, IOError, DBusError {
+		if (arguments == null) {
+			arguments = new VariantBuilder (VariantType.VARDICT).end ();
 		}
 
-		var reply = bus.send_message_with_reply.end (dbus_res);
-		handle_error_reply (reply);
-
-		string[] variable_names = (string[]) reply.get_body ().get_child_value (0);
-		mem_stream.close ();
-		return new FDCursor (mem_stream.steal_data (), mem_stream.data_size, variable_names);
+		// results are read from the pipe as the cursor advances,
+		// starting as soon as the store sent the variable names
+		var cursor = new StreamCursor (this, sparql, arguments, result_format);
+		yield cursor.start_async (cancellable);
+		return cursor;
 	}
 
 	void send_update (string method, UnixInputStream input, Cancellable? cancellable, AsyncReadyCallback? callback) throws GLib.IOError {
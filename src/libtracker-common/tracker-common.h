@@ -37,6 +37,7 @@
 #include "tracker-language.h"
 #include "tracker-log.h"
 #include "tracker-media-art.h"
+#include "tracker-memfd.h"
 #include "tracker-ontologies.h"
 #include "tracker-os-dependant.h"
 #include "tracker-sched.h"
@@ -44,8 +44,37 @@
  *
  */
 
+#include "config.h"
+
+#include <string.h>
+
+#if defined (__aarch64__) && defined (HAVE_GETAUXVAL)
+#include <sys/auxv.h>
+#endif
+
 #include <libtracker-common/tracker-crc32.h>
 
+/* Checksums are computed with the fastest implementation the CPU has:
+ * CRC instructions on ARMv8 (both polynomials) and SSE 4.2 (CRC-32C
+ * only), or else slicing-by-8, 8 table lookups for 8 bytes at once.
+ */
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define HAVE_CRC32_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+#if defined (__aarch64__) && defined (__GNUC__) && defined (HAVE_GETAUXVAL) && defined (HWCAP_CRC32)
+#define HAVE_CRC32_ARMV8 1
+#include <arm_acle.h>
+#endif
+
+#define POLY_IEEE       0xEDB88320UL
+#define POLY_CASTAGNOLI 0x82F63B78UL
+
+typedef guint32 (* Crc32Func) (guint32       crc,
+                               const guint8 *bp,
+                               gsize         len);
+
 static const guint32 crcTable[256] = {
   0x00000000UL, 0x77073096UL, 0xEE0E612CUL, 0x990951BAUL, 0x076DC419UL, 0x706AF48FUL, 0xE963A535UL, 0x9E6495A3UL,
   0x0EDB8832UL, 0x79DCB8A4UL, 0xE0D5E91EUL, 0x97D2D988UL, 0x09B64C2BUL, 0x7EB17CBDUL, 0xE7B82D07UL, 0x90BF1D91UL,
@@ -81,15 +110,305 @@ static const guint32 crcTable[256] = {
   0xB3667A2EUL, 0xC4614AB8UL, 0x5D681B02UL, 0x2A6F2B94UL, 0xB40BBE37UL, 0xC30C8EA1UL, 0x5A05DF1BUL, 0x2D02EF8DUL
 };
 
-guint32
-tracker_crc32 (gconstpointer ptr, gsize len)
+static guint32 ieee_tables[8][256];
+static guint32 castagnoli_tables[8][256];
+
+static Crc32Func crc32_funcs[2];
+static TrackerCrc32Impl crc32_impls[2];
+
+static guint32
+crc32_table (const guint32  *table,
+             guint32         crc,
+             const guint8   *bp,
+             gsize           len)
 {
-  guint32 crc = 0xFFFFFFFF;
-  const guint8 *bp = (const guint8 *) ptr;
   size_t i;
 
   for (i=0; i<len; i++)
-    crc = crcTable[(crc ^ bp[i]) & 0xFF] ^ (crc >> 8);
+    crc = table[(crc ^ bp[i]) & 0xFF] ^ (crc >> 8);
+
+  return crc;
+}
+
+static guint32
+crc32_slicing_by_8 (const guint32 *tables[8],
+                    guint32        crc,
+                    const guint8  *bp,
+                    gsize          len)
+{
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  guint32 one, two;
+
+  /* align to read words */
+  while (len > 0 && ((gsize) bp & 7) != 0) {
+    crc = tables[0][(crc ^ *bp++) & 0xFF] ^ (crc >> 8);
+    len--;
+  }
+
+  while (len >= 8) {
+    memcpy (&one, bp, 4);
+    memcpy (&two, bp + 4, 4);
+    one ^= crc;
+
+    crc = tables[7][one & 0xFF] ^
+          tables[6][(one >> 8) & 0xFF] ^
+          tables[5][(one >> 16) & 0xFF] ^
+          tables[4][one >> 24] ^
+          tables[3][two & 0xFF] ^
+          tables[2][(two >> 8) & 0xFF] ^
+          tables[1][(two >> 16) & 0xFF] ^
+          tables[0][two >> 24];
+
+    bp += 8;
+    len -= 8;
+  }
+#endif
+
+  return crc32_table (tables[0], crc, bp, len);
+}
+
+static guint32
+crc32_ieee_table (guint32 crc, const guint8 *bp, gsize len)
+{
+  return crc32_table (crcTable, crc, bp, len);
+}
+
+static guint32
+crc32_ieee_slicing_by_8 (guint32 crc, const guint8 *bp, gsize len)
+{
+  const guint32 *tables[8] = {
+    ieee_tables[0], ieee_tables[1], ieee_tables[2], ieee_tables[3],
+    ieee_tables[4], ieee_tables[5], ieee_tables[6], ieee_tables[7]
+  };
+
+  return crc32_slicing_by_8 (tables, crc, bp, len);
+}
+
+static guint32
+crc32_castagnoli_table (guint32 crc, const guint8 *bp, gsize len)
+{
+  return crc32_table (castagnoli_tables[0], crc, bp, len);
+}
+
+static guint32
+crc32_castagnoli_slicing_by_8 (guint32 crc, const guint8 *bp, gsize len)
+{
+  const guint32 *tables[8] = {
+    castagnoli_tables[0], castagnoli_tables[1], castagnoli_tables[2], castagnoli_tables[3],
+    castagnoli_tables[4], castagnoli_tables[5], castagnoli_tables[6], castagnoli_tables[7]
+  };
+
+  return crc32_slicing_by_8 (tables, crc, bp, len);
+}
+
+#ifdef HAVE_CRC32_SSE42
+__attribute__ ((target ("sse4.2")))
+static guint32
+crc32_castagnoli_sse42 (guint32 crc, const guint8 *bp, gsize len)
+{
+  while (len > 0 && ((gsize) bp & 7) != 0) {
+    crc = _mm_crc32_u8 (crc, *bp++);
+    len--;
+  }
+
+#ifdef __x86_64__
+  while (len >= 8) {
+    guint64 word;
+
+    memcpy (&word, bp, 8);
+    crc = (guint32) _mm_crc32_u64 (crc, word);
+    bp += 8;
+    len -= 8;
+  }
+#endif
+
+  while (len >= 4) {
+    guint32 word;
+
+    memcpy (&word, bp, 4);
+    crc = _mm_crc32_u32 (crc, word);
+    bp += 4;
+    len -= 4;
+  }
+
+  while (len > 0) {
+    crc = _mm_crc32_u8 (crc, *bp++);
+    len--;
+  }
+
+  return crc;
+}
+#endif /* HAVE_CRC32_SSE42 */
+
+#ifdef HAVE_CRC32_ARMV8
+#define DEFINE_CRC32_ARMV8(name, b, d)                  \
+__attribute__ ((target ("+crc")))                       \
+static guint32                                          \
+name (guint32 crc, const guint8 *bp, gsize len)         \
+{                                                       \
+  while (len > 0 && ((gsize) bp & 7) != 0) {            \
+    crc = b (crc, *bp++);                               \
+    len--;                                              \
+  }                                                     \
+                                                        \
+  while (len >= 8) {                                    \
+    guint64 word;                                       \
+                                                        \
+    memcpy (&word, bp, 8);                              \
+    crc = d (crc, word);                                \
+    bp += 8;                                            \
+    len -= 8;                                           \
+  }                                                     \
+                                                        \
+  while (len > 0) {                                     \
+    crc = b (crc, *bp++);                               \
+    len--;                                              \
+  }                                                     \
+                                                        \
+  return crc;                                           \
+}
+
+DEFINE_CRC32_ARMV8 (crc32_ieee_armv8, __crc32b, __crc32d)
+DEFINE_CRC32_ARMV8 (crc32_castagnoli_armv8, __crc32cb, __crc32cd)
+#endif /* HAVE_CRC32_ARMV8 */
+
+static gboolean
+crc32_has_hardware (TrackerCrc32Type type)
+{
+#ifdef HAVE_CRC32_SSE42
+  if (type == TRACKER_CRC32_CASTAGNOLI) {
+    __builtin_cpu_init ();
+    return __builtin_cpu_supports ("sse4.2");
+  }
+#endif
+
+#ifdef HAVE_CRC32_ARMV8
+  return (getauxval (AT_HWCAP) & HWCAP_CRC32) != 0;
+#endif
+
+  return FALSE;
+}
+
+static void
+crc32_init_tables (guint32 tables[8][256],
+                   guint32 poly)
+{
+  guint32 crc, i;
+  gint j;
+
+  for (i = 0; i < 256; i++) {
+    crc = i;
+    for (j = 0; j < 8; j++)
+      crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+    tables[0][i] = crc;
+  }
+
+  /* each table is the previous one followed by a zero byte */
+  for (i = 0; i < 256; i++) {
+    crc = tables[0][i];
+    for (j = 1; j < 8; j++) {
+      crc = (crc >> 8) ^ tables[0][crc & 0xFF];
+      tables[j][i] = crc;
+    }
+  }
+}
+
+static gboolean
+crc32_set_impl (TrackerCrc32Type type,
+                TrackerCrc32Impl impl)
+{
+  Crc32Func func = NULL;
+
+  switch (impl) {
+  case TRACKER_CRC32_IMPL_TABLE:
+    func = type == TRACKER_CRC32_IEEE ? crc32_ieee_table : crc32_castagnoli_table;
+    break;
+  case TRACKER_CRC32_IMPL_SLICING_BY_8:
+    func = type == TRACKER_CRC32_IEEE ? crc32_ieee_slicing_by_8 : crc32_castagnoli_slicing_by_8;
+    break;
+  case TRACKER_CRC32_IMPL_HARDWARE:
+    if (!crc32_has_hardware (type))
+      return FALSE;
+#ifdef HAVE_CRC32_ARMV8
+    func = type == TRACKER_CRC32_IEEE ? crc32_ieee_armv8 : crc32_castagnoli_armv8;
+#elif defined (HAVE_CRC32_SSE42)
+    func = crc32_castagnoli_sse42;
+#endif
+    break;
+  }
+
+  g_return_val_if_fail (func != NULL, FALSE);
+
+  crc32_funcs[type] = func;
+  crc32_impls[type] = impl;
+
+  return TRUE;
+}
+
+static void
+crc32_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    crc32_init_tables (ieee_tables, POLY_IEEE);
+    crc32_init_tables (castagnoli_tables, POLY_CASTAGNOLI);
+
+    if (!crc32_set_impl (TRACKER_CRC32_IEEE, TRACKER_CRC32_IMPL_HARDWARE))
+      crc32_set_impl (TRACKER_CRC32_IEEE, TRACKER_CRC32_IMPL_SLICING_BY_8);
+
+    if (!crc32_set_impl (TRACKER_CRC32_CASTAGNOLI, TRACKER_CRC32_IMPL_HARDWARE))
+      crc32_set_impl (TRACKER_CRC32_CASTAGNOLI, TRACKER_CRC32_IMPL_SLICING_BY_8);
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+/**
+ * tracker_crc32_set_impl:
+ * @type: the CRC
+ * @impl: how to compute it
+ *
+ * Makes @type be computed with @impl, for tests and benchmarks.
+ *
+ * Returns: %FALSE if the CPU can't do @impl, nothing is changed then.
+ */
+gboolean
+tracker_crc32_set_impl (TrackerCrc32Type type,
+                        TrackerCrc32Impl impl)
+{
+  crc32_init ();
+
+  return crc32_set_impl (type, impl);
+}
+
+TrackerCrc32Impl
+tracker_crc32_get_impl (TrackerCrc32Type type)
+{
+  crc32_init ();
+
+  return crc32_impls[type];
+}
+
+guint32
+tracker_crc32 (gconstpointer ptr, gsize len)
+{
+  crc32_init ();
+
+  return crc32_funcs[TRACKER_CRC32_IEEE] (0xFFFFFFFF, ptr, len) ^ 0xFFFFFFFF;
+}
+
+/**
+ * tracker_crc32c:
+ * @ptr: the data
+ * @len: the length of @ptr
+ *
+ * Returns: the CRC-32C (Castagnoli) of @ptr, which SSE 4.2 computes.
+ */
+guint32
+tracker_crc32c (gconstpointer ptr, gsize len)
+{
+  crc32_init ();
 
-  return crc ^ 0xFFFFFFFF;
+  return crc32_funcs[TRACKER_CRC32_CASTAGNOLI] (0xFFFFFFFF, ptr, len) ^ 0xFFFFFFFF;
 }
@@ -46,4 +46,22 @@
 
 #include <glib.h>
 
+typedef enum {
+	/* CRC-32 as in zlib, journal format 04 */
+	TRACKER_CRC32_IEEE,
+	/* CRC-32C as in SSE 4.2, journal format 05 */
+	TRACKER_CRC32_CASTAGNOLI
+} TrackerCrc32Type;
+
+typedef enum {
+	TRACKER_CRC32_IMPL_TABLE,
+	TRACKER_CRC32_IMPL_SLICING_BY_8,
+	TRACKER_CRC32_IMPL_HARDWARE
+} TrackerCrc32Impl;
+
 guint32 tracker_crc32 (gconstpointer ptr, gsize len);
+guint32 tracker_crc32c (gconstpointer ptr, gsize len);
+
+TrackerCrc32Impl tracker_crc32_get_impl (TrackerCrc32Type type);
+gboolean         tracker_crc32_set_impl (TrackerCrc32Type type,
+                                         TrackerCrc32Impl impl);
@@ -289,6 +289,100 @@ tracker_file_get_mime_type (GFile *file)
 	return content_type ? content_type : g_strdup ("unknown");
 }
 
+static gboolean
+fingerprint_update (GChecksum     *checksum,
+                    GInputStream  *stream,
+                    gsize          count,
+                    GCancellable  *cancellable,
+                    GError       **error)
+{
+	guchar buffer[8192];
+
+	while (count > 0) {
+		gssize n_read;
+
+		n_read = g_input_stream_read (stream, buffer,
+		                              MIN (count, sizeof (buffer)),
+		                              cancellable, error);
+		if (n_read < 0) {
+			return FALSE;
+		} else if (n_read == 0) {
+			/* Truncated under our feet */
+			break;
+		}
+
+		g_checksum_update (checksum, buffer, n_read);
+		count -= n_read;
+	}
+
+	return TRUE;
+}
+
+/* Cheap fingerprint of the contents of a file, made of its size and
+ * a hash of its first and last blocks, so copies of the same file on
+ * different volumes can be spotted without reading them whole.
+ */
+gchar *
+tracker_file_get_content_fingerprint (GFile         *file,
+                                      GCancellable  *cancellable,
+                                      GError       **error)
+{
+	GFileInputStream *stream;
+	GFileInfo *info;
+	GChecksum *checksum;
+	goffset size;
+	gchar *fingerprint = NULL;
+	gboolean success;
+
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	stream = g_file_read (file, cancellable, error);
+	if (!stream) {
+		return NULL;
+	}
+
+	info = g_file_input_stream_query_info (stream,
+	                                       G_FILE_ATTRIBUTE_STANDARD_SIZE,
+	                                       cancellable, error);
+	if (!info) {
+		g_object_unref (stream);
+		return NULL;
+	}
+
+	size = g_file_info_get_size (info);
+	g_object_unref (info);
+
+	checksum = g_checksum_new (G_CHECKSUM_MD5);
+
+	success = fingerprint_update (checksum, G_INPUT_STREAM (stream),
+	                              MIN (size, TRACKER_FILE_FINGERPRINT_BLOCK),
+	                              cancellable, error);
+
+	if (success && size > TRACKER_FILE_FINGERPRINT_BLOCK) {
+		goffset tail;
+
+		/* Don't hash the overlap twice on files smaller than both blocks */
+		tail = MAX (TRACKER_FILE_FINGERPRINT_BLOCK, size - TRACKER_FILE_FINGERPRINT_BLOCK);
+
+		success = g_seekable_seek (G_SEEKABLE (stream), tail, G_SEEK_SET,
+		                           cancellable, error) &&
+		          fingerprint_update (checksum, G_INPUT_STREAM (stream),
+		                              size - tail, cancellable, error);
+	}
+
+	if (success) {
+		fingerprint = g_strdup_printf ("%" G_GINT64_FORMAT "-%s",
+		                               (gint64) size,
+		                               g_checksum_get_string (checksum));
+	}
+
+	g_checksum_free (checksum);
+	g_input_stream_close (G_INPUT_STREAM (stream), NULL, NULL);
+	g_object_unref (stream);
+
+	return fingerprint;
+}
+
 #ifdef __linux__
 
 #ifdef __USE_LARGEFILE64
@@ -31,6 +31,9 @@ G_BEGIN_DECLS
 #error "only <libtracker-common/tracker-common.h> must be included directly."
 #endif
 
+/* Size of the head and tail blocks hashed for content fingerprints */
+#define TRACKER_FILE_FINGERPRINT_BLOCK (64 * 1024)
+
 /* File utils */
 int      tracker_file_open_fd                               (const gchar *path);
 FILE*    tracker_file_open                                  (const gchar *path);
@@ -40,6 +43,9 @@ goffset  tracker_file_get_size                              (const gchar *path);
 guint64  tracker_file_get_mtime                             (const gchar *path);
 guint64  tracker_file_get_mtime_uri                         (const gchar *uri);
 gchar *  tracker_file_get_mime_type                         (GFile       *file);
+gchar *  tracker_file_get_content_fingerprint               (GFile         *file,
+                                                             GCancellable  *cancellable,
+                                                             GError       **error);
 gboolean tracker_file_lock                                  (GFile       *file);
 gboolean tracker_file_unlock                                (GFile       *file);
 gboolean tracker_file_is_locked                             (GFile       *file);
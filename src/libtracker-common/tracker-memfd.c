@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <glib.h>
+
+#include "tracker-memfd.h"
+
+/* Older C libraries know nothing about memfds, the kernel ABI is
+ * stable though.
+ */
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC       0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS       1033
+#define F_GET_SEALS       1034
+#endif
+#ifndef F_SEAL_SHRINK
+#define F_SEAL_SEAL       0x0001
+#define F_SEAL_SHRINK     0x0002
+#define F_SEAL_GROW       0x0004
+#define F_SEAL_WRITE      0x0008
+#endif
+
+#define TRACKER_MEMFD_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+
+/*
+ * tracker_memfd_create:
+ * @name: name of the file, only used for debugging
+ *
+ * Creates an anonymous file in memory which can be sealed with
+ * tracker_memfd_seal() once written.
+ *
+ * Returns: the file descriptor, or -1 if memfds are not supported,
+ * with errno set.
+ */
+gint
+tracker_memfd_create (const gchar *name)
+{
+#if defined (HAVE_MEMFD_CREATE)
+	return memfd_create (name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#elif defined (__NR_memfd_create)
+	return syscall (__NR_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ * tracker_memfd_seal:
+ * @fd: a file descriptor returned by tracker_memfd_create()
+ *
+ * Seals @fd so its contents and size can't change anymore, and
+ * readers can map it without worrying about it being truncated
+ * under their feet. The file can't be sealed while it has shared
+ * writable mappings.
+ *
+ * Returns: %TRUE if @fd was sealed.
+ */
+gboolean
+tracker_memfd_seal (gint fd)
+{
+	if (fcntl (fd, F_ADD_SEALS, TRACKER_MEMFD_SEALS | F_SEAL_SEAL) < 0) {
+		g_warning ("Could not seal memory file, %s", g_strerror (errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * tracker_memfd_is_sealed:
+ * @fd: a file descriptor
+ *
+ * Checks that @fd is a memfd sealed by tracker_memfd_seal().
+ *
+ * Returns: %TRUE if @fd can be safely mapped.
+ */
+gboolean
+tracker_memfd_is_sealed (gint fd)
+{
+	gint seals;
+
+	seals = fcntl (fd, F_GET_SEALS);
+
+	return seals >= 0 && (seals & TRACKER_MEMFD_SEALS) == TRACKER_MEMFD_SEALS;
+}
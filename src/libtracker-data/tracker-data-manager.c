@@ -3466,6 +3466,60 @@ tracker_data_manager_recreate_indexes (TrackerBusyCallback    busy_callback,
 	g_debug ("  Finished index re-creation...");
 }
 
+#ifndef DISABLE_JOURNAL
+
+/* Indexes on single value properties are only used by queries,
+ * journal replay fills the tables faster without them */
+static void
+tracker_data_manager_set_value_indexes (gboolean              recreate,
+                                        TrackerBusyCallback   busy_callback,
+                                        gpointer              busy_user_data,
+                                        const gchar          *busy_status)
+{
+	GError *internal_error = NULL;
+	TrackerDBInterface *iface;
+	TrackerProperty **properties;
+	guint n_properties;
+	guint i;
+
+	properties = tracker_ontologies_get_properties (&n_properties);
+	if (!properties) {
+		g_critical ("Couldn't get all properties to %s indexes",
+		            recreate ? "create" : "drop");
+		return;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+	tracker_db_interface_execute_query (iface, NULL, "PRAGMA cache_size = %d", TRACKER_DB_CACHE_SIZE_REPLAY);
+
+	for (i = 0; i < n_properties; i++) {
+		if (tracker_property_get_multiple_values (properties[i])) {
+			/* needed for lookups by ID and unique values */
+			continue;
+		}
+
+		fix_indexed (properties[i], recreate, &internal_error);
+
+		if (internal_error) {
+			g_critical ("Unable to %s index for %s: %s",
+			            recreate ? "create" : "drop",
+			            tracker_property_get_name (properties[i]),
+			            internal_error->message);
+			g_clear_error (&internal_error);
+		}
+
+		if (recreate && busy_callback) {
+			busy_callback (busy_status,
+			               (gdouble) ((gdouble) i / (gdouble) n_properties),
+			               busy_user_data);
+		}
+	}
+
+	tracker_db_interface_execute_query (iface, NULL, "PRAGMA cache_size = %d", TRACKER_DB_CACHE_SIZE_DEFAULT);
+}
+
+#endif /* DISABLE_JOURNAL */
+
 gboolean
 tracker_data_manager_reload (TrackerBusyCallback   busy_callback,
                              gpointer              busy_user_data,
@@ -3666,6 +3720,13 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 		return TRUE;
 	}
 
+	/* Translations are only valid for the ontology they were made
+	 * with, which may change while initializing.
+	 */
+	tracker_sparql_query_clear_cache ();
+	tracker_data_update_clear_plans ();
+	tracker_data_update_reset_resource_cache (FALSE);
+
 	/* Make sure we initialize all other modules we depend on */
 	tracker_ontologies_init ();
 
@@ -4480,6 +4541,18 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 
 #ifndef DISABLE_JOURNAL
 	if (read_journal) {
+		gboolean bulk_replay;
+
+		bulk_replay = tracker_data_update_get_bulk_replay ();
+
+		if (bulk_replay) {
+			/* Created again once the journal is replayed, or on
+			 * the next start if replay doesn't get that far.
+			 */
+			tracker_db_manager_set_indexes_pending (TRUE);
+			tracker_data_manager_set_value_indexes (FALSE, NULL, NULL, NULL);
+		}
+
 		/* Report OPERATION - STATUS */
 		busy_status = g_strdup_printf ("%s - %s",
 		                               busy_operation,
@@ -4491,6 +4564,20 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 		                             &internal_error);
 		g_free (busy_status);
 
+		if (bulk_replay && !internal_error) {
+			/* Report OPERATION - STATUS */
+			busy_status = g_strdup_printf ("%s - %s",
+			                               busy_operation,
+			                               "Creating indexes");
+			tracker_data_manager_set_value_indexes (TRUE,
+			                                        busy_callback,
+			                                        busy_user_data,
+			                                        busy_status);
+			g_free (busy_status);
+
+			tracker_db_manager_set_indexes_pending (FALSE);
+		}
+
 		if (internal_error) {
 
 			if (g_error_matches (internal_error, TRACKER_DB_INTERFACE_ERROR, TRACKER_DB_NO_SPACE)) {
@@ -4542,6 +4629,20 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 		}
 
 		g_hash_table_unref (uri_id_map);
+	} else if (!read_only && tracker_db_manager_get_indexes_pending ()) {
+		/* A bulk replay failed or was killed before creating
+		 * the indexes it dropped.
+		 */
+		busy_status = g_strdup_printf ("%s - %s",
+		                               busy_operation,
+		                               "Creating indexes");
+		tracker_data_manager_set_value_indexes (TRUE,
+		                                        busy_callback,
+		                                        busy_user_data,
+		                                        busy_status);
+		g_free (busy_status);
+
+		tracker_db_manager_set_indexes_pending (FALSE);
 	}
 #endif /* DISABLE_JOURNAL */
 
@@ -4583,6 +4684,27 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 		tracker_ontologies_sort ();
 	}
 
+	/* Volume databases are checked against the final ontology,
+	 * on a new database they're stale, their contents will be
+	 * indexed again.
+	 */
+	tracker_db_manager_load_volumes (is_first_time_index);
+
+	tracker_sparql_query_clear_cache ();
+	tracker_data_update_clear_plans ();
+
+	/* Ontologies and the journal are done storing resources on
+	 * their own, new ones can be looked up in a filter from now.
+	 */
+	tracker_data_update_reset_resource_cache (TRUE);
+
+	/* Built while starting up, as the first update would otherwise
+	 * wait for it to read every stored URI.
+	 */
+	if (!read_only) {
+		tracker_data_update_build_resource_filter ();
+	}
+
 	initialized = TRUE;
 
 	g_free (ontologies_dir);
@@ -4616,6 +4738,9 @@ tracker_data_manager_shutdown (void)
 	}
 #endif /* DISABLE_JOURNAL */
 
+	tracker_sparql_query_clear_cache ();
+	tracker_data_update_clear_plans ();
+
 	tracker_db_manager_shutdown ();
 	tracker_ontologies_shutdown ();
 	if (!reloading) {
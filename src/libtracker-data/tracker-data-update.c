@@ -40,6 +40,7 @@
 #include "tracker-db-journal.h"
 #include "tracker-ontologies.h"
 #include "tracker-property.h"
+#include "tracker-resource-cache.h"
 #include "tracker-sparql-query.h"
 
 #define RDF_PREFIX TRACKER_RDF_PREFIX
@@ -51,6 +52,12 @@
 #define RDF_PROPERTY RDF_PREFIX "Property"
 #define RDF_TYPE RDF_PREFIX "type"
 
+/* bytes taken by cached resource IDs at most */
+#define TRACKER_DATA_RESOURCE_CACHE_SIZE (4 * 1024 * 1024)
+
+/* resource ID -> database mappings cached at most */
+#define TRACKER_DATA_RESOURCE_SCHEMA_CACHE_SIZE 10000
+
 typedef struct _TrackerDataUpdateBuffer TrackerDataUpdateBuffer;
 typedef struct _TrackerDataUpdateBufferResource TrackerDataUpdateBufferResource;
 typedef struct _TrackerDataUpdateBufferPredicate TrackerDataUpdateBufferPredicate;
@@ -61,8 +68,8 @@ typedef struct _TrackerStatementDelegate TrackerStatementDelegate;
 typedef struct _TrackerCommitDelegate TrackerCommitDelegate;
 
 struct _TrackerDataUpdateBuffer {
-	/* string -> integer */
-	GHashTable *resource_cache;
+	/* string -> integer, kept between transactions */
+	TrackerResourceCache *resource_cache;
 	/* string -> TrackerDataUpdateBufferResource */
 	GHashTable *resources;
 	/* integer -> TrackerDataUpdateBufferResource */
@@ -88,6 +95,10 @@ struct _TrackerDataUpdateBufferResource {
 	GHashTable *tables;
 	/* TrackerClass */
 	GPtrArray *types;
+	/* database the rows of this resource are stored in */
+	const gchar *schema;
+	/* whether there are rows for this resource already */
+	gboolean stored;
 
 #if HAVE_TRACKER_FTS
 	gboolean fts_updated;
@@ -149,6 +160,8 @@ typedef struct {
 static gboolean in_transaction = FALSE;
 static gboolean in_ontology_transaction = FALSE;
 static gboolean in_journal_replay = FALSE;
+/* whether journal replay commits many journal transactions together */
+static gboolean bulk_replay = TRUE;
 static TrackerDataUpdateBuffer update_buffer;
 /* current resource */
 static TrackerDataUpdateBufferResource *resource_buffer;
@@ -162,6 +175,15 @@ static GPtrArray *delete_callbacks = NULL;
 static GPtrArray *commit_callbacks = NULL;
 static GPtrArray *rollback_callbacks = NULL;
 static gint max_service_id = 0;
+/* whether all URIs stored in the Resource table go through
+ * ensure_resource_id(), so the resource cache can filter new ones
+ */
+static gboolean resource_filter_enabled = FALSE;
+/* resource ID -> interned name of the database holding its rows,
+ * for the volume databases generation it was filled in
+ */
+static GHashTable *resource_schemas = NULL;
+static gint resource_schemas_generation = 0;
 static gint max_ontology_id = 0;
 
 static gint         ensure_resource_id         (const gchar      *uri,
@@ -465,11 +487,55 @@ tracker_data_update_get_next_modseq (void)
 void
 tracker_data_update_shutdown (void)
 {
+	tracker_data_update_reset_resource_cache (FALSE);
+
+	if (resource_schemas) {
+		g_hash_table_unref (resource_schemas);
+		resource_schemas = NULL;
+	}
+
 	max_service_id = 0;
 	max_ontology_id = 0;
 	transaction_modseq = 0;
 }
 
+/**
+ * tracker_data_update_reset_resource_cache:
+ * @use_filter: whether URIs are only stored in the Resource table by
+ * updates from now on, so new ones can be told apart without a query
+ *
+ * Forgets the cached IDs of resources, and the filter of stored ones.
+ */
+void
+tracker_data_update_reset_resource_cache (gboolean use_filter)
+{
+	TrackerResourceCacheStats stats;
+
+	if (update_buffer.resource_cache) {
+		tracker_resource_cache_get_stats (update_buffer.resource_cache, &stats);
+		g_debug ("Resource cache: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses, "
+		         "%" G_GUINT64_FORMAT " filtered, %" G_GUINT64_FORMAT " false positives, "
+		         "%" G_GUINT64_FORMAT " evictions",
+		         stats.hits, stats.misses, stats.filtered,
+		         stats.false_positives, stats.evictions);
+
+		tracker_resource_cache_clear (update_buffer.resource_cache);
+		tracker_resource_cache_drop_filter (update_buffer.resource_cache);
+	}
+
+	resource_filter_enabled = use_filter;
+}
+
+void
+tracker_data_update_get_resource_cache_stats (TrackerResourceCacheStats *stats)
+{
+	if (update_buffer.resource_cache) {
+		tracker_resource_cache_get_stats (update_buffer.resource_cache, stats);
+	} else {
+		memset (stats, 0, sizeof (TrackerResourceCacheStats));
+	}
+}
+
 static gint
 get_transaction_modseq (void)
 {
@@ -616,19 +682,111 @@ cache_delete_value (const gchar            *table_name,
 	g_array_append_val (table->properties, property);
 }
 
+static void
+resource_filter_build (void)
+{
+	TrackerDBInterface *iface;
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	GError *error = NULL;
+	GTimer *timer;
+	guint n_uris = 0;
+
+	timer = g_timer_new ();
+	iface = tracker_db_manager_get_db_interface ();
+
+	/* IDs only grow, the highest one bounds the number of URIs and
+	 * is found in the primary key without counting the table.
+	 */
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &error,
+	                                              "SELECT MAX(ID) FROM Resource");
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &error);
+		g_object_unref (stmt);
+	}
+
+	if (cursor) {
+		if (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+			n_uris = tracker_db_cursor_get_int (cursor, 0);
+		}
+
+		g_object_unref (cursor);
+		cursor = NULL;
+	}
+
+	if (!error) {
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &error,
+		                                              "SELECT Uri FROM Resource");
+
+		if (stmt) {
+			cursor = tracker_db_statement_start_cursor (stmt, &error);
+			g_object_unref (stmt);
+		}
+	}
+
+	if (cursor) {
+		tracker_resource_cache_set_filter (update_buffer.resource_cache, n_uris);
+
+		while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+			tracker_resource_cache_filter_add (update_buffer.resource_cache,
+			                                   tracker_db_cursor_get_string (cursor, 0, NULL));
+		}
+
+		g_object_unref (cursor);
+	}
+
+	if (G_UNLIKELY (error)) {
+		g_warning ("Could not build filter of stored resources: %s", error->message);
+		g_error_free (error);
+
+		/* don't try again for every resource */
+		tracker_resource_cache_drop_filter (update_buffer.resource_cache);
+		resource_filter_enabled = FALSE;
+	} else {
+		g_debug ("Built filter of %u stored resources in %.3f seconds",
+		         n_uris, g_timer_elapsed (timer, NULL));
+	}
+
+	g_timer_destroy (timer);
+}
+
+/**
+ * tracker_data_update_build_resource_filter:
+ *
+ * Builds the filter of stored resources now, if it is used, rather
+ * than on the first update looking up a resource.
+ */
+void
+tracker_data_update_build_resource_filter (void)
+{
+	if (!resource_filter_enabled) {
+		return;
+	}
+
+	/* no transaction may have happened yet */
+	if (update_buffer.resource_cache == NULL) {
+		update_buffer.resource_cache = tracker_resource_cache_new (TRACKER_DATA_RESOURCE_CACHE_SIZE);
+	}
+
+	if (!tracker_resource_cache_has_filter (update_buffer.resource_cache)) {
+		resource_filter_build ();
+	}
+}
+
 static gint
 query_resource_id (const gchar *uri)
 {
 	gint id;
 
-	id = GPOINTER_TO_INT (g_hash_table_lookup (update_buffer.resource_cache, uri));
+	if (resource_filter_enabled && !in_ontology_transaction && !in_journal_replay &&
+	    !tracker_resource_cache_has_filter (update_buffer.resource_cache)) {
+		resource_filter_build ();
+	}
 
-	if (id == 0) {
+	if (!tracker_resource_cache_lookup (update_buffer.resource_cache, uri, &id)) {
 		id = tracker_data_query_resource_id (uri);
-
-		if (id) {
-			g_hash_table_insert (update_buffer.resource_cache, g_strdup (uri), GINT_TO_POINTER (id));
-		}
+		tracker_resource_cache_queried (update_buffer.resource_cache, uri, id);
 	}
 
 	return id;
@@ -674,7 +832,7 @@ ensure_resource_id (const gchar *uri,
 		}
 #endif /* DISABLE_JOURNAL */
 
-		g_hash_table_insert (update_buffer.resource_cache, g_strdup (uri), GINT_TO_POINTER (id));
+		tracker_resource_cache_insert (update_buffer.resource_cache, uri, id);
 	}
 
 	return id;
@@ -728,6 +886,444 @@ add_class_count (TrackerClass *class,
 	                     GINT_TO_POINTER (old_count_entry + count));
 }
 
+/* Statements writing the rows of a table, or values of a multiple
+ * value table, are kept as plans, by the columns they write. Columns
+ * get an index, in the order they are first seen in each table, and
+ * a plan is found by the bitmask of those indexes, so flushing a
+ * resource needs no SQL formatting nor looking it up by text.
+ */
+#define PLAN_MASK_WORDS 4
+#define PLAN_MAX_COLUMNS (PLAN_MASK_WORDS * 64)
+
+typedef enum {
+	PLAN_INSERT_ROW,
+	PLAN_UPDATE_ROW,
+	PLAN_INSERT_VALUE,
+	PLAN_DELETE_VALUE
+} TrackerDataPlanKind;
+
+typedef struct {
+	const gchar *schema;
+	TrackerDataPlanKind kind;
+	guint64 mask[PLAN_MASK_WORDS];
+} TrackerDataPlanKey;
+
+typedef struct {
+	TrackerDataPlanKey key;
+	gchar *schema;
+	TrackerDBStatement *stmt;
+} TrackerDataPlan;
+
+typedef struct {
+	/* property name -> column index + 1 */
+	GHashTable *columns;
+	gint n_columns;
+	/* TrackerDataPlanKey -> TrackerDataPlan */
+	GHashTable *plans;
+} TrackerDataTablePlans;
+
+typedef struct {
+	gint column;
+	TrackerDataUpdateBufferProperty *property;
+} TrackerDataPlanColumn;
+
+/* table name -> TrackerDataTablePlans */
+static GHashTable *table_plans = NULL;
+/* plans are only valid for the connection they were prepared on */
+static TrackerDBInterface *plans_iface = NULL;
+/* properties of the row being flushed, in column order */
+static GArray *plan_columns = NULL;
+/* for tests, not reset when plans are dropped */
+static guint plan_hits = 0;
+static guint plan_misses = 0;
+static guint plan_uncacheable = 0;
+
+static guint
+plan_key_hash (gconstpointer data)
+{
+	const TrackerDataPlanKey *key = data;
+	guint64 hash = key->kind;
+	gint i;
+
+	for (i = 0; i < PLAN_MASK_WORDS; i++) {
+		hash = hash * 31 + key->mask[i];
+	}
+
+	return (guint) (hash ^ (hash >> 32)) ^ g_str_hash (key->schema);
+}
+
+static gboolean
+plan_key_equal (gconstpointer a,
+                gconstpointer b)
+{
+	const TrackerDataPlanKey *key_a = a;
+	const TrackerDataPlanKey *key_b = b;
+
+	return key_a->kind == key_b->kind &&
+	       memcmp (key_a->mask, key_b->mask, sizeof (key_a->mask)) == 0 &&
+	       strcmp (key_a->schema, key_b->schema) == 0;
+}
+
+static void
+plan_free (TrackerDataPlan *plan)
+{
+	g_object_unref (plan->stmt);
+	g_free (plan->schema);
+	g_slice_free (TrackerDataPlan, plan);
+}
+
+static void
+table_plans_free (TrackerDataTablePlans *plans)
+{
+	g_hash_table_unref (plans->columns);
+	g_hash_table_unref (plans->plans);
+	g_slice_free (TrackerDataTablePlans, plans);
+}
+
+/**
+ * tracker_data_update_clear_plans:
+ *
+ * Drops the statements kept to write resources, which are only valid
+ * for the current ontology and database connection.
+ */
+void
+tracker_data_update_clear_plans (void)
+{
+	if (table_plans) {
+		g_hash_table_unref (table_plans);
+		table_plans = NULL;
+	}
+
+	if (plans_iface) {
+		g_object_unref (plans_iface);
+		plans_iface = NULL;
+	}
+}
+
+/**
+ * tracker_data_update_get_plan_statistics:
+ * @size: (out): number of plans kept
+ * @hits: (out): statements found in a plan
+ * @misses: (out): plans made
+ * @uncacheable: (out): statements made without a plan
+ *
+ * Tells how the statements writing resources were found, the counts
+ * are kept when plans are dropped.
+ */
+void
+tracker_data_update_get_plan_statistics (guint *size,
+                                         guint *hits,
+                                         guint *misses,
+                                         guint *uncacheable)
+{
+	GHashTableIter iter;
+	TrackerDataTablePlans *plans;
+
+	*size = 0;
+
+	if (table_plans) {
+		g_hash_table_iter_init (&iter, table_plans);
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &plans)) {
+			*size += g_hash_table_size (plans->plans);
+		}
+	}
+
+	*hits = plan_hits;
+	*misses = plan_misses;
+	*uncacheable = plan_uncacheable;
+}
+
+static TrackerDataTablePlans *
+table_plans_get (TrackerDBInterface *iface,
+                 const gchar        *table_name)
+{
+	TrackerDataTablePlans *plans;
+
+	if (iface != plans_iface) {
+		tracker_data_update_clear_plans ();
+		plans_iface = g_object_ref (iface);
+	}
+
+	if (!table_plans) {
+		table_plans = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) table_plans_free);
+	}
+
+	plans = g_hash_table_lookup (table_plans, table_name);
+
+	if (!plans) {
+		plans = g_slice_new0 (TrackerDataTablePlans);
+		plans->columns = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		plans->plans = g_hash_table_new_full (plan_key_hash, plan_key_equal, NULL, (GDestroyNotify) plan_free);
+		g_hash_table_insert (table_plans, g_strdup (table_name), plans);
+	}
+
+	return plans;
+}
+
+static gint
+table_plans_get_column (TrackerDataTablePlans *plans,
+                        const gchar           *name)
+{
+	gint column;
+
+	column = GPOINTER_TO_INT (g_hash_table_lookup (plans->columns, name)) - 1;
+
+	if (column < 0) {
+		column = plans->n_columns++;
+		g_hash_table_insert (plans->columns, g_strdup (name), GINT_TO_POINTER (column + 1));
+	}
+
+	return column;
+}
+
+/* Puts @n_properties properties of @properties, from @first, into
+ * plan_columns, sorted by column, and sets the key of the plan writing
+ * them. Returns FALSE if no plan can be made, with a property written
+ * twice or too many columns, plan_columns is then in buffer order.
+ */
+static gboolean
+plan_key_init (TrackerDataPlanKey    *key,
+               TrackerDataTablePlans *plans,
+               TrackerDataPlanKind    kind,
+               const gchar           *schema,
+               GArray                *properties,
+               guint                  first,
+               guint                  n_properties)
+{
+	TrackerDataPlanColumn column;
+	gboolean sorted = TRUE;
+	guint i, j;
+
+	memset (key, 0, sizeof (TrackerDataPlanKey));
+	key->schema = schema;
+	key->kind = kind;
+
+	if (!plan_columns) {
+		plan_columns = g_array_new (FALSE, FALSE, sizeof (TrackerDataPlanColumn));
+	}
+
+	g_array_set_size (plan_columns, n_properties);
+
+	for (i = 0; i < n_properties; i++) {
+		column.property = &g_array_index (properties, TrackerDataUpdateBufferProperty, first + i);
+		column.column = table_plans_get_column (plans, column.property->name);
+		g_array_index (plan_columns, TrackerDataPlanColumn, i) = column;
+
+		if (column.column >= PLAN_MAX_COLUMNS ||
+		    key->mask[column.column / 64] & (G_GUINT64_CONSTANT (1) << (column.column % 64))) {
+			sorted = FALSE;
+		} else {
+			key->mask[column.column / 64] |= G_GUINT64_CONSTANT (1) << (column.column % 64);
+		}
+	}
+
+	if (!sorted) {
+		return FALSE;
+	}
+
+	/* rows have few properties, insertion sort will do */
+	for (i = 1; i < n_properties; i++) {
+		column = g_array_index (plan_columns, TrackerDataPlanColumn, i);
+
+		for (j = i; j > 0 && g_array_index (plan_columns, TrackerDataPlanColumn, j - 1).column > column.column; j--) {
+			g_array_index (plan_columns, TrackerDataPlanColumn, j) = g_array_index (plan_columns, TrackerDataPlanColumn, j - 1);
+		}
+
+		g_array_index (plan_columns, TrackerDataPlanColumn, j) = column;
+	}
+
+	return TRUE;
+}
+
+static TrackerDBStatement *
+row_statement_new (TrackerDBInterface               *iface,
+                   TrackerDBStatementCacheType       cache_type,
+                   const gchar                      *schema,
+                   const gchar                      *table_name,
+                   gboolean                          insert,
+                   GError                          **error)
+{
+	TrackerDataUpdateBufferProperty *property;
+	TrackerDBStatement *stmt;
+	GString *sql, *values_sql;
+	guint i;
+
+	if (insert) {
+		sql = g_string_new ("INSERT INTO \"");
+		values_sql = g_string_new ("VALUES (?");
+	} else {
+		sql = g_string_new ("UPDATE \"");
+		values_sql = NULL;
+	}
+
+	g_string_append_printf (sql, "%s\".\"%s", schema, table_name);
+
+	if (insert) {
+		g_string_append (sql, "\" (ID");
+
+		if (strcmp (table_name, "rdfs:Resource") == 0) {
+			g_string_append (sql, ", \"tracker:added\", \"tracker:modified\", Available");
+			g_string_append (values_sql, ", ?, ?, 1");
+		}
+	} else {
+		g_string_append (sql, "\" SET ");
+	}
+
+	for (i = 0; i < plan_columns->len; i++) {
+		property = g_array_index (plan_columns, TrackerDataPlanColumn, i).property;
+		if (insert) {
+			g_string_append_printf (sql, ", \"%s\"", property->name);
+			g_string_append (values_sql, ", ?");
+
+			if (property->date_time) {
+				g_string_append_printf (sql, ", \"%s:localDate\"", property->name);
+				g_string_append_printf (sql, ", \"%s:localTime\"", property->name);
+				g_string_append (values_sql, ", ?, ?");
+			}
+
+			g_string_append_printf (sql, ", \"%s:graph\"", property->name);
+			g_string_append (values_sql, ", ?");
+		} else {
+			if (i > 0) {
+				g_string_append (sql, ", ");
+			}
+			g_string_append_printf (sql, "\"%s\" = ?", property->name);
+
+			if (property->date_time) {
+				g_string_append_printf (sql, ", \"%s:localDate\" = ?", property->name);
+				g_string_append_printf (sql, ", \"%s:localTime\" = ?", property->name);
+			}
+
+			g_string_append_printf (sql, ", \"%s:graph\" = ?", property->name);
+		}
+	}
+
+	if (insert) {
+		g_string_append (sql, ")");
+		g_string_append (values_sql, ")");
+
+		stmt = tracker_db_interface_create_statement (iface, cache_type, error,
+		                                              "%s %s", sql->str, values_sql->str);
+		g_string_free (sql, TRUE);
+		g_string_free (values_sql, TRUE);
+	} else {
+		g_string_append (sql, " WHERE ID = ?");
+
+		stmt = tracker_db_interface_create_statement (iface, cache_type, error,
+		                                              "%s", sql->str);
+		g_string_free (sql, TRUE);
+	}
+
+	return stmt;
+}
+
+static TrackerDBStatement *
+value_statement_new (TrackerDBInterface               *iface,
+                     TrackerDBStatementCacheType       cache_type,
+                     const gchar                      *schema,
+                     const gchar                      *table_name,
+                     gboolean                          delete_value,
+                     TrackerDataUpdateBufferProperty  *property,
+                     GError                          **error)
+{
+	if (delete_value) {
+		/* delete rows for multiple value properties */
+		return tracker_db_interface_create_statement (iface, cache_type, error,
+		                                              "DELETE FROM \"%s\".\"%s\" WHERE ID = ? AND \"%s\" = ?",
+		                                              schema,
+		                                              table_name,
+		                                              property->name);
+	} else if (property->date_time) {
+		return tracker_db_interface_create_statement (iface, cache_type, error,
+		                                              "INSERT OR IGNORE INTO \"%s\".\"%s\" (ID, \"%s\", \"%s:localDate\", \"%s:localTime\", \"%s:graph\") VALUES (?, ?, ?, ?, ?)",
+		                                              schema,
+		                                              table_name,
+		                                              property->name,
+		                                              property->name,
+		                                              property->name,
+		                                              property->name);
+	} else {
+		return tracker_db_interface_create_statement (iface, cache_type, error,
+		                                              "INSERT OR IGNORE INTO \"%s\".\"%s\" (ID, \"%s\", \"%s:graph\") VALUES (?, ?, ?)",
+		                                              schema,
+		                                              table_name,
+		                                              property->name,
+		                                              property->name);
+	}
+}
+
+/* Returns the statement writing @n_properties properties of
+ * @properties, from @first, to @table_name, from its plan if there's
+ * one. The statement is ready to be bound, in the order of the
+ * properties left in plan_columns.
+ */
+static TrackerDBStatement *
+plan_get_statement (TrackerDBInterface               *iface,
+                    const gchar                      *schema,
+                    const gchar                      *table_name,
+                    TrackerDataPlanKind               kind,
+                    GArray                           *properties,
+                    guint                             first,
+                    guint                             n_properties,
+                    GError                          **error)
+{
+	TrackerDataTablePlans *plans;
+	TrackerDataPlan *plan;
+	TrackerDataPlanKey key;
+	TrackerDBStatementCacheType cache_type;
+	TrackerDBStatement *stmt;
+
+	if ((kind == PLAN_INSERT_ROW || kind == PLAN_INSERT_VALUE) &&
+	    strcmp (schema, "main") != 0) {
+		/* The union view may not cover this table yet */
+		tracker_db_manager_set_volume_table_used (schema, table_name);
+	}
+
+	plans = table_plans_get (iface, table_name);
+
+	if (plan_key_init (&key, plans, kind, schema, properties, first, n_properties)) {
+		plan = g_hash_table_lookup (plans->plans, &key);
+
+		if (plan) {
+			plan_hits++;
+			tracker_db_statement_reset (plan->stmt);
+			return g_object_ref (plan->stmt);
+		}
+
+		plan_misses++;
+		cache_type = TRACKER_DB_STATEMENT_CACHE_TYPE_NONE;
+	} else {
+		plan_uncacheable++;
+		cache_type = TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE;
+	}
+
+	switch (kind) {
+	case PLAN_INSERT_ROW:
+	case PLAN_UPDATE_ROW:
+		stmt = row_statement_new (iface, cache_type, schema, table_name,
+		                          kind == PLAN_INSERT_ROW, error);
+		break;
+	default:
+		stmt = value_statement_new (iface, cache_type, schema, table_name,
+		                            kind == PLAN_DELETE_VALUE,
+		                            g_array_index (plan_columns, TrackerDataPlanColumn, 0).property,
+		                            error);
+		break;
+	}
+
+	if (stmt && cache_type == TRACKER_DB_STATEMENT_CACHE_TYPE_NONE) {
+		plan = g_slice_new (TrackerDataPlan);
+		plan->key = key;
+		/* volume schemas may go away with their volume */
+		plan->schema = g_strdup (schema);
+		plan->key.schema = plan->schema;
+		plan->stmt = g_object_ref (stmt);
+		g_hash_table_insert (plans->plans, &plan->key, plan);
+	}
+
+	return stmt;
+}
+
 static void
 tracker_data_resource_buffer_flush (GError **error)
 {
@@ -748,27 +1344,9 @@ tracker_data_resource_buffer_flush (GError **error)
 			for (i = 0; i < table->properties->len; i++) {
 				property = &g_array_index (table->properties, TrackerDataUpdateBufferProperty, i);
 
-				if (table->delete_value) {
-					/* delete rows for multiple value properties */
-					stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
-					                                              "DELETE FROM \"%s\" WHERE ID = ? AND \"%s\" = ?",
-					                                              table_name,
-					                                              property->name);
-				} else if (property->date_time) {
-					stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
-					                                              "INSERT OR IGNORE INTO \"%s\" (ID, \"%s\", \"%s:localDate\", \"%s:localTime\", \"%s:graph\") VALUES (?, ?, ?, ?, ?)",
-					                                              table_name,
-					                                              property->name,
-					                                              property->name,
-					                                              property->name,
-					                                              property->name);
-				} else {
-					stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
-					                                              "INSERT OR IGNORE INTO \"%s\" (ID, \"%s\", \"%s:graph\") VALUES (?, ?, ?)",
-					                                              table_name,
-					                                              property->name,
-					                                              property->name);
-				}
+				stmt = plan_get_statement (iface, resource_buffer->schema, table_name,
+				                           table->delete_value ? PLAN_DELETE_VALUE : PLAN_INSERT_VALUE,
+				                           table->properties, i, 1, &actual_error);
 
 				if (actual_error) {
 					g_propagate_error (error, actual_error);
@@ -795,12 +1373,11 @@ tracker_data_resource_buffer_flush (GError **error)
 				}
 			}
 		} else {
-			GString *sql, *values_sql;
-
 			if (table->delete_row) {
 				/* remove entry from rdf:type table */
 				stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
-				                                              "DELETE FROM \"rdfs:Resource_rdf:type\" WHERE ID = ? AND \"rdf:type\" = ?");
+				                                              "DELETE FROM \"%s\".\"rdfs:Resource_rdf:type\" WHERE ID = ? AND \"rdf:type\" = ?",
+				                                              resource_buffer->schema);
 
 				if (stmt) {
 					tracker_db_statement_bind_int (stmt, 0, resource_buffer->id);
@@ -820,7 +1397,8 @@ tracker_data_resource_buffer_flush (GError **error)
 
 				/* remove row from class table */
 				stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
-				                                              "DELETE FROM \"%s\" WHERE ID = ?", table_name);
+				                                              "DELETE FROM \"%s\".\"%s\" WHERE ID = ?",
+				                                              resource_buffer->schema, table_name);
 
 				if (stmt) {
 					tracker_db_statement_bind_int (stmt, 0, resource_buffer->id);
@@ -828,81 +1406,19 @@ tracker_data_resource_buffer_flush (GError **error)
 					g_object_unref (stmt);
 				}
 
-				if (actual_error) {
-					g_propagate_error (error, actual_error);
-					return;
-				}
-
-				continue;
-			}
-
-			if (table->insert) {
-				sql = g_string_new ("INSERT INTO \"");
-				values_sql = g_string_new ("VALUES (?");
-			} else {
-				sql = g_string_new ("UPDATE \"");
-				values_sql = NULL;
-			}
-
-			g_string_append (sql, table_name);
-
-			if (table->insert) {
-				g_string_append (sql, "\" (ID");
-
-				if (strcmp (table_name, "rdfs:Resource") == 0) {
-					g_string_append (sql, ", \"tracker:added\", \"tracker:modified\", Available");
-					g_string_append (values_sql, ", ?, ?, 1");
-				} else {
-				}
-			} else {
-				g_string_append (sql, "\" SET ");
-			}
-
-			for (i = 0; i < table->properties->len; i++) {
-				property = &g_array_index (table->properties, TrackerDataUpdateBufferProperty, i);
-				if (table->insert) {
-					g_string_append_printf (sql, ", \"%s\"", property->name);
-					g_string_append (values_sql, ", ?");
-
-					if (property->date_time) {
-						g_string_append_printf (sql, ", \"%s:localDate\"", property->name);
-						g_string_append_printf (sql, ", \"%s:localTime\"", property->name);
-						g_string_append (values_sql, ", ?, ?");
-					}
-
-					g_string_append_printf (sql, ", \"%s:graph\"", property->name);
-					g_string_append (values_sql, ", ?");
-				} else {
-					if (i > 0) {
-						g_string_append (sql, ", ");
-					}
-					g_string_append_printf (sql, "\"%s\" = ?", property->name);
-
-					if (property->date_time) {
-						g_string_append_printf (sql, ", \"%s:localDate\" = ?", property->name);
-						g_string_append_printf (sql, ", \"%s:localTime\" = ?", property->name);
-					}
-
-					g_string_append_printf (sql, ", \"%s:graph\" = ?", property->name);
-				}
-			}
-
-			if (table->insert) {
-				g_string_append (sql, ")");
-				g_string_append (values_sql, ")");
-
-				stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
-				                                              "%s %s", sql->str, values_sql->str);
-				g_string_free (sql, TRUE);
-				g_string_free (values_sql, TRUE);
-			} else {
-				g_string_append (sql, " WHERE ID = ?");
+				if (actual_error) {
+					g_propagate_error (error, actual_error);
+					return;
+				}
 
-				stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
-				                                              "%s", sql->str);
-				g_string_free (sql, TRUE);
+				continue;
 			}
 
+			stmt = plan_get_statement (iface, resource_buffer->schema, table_name,
+			                           table->insert ? PLAN_INSERT_ROW : PLAN_UPDATE_ROW,
+			                           table->properties, 0, table->properties->len,
+			                           &actual_error);
+
 			if (actual_error) {
 				g_propagate_error (error, actual_error);
 				return;
@@ -923,8 +1439,8 @@ tracker_data_resource_buffer_flush (GError **error)
 				param = 0;
 			}
 
-			for (i = 0; i < table->properties->len; i++) {
-				property = &g_array_index (table->properties, TrackerDataUpdateBufferProperty, i);
+			for (i = 0; i < plan_columns->len; i++) {
+				property = g_array_index (plan_columns, TrackerDataPlanColumn, i).property;
 				if (table->delete_value) {
 					/* just set value to NULL for single value properties */
 					tracker_db_statement_bind_null (stmt, param++);
@@ -958,7 +1474,9 @@ tracker_data_resource_buffer_flush (GError **error)
 	}
 
 #if HAVE_TRACKER_FTS
-	if (resource_buffer->fts_updated) {
+	/* Full-text search is only maintained for the main database */
+	if (resource_buffer->fts_updated &&
+	    strcmp (resource_buffer->schema, "main") == 0) {
 		TrackerProperty *prop;
 		GValueArray *values;
 		gboolean create = resource_buffer->create;
@@ -1016,6 +1534,16 @@ static void resource_buffer_free (TrackerDataUpdateBufferResource *resource)
 	g_slice_free (TrackerDataUpdateBufferResource, resource);
 }
 
+static gint
+resource_buffer_compare_id (gconstpointer a,
+                            gconstpointer b)
+{
+	const TrackerDataUpdateBufferResource *resource_a = a;
+	const TrackerDataUpdateBufferResource *resource_b = b;
+
+	return resource_a->id - resource_b->id;
+}
+
 void
 tracker_data_update_buffer_flush (GError **error)
 {
@@ -1023,8 +1551,15 @@ tracker_data_update_buffer_flush (GError **error)
 	GError *actual_error = NULL;
 
 	if (in_journal_replay) {
-		g_hash_table_iter_init (&iter, update_buffer.resources_by_id);
-		while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &resource_buffer)) {
+		GList *resources, *l;
+
+		/* IDs were given in creation order, flushing by ID appends
+		 * rows to the tables instead of inserting them in between */
+		resources = g_list_sort (g_hash_table_get_values (update_buffer.resources_by_id),
+		                         resource_buffer_compare_id);
+
+		for (l = resources; l; l = l->next) {
+			resource_buffer = l->data;
 			tracker_data_resource_buffer_flush (&actual_error);
 			if (actual_error) {
 				g_propagate_error (error, actual_error);
@@ -1032,6 +1567,7 @@ tracker_data_update_buffer_flush (GError **error)
 			}
 		}
 
+		g_list_free (resources);
 		g_hash_table_remove_all (update_buffer.resources_by_id);
 	} else {
 		g_hash_table_iter_init (&iter, update_buffer.resources);
@@ -1063,7 +1599,8 @@ tracker_data_update_buffer_clear (void)
 {
 	g_hash_table_remove_all (update_buffer.resources);
 	g_hash_table_remove_all (update_buffer.resources_by_id);
-	g_hash_table_remove_all (update_buffer.resource_cache);
+	/* IDs of resources inserted in the transaction are gone */
+	tracker_resource_cache_clear (update_buffer.resource_cache);
 	resource_buffer = NULL;
 
 #if HAVE_TRACKER_FTS
@@ -1389,9 +1926,12 @@ get_property_values (TrackerProperty *property)
 
 		iface = tracker_db_manager_get_db_interface ();
 
+		/* Rows of a resource are all in the same database,
+		 * skip the union view over the volume databases.
+		 */
 		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &error,
-		                                              "SELECT \"%s\" FROM \"%s\" WHERE ID = ?",
-		                                              field_name, table_name);
+		                                              "SELECT \"%s\" FROM \"%s\".\"%s\" WHERE ID = ?",
+		                                              field_name, resource_buffer->schema, table_name);
 
 		if (stmt) {
 			tracker_db_statement_bind_int (stmt, 0, resource_buffer->id);
@@ -2038,6 +2578,7 @@ delete_metadata_decomposed (TrackerProperty  *property,
 
 static void
 db_delete_row (TrackerDBInterface *iface,
+               const gchar        *schema,
                const gchar        *table_name,
                gint                id)
 {
@@ -2045,8 +2586,8 @@ db_delete_row (TrackerDBInterface *iface,
 	GError *error = NULL;
 
 	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &error,
-	                                              "DELETE FROM \"%s\" WHERE ID = ?",
-	                                              table_name);
+	                                              "DELETE FROM \"%s\".\"%s\" WHERE ID = ?",
+	                                              schema, table_name);
 
 	if (stmt) {
 		tracker_db_statement_bind_int (stmt, 0, id);
@@ -2172,7 +2713,7 @@ cache_delete_resource_type_full (TrackerClass *class,
 
 		if (direct_delete) {
 			if (multiple_values) {
-				db_delete_row (iface, table_name, resource_buffer->id);
+				db_delete_row (iface, resource_buffer->schema, table_name, resource_buffer->id);
 			}
 			/* single-valued property values are deleted right after the loop by deleting the row in the class table */
 			continue;
@@ -2221,14 +2762,15 @@ cache_delete_resource_type_full (TrackerClass *class,
 
 	if (direct_delete) {
 		/* delete row from class table */
-		db_delete_row (iface, tracker_class_get_name (class), resource_buffer->id);
+		db_delete_row (iface, resource_buffer->schema, tracker_class_get_name (class), resource_buffer->id);
 
 		if (!single_type) {
 			/* delete row from rdfs:Resource_rdf:type table */
 			/* this is not necessary when deleting the whole resource
 			   as all property values are deleted implicitly */
 			stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &error,
-						                      "DELETE FROM \"rdfs:Resource_rdf:type\" WHERE ID = ? AND \"rdf:type\" = ?");
+						                      "DELETE FROM \"%s\".\"rdfs:Resource_rdf:type\" WHERE ID = ? AND \"rdf:type\" = ?",
+						                      resource_buffer->schema);
 
 			if (stmt) {
 				tracker_db_statement_bind_int (stmt, 0, resource_buffer->id);
@@ -2279,6 +2821,107 @@ cache_delete_resource_type (TrackerClass *class,
 	cache_delete_resource_type_full (class, graph, graph_id, FALSE);
 }
 
+static void
+resource_schemas_clear (void)
+{
+	if (resource_schemas) {
+		g_hash_table_remove_all (resource_schemas);
+	}
+}
+
+/* Returns the database holding the rows of an existing resource */
+static const gchar *
+resource_get_schema (gint id)
+{
+	TrackerDBInterface *iface;
+	GList *schemas, *l;
+	const gchar *schema = "main";
+	gint generation;
+
+	generation = tracker_db_manager_get_volumes_generation ();
+
+	if (resource_schemas && resource_schemas_generation == generation) {
+		const gchar *cached;
+
+		cached = g_hash_table_lookup (resource_schemas, GINT_TO_POINTER (id));
+
+		if (cached) {
+			return cached;
+		}
+	}
+
+	schemas = tracker_db_manager_get_volume_schemas ();
+
+	if (!schemas) {
+		return schema;
+	}
+
+	if (!resource_schemas) {
+		resource_schemas = g_hash_table_new (g_direct_hash, g_direct_equal);
+	}
+
+	if (resource_schemas_generation != generation ||
+	    g_hash_table_size (resource_schemas) >= TRACKER_DATA_RESOURCE_SCHEMA_CACHE_SIZE) {
+		/* Volumes were attached or removed, or the cache is full */
+		g_hash_table_remove_all (resource_schemas);
+		resource_schemas_generation = generation;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	for (l = schemas; l; l = l->next) {
+		TrackerDBStatement *stmt;
+		TrackerDBCursor *cursor = NULL;
+		gboolean found = FALSE;
+
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, NULL,
+		                                              "SELECT 1 FROM \"%s\".\"rdfs:Resource\" WHERE ID = ?",
+		                                              (const gchar *) l->data);
+
+		if (stmt) {
+			tracker_db_statement_bind_int (stmt, 0, id);
+			cursor = tracker_db_statement_start_cursor (stmt, NULL);
+			g_object_unref (stmt);
+		}
+
+		if (cursor) {
+			found = tracker_db_cursor_iter_next (cursor, NULL, NULL);
+			g_object_unref (cursor);
+		}
+
+		if (found) {
+			schema = l->data;
+			break;
+		}
+	}
+
+	g_list_free (schemas);
+
+	g_hash_table_insert (resource_schemas, GINT_TO_POINTER (id), (gpointer) schema);
+
+	return schema;
+}
+
+/* Resources with a nie:dataSource pointing to a removable volume
+ * are stored in the database of that volume, as long as nothing
+ * was stored for them elsewhere.
+ */
+static void
+resource_buffer_set_data_source (const gchar *data_source)
+{
+	const gchar *schema;
+
+	if (resource_buffer->stored) {
+		return;
+	}
+
+	schema = tracker_db_manager_get_volume_schema (data_source);
+
+	if (schema) {
+		resource_buffer->schema = schema;
+	}
+}
+
 static void
 resource_buffer_switch (const gchar *graph,
                         gint         graph_id,
@@ -2327,6 +2970,18 @@ resource_buffer_switch (const gchar *graph,
 		} else {
 			resource_buffer->types = tracker_data_query_rdf_type (resource_buffer->id);
 		}
+		resource_buffer->stored = (resource_buffer->types->len > 0);
+
+		if (resource_buffer->stored) {
+			resource_buffer->schema = resource_get_schema (resource_buffer->id);
+		} else {
+			/* May be stored elsewhere this time */
+			resource_buffer->schema = "main";
+
+			if (resource_schemas) {
+				g_hash_table_remove (resource_schemas, GINT_TO_POINTER (resource_buffer->id));
+			}
+		}
 		resource_buffer->predicates = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, (GDestroyNotify) g_array_unref);
 		resource_buffer->tables = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) cache_table_free);
 
@@ -2742,6 +3397,11 @@ tracker_data_insert_statement_with_uri (const gchar            *graph,
 			final_prop_id = (prop_id != 0) ? prop_id : tracker_data_query_resource_id (predicate);
 			object_id = query_resource_id (object);
 
+			if (!resource_buffer->stored &&
+			    strcmp (predicate, TRACKER_NIE_PREFIX "dataSource") == 0) {
+				resource_buffer_set_data_source (object);
+			}
+
 			if (insert_callbacks) {
 				guint n;
 				for (n = 0; n < insert_callbacks->len; n++) {
@@ -3288,7 +3948,10 @@ tracker_data_begin_transaction (GError **error)
 	has_persistent = FALSE;
 
 	if (update_buffer.resource_cache == NULL) {
-		update_buffer.resource_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		update_buffer.resource_cache = tracker_resource_cache_new (TRACKER_DATA_RESOURCE_CACHE_SIZE);
+	}
+
+	if (update_buffer.resources == NULL) {
 		/* used for normal transactions */
 		update_buffer.resources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) resource_buffer_free);
 		/* used for journal replay */
@@ -3415,7 +4078,6 @@ tracker_data_commit_transaction (GError **error)
 
 	g_hash_table_remove_all (update_buffer.resources);
 	g_hash_table_remove_all (update_buffer.resources_by_id);
-	g_hash_table_remove_all (update_buffer.resource_cache);
 
 	in_journal_replay = FALSE;
 }
@@ -3447,6 +4109,7 @@ tracker_data_rollback_transaction (void)
 	iface = tracker_db_manager_get_db_interface ();
 
 	tracker_data_update_buffer_clear ();
+	resource_schemas_clear ();
 
 	tracker_db_interface_execute_query (iface, &ignorable, "ROLLBACK");
 
@@ -3456,6 +4119,9 @@ tracker_data_rollback_transaction (void)
 
 	tracker_db_interface_execute_query (iface, NULL, "PRAGMA cache_size = %d", TRACKER_DB_CACHE_SIZE_DEFAULT);
 
+	/* Views created for volume tables were rolled back too */
+	tracker_db_manager_reset_volume_views ();
+
 	/* Runtime false in case of DISABLE_JOURNAL */
 	if (!in_journal_replay) {
 
@@ -3554,8 +4220,260 @@ tracker_data_sync (void)
 #endif
 }
 
+void
+tracker_data_update_set_bulk_replay (gboolean enabled)
+{
+	bulk_replay = enabled;
+}
+
+gboolean
+tracker_data_update_get_bulk_replay (void)
+{
+	return bulk_replay;
+}
+
+/**
+ * tracker_data_forget_volume:
+ * @uuid: UUID of a removable volume
+ * @error: location for a #GError
+ *
+ * Drops all resources stored in the database of the volume identified
+ * by @uuid, see tracker_db_manager_forget_volume(). Their entries in
+ * the Resource table are removed in the same transaction as the
+ * journal entry recording the forget, so a replay drops the resources
+ * of the volume at that point. Must be called with no transaction
+ * ongoing.
+ *
+ * returns: %TRUE if the volume had a database and it was removed
+ **/
+gboolean
+tracker_data_forget_volume (const gchar  *uuid,
+                            GError      **error)
+{
+	TrackerDBInterface *iface;
+	GError *actual_error = NULL;
+	const gchar *schema;
+	gchar *data_source;
+	gint ds_id;
+
+	g_return_val_if_fail (uuid != NULL, FALSE);
+	g_return_val_if_fail (!in_transaction, FALSE);
+
+	data_source = g_strconcat (TRACKER_DATASOURCE_URN_PREFIX, uuid, NULL);
+	schema = tracker_db_manager_get_volume_schema (data_source);
+
+	if (!schema) {
+		g_free (data_source);
+
+		/* Reports the invalid or unknown volume */
+		return tracker_db_manager_forget_volume (uuid, error);
+	}
+
+	tracker_data_begin_transaction (&actual_error);
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		g_free (data_source);
+		return FALSE;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	/* IDs are never reused, nothing refers to these
+	 * anymore once the volume database is gone.
+	 */
+	tracker_db_interface_execute_query (iface, &actual_error,
+	                                    "DELETE FROM \"main\".\"Resource\" "
+	                                    "WHERE ID IN (SELECT ID FROM \"%s\".\"rdfs:Resource\")",
+	                                    schema);
+
+	ds_id = query_resource_id (data_source);
+	g_free (data_source);
+
+#ifndef DISABLE_JOURNAL
+	if (!actual_error && ds_id != 0) {
+		tracker_db_journal_append_forget_data_source (ds_id);
+		has_persistent = TRUE;
+	}
+#endif /* DISABLE_JOURNAL */
+
+	if (actual_error) {
+		tracker_data_rollback_transaction ();
+		g_propagate_error (error, actual_error);
+		return FALSE;
+	}
+
+	tracker_data_commit_transaction (&actual_error);
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return FALSE;
+	}
+
+	/* Cached IDs of the dropped resources are stale */
+	tracker_data_update_reset_resource_cache (resource_filter_enabled);
+
+	return tracker_db_manager_forget_volume (uuid, error);
+}
+
 #ifndef DISABLE_JOURNAL
 
+/* Statements replayed in one database transaction */
+#define REPLAY_BATCH_SIZE 100000
+
+/* In bulk replay, each journal transaction is a savepoint of a
+ * database transaction spanning many of them */
+static void
+replay_begin_transaction (time_t time)
+{
+	TrackerDBInterface *iface;
+
+	if (!bulk_replay) {
+		tracker_data_begin_transaction_for_replay (time, NULL);
+		return;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	if (!in_transaction) {
+		tracker_data_begin_transaction_for_replay (time, NULL);
+		tracker_db_interface_execute_query (iface, NULL, "PRAGMA cache_size = %d", TRACKER_DB_CACHE_SIZE_REPLAY);
+	} else {
+		resource_time = time;
+		has_persistent = FALSE;
+	}
+
+	tracker_db_interface_execute_query (iface, NULL, "SAVEPOINT replay");
+}
+
+static void
+replay_rollback_transaction (void)
+{
+	TrackerDBInterface *iface;
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	tracker_data_update_buffer_clear ();
+	resource_schemas_clear ();
+
+	tracker_db_interface_execute_query (iface, NULL, "ROLLBACK TO replay");
+	tracker_db_interface_execute_query (iface, NULL, "RELEASE replay");
+}
+
+static void
+replay_commit_transaction (gboolean   end_batch,
+                           GError   **error)
+{
+	TrackerDBInterface *iface;
+	GError *actual_error = NULL;
+
+	if (!bulk_replay) {
+		tracker_data_commit_transaction (error);
+		return;
+	}
+
+	tracker_data_update_buffer_flush (&actual_error);
+
+	if (actual_error) {
+		/* Only this journal transaction is lost */
+		replay_rollback_transaction ();
+	} else {
+		iface = tracker_db_manager_get_db_interface ();
+		tracker_db_interface_execute_query (iface, NULL, "RELEASE replay");
+
+		get_transaction_modseq ();
+		if (has_persistent) {
+			transaction_modseq++;
+			has_persistent = FALSE;
+		}
+
+		if (update_buffer.class_counts) {
+			g_hash_table_remove_all (update_buffer.class_counts);
+		}
+	}
+
+	if (end_batch) {
+		tracker_data_commit_transaction (actual_error ? NULL : &actual_error);
+	}
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+	}
+}
+
+/* Everything is replayed into the main database, the resources
+ * the volume database held are found through their nie:dataSource.
+ */
+static void
+replay_forget_data_source (gint     ds_id,
+                           GError **error)
+{
+	TrackerDBInterface *iface;
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	TrackerProperty *data_source;
+	TrackerClass *resource;
+	GError *actual_error = NULL;
+	GArray *ids;
+	guint i;
+
+	data_source = tracker_ontologies_get_property_by_uri (TRACKER_NIE_PREFIX "dataSource");
+	resource = tracker_ontologies_get_class_by_uri (RDFS_PREFIX "Resource");
+
+	if (!data_source || !resource) {
+		return;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+	ids = g_array_new (FALSE, FALSE, sizeof (gint));
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &actual_error,
+	                                              "SELECT ID FROM \"%s\" WHERE \"%s\" = ?",
+	                                              tracker_property_get_table_name (data_source),
+	                                              tracker_property_get_name (data_source));
+
+	if (stmt) {
+		tracker_db_statement_bind_int (stmt, 0, ds_id);
+		cursor = tracker_db_statement_start_cursor (stmt, &actual_error);
+		g_object_unref (stmt);
+	}
+
+	while (cursor && tracker_db_cursor_iter_next (cursor, NULL, &actual_error)) {
+		gint id;
+
+		id = tracker_db_cursor_get_int (cursor, 0);
+		g_array_append_val (ids, id);
+	}
+
+	g_clear_object (&cursor);
+
+	for (i = 0; !actual_error && i < ids->len; i++) {
+		resource_buffer_switch (NULL, 0, NULL, g_array_index (ids, gint, i));
+		cache_delete_resource_type (resource, NULL, 0);
+	}
+
+	if (!actual_error) {
+		tracker_data_update_buffer_flush (&actual_error);
+	}
+
+	for (i = 0; !actual_error && i < ids->len; i++) {
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+		                                              "DELETE FROM Resource WHERE ID = ?");
+
+		if (stmt) {
+			tracker_db_statement_bind_int (stmt, 0, g_array_index (ids, gint, i));
+			tracker_db_statement_execute (stmt, &actual_error);
+			g_object_unref (stmt);
+		}
+	}
+
+	g_array_free (ids, TRUE);
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+	}
+}
+
 void
 tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
                              gpointer              busy_user_data,
@@ -3567,6 +4485,8 @@ tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
 	gint last_operation_type = 0;
 	const gchar *uri;
 	GError *n_error = NULL;
+	gboolean replay_transaction = FALSE;
+	guint batch_size = 0;
 
 
 	rdf_type = tracker_ontologies_get_rdf_type ();
@@ -3585,6 +4505,7 @@ tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
 		gint graph_id, subject_id, predicate_id, object_id;
 
 		type = tracker_db_journal_reader_get_type ();
+		batch_size++;
 		if (type == TRACKER_DB_JOURNAL_RESOURCE) {
 			GError *new_error = NULL;
 			TrackerDBInterface *iface;
@@ -3611,15 +4532,27 @@ tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
 			}
 
 		} else if (type == TRACKER_DB_JOURNAL_START_TRANSACTION) {
-			tracker_data_begin_transaction_for_replay (tracker_db_journal_reader_get_time (), NULL);
+			replay_begin_transaction (tracker_db_journal_reader_get_time ());
+			replay_transaction = TRUE;
 		} else if (type == TRACKER_DB_JOURNAL_END_TRANSACTION) {
 			GError *new_error = NULL;
-			tracker_data_update_buffer_might_flush (&new_error);
+			gboolean end_batch;
+
+			end_batch = batch_size >= REPLAY_BATCH_SIZE;
+			if (end_batch) {
+				batch_size = 0;
+			}
+
+			replay_commit_transaction (end_batch, &new_error);
+			replay_transaction = FALSE;
 
-			tracker_data_commit_transaction (&new_error);
 			if (new_error) {
 				/* Out of disk is an unrecoverable fatal error */
 				if (g_error_matches (new_error, TRACKER_DB_INTERFACE_ERROR, TRACKER_DB_NO_SPACE)) {
+					if (bulk_replay && in_transaction) {
+						tracker_data_rollback_transaction ();
+						in_journal_replay = FALSE;
+					}
 					g_propagate_error (error, new_error);
 					return;
 				} else {
@@ -3773,6 +4706,26 @@ tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
 				g_warning ("Journal replay error: 'property with ID %d doesn't exist'", predicate_id);
 			}
 
+		} else if (type == TRACKER_DB_JOURNAL_FORGET_DATA_SOURCE) {
+			GError *new_error = NULL;
+			gint ds_id;
+
+			tracker_db_journal_reader_get_data_source (&ds_id);
+
+			/* Resources are looked up in the database */
+			tracker_data_update_buffer_flush (&new_error);
+			if (new_error) {
+				g_warning ("Journal replay error: '%s'", new_error->message);
+				g_clear_error (&new_error);
+			}
+			last_operation_type = -1;
+
+			replay_forget_data_source (ds_id, &new_error);
+
+			if (new_error) {
+				g_warning ("Journal replay error: '%s'", new_error->message);
+				g_error_free (new_error);
+			}
 		} else if (type == TRACKER_DB_JOURNAL_DELETE_STATEMENT_ID) {
 			GError *new_error = NULL;
 			TrackerClass *class = NULL;
@@ -3830,6 +4783,28 @@ tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
 		}
 	}
 
+	if (bulk_replay) {
+		if (replay_transaction) {
+			/* The journal ends within this transaction */
+			replay_rollback_transaction ();
+		}
+
+		if (in_transaction) {
+			tracker_data_commit_transaction (&n_error);
+			if (n_error) {
+				if (g_error_matches (n_error, TRACKER_DB_INTERFACE_ERROR, TRACKER_DB_NO_SPACE)) {
+					g_clear_error (&journal_error);
+					tracker_db_journal_reader_shutdown ();
+					g_propagate_error (error, n_error);
+					return;
+				} else {
+					g_warning ("Journal replay error: '%s'", n_error->message);
+					g_clear_error (&n_error);
+				}
+			}
+		}
+	}
+
 
 	if (journal_error) {
 		GError *n_error = NULL;
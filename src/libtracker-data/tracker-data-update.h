@@ -27,6 +27,7 @@
 #include <libtracker-common/tracker-ontologies.h>
 
 #include "tracker-db-interface.h"
+#include "tracker-resource-cache.h"
 
 G_BEGIN_DECLS
 
@@ -94,10 +95,22 @@ GVariant *
                                                      GError                   **error);
 void     tracker_data_update_buffer_flush           (GError                   **error);
 void     tracker_data_update_buffer_might_flush     (GError                   **error);
+void     tracker_data_update_clear_plans            (void);
+void     tracker_data_update_get_plan_statistics    (guint                     *size,
+                                                     guint                     *hits,
+                                                     guint                     *misses,
+                                                     guint                     *uncacheable);
+void     tracker_data_update_reset_resource_cache   (gboolean                   use_filter);
+void     tracker_data_update_build_resource_filter  (void);
+void     tracker_data_update_get_resource_cache_stats (TrackerResourceCacheStats *stats);
 void     tracker_data_load_turtle_file              (GFile                     *file,
                                                      GError                   **error);
 
 void     tracker_data_sync                          (void);
+void     tracker_data_update_set_bulk_replay        (gboolean                   enabled);
+gboolean tracker_data_update_get_bulk_replay        (void);
+gboolean tracker_data_forget_volume                 (const gchar               *uuid,
+                                                     GError                   **error);
 void     tracker_data_replay_journal                (TrackerBusyCallback        busy_callback,
                                                      gpointer                   busy_user_data,
                                                      const gchar               *busy_status,
@@ -40,6 +40,7 @@
 #include "tracker-ontology.h"
 #include "tracker-ontologies.h"
 #include "tracker-property.h"
+#include "tracker-resource-cache.h"
 #include "tracker-sparql-query.h"
 
 #undef __LIBTRACKER_DATA_INSIDE__
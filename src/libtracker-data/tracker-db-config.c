@@ -31,10 +31,12 @@
 
 /* GKeyFile defines */
 #define GROUP_JOURNAL     "Journal"
+#define GROUP_DATABASE    "Database"
 
 /* Default values */
 #define DEFAULT_JOURNAL_CHUNK_SIZE           50
 #define DEFAULT_JOURNAL_ROTATE_DESTINATION   ""
+#define DEFAULT_VOLUME_DATABASES             FALSE
 
 static void config_set_property (GObject      *object,
                                  guint         param_id,
@@ -52,12 +54,16 @@ enum {
 
 	/* Journal */
 	PROP_JOURNAL_CHUNK_SIZE,
-	PROP_JOURNAL_ROTATE_DESTINATION
+	PROP_JOURNAL_ROTATE_DESTINATION,
+
+	/* Database */
+	PROP_VOLUME_DATABASES
 };
 
 static TrackerConfigMigrationEntry migration[] = {
 	{ G_TYPE_INT, GROUP_JOURNAL, "JournalChunkSize", "journal-chunk-size" },
 	{ G_TYPE_STRING, GROUP_JOURNAL, "JournalRotateDestination", "journal-rotate-destination" },
+	{ G_TYPE_BOOLEAN, GROUP_DATABASE, "VolumeDatabases", "volume-databases" },
 };
 
 G_DEFINE_TYPE (TrackerDBConfig, tracker_db_config, G_TYPE_SETTINGS);
@@ -90,6 +96,14 @@ tracker_db_config_class_init (TrackerDBConfigClass *klass)
 	                                                      DEFAULT_JOURNAL_ROTATE_DESTINATION,
 	                                                      G_PARAM_READWRITE));
 
+	g_object_class_install_property (object_class,
+	                                 PROP_VOLUME_DATABASES,
+	                                 g_param_spec_boolean ("volume-databases",
+	                                                       "Volume databases",
+	                                                       " Store resources from removable volumes in per-volume databases",
+	                                                       DEFAULT_VOLUME_DATABASES,
+	                                                       G_PARAM_READWRITE));
+
 }
 
 static void
@@ -113,6 +127,12 @@ config_set_property (GObject      *object,
 		tracker_db_config_set_journal_rotate_destination (TRACKER_DB_CONFIG (object),
 		                                                  g_value_get_string(value));
 		break;
+
+		/* Database */
+	case PROP_VOLUME_DATABASES:
+		tracker_db_config_set_volume_databases (TRACKER_DB_CONFIG (object),
+		                                        g_value_get_boolean (value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -134,6 +154,9 @@ config_get_property (GObject    *object,
 	case PROP_JOURNAL_ROTATE_DESTINATION:
 		g_value_take_string (value, tracker_db_config_get_journal_rotate_destination (config));
 		break;
+	case PROP_VOLUME_DATABASES:
+		g_value_set_boolean (value, tracker_db_config_get_volume_databases (config));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -201,6 +224,14 @@ tracker_db_config_get_journal_rotate_destination (TrackerDBConfig *config)
 	return g_settings_get_string (G_SETTINGS (config), "journal-rotate-destination");
 }
 
+gboolean
+tracker_db_config_get_volume_databases (TrackerDBConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_DB_CONFIG (config), DEFAULT_VOLUME_DATABASES);
+
+	return g_settings_get_boolean (G_SETTINGS (config), "volume-databases");
+}
+
 void
 tracker_db_config_set_journal_chunk_size (TrackerDBConfig *config,
                                           gint             value)
@@ -220,3 +251,13 @@ tracker_db_config_set_journal_rotate_destination (TrackerDBConfig *config,
 	g_settings_set_string (G_SETTINGS (config), "journal-rotate-destination", value);
 	g_object_notify (G_OBJECT (config), "journal-rotate-destination");
 }
+
+void
+tracker_db_config_set_volume_databases (TrackerDBConfig *config,
+                                        gboolean         value)
+{
+	g_return_if_fail (TRACKER_IS_DB_CONFIG (config));
+
+	g_settings_set_boolean (G_SETTINGS (config), "volume-databases", value);
+	g_object_notify (G_OBJECT (config), "volume-databases");
+}
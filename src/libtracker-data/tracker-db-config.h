@@ -58,11 +58,14 @@ gboolean         tracker_db_config_save                           (TrackerDBConf
 
 gint             tracker_db_config_get_journal_chunk_size         (TrackerDBConfig *config);
 gchar *          tracker_db_config_get_journal_rotate_destination (TrackerDBConfig *config);
+gboolean         tracker_db_config_get_volume_databases           (TrackerDBConfig *config);
 
 void             tracker_db_config_set_journal_chunk_size         (TrackerDBConfig *config,
                                                                    gint             value);
 void             tracker_db_config_set_journal_rotate_destination (TrackerDBConfig *config,
                                                                    const gchar     *value);
+void             tracker_db_config_set_volume_databases           (TrackerDBConfig *config,
+                                                                   gboolean         value);
 
 G_END_DECLS
 
@@ -1191,6 +1191,14 @@ tracker_db_interface_sqlite_reset_collator (TrackerDBInterface *db_interface)
 	}
 }
 
+gboolean
+tracker_db_interface_sqlite_in_use (TrackerDBInterface *db_interface)
+{
+	/* A transaction is ongoing, or a cursor is being iterated */
+	return (!sqlite3_get_autocommit (db_interface->db) ||
+	        g_atomic_int_get (&db_interface->n_active_cursors) > 0);
+}
+
 static gint
 wal_hook (gpointer     user_data,
           sqlite3     *db,
@@ -2214,6 +2222,17 @@ tracker_db_statement_execute (TrackerDBStatement  *stmt,
 	execute_stmt (stmt->db_interface, stmt->stmt, NULL, error);
 }
 
+/* Makes a statement kept by the caller ready to be bound again, those
+ * from tracker_db_interface_create_statement() already are.
+ */
+void
+tracker_db_statement_reset (TrackerDBStatement *stmt)
+{
+	g_return_if_fail (TRACKER_IS_DB_STATEMENT (stmt));
+
+	tracker_db_statement_sqlite_reset (stmt);
+}
+
 TrackerDBCursor *
 tracker_db_statement_start_cursor (TrackerDBStatement  *stmt,
                                    GError             **error)
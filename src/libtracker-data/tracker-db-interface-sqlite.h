@@ -45,6 +45,7 @@ void                tracker_db_interface_sqlite_fts_init               (TrackerD
                                                                         GHashTable               *multivalued,
                                                                         gboolean                  create);
 void                tracker_db_interface_sqlite_reset_collator         (TrackerDBInterface       *interface);
+gboolean            tracker_db_interface_sqlite_in_use                 (TrackerDBInterface       *interface);
 void                tracker_db_interface_sqlite_wal_hook               (TrackerDBInterface       *interface,
                                                                         TrackerDBWalCallback      callback);
 
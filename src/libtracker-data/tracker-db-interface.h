@@ -122,6 +122,7 @@ void                    tracker_db_statement_bind_text               (TrackerDBS
                                                                       const gchar                *value);
 void                    tracker_db_statement_execute                 (TrackerDBStatement         *stmt,
                                                                       GError                    **error);
+void                    tracker_db_statement_reset                   (TrackerDBStatement         *stmt);
 TrackerDBCursor *       tracker_db_statement_start_cursor            (TrackerDBStatement         *stmt,
                                                                       GError                    **error);
 TrackerDBCursor *       tracker_db_statement_start_sparql_cursor     (TrackerDBStatement         *stmt,
@@ -50,11 +50,12 @@
 /*
  * data_format:
  * #... 0000 0000 (total size is 4 bytes)
- *         | |||`- resource insert (all other bits must be 0 if 1)
- *         | ||`-- object type (1 = id, 0 = cstring)
- *         | |`--- operation type (0 = insert, 1 = delete)
- *         | `---- graph (0 = default graph, 1 = named graph)
- *         `------ update (0 = insert, 1 = update)
+ *        || |||`- resource insert (all other bits must be 0 if 1)
+ *        || ||`-- object type (1 = id, 0 = cstring)
+ *        || |`--- operation type (0 = insert, 1 = delete)
+ *        || `---- graph (0 = default graph, 1 = named graph)
+ *        |`------ update (0 = insert, 1 = update)
+ *        `------- data source forgotten (all other bits must be 0 if 1)
  */
 
 typedef enum {
@@ -62,9 +63,18 @@ typedef enum {
 	DATA_FORMAT_OBJECT_ID        = 1 << 1,
 	DATA_FORMAT_OPERATION_DELETE = 1 << 2,
 	DATA_FORMAT_GRAPH            = 1 << 3,
-	DATA_FORMAT_OPERATION_UPDATE = 1 << 4
+	DATA_FORMAT_OPERATION_UPDATE = 1 << 4,
+	DATA_FORMAT_FORGET_DATA_SOURCE = 1 << 5
 } DataFormat;
 
+/* Journal file versions, entries are checksummed with CRC-32 up to
+ * 04, and with CRC-32C from 05, where the CPU computes it faster.
+ */
+#define JOURNAL_HEADER_V3 "trlog\00003"
+#define JOURNAL_HEADER_V4 "trlog\00004"
+#define JOURNAL_HEADER_V5 "trlog\00005"
+#define JOURNAL_HEADER_SIZE 8
+
 typedef enum {
 	TRANSACTION_FORMAT_NONE      = 0,
 	TRANSACTION_FORMAT_DATA      = 1 << 0,
@@ -94,6 +104,7 @@ typedef struct {
 	gchar *object;
 	guint current_file;
 	gchar *rotate_to;
+	TrackerCrc32Type crc_type;
 } JournalReader;
 
 typedef struct {
@@ -105,6 +116,7 @@ typedef struct {
 	gchar *cur_block;
 	guint cur_entry_amount;
 	guint cur_pos;
+	TrackerCrc32Type crc_type;
 } JournalWriter;
 
 static struct {
@@ -272,15 +284,44 @@ journal_read_string (JournalReader  *jreader,
 	return result;
 }
 
+static guint32
+journal_crc (TrackerCrc32Type  crc_type,
+             gconstpointer     data,
+             gsize             len)
+{
+	if (crc_type == TRACKER_CRC32_CASTAGNOLI) {
+		return tracker_crc32c (data, len);
+	} else {
+		return tracker_crc32 (data, len);
+	}
+}
+
+static gboolean
+journal_header_get_crc_type (const gchar      *header,
+                             TrackerCrc32Type *crc_type)
+{
+	/* Version 00003 is identical to 00004, it just has no UPDATE
+	 * operations, 00005 only changes the checksum.
+	 */
+	if (memcmp (header, JOURNAL_HEADER_V5, JOURNAL_HEADER_SIZE) == 0) {
+		*crc_type = TRACKER_CRC32_CASTAGNOLI;
+	} else if (memcmp (header, JOURNAL_HEADER_V4, JOURNAL_HEADER_SIZE) == 0 ||
+	           memcmp (header, JOURNAL_HEADER_V3, JOURNAL_HEADER_SIZE) == 0) {
+		*crc_type = TRACKER_CRC32_IEEE;
+	} else {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static gboolean
 journal_verify_header (JournalReader *jreader)
 {
-	gchar header[8];
+	gchar header[JOURNAL_HEADER_SIZE];
 	gint i;
 	GError *error = NULL;
 
-	/* Version 00003 is identical, it just has no UPDATE operations */
-
 	if (jreader->stream) {
 		for (i = 0; i < sizeof (header); i++) {
 			header[i] = g_data_input_stream_read_byte (jreader->stream, NULL, &error);
@@ -290,20 +331,20 @@ journal_verify_header (JournalReader *jreader)
 			}
 		}
 
-		if (memcmp (header, "trlog\00004", 8) && memcmp (header, "trlog\00003", 8)) {
+		if (!journal_header_get_crc_type (header, &jreader->crc_type)) {
 			return FALSE;
 		}
 	} else {
 		/* verify journal file header */
-		if (jreader->end - jreader->current < 8) {
+		if (jreader->end - jreader->current < JOURNAL_HEADER_SIZE) {
 			return FALSE;
 		}
 
-		if (memcmp (jreader->current, "trlog\00004", 8) && memcmp (jreader->current, "trlog\00003", 8)) {
+		if (!journal_header_get_crc_type (jreader->current, &jreader->crc_type)) {
 			return FALSE;
 		}
 
-		jreader->current += 8;
+		jreader->current += JOURNAL_HEADER_SIZE;
 	}
 
 	return TRUE;
@@ -485,18 +526,23 @@ db_journal_init_file (JournalWriter  *jwriter,
 		g_assert (jwriter->cur_block_alloc == 0);
 		g_assert (jwriter->cur_block == NULL);
 
-		cur_block_maybe_expand (jwriter, 8);
+		/* Older versions can't read CRC-32C journals, only write
+		 * those when there's something to gain.
+		 */
+		if (tracker_crc32_get_impl (TRACKER_CRC32_CASTAGNOLI) == TRACKER_CRC32_IMPL_HARDWARE &&
+		    tracker_crc32_get_impl (TRACKER_CRC32_IEEE) != TRACKER_CRC32_IMPL_HARDWARE) {
+			jwriter->crc_type = TRACKER_CRC32_CASTAGNOLI;
+		} else {
+			jwriter->crc_type = TRACKER_CRC32_IEEE;
+		}
 
-		jwriter->cur_block[0] = 't';
-		jwriter->cur_block[1] = 'r';
-		jwriter->cur_block[2] = 'l';
-		jwriter->cur_block[3] = 'o';
-		jwriter->cur_block[4] = 'g';
-		jwriter->cur_block[5] = '\0';
-		jwriter->cur_block[6] = '0';
-		jwriter->cur_block[7] = '4';
+		cur_block_maybe_expand (jwriter, JOURNAL_HEADER_SIZE);
 
-		if (!write_all_data (jwriter->journal, jwriter->cur_block, 8, error)) {
+		memcpy (jwriter->cur_block,
+		        jwriter->crc_type == TRACKER_CRC32_CASTAGNOLI ? JOURNAL_HEADER_V5 : JOURNAL_HEADER_V4,
+		        JOURNAL_HEADER_SIZE);
+
+		if (!write_all_data (jwriter->journal, jwriter->cur_block, JOURNAL_HEADER_SIZE, error)) {
 			cur_block_kill (jwriter);
 			/* delete empty journal file */
 			g_unlink (jwriter->journal_filename);
@@ -505,8 +551,23 @@ db_journal_init_file (JournalWriter  *jwriter,
 			return FALSE;
 		}
 
-		jwriter->cur_size += 8;
+		jwriter->cur_size += JOURNAL_HEADER_SIZE;
 		cur_block_kill (jwriter);
+	} else {
+		gchar header[JOURNAL_HEADER_SIZE];
+		int fd;
+
+		/* Keep appending with the checksum the journal has */
+		jwriter->crc_type = TRACKER_CRC32_IEEE;
+		fd = g_open (jwriter->journal_filename, O_RDONLY, 0);
+
+		if (fd != -1) {
+			if (read (fd, header, JOURNAL_HEADER_SIZE) == JOURNAL_HEADER_SIZE) {
+				journal_header_get_crc_type (header, &jwriter->crc_type);
+			}
+
+			close (fd);
+		}
 	}
 
 	return TRUE;
@@ -1107,6 +1168,40 @@ tracker_db_journal_append_resource (gint         s_id,
 	return ret;
 }
 
+static gboolean
+db_journal_writer_append_forget_data_source (JournalWriter *jwriter,
+                                             gint           ds_id)
+{
+	DataFormat df;
+	gint size;
+
+	g_return_val_if_fail (jwriter->journal > 0, FALSE);
+
+	df = DATA_FORMAT_FORGET_DATA_SOURCE;
+	size = sizeof (guint32) * 2;
+
+	cur_block_maybe_expand (jwriter, size);
+
+	cur_setnum (jwriter->cur_block, &(jwriter->cur_pos), df);
+	cur_setnum (jwriter->cur_block, &(jwriter->cur_pos), ds_id);
+
+	jwriter->cur_entry_amount++;
+	jwriter->cur_block_len += size;
+
+	return TRUE;
+}
+
+/* All resources with a nie:dataSource of @ds_id were dropped at
+ * once, along with their entries in the Resource table.
+ */
+gboolean
+tracker_db_journal_append_forget_data_source (gint ds_id)
+{
+	g_return_val_if_fail (current_transaction_format == TRANSACTION_FORMAT_DATA, FALSE);
+
+	return db_journal_writer_append_forget_data_source (&writer, ds_id);
+}
+
 gboolean
 tracker_db_journal_rollback_transaction (GError **error)
 {
@@ -1171,7 +1266,7 @@ db_journal_writer_commit_db_transaction (JournalWriter  *jwriter,
 	 *
 	 * NOTE: the size check at the end is included in the CRC!
 	 */
-	crc = tracker_crc32 (jwriter->cur_block + offset, jwriter->cur_block_len - offset);
+	crc = journal_crc (jwriter->crc_type, jwriter->cur_block + offset, jwriter->cur_block_len - offset);
 	cur_setnum (jwriter->cur_block, &begin_pos, crc);
 
 	if (!write_all_data (jwriter->journal, jwriter->cur_block, jwriter->cur_block_len, error)) {
@@ -1715,16 +1810,19 @@ db_journal_reader_next (JournalReader *jreader, gboolean global_reader, GError *
 			// might this be too problematic memory-wise
 
 			/* Calculate the crc */
-			crc = tracker_crc32 (jreader->entry_begin + (sizeof (guint32) * 3), entry_size - (sizeof (guint32) * 3));
+			crc = journal_crc (jreader->crc_type,
+			                   jreader->entry_begin + (sizeof (guint32) * 3),
+			                   entry_size - (sizeof (guint32) * 3));
 
 			/* Verify checksum */
 			if (crc != crc_check) {
 				/* damaged journal entry */
 				g_set_error (error, TRACKER_DB_JOURNAL_ERROR,
 				             TRACKER_DB_JOURNAL_ERROR_DAMAGED_JOURNAL_ENTRY,
-				             "Damaged journal entry, 0x%.8x != 0x%.8x (crc32 failed)",
+				             "Damaged journal entry, 0x%.8x != 0x%.8x (%s failed)",
 				             crc,
-				             crc_check);
+				             crc_check,
+				             jreader->crc_type == TRACKER_CRC32_CASTAGNOLI ? "crc32c" : "crc32");
 				return FALSE;
 			}
 		}
@@ -1797,6 +1895,14 @@ db_journal_reader_next (JournalReader *jreader, gboolean global_reader, GError *
 				g_propagate_error (error, inner_error);
 				return FALSE;
 			}
+		} else if (df == DATA_FORMAT_FORGET_DATA_SOURCE) {
+			jreader->type = TRACKER_DB_JOURNAL_FORGET_DATA_SOURCE;
+
+			jreader->s_id = journal_read_uint32 (jreader, &inner_error);
+			if (inner_error) {
+				g_propagate_error (error, inner_error);
+				return FALSE;
+			}
 		} else {
 			if (df & DATA_FORMAT_OPERATION_DELETE) {
 				if (df & DATA_FORMAT_OBJECT_ID) {
@@ -1924,6 +2030,17 @@ tracker_db_journal_reader_get_resource (gint         *id,
 	return TRUE;
 }
 
+gboolean
+tracker_db_journal_reader_get_data_source (gint *ds_id)
+{
+	g_return_val_if_fail (reader.file != NULL || reader.stream != NULL, FALSE);
+	g_return_val_if_fail (reader.type == TRACKER_DB_JOURNAL_FORGET_DATA_SOURCE, FALSE);
+
+	*ds_id = reader.s_id;
+
+	return TRUE;
+}
+
 gboolean
 tracker_db_journal_reader_get_statement (gint         *g_id,
                                          gint         *s_id,
@@ -52,6 +52,7 @@ typedef enum {
 	TRACKER_DB_JOURNAL_DELETE_STATEMENT_ID,
 	TRACKER_DB_JOURNAL_UPDATE_STATEMENT,
 	TRACKER_DB_JOURNAL_UPDATE_STATEMENT_ID,
+	TRACKER_DB_JOURNAL_FORGET_DATA_SOURCE,
 } TrackerDBJournalEntryType;
 
 GQuark       tracker_db_journal_error_quark                  (void);
@@ -105,6 +106,7 @@ gboolean     tracker_db_journal_append_update_statement_id   (gint         g_id,
                                                               gint         o_id);
 gboolean     tracker_db_journal_append_resource              (gint         s_id,
                                                               const gchar *uri);
+gboolean     tracker_db_journal_append_forget_data_source    (gint         ds_id);
 
 gboolean     tracker_db_journal_rollback_transaction         (GError **error);
 gboolean     tracker_db_journal_commit_db_transaction        (GError **error);
@@ -127,6 +129,7 @@ gboolean     tracker_db_journal_reader_next                  (GError      **erro
 gint64       tracker_db_journal_reader_get_time              (void);
 gboolean     tracker_db_journal_reader_get_resource          (gint         *id,
                                                               const gchar **uri);
+gboolean     tracker_db_journal_reader_get_data_source       (gint         *ds_id);
 gboolean     tracker_db_journal_reader_get_statement         (gint         *g_id,
                                                               gint         *s_id,
                                                               gint         *p_id,
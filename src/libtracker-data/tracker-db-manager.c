@@ -33,10 +33,13 @@
 
 #include <glib/gstdio.h>
 
+#include <sqlite3.h>
+
 #include <libtracker-common/tracker-date-time.h>
 #include <libtracker-common/tracker-file-utils.h>
 #include <libtracker-common/tracker-utils.h>
 #include <libtracker-common/tracker-locale.h>
+#include <libtracker-common/tracker-ontologies.h>
 
 #if HAVE_TRACKER_FTS
 #include <libtracker-fts/tracker-fts.h>
@@ -47,6 +50,7 @@
 #include "tracker-db-interface-sqlite.h"
 #include "tracker-db-interface.h"
 #include "tracker-data-manager.h"
+#include "tracker-ontologies.h"
 
 /* ZLib buffer settings */
 #define ZLIB_BUF_SIZE                 8192
@@ -64,10 +68,22 @@
 
 #define IN_USE_FILENAME               ".meta.isrunning"
 
+/* Every thread running queries opens its own connection, each
+ * with its own page and statement caches, so keep them bounded.
+ */
+#define MIN_READ_INTERFACES           2
+#define MAX_READ_INTERFACES           8
+
 /* Stamp files to know crawling/indexing state */
 #define FIRST_INDEX_FILENAME          "first-index.txt"
 #define LAST_CRAWL_FILENAME           "last-crawl.txt"
 #define NEED_MTIME_CHECK_FILENAME     "no-need-mtime-check.txt"
+#define INDEXES_PENDING_FILENAME      "indexes-pending.txt"
+
+/* Per-volume databases, one file per removable volume UUID */
+#define VOLUMES_DIRNAME               "volumes"
+#define VOLUME_SCHEMA_PREFIX          "volume_"
+#define VOLUME_UUID_MAX_LENGTH        128
 
 typedef enum {
 	TRACKER_DB_LOCATION_DATA_DIR,
@@ -116,6 +132,13 @@ typedef struct {
 	guint64             mtime;
 } TrackerDBDefinition;
 
+typedef struct {
+	gchar              *uuid;
+	const gchar        *schema;
+	gchar              *abs_filename;
+	GHashTable         *tables; /* tables holding rows, protected by volumes_mutex */
+} TrackerDBVolume;
+
 static TrackerDBDefinition dbs[] = {
 	{ TRACKER_DB_UNKNOWN,
 	  TRACKER_DB_LOCATION_USER_DATA_DIR,
@@ -173,6 +196,14 @@ static GMutex                global_mutex;
 
 static TrackerDBInterface   *global_iface;
 
+/* Volume databases attached to every connection, protected by
+ * volumes_mutex. Connections compare volumes_generation against
+ * the one they were last synchronized with.
+ */
+static GMutex                volumes_mutex;
+static GHashTable           *volumes;
+static gint                  volumes_generation;
+
 static const gchar *
 location_to_directory (TrackerDBLocation location)
 {
@@ -479,6 +510,7 @@ db_manager_remove_all (gboolean rm_journal)
 	tracker_db_manager_set_first_index_done (FALSE);
 	tracker_db_manager_set_last_crawl_done (FALSE);
 	tracker_db_manager_set_need_mtime_check (TRUE);
+	tracker_db_manager_set_indexes_pending (FALSE);
 
 	/* NOTE: We don't have to be initialized for this so we
 	 * calculate the absolute directories here.
@@ -1281,6 +1313,11 @@ tracker_db_manager_shutdown (void)
 	g_free (user_data_dir);
 	user_data_dir = NULL;
 
+	if (volumes) {
+		g_hash_table_unref (volumes);
+		volumes = NULL;
+	}
+
 	if (global_iface) {
 		/* libtracker-direct */
 		g_object_unref (global_iface);
@@ -1480,260 +1517,1263 @@ tracker_db_manager_get_db_interfaces_ro (GError **error,
 	return connection;
 }
 
-/**
- * tracker_db_manager_get_db_interface:
- *
- * Request a database connection to the database
- *
- * The caller must NOT g_object_unref the result
- *
- * returns: (callee-owns): a database connection
- **/
-TrackerDBInterface *
-tracker_db_manager_get_db_interface (void)
+static void
+db_volume_free (TrackerDBVolume *volume)
 {
-	GError *internal_error = NULL;
-	TrackerDBInterface *interface;
-
-	g_return_val_if_fail (initialized != FALSE, NULL);
-
-	if (global_iface) {
-		/* libtracker-direct */
-		return global_iface;
-	}
+	g_free (volume->uuid);
+	g_free (volume->abs_filename);
+	g_hash_table_unref (volume->tables);
+	g_slice_free (TrackerDBVolume, volume);
+}
 
-#if GLIB_CHECK_VERSION (2,31,0)
-	interface = g_private_get (&interface_data_key);
-#else
-	interface = g_static_private_get (&interface_data_key);
-#endif
+static TrackerDBVolume *
+db_volume_new (const gchar *uuid)
+{
+	TrackerDBVolume *volume;
+	gchar *filename;
+	GString *schema;
+	const gchar *p;
 
-	/* Ensure the interface is there */
-	if (!interface) {
-		interface = tracker_db_manager_get_db_interfaces (&internal_error, 1,
-		                                                  TRACKER_DB_METADATA);
+	g_return_val_if_fail (tracker_db_manager_volume_uuid_is_valid (uuid), NULL);
 
-		if (internal_error) {
-			g_critical ("Error opening database: %s", internal_error->message);
-			g_error_free (internal_error);
-			return NULL;
-		}
+	/* Schema names are case insensitive in SQLite, and used
+	 * unquoted in some places, so hex encode the UUID to get
+	 * a distinct plain identifier for each one.
+	 */
+	schema = g_string_new (VOLUME_SCHEMA_PREFIX);
 
-		tracker_data_manager_init_fts (interface, FALSE);
+	for (p = uuid; *p; p++) {
+		g_string_append_printf (schema, "%02x", (guchar) *p);
+	}
 
-		tracker_db_interface_set_max_stmt_cache_size (interface,
-		                                              TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT,
-		                                              s_cache_size);
+	filename = g_strconcat (uuid, ".db", NULL);
 
-		tracker_db_interface_set_max_stmt_cache_size (interface,
-		                                              TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE,
-		                                              u_cache_size);
+	volume = g_slice_new0 (TrackerDBVolume);
+	volume->uuid = g_strdup (uuid);
+	volume->schema = g_intern_string (schema->str);
+	volume->abs_filename = g_build_filename (data_dir, VOLUMES_DIRNAME, filename, NULL);
+	volume->tables = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-#if GLIB_CHECK_VERSION (2,31,0)
-		g_private_set (&interface_data_key, interface);
-#else
-		g_static_private_set (&interface_data_key, interface, (GDestroyNotify)g_object_unref);
-#endif
-	}
+	g_free (filename);
+	g_string_free (schema, TRUE);
 
-	return interface;
+	return volume;
 }
 
-/**
- * tracker_db_manager_has_enough_space:
- *
- * Checks whether the file system, where the database files are stored,
- * has enough free space to allow modifications.
- *
- * returns: TRUE if there is enough space, FALSE otherwise
- **/
-gboolean
-tracker_db_manager_has_enough_space  (void)
+static void
+db_volume_attach (TrackerDBInterface  *iface,
+                  TrackerDBVolume     *volume,
+                  GError             **error)
 {
-	return tracker_file_system_has_enough_space (data_dir, TRACKER_DB_MIN_REQUIRED_SPACE, FALSE);
+	gchar *query;
+
+	/* Data directories may contain quotes */
+	query = sqlite3_mprintf ("ATTACH %Q AS \"%w\"",
+	                         volume->abs_filename,
+	                         volume->schema);
+	tracker_db_interface_execute_query (iface, error, "%s", query);
+	sqlite3_free (query);
 }
 
-
-inline static gchar *
-get_first_index_filename (void)
+static void
+db_volume_unlink (TrackerDBVolume *volume)
 {
-	return g_build_filename (g_get_user_cache_dir (),
-	                         "tracker",
-	                         FIRST_INDEX_FILENAME,
-	                         NULL);
-}
+	gchar *path;
 
-/**
- * tracker_db_manager_get_first_index_done:
- *
- * Check if first full index of files was already done.
- *
- * Returns: %TRUE if a first full index have been done, %FALSE otherwise.
- **/
-gboolean
-tracker_db_manager_get_first_index_done (void)
-{
-	gboolean exists;
-	gchar *filename;
+	g_unlink (volume->abs_filename);
 
-	filename = get_first_index_filename ();
-	exists = g_file_test (filename, G_FILE_TEST_EXISTS);
-	g_free (filename);
+	path = g_strconcat (volume->abs_filename, "-wal", NULL);
+	g_unlink (path);
+	g_free (path);
 
-	return exists;
+	path = g_strconcat (volume->abs_filename, "-shm", NULL);
+	g_unlink (path);
+	g_free (path);
 }
 
-/**
- * tracker_db_manager_set_first_index_done:
- *
- * Set the status of the first full index of files. Should be set to
- *  %FALSE if the index was never done or if a reindex is needed. When
- *  the index is completed, should be set to %TRUE.
- **/
-void
-tracker_db_manager_set_first_index_done (gboolean done)
+/* Class and property tables of the main database */
+static GPtrArray *
+db_main_tables (TrackerDBInterface *iface)
 {
-	gboolean already_exists;
-	gchar *filename;
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor;
+	GPtrArray *tables;
+	GError *error = NULL;
 
-	filename = get_first_index_filename ();
-	already_exists = g_file_test (filename, G_FILE_TEST_EXISTS);
+	tables = g_ptr_array_new_with_free_func (g_free);
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &error,
+	                                              "SELECT name FROM main.sqlite_master "
+	                                              "WHERE type = 'table' AND name LIKE '%%:%%'");
 
-	if (done && !already_exists) {
-		GError *error = NULL;
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &error);
+		g_object_unref (stmt);
 
-		/* If done, create stamp file if not already there */
-		if (!g_file_set_contents (filename, PACKAGE_VERSION, -1, &error)) {
-			g_warning ("  Could not create file:'%s' failed, %s",
-			           filename,
-			           error->message);
-			g_error_free (error);
-		} else {
-			g_message ("  First index file:'%s' created",
-			           filename);
+		while (cursor && tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+			g_ptr_array_add (tables, g_strdup (tracker_db_cursor_get_string (cursor, 0, NULL)));
 		}
-	} else if (!done && already_exists) {
-		/* If NOT done, remove stamp file */
-		g_message ("  Removing first index file:'%s'", filename);
 
-		if (g_remove (filename)) {
-			g_warning ("    Could not remove file:'%s', %s",
-			           filename,
-			           g_strerror (errno));
-		}
+		g_clear_object (&cursor);
 	}
 
-	g_free (filename);
-}
+	if (error) {
+		g_warning ("Could not list tables: %s", error->message);
+		g_error_free (error);
+	}
 
-inline static gchar *
-get_last_crawl_filename (void)
-{
-	return g_build_filename (g_get_user_cache_dir (),
-	                         "tracker",
-	                         LAST_CRAWL_FILENAME,
-	                         NULL);
+	return tables;
 }
 
-/**
- * tracker_db_manager_get_last_crawl_done:
- *
- * Check when last crawl was performed.
- *
- * Returns: time_t() value when last crawl occurred, otherwise 0.
- **/
-guint64
-tracker_db_manager_get_last_crawl_done (void)
+/* Tables and indexes of the main database that hold resource data,
+ * these are the ones named after ontology classes and properties.
+ */
+static TrackerDBCursor *
+db_schema_objects_cursor (TrackerDBInterface  *iface,
+                          const gchar         *schema,
+                          GError             **error)
 {
-	gchar *filename;
-	gchar *content;
-	guint64 then;
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor;
 
-	filename = get_last_crawl_filename ();
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, error,
+	                                              "SELECT type, name, sql FROM \"%s\".sqlite_master "
+	                                              "WHERE type IN ('table', 'index') AND sql IS NOT NULL "
+	                                              "AND name LIKE '%%:%%' "
+	                                              "ORDER BY type DESC",
+	                                              schema);
 
-	if (!g_file_get_contents (filename, &content, NULL, NULL)) {
-		g_message ("  No previous timestamp, crawling forced");
-		return 0;
+	if (!stmt) {
+		return NULL;
 	}
 
-	then = g_ascii_strtoull (content, NULL, 10);
-	g_free (content);
+	cursor = tracker_db_statement_start_cursor (stmt, error);
+	g_object_unref (stmt);
 
-	return then;
+	return cursor;
 }
 
-/**
- * tracker_db_manager_set_last_crawl_done:
- *
- * Set the status of the first full index of files. Should be set to
- *  %FALSE if the index was never done or if a reindex is needed. When
- *  the index is completed, should be set to %TRUE.
- **/
-void
-tracker_db_manager_set_last_crawl_done (gboolean done)
+/* Makes sure the volume database has the same tables and indexes
+ * as the main database, the union views rely on that. Missing
+ * objects are created, a changed table means the volume database
+ * was created with an older ontology.
+ */
+static gboolean
+db_volume_check_schema (TrackerDBInterface  *iface,
+                        TrackerDBVolume     *volume,
+                        GError             **error)
 {
-	gboolean already_exists;
-	gchar *filename;
+	TrackerDBCursor *cursor;
+	GHashTable *volume_objects;
+	GError *internal_error = NULL;
+	gboolean retval = TRUE;
 
-	filename = get_last_crawl_filename ();
-	already_exists = g_file_test (filename, G_FILE_TEST_EXISTS);
+	volume_objects = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
-	if (done && !already_exists) {
-		GError *error = NULL;
-		gchar *content;
+	cursor = db_schema_objects_cursor (iface, volume->schema, &internal_error);
 
-		content = g_strdup_printf ("%" G_GUINT64_FORMAT, (guint64) time (NULL));
+	while (cursor && tracker_db_cursor_iter_next (cursor, NULL, &internal_error)) {
+		g_hash_table_insert (volume_objects,
+		                     g_strdup (tracker_db_cursor_get_string (cursor, 1, NULL)),
+		                     g_strdup (tracker_db_cursor_get_string (cursor, 2, NULL)));
+	}
 
-		/* If done, create stamp file if not already there */
-		if (!g_file_set_contents (filename, content, -1, &error)) {
-			g_warning ("  Could not create file:'%s' failed, %s",
-			           filename,
-			           error->message);
-			g_error_free (error);
-		} else {
-			g_message ("  Last crawl file:'%s' created",
-			           filename);
+	g_clear_object (&cursor);
+
+	if (!internal_error) {
+		cursor = db_schema_objects_cursor (iface, "main", &internal_error);
+	}
+
+	while (retval && cursor &&
+	       tracker_db_cursor_iter_next (cursor, NULL, &internal_error)) {
+		const gchar *type, *name, *sql, *volume_sql, *name_pos;
+		gchar *quoted_name;
+		GString *create;
+
+		type = tracker_db_cursor_get_string (cursor, 0, NULL);
+		name = tracker_db_cursor_get_string (cursor, 1, NULL);
+		sql = tracker_db_cursor_get_string (cursor, 2, NULL);
+		volume_sql = g_hash_table_lookup (volume_objects, name);
+
+		if (volume_sql) {
+			if (strcmp (type, "table") == 0 && strcmp (sql, volume_sql) != 0) {
+				g_set_error (&internal_error,
+				             TRACKER_DB_INTERFACE_ERROR,
+				             TRACKER_DB_OPEN_ERROR,
+				             "Table '%s' differs from the main database",
+				             name);
+				retval = FALSE;
+			}
+
+			continue;
 		}
 
-		g_free (content);
-	} else if (!done && already_exists) {
-		/* If NOT done, remove stamp file */
-		g_message ("  Removing last crawl file:'%s'", filename);
+		/* Qualify the created object with the volume schema,
+		 * the stored statement has the name right after the
+		 * CREATE TABLE/INDEX keywords.
+		 */
+		quoted_name = g_strdup_printf ("\"%s\"", name);
+		name_pos = strstr (sql, quoted_name);
+		g_free (quoted_name);
 
-		if (g_remove (filename)) {
-			g_warning ("    Could not remove file:'%s', %s",
-			           filename,
-			           g_strerror (errno));
+		if (!name_pos) {
+			continue;
+		}
+
+		create = g_string_new_len (sql, name_pos - sql);
+		g_string_append_printf (create, "\"%s\".%s", volume->schema, name_pos);
+		tracker_db_interface_execute_query (iface, &internal_error, "%s", create->str);
+		g_string_free (create, TRUE);
+
+		if (internal_error) {
+			retval = FALSE;
 		}
 	}
 
-	g_free (filename);
-}
+	g_clear_object (&cursor);
+	g_hash_table_unref (volume_objects);
 
-inline static gchar *
-get_need_mtime_check_filename (void)
-{
-	return g_build_filename (g_get_user_cache_dir (),
-	                         "tracker",
-	                         NEED_MTIME_CHECK_FILENAME,
-	                         NULL);
+	if (internal_error) {
+		g_propagate_error (error, internal_error);
+		retval = FALSE;
+	}
+
+	return retval;
 }
 
-/**
- * tracker_db_manager_get_need_mtime_check:
- *
- * Check if the miner-fs was cleanly shutdown or not.
- *
- * Returns: %TRUE if we need to check mtimes for directories against
- * the database on the next start for the miner-fs, %FALSE otherwise.
- *
- * Since: 0.10
- **/
-gboolean
-tracker_db_manager_get_need_mtime_check (void)
+/* Most class and property tables stay empty in volume databases,
+ * the union views only cover the volume tables holding rows.
+ */
+static void
+db_volume_find_tables (TrackerDBInterface *iface,
+                       TrackerDBVolume    *volume)
 {
-	gboolean exists;
-	gchar *filename;
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor;
+	GPtrArray *tables;
+	guint i;
+
+	tables = db_main_tables (iface);
+
+	for (i = 0; i < tables->len; i++) {
+		const gchar *table = g_ptr_array_index (tables, i);
+		gboolean has_rows = FALSE;
+
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, NULL,
+		                                              "SELECT 1 FROM \"%s\".\"%s\" LIMIT 1",
+		                                              volume->schema, table);
+
+		if (stmt) {
+			cursor = tracker_db_statement_start_cursor (stmt, NULL);
+			g_object_unref (stmt);
+
+			if (cursor) {
+				has_rows = tracker_db_cursor_iter_next (cursor, NULL, NULL);
+				g_object_unref (cursor);
+			}
+		}
+
+		if (has_rows) {
+			g_hash_table_insert (volume->tables, g_strdup (table), GINT_TO_POINTER (TRUE));
+		}
+	}
+
+	g_ptr_array_unref (tables);
+}
+
+/* A forget commits the removal of the volume resources from the
+ * Resource table before the database file is removed, a database
+ * whose resources are not there anymore was left behind by an
+ * interrupted forget.
+ */
+static gboolean
+db_volume_is_forgotten (TrackerDBInterface *iface,
+                        TrackerDBVolume    *volume)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor;
+	gboolean forgotten = FALSE;
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, NULL,
+	                                              "SELECT 1 FROM (SELECT ID FROM \"%s\".\"rdfs:Resource\" LIMIT 1) AS V "
+	                                              "WHERE NOT EXISTS (SELECT 1 FROM \"main\".Resource WHERE ID = V.ID)",
+	                                              volume->schema);
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, NULL);
+		g_object_unref (stmt);
+
+		if (cursor) {
+			forgotten = tracker_db_cursor_iter_next (cursor, NULL, NULL);
+			g_object_unref (cursor);
+		}
+	}
+
+	return forgotten;
+}
+
+static gboolean
+db_volume_prepare (TrackerDBInterface  *iface,
+                   TrackerDBVolume     *volume,
+                   gboolean             readonly,
+                   GError             **error)
+{
+	GError *internal_error = NULL;
+
+	db_volume_attach (iface, volume, &internal_error);
+
+	if (internal_error) {
+		g_propagate_error (error, internal_error);
+		return FALSE;
+	}
+
+	if (!readonly) {
+		db_volume_check_schema (iface, volume, &internal_error);
+
+		if (!internal_error && db_volume_is_forgotten (iface, volume)) {
+			g_message ("Removing forgotten volume database... '%s'", volume->abs_filename);
+
+			db_exec_no_reply (iface, "DETACH \"%s\"", volume->schema);
+			db_volume_unlink (volume);
+			db_volume_attach (iface, volume, &internal_error);
+
+			if (internal_error) {
+				g_propagate_error (error, internal_error);
+				return FALSE;
+			}
+
+			db_volume_check_schema (iface, volume, &internal_error);
+		}
+	}
+
+	if (!internal_error) {
+		db_volume_find_tables (iface, volume);
+	}
+
+	db_exec_no_reply (iface, "DETACH \"%s\"", volume->schema);
+
+	if (internal_error) {
+		g_propagate_error (error, internal_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Returns the statement creating the union view for @table over
+ * the main database and the volume databases in @attached holding
+ * rows in it, or %NULL if none does, the main table is then used
+ * as is. Must be called with volumes_mutex held.
+ */
+static gchar *
+db_volumes_view_sql (GHashTable  *attached,
+                     const gchar *table)
+{
+	TrackerDBVolume *volume;
+	GHashTableIter iter;
+	GString *sql = NULL;
+
+	g_hash_table_iter_init (&iter, volumes);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &volume)) {
+		if (!g_hash_table_lookup (attached, volume->schema) ||
+		    !g_hash_table_lookup (volume->tables, table)) {
+			continue;
+		}
+
+		if (!sql) {
+			sql = g_string_new (NULL);
+			g_string_append_printf (sql,
+			                        "CREATE TEMP VIEW \"%s\" AS SELECT * FROM \"main\".\"%s\"",
+			                        table, table);
+		}
+
+		g_string_append_printf (sql,
+		                        " UNION ALL SELECT * FROM \"%s\".\"%s\"",
+		                        volume->schema, table);
+	}
+
+	return sql ? g_string_free (sql, FALSE) : NULL;
+}
+
+/* Brings the attached volume databases of a connection up to date,
+ * class and property tables are shadowed by temporary views over
+ * the main and volume tables, so queries see the union of all of
+ * them. A UNION ALL view can't be flattened into the queries using
+ * it, so tables empty in every volume database get no view. Writes
+ * qualify the table with the schema they go to.
+ */
+static void
+db_interface_sync_volumes (TrackerDBInterface *iface)
+{
+	GHashTable *attached;
+	GHashTableIter iter;
+	TrackerDBVolume *volume;
+	TrackerDBCursor *cursor;
+	TrackerDBStatement *stmt;
+	GPtrArray *views, *tables;
+	GError *error = NULL;
+	const gchar *schema;
+	gint generation;
+	guint i;
+
+	generation = g_atomic_int_get (&volumes_generation);
+
+	if (GPOINTER_TO_INT (g_object_get_data (G_OBJECT (iface), "tracker-volumes-generation")) == generation) {
+		return;
+	}
+
+	/* ATTACH/DETACH are not possible within a transaction,
+	 * this is retried next time the connection is requested.
+	 */
+	if (tracker_db_interface_sqlite_in_use (iface)) {
+		return;
+	}
+
+	attached = g_object_get_data (G_OBJECT (iface), "tracker-volumes");
+
+	if (!attached) {
+		attached = g_hash_table_new (g_str_hash, g_str_equal);
+		g_object_set_data_full (G_OBJECT (iface), "tracker-volumes",
+		                        attached, (GDestroyNotify) g_hash_table_unref);
+	}
+
+	/* Drop the union views first, they reference the schemas */
+	views = g_ptr_array_new_with_free_func (g_free);
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &error,
+	                                              "SELECT name FROM sqlite_temp_master WHERE type = 'view'");
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &error);
+		g_object_unref (stmt);
+
+		while (cursor && tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+			g_ptr_array_add (views, g_strdup (tracker_db_cursor_get_string (cursor, 0, NULL)));
+		}
+
+		g_clear_object (&cursor);
+	}
+
+	for (i = 0; i < views->len; i++) {
+		db_exec_no_reply (iface, "DROP VIEW temp.\"%s\"", (gchar *) g_ptr_array_index (views, i));
+	}
+
+	g_ptr_array_set_size (views, 0);
+
+	tables = db_main_tables (iface);
+
+	g_mutex_lock (&volumes_mutex);
+
+	g_hash_table_iter_init (&iter, attached);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &schema, NULL)) {
+		gboolean found = FALSE;
+		GHashTableIter volumes_iter;
+
+		if (volumes) {
+			g_hash_table_iter_init (&volumes_iter, volumes);
+			while (!found && g_hash_table_iter_next (&volumes_iter, NULL, (gpointer *) &volume)) {
+				found = (volume->schema == schema);
+			}
+		}
+
+		if (!found) {
+			db_exec_no_reply (iface, "DETACH \"%s\"", schema);
+			g_hash_table_iter_remove (&iter);
+		}
+	}
+
+	if (volumes) {
+		g_hash_table_iter_init (&iter, volumes);
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &volume)) {
+			if (g_hash_table_lookup (attached, volume->schema)) {
+				continue;
+			}
+
+			db_volume_attach (iface, volume, &error);
+
+			if (error) {
+				g_warning ("Could not attach volume database '%s': %s",
+				           volume->abs_filename, error->message);
+				g_clear_error (&error);
+				continue;
+			}
+
+			g_hash_table_insert (attached, (gpointer) volume->schema, GINT_TO_POINTER (TRUE));
+		}
+
+		for (i = 0; i < tables->len; i++) {
+			gchar *sql;
+
+			sql = db_volumes_view_sql (attached, g_ptr_array_index (tables, i));
+
+			if (sql) {
+				g_ptr_array_add (views, sql);
+			}
+		}
+	}
+
+	g_mutex_unlock (&volumes_mutex);
+
+	for (i = 0; i < views->len; i++) {
+		db_exec_no_reply (iface, "%s", (gchar *) g_ptr_array_index (views, i));
+	}
+
+	g_ptr_array_unref (views);
+	g_ptr_array_unref (tables);
+
+	if (error) {
+		g_warning ("Could not set up volume databases: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_object_set_data (G_OBJECT (iface), "tracker-volumes-generation",
+	                   GINT_TO_POINTER (generation));
+}
+
+/**
+ * tracker_db_manager_load_volumes:
+ * @remove: whether existing volume databases must be discarded
+ *
+ * Attaches the volume databases found in the data directory, this
+ * must happen once the ontology in the main database is final, as
+ * volume databases created with an older ontology are discarded.
+ * Does nothing unless %TRACKER_DB_MANAGER_VOLUME_DATABASES was given.
+ **/
+void
+tracker_db_manager_load_volumes (gboolean remove)
+{
+	TrackerDBInterface *iface;
+	gboolean readonly;
+	const gchar *name;
+	gchar *dirname;
+	GDir *dir;
+
+	g_return_if_fail (initialized != FALSE);
+
+	if ((old_flags & TRACKER_DB_MANAGER_VOLUME_DATABASES) == 0 || volumes) {
+		return;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+	readonly = (old_flags & TRACKER_DB_MANAGER_READONLY) != 0;
+
+	volumes = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+	                                 (GDestroyNotify) db_volume_free);
+
+	dirname = g_build_filename (data_dir, VOLUMES_DIRNAME, NULL);
+	dir = g_dir_open (dirname, 0, NULL);
+	g_free (dirname);
+
+	if (!dir) {
+		return;
+	}
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		TrackerDBVolume *volume;
+		GError *error = NULL;
+		gchar *uuid;
+
+		if (!g_str_has_suffix (name, ".db")) {
+			continue;
+		}
+
+		uuid = g_strndup (name, strlen (name) - strlen (".db"));
+
+		if (!tracker_db_manager_volume_uuid_is_valid (uuid)) {
+			/* Not created by us, leave it alone */
+			g_free (uuid);
+			continue;
+		}
+
+		volume = db_volume_new (uuid);
+		g_free (uuid);
+
+		if (remove && !readonly) {
+			/* The main database was recreated */
+			db_volume_unlink (volume);
+			db_volume_free (volume);
+			continue;
+		}
+
+		if (!db_volume_prepare (iface, volume, readonly, &error)) {
+			g_message ("Dropping volume database '%s': %s",
+			           volume->abs_filename, error->message);
+			g_error_free (error);
+
+			if (!readonly) {
+				/* Outdated, the miner will index the volume again */
+				db_volume_unlink (volume);
+			}
+
+			db_volume_free (volume);
+			continue;
+		}
+
+		g_message ("Loading volume database... '%s'", volume->abs_filename);
+		g_hash_table_insert (volumes, volume->uuid, volume);
+	}
+
+	g_dir_close (dir);
+
+	if (g_hash_table_size (volumes) > 0) {
+		g_atomic_int_inc (&volumes_generation);
+		db_interface_sync_volumes (iface);
+	}
+}
+
+/**
+ * tracker_db_manager_volume_uuid_is_valid:
+ * @uuid: UUID of a removable volume
+ *
+ * Checks @uuid is made of ASCII letters, digits and dashes only, as
+ * it is used to name files and databases.
+ *
+ * returns: %TRUE if @uuid can be given to
+ * tracker_db_manager_attach_volume()
+ **/
+gboolean
+tracker_db_manager_volume_uuid_is_valid (const gchar *uuid)
+{
+	const gchar *p;
+
+	if (!uuid || !*uuid) {
+		return FALSE;
+	}
+
+	for (p = uuid; *p; p++) {
+		if (!g_ascii_isalnum (*p) && *p != '-') {
+			return FALSE;
+		}
+	}
+
+	return (p - uuid) <= VOLUME_UUID_MAX_LENGTH;
+}
+
+/**
+ * tracker_db_manager_attach_volume:
+ * @uuid: UUID of a removable volume
+ * @error: location for a #GError
+ *
+ * Creates if needed, and attaches the database holding the resources
+ * of the volume identified by @uuid. New resources with a
+ * nie:dataSource pointing to the volume are stored in that database
+ * from now on. Only available with %TRACKER_DB_MANAGER_VOLUME_DATABASES,
+ * and must be called with no transaction ongoing.
+ *
+ * returns: %TRUE if the volume database is attached
+ **/
+gboolean
+tracker_db_manager_attach_volume (const gchar  *uuid,
+                                  GError      **error)
+{
+	TrackerDBInterface *iface;
+	TrackerDBVolume *volume;
+	gboolean existed;
+	gchar *dirname;
+
+	g_return_val_if_fail (initialized != FALSE, FALSE);
+	g_return_val_if_fail (uuid != NULL, FALSE);
+
+	if (!tracker_db_manager_volume_uuid_is_valid (uuid)) {
+		g_set_error (error,
+		             TRACKER_DB_INTERFACE_ERROR,
+		             TRACKER_DB_OPEN_ERROR,
+		             "Invalid volume UUID '%s'",
+		             uuid);
+		return FALSE;
+	}
+
+	if ((old_flags & TRACKER_DB_MANAGER_VOLUME_DATABASES) == 0 ||
+	    (old_flags & TRACKER_DB_MANAGER_READONLY) != 0) {
+		g_set_error (error,
+		             TRACKER_DB_INTERFACE_ERROR,
+		             TRACKER_DB_OPEN_ERROR,
+		             "Volume databases are not enabled");
+		return FALSE;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	g_mutex_lock (&volumes_mutex);
+
+	if (g_hash_table_lookup (volumes, uuid)) {
+		g_mutex_unlock (&volumes_mutex);
+		return TRUE;
+	}
+
+	dirname = g_build_filename (data_dir, VOLUMES_DIRNAME, NULL);
+	g_mkdir_with_parents (dirname, 00755);
+	g_free (dirname);
+
+	volume = db_volume_new (uuid);
+	existed = g_file_test (volume->abs_filename, G_FILE_TEST_EXISTS);
+
+	if (!db_volume_prepare (iface, volume, FALSE, error)) {
+		g_mutex_unlock (&volumes_mutex);
+
+		/* Only clean up after ourselves */
+		if (!existed) {
+			db_volume_unlink (volume);
+		}
+
+		db_volume_free (volume);
+		return FALSE;
+	}
+
+	g_message ("Attaching volume database... '%s'", volume->abs_filename);
+	g_hash_table_insert (volumes, volume->uuid, volume);
+	g_atomic_int_inc (&volumes_generation);
+
+	g_mutex_unlock (&volumes_mutex);
+
+	db_interface_sync_volumes (iface);
+
+	return TRUE;
+}
+
+/**
+ * tracker_db_manager_forget_volume:
+ * @uuid: UUID of a removable volume
+ * @error: location for a #GError
+ *
+ * Drops all resources stored in the database of the volume identified
+ * by @uuid, by detaching and removing the database file. Must be
+ * called with no transaction ongoing, through tracker_data_forget_volume()
+ * so the journal and the Resource table of the main database follow.
+ *
+ * returns: %TRUE if the volume had a database and it was removed
+ **/
+gboolean
+tracker_db_manager_forget_volume (const gchar  *uuid,
+                                  GError      **error)
+{
+	TrackerDBInterface *iface;
+	TrackerDBVolume *volume;
+	TrackerClass **classes;
+	guint i, n_classes;
+
+	g_return_val_if_fail (initialized != FALSE, FALSE);
+	g_return_val_if_fail (uuid != NULL, FALSE);
+
+	if (!tracker_db_manager_volume_uuid_is_valid (uuid)) {
+		g_set_error (error,
+		             TRACKER_DB_INTERFACE_ERROR,
+		             TRACKER_DB_OPEN_ERROR,
+		             "Invalid volume UUID '%s'",
+		             uuid);
+		return FALSE;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	g_mutex_lock (&volumes_mutex);
+	volume = volumes ? g_hash_table_lookup (volumes, uuid) : NULL;
+	g_mutex_unlock (&volumes_mutex);
+
+	if (!volume) {
+		g_set_error (error,
+		             TRACKER_DB_INTERFACE_ERROR,
+		             TRACKER_DB_OPEN_ERROR,
+		             "No database for volume '%s'",
+		             uuid);
+		return FALSE;
+	}
+
+	if (tracker_db_interface_sqlite_in_use (iface)) {
+		g_set_error (error,
+		             TRACKER_DB_INTERFACE_ERROR,
+		             TRACKER_DB_INTERRUPTED,
+		             "Database is in use");
+		return FALSE;
+	}
+
+	/* Keep the class counts in sync with what remains */
+	classes = tracker_ontologies_get_classes (&n_classes);
+
+	for (i = 0; i < n_classes; i++) {
+		TrackerDBStatement *stmt;
+		TrackerDBCursor *cursor = NULL;
+
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, NULL,
+		                                              "SELECT COUNT(1) FROM \"%s\".\"%s\"",
+		                                              volume->schema,
+		                                              tracker_class_get_name (classes[i]));
+
+		if (stmt) {
+			cursor = tracker_db_statement_start_cursor (stmt, NULL);
+			g_object_unref (stmt);
+		}
+
+		if (cursor && tracker_db_cursor_iter_next (cursor, NULL, NULL)) {
+			gint count;
+
+			count = tracker_db_cursor_get_int (cursor, 0);
+			tracker_class_set_count (classes[i],
+			                         MAX (0, tracker_class_get_count (classes[i]) - count));
+		}
+
+		g_clear_object (&cursor);
+	}
+
+	g_message ("Removing volume database... '%s'", volume->abs_filename);
+
+	g_mutex_lock (&volumes_mutex);
+	g_hash_table_steal (volumes, uuid);
+	g_atomic_int_inc (&volumes_generation);
+	g_mutex_unlock (&volumes_mutex);
+
+	db_interface_sync_volumes (iface);
+
+	/* Other connections detach it next time they're used, the
+	 * data remains readable for them until then.
+	 */
+	db_volume_unlink (volume);
+	db_volume_free (volume);
+
+	return TRUE;
+}
+
+/**
+ * tracker_db_manager_get_volume_schema:
+ * @datasource: a nie:dataSource URN
+ *
+ * Returns the schema name the volume database for @datasource is
+ * attached as, if any.
+ *
+ * returns: (callee-owns): an interned schema name, or %NULL
+ **/
+const gchar *
+tracker_db_manager_get_volume_schema (const gchar *datasource)
+{
+	TrackerDBVolume *volume = NULL;
+
+	if (!volumes ||
+	    !g_str_has_prefix (datasource, TRACKER_DATASOURCE_URN_PREFIX)) {
+		return NULL;
+	}
+
+	g_mutex_lock (&volumes_mutex);
+
+	if (g_hash_table_size (volumes) > 0) {
+		volume = g_hash_table_lookup (volumes,
+		                              datasource + strlen (TRACKER_DATASOURCE_URN_PREFIX));
+	}
+
+	g_mutex_unlock (&volumes_mutex);
+
+	return volume ? volume->schema : NULL;
+}
+
+/**
+ * tracker_db_manager_set_volume_table_used:
+ * @schema: schema name of an attached volume database
+ * @table: name of a class or property table
+ *
+ * Notes that rows are about to be written to @table in the volume
+ * database attached as @schema. The first time, the union view for
+ * @table is rebuilt to cover it, right away for the connection of
+ * the calling thread, so later queries within the same transaction
+ * see these rows, and the next time they are requested for others.
+ **/
+void
+tracker_db_manager_set_volume_table_used (const gchar *schema,
+                                          const gchar *table)
+{
+	TrackerDBInterface *iface;
+	TrackerDBVolume *volume;
+	GHashTableIter iter;
+	GHashTable *attached;
+	gboolean changed = FALSE;
+	gchar *sql = NULL;
+	gint generation = 0;
+
+	if (!volumes) {
+		return;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+	attached = g_object_get_data (G_OBJECT (iface), "tracker-volumes");
+
+	g_mutex_lock (&volumes_mutex);
+
+	g_hash_table_iter_init (&iter, volumes);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &volume)) {
+		if (volume->schema != schema) {
+			continue;
+		}
+
+		if (!g_hash_table_lookup (volume->tables, table)) {
+			g_hash_table_insert (volume->tables, g_strdup (table), GINT_TO_POINTER (TRUE));
+			generation = g_atomic_int_add (&volumes_generation, 1);
+			changed = TRUE;
+
+			if (attached) {
+				sql = db_volumes_view_sql (attached, table);
+			}
+		}
+
+		break;
+	}
+
+	g_mutex_unlock (&volumes_mutex);
+
+	if (!changed) {
+		return;
+	}
+
+	db_exec_no_reply (iface, "DROP VIEW IF EXISTS temp.\"%s\"", table);
+
+	if (sql) {
+		db_exec_no_reply (iface, "%s", sql);
+		g_free (sql);
+	}
+
+	/* Nothing else changed since this connection was synchronized */
+	if (GPOINTER_TO_INT (g_object_get_data (G_OBJECT (iface), "tracker-volumes-generation")) == generation) {
+		g_object_set_data (G_OBJECT (iface), "tracker-volumes-generation",
+		                   GINT_TO_POINTER (generation + 1));
+	}
+}
+
+/**
+ * tracker_db_manager_reset_volume_views:
+ *
+ * Has the union views of the connection of the calling thread rebuilt
+ * the next time it is requested. Views created by
+ * tracker_db_manager_set_volume_table_used() within a transaction
+ * are gone once it is rolled back.
+ **/
+void
+tracker_db_manager_reset_volume_views (void)
+{
+	TrackerDBInterface *iface;
+
+	if (!volumes) {
+		return;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+	g_object_set_data (G_OBJECT (iface), "tracker-volumes-generation",
+	                   GINT_TO_POINTER (-1));
+}
+
+/**
+ * tracker_db_manager_get_volumes_generation:
+ *
+ * Returns a number that changes whenever a volume database is
+ * attached or removed.
+ *
+ * returns: the current generation of the volume databases
+ **/
+gint
+tracker_db_manager_get_volumes_generation (void)
+{
+	return g_atomic_int_get (&volumes_generation);
+}
+
+/**
+ * tracker_db_manager_get_volume_schemas:
+ *
+ * Returns the schema names of all attached volume databases.
+ *
+ * returns: (transfer container): a list of interned schema names
+ **/
+GList *
+tracker_db_manager_get_volume_schemas (void)
+{
+	TrackerDBVolume *volume;
+	GHashTableIter iter;
+	GList *schemas = NULL;
+
+	if (!volumes) {
+		return NULL;
+	}
+
+	g_mutex_lock (&volumes_mutex);
+
+	g_hash_table_iter_init (&iter, volumes);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &volume)) {
+		schemas = g_list_prepend (schemas, (gpointer) volume->schema);
+	}
+
+	g_mutex_unlock (&volumes_mutex);
+
+	return schemas;
+}
+
+/**
+ * tracker_db_manager_get_db_interface:
+ *
+ * Request a database connection to the database
+ *
+ * The caller must NOT g_object_unref the result
+ *
+ * returns: (callee-owns): a database connection
+ **/
+TrackerDBInterface *
+tracker_db_manager_get_db_interface (void)
+{
+	GError *internal_error = NULL;
+	TrackerDBInterface *interface;
+
+	g_return_val_if_fail (initialized != FALSE, NULL);
+
+	if (global_iface) {
+		/* libtracker-direct */
+		db_interface_sync_volumes (global_iface);
+		return global_iface;
+	}
+
+#if GLIB_CHECK_VERSION (2,31,0)
+	interface = g_private_get (&interface_data_key);
+#else
+	interface = g_static_private_get (&interface_data_key);
+#endif
+
+	/* Ensure the interface is there */
+	if (!interface) {
+		interface = tracker_db_manager_get_db_interfaces (&internal_error, 1,
+		                                                  TRACKER_DB_METADATA);
+
+		if (internal_error) {
+			g_critical ("Error opening database: %s", internal_error->message);
+			g_error_free (internal_error);
+			return NULL;
+		}
+
+		tracker_data_manager_init_fts (interface, FALSE);
+
+		tracker_db_interface_set_max_stmt_cache_size (interface,
+		                                              TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT,
+		                                              s_cache_size);
+
+		tracker_db_interface_set_max_stmt_cache_size (interface,
+		                                              TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE,
+		                                              u_cache_size);
+
+#if GLIB_CHECK_VERSION (2,31,0)
+		g_private_set (&interface_data_key, interface);
+#else
+		g_static_private_set (&interface_data_key, interface, (GDestroyNotify)g_object_unref);
+#endif
+	}
+
+	db_interface_sync_volumes (interface);
+
+	return interface;
+}
+
+/**
+ * tracker_db_manager_get_max_read_interfaces:
+ *
+ * Returns the number of per-thread connections that may be used
+ * to run queries concurrently, following the number of processors.
+ *
+ * returns: the maximum number of read connections
+ **/
+guint
+tracker_db_manager_get_max_read_interfaces (void)
+{
+	glong n_processors;
+
+	n_processors = sysconf (_SC_NPROCESSORS_ONLN);
+
+	return CLAMP (n_processors, MIN_READ_INTERFACES, MAX_READ_INTERFACES);
+}
+
+/**
+ * tracker_db_manager_has_enough_space:
+ *
+ * Checks whether the file system, where the database files are stored,
+ * has enough free space to allow modifications.
+ *
+ * returns: TRUE if there is enough space, FALSE otherwise
+ **/
+gboolean
+tracker_db_manager_has_enough_space  (void)
+{
+	return tracker_file_system_has_enough_space (data_dir, TRACKER_DB_MIN_REQUIRED_SPACE, FALSE);
+}
+
+
+inline static gchar *
+get_first_index_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+	                         "tracker",
+	                         FIRST_INDEX_FILENAME,
+	                         NULL);
+}
+
+/**
+ * tracker_db_manager_get_first_index_done:
+ *
+ * Check if first full index of files was already done.
+ *
+ * Returns: %TRUE if a first full index have been done, %FALSE otherwise.
+ **/
+gboolean
+tracker_db_manager_get_first_index_done (void)
+{
+	gboolean exists;
+	gchar *filename;
+
+	filename = get_first_index_filename ();
+	exists = g_file_test (filename, G_FILE_TEST_EXISTS);
+	g_free (filename);
+
+	return exists;
+}
+
+/**
+ * tracker_db_manager_set_first_index_done:
+ *
+ * Set the status of the first full index of files. Should be set to
+ *  %FALSE if the index was never done or if a reindex is needed. When
+ *  the index is completed, should be set to %TRUE.
+ **/
+void
+tracker_db_manager_set_first_index_done (gboolean done)
+{
+	gboolean already_exists;
+	gchar *filename;
+
+	filename = get_first_index_filename ();
+	already_exists = g_file_test (filename, G_FILE_TEST_EXISTS);
+
+	if (done && !already_exists) {
+		GError *error = NULL;
+
+		/* If done, create stamp file if not already there */
+		if (!g_file_set_contents (filename, PACKAGE_VERSION, -1, &error)) {
+			g_warning ("  Could not create file:'%s' failed, %s",
+			           filename,
+			           error->message);
+			g_error_free (error);
+		} else {
+			g_message ("  First index file:'%s' created",
+			           filename);
+		}
+	} else if (!done && already_exists) {
+		/* If NOT done, remove stamp file */
+		g_message ("  Removing first index file:'%s'", filename);
+
+		if (g_remove (filename)) {
+			g_warning ("    Could not remove file:'%s', %s",
+			           filename,
+			           g_strerror (errno));
+		}
+	}
+
+	g_free (filename);
+}
+
+inline static gchar *
+get_last_crawl_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+	                         "tracker",
+	                         LAST_CRAWL_FILENAME,
+	                         NULL);
+}
+
+/**
+ * tracker_db_manager_get_last_crawl_done:
+ *
+ * Check when last crawl was performed.
+ *
+ * Returns: time_t() value when last crawl occurred, otherwise 0.
+ **/
+guint64
+tracker_db_manager_get_last_crawl_done (void)
+{
+	gchar *filename;
+	gchar *content;
+	guint64 then;
+
+	filename = get_last_crawl_filename ();
+
+	if (!g_file_get_contents (filename, &content, NULL, NULL)) {
+		g_message ("  No previous timestamp, crawling forced");
+		return 0;
+	}
+
+	then = g_ascii_strtoull (content, NULL, 10);
+	g_free (content);
+
+	return then;
+}
+
+/**
+ * tracker_db_manager_set_last_crawl_done:
+ *
+ * Set the status of the first full index of files. Should be set to
+ *  %FALSE if the index was never done or if a reindex is needed. When
+ *  the index is completed, should be set to %TRUE.
+ **/
+void
+tracker_db_manager_set_last_crawl_done (gboolean done)
+{
+	gboolean already_exists;
+	gchar *filename;
+
+	filename = get_last_crawl_filename ();
+	already_exists = g_file_test (filename, G_FILE_TEST_EXISTS);
+
+	if (done && !already_exists) {
+		GError *error = NULL;
+		gchar *content;
+
+		content = g_strdup_printf ("%" G_GUINT64_FORMAT, (guint64) time (NULL));
+
+		/* If done, create stamp file if not already there */
+		if (!g_file_set_contents (filename, content, -1, &error)) {
+			g_warning ("  Could not create file:'%s' failed, %s",
+			           filename,
+			           error->message);
+			g_error_free (error);
+		} else {
+			g_message ("  Last crawl file:'%s' created",
+			           filename);
+		}
+
+		g_free (content);
+	} else if (!done && already_exists) {
+		/* If NOT done, remove stamp file */
+		g_message ("  Removing last crawl file:'%s'", filename);
+
+		if (g_remove (filename)) {
+			g_warning ("    Could not remove file:'%s', %s",
+			           filename,
+			           g_strerror (errno));
+		}
+	}
+
+	g_free (filename);
+}
+
+inline static gchar *
+get_need_mtime_check_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+	                         "tracker",
+	                         NEED_MTIME_CHECK_FILENAME,
+	                         NULL);
+}
+
+/**
+ * tracker_db_manager_get_need_mtime_check:
+ *
+ * Check if the miner-fs was cleanly shutdown or not.
+ *
+ * Returns: %TRUE if we need to check mtimes for directories against
+ * the database on the next start for the miner-fs, %FALSE otherwise.
+ *
+ * Since: 0.10
+ **/
+gboolean
+tracker_db_manager_get_need_mtime_check (void)
+{
+	gboolean exists;
+	gchar *filename;
 
 	filename = get_need_mtime_check_filename ();
 	exists = g_file_test (filename, G_FILE_TEST_EXISTS);
@@ -1800,6 +2840,80 @@ tracker_db_manager_set_need_mtime_check (gboolean needed)
 	g_free (filename);
 }
 
+inline static gchar *
+get_indexes_pending_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+	                         "tracker",
+	                         INDEXES_PENDING_FILENAME,
+	                         NULL);
+}
+
+/**
+ * tracker_db_manager_get_indexes_pending:
+ *
+ * Check if indexes were dropped, for a bulk journal replay, and not
+ * created again, e.g. as the replay failed or was interrupted.
+ *
+ * Returns: %TRUE if indexes have to be created, %FALSE otherwise.
+ **/
+gboolean
+tracker_db_manager_get_indexes_pending (void)
+{
+	gboolean exists;
+	gchar *filename;
+
+	filename = get_indexes_pending_filename ();
+	exists = g_file_test (filename, G_FILE_TEST_EXISTS);
+	g_free (filename);
+
+	return exists;
+}
+
+/**
+ * tracker_db_manager_set_indexes_pending:
+ * @pending: a #gboolean
+ *
+ * Should be set to %TRUE before indexes are dropped and to %FALSE
+ * once they are created again, so the next start can create them
+ * if that didn't happen.
+ **/
+void
+tracker_db_manager_set_indexes_pending (gboolean pending)
+{
+	gboolean already_exists;
+	gchar *filename;
+
+	filename = get_indexes_pending_filename ();
+	already_exists = g_file_test (filename, G_FILE_TEST_EXISTS);
+
+	if (pending && !already_exists) {
+		GError *error = NULL;
+
+		/* Create stamp file if not already there */
+		if (!g_file_set_contents (filename, PACKAGE_VERSION, -1, &error)) {
+			g_warning ("  Could not create file:'%s' failed, %s",
+			           filename,
+			           error->message);
+			g_error_free (error);
+		} else {
+			g_message ("  Indexes pending file:'%s' created",
+			           filename);
+		}
+	} else if (!pending && already_exists) {
+		/* Remove stamp file */
+		g_message ("  Removing indexes pending file:'%s'", filename);
+
+		if (g_remove (filename)) {
+			g_warning ("    Could not remove file:'%s', %s",
+			           filename,
+			           g_strerror (errno));
+		}
+	}
+
+	g_free (filename);
+}
+
 void
 tracker_db_manager_lock (void)
 {
@@ -32,6 +32,7 @@ G_BEGIN_DECLS
 
 #define TRACKER_DB_CACHE_SIZE_DEFAULT 250
 #define TRACKER_DB_CACHE_SIZE_UPDATE 2000
+#define TRACKER_DB_CACHE_SIZE_REPLAY 10000
 
 #define TRACKER_TYPE_DB (tracker_db_get_type ())
 
@@ -47,7 +48,8 @@ typedef enum {
 	/* 1 << 3 Was low mem mode */
 	TRACKER_DB_MANAGER_REMOVE_ALL            = 1 << 4,
 	TRACKER_DB_MANAGER_READONLY              = 1 << 5,
-	TRACKER_DB_MANAGER_DO_NOT_CHECK_ONTOLOGY = 1 << 6
+	TRACKER_DB_MANAGER_DO_NOT_CHECK_ONTOLOGY = 1 << 6,
+	TRACKER_DB_MANAGER_VOLUME_DATABASES      = 1 << 7
 } TrackerDBManagerFlags;
 
 GType               tracker_db_get_type                       (void) G_GNUC_CONST;
@@ -66,6 +68,7 @@ void                tracker_db_manager_remove_all             (gboolean
 void                tracker_db_manager_optimize               (void);
 const gchar *       tracker_db_manager_get_file               (TrackerDB              db);
 TrackerDBInterface *tracker_db_manager_get_db_interface       (void);
+guint               tracker_db_manager_get_max_read_interfaces (void);
 void                tracker_db_manager_init_locations         (void);
 gboolean            tracker_db_manager_has_enough_space       (void);
 void                tracker_db_manager_create_version_file    (void);
@@ -75,6 +78,19 @@ void                tracker_db_manager_lock                   (void);
 gboolean            tracker_db_manager_trylock                (void);
 void                tracker_db_manager_unlock                 (void);
 
+void                tracker_db_manager_load_volumes           (gboolean                remove);
+gboolean            tracker_db_manager_volume_uuid_is_valid   (const gchar            *uuid);
+gboolean            tracker_db_manager_attach_volume          (const gchar            *uuid,
+                                                               GError                **error);
+gboolean            tracker_db_manager_forget_volume          (const gchar            *uuid,
+                                                               GError                **error);
+const gchar *       tracker_db_manager_get_volume_schema      (const gchar            *datasource);
+GList *             tracker_db_manager_get_volume_schemas     (void);
+void                tracker_db_manager_set_volume_table_used  (const gchar            *schema,
+                                                               const gchar            *table);
+void                tracker_db_manager_reset_volume_views     (void);
+gint                tracker_db_manager_get_volumes_generation (void);
+
 TrackerDBManagerFlags
                     tracker_db_manager_get_flags              (guint *select_cache_size,
                                                                guint *update_cache_size);
@@ -82,10 +98,12 @@ TrackerDBManagerFlags
 gboolean            tracker_db_manager_get_first_index_done   (void);
 guint64             tracker_db_manager_get_last_crawl_done    (void);
 gboolean            tracker_db_manager_get_need_mtime_check   (void);
+gboolean            tracker_db_manager_get_indexes_pending    (void);
 
 void                tracker_db_manager_set_first_index_done   (gboolean done);
 void                tracker_db_manager_set_last_crawl_done    (gboolean done);
 void                tracker_db_manager_set_need_mtime_check   (gboolean needed);
+void                tracker_db_manager_set_indexes_pending    (gboolean pending);
 
 gboolean            tracker_db_manager_locale_changed         (void);
 void                tracker_db_manager_set_current_locale     (void);
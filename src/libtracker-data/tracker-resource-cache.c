@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "tracker-resource-cache.h"
+
+/* URI to resource ID cache, limited in size.
+ *
+ * Entries are kept in two generations, each with an open addressing
+ * table of URI hashes and an arena holding the URIs. New entries go
+ * to the current generation, when it's full the old one is dropped
+ * and the current one takes its place, entries found in the old one
+ * are moved back to the current one, so resources still in use stay.
+ *
+ * The filter is a bloom filter of all URIs in the Resource table,
+ * URIs not in it were never stored so they don't need to be queried.
+ */
+
+/* table slots take up to this part of a generation, the rest is arena,
+ * which leaves room for URIs of ~64 bytes at the most slots may be used
+ */
+#define SLOTS_SHARE 2
+#define MIN_SLOTS 64
+
+#define FILTER_HASHES 7
+/* bits per URI, ~1% false positives with the hashes above */
+#define FILTER_BITS_PER_URI 10
+#define FILTER_MIN_BITS (1 << 16)
+
+typedef struct {
+	guint64 hash;
+	guint32 offset;
+	guint32 length;
+	/* 0 for empty slots */
+	gint id;
+} TrackerResourceCacheEntry;
+
+typedef struct {
+	TrackerResourceCacheEntry *entries;
+	guint n_entries;
+	gchar *arena;
+	gsize arena_len;
+} TrackerResourceCacheGeneration;
+
+struct _TrackerResourceCache {
+	TrackerResourceCacheGeneration generations[2];
+	TrackerResourceCacheGeneration *current;
+	TrackerResourceCacheGeneration *old;
+	guint n_slots;
+	gsize arena_size;
+
+	guint64 *filter;
+	guint64 filter_bits;
+	guint filter_count;
+
+	TrackerResourceCacheStats stats;
+};
+
+static guint64
+uri_hash (const gchar *uri,
+          gsize       *length)
+{
+	const guchar *p;
+	guint64 hash = G_GUINT64_CONSTANT (14695981039346656037);
+
+	/* FNV-1a */
+	for (p = (const guchar *) uri; *p; p++) {
+		hash ^= *p;
+		hash *= G_GUINT64_CONSTANT (1099511628211);
+	}
+
+	*length = (const gchar *) p - uri;
+
+	return hash;
+}
+
+/**
+ * tracker_resource_cache_new:
+ * @max_size: the size the cache may take, in bytes, not counting
+ * the filter
+ *
+ * Returns: a new #TrackerResourceCache, without filter.
+ */
+TrackerResourceCache *
+tracker_resource_cache_new (gsize max_size)
+{
+	TrackerResourceCache *cache;
+	gsize generation_size, slots_size;
+
+	cache = g_slice_new0 (TrackerResourceCache);
+
+	generation_size = max_size / 2;
+	cache->n_slots = MIN_SLOTS;
+
+	while (cache->n_slots * 2 * sizeof (TrackerResourceCacheEntry) <= generation_size / SLOTS_SHARE) {
+		cache->n_slots *= 2;
+	}
+
+	slots_size = cache->n_slots * sizeof (TrackerResourceCacheEntry);
+	cache->arena_size = MAX (generation_size, slots_size * 2) - slots_size;
+
+	cache->current = &cache->generations[0];
+	cache->old = &cache->generations[1];
+
+	return cache;
+}
+
+static void
+generation_clear (TrackerResourceCacheGeneration *generation,
+                  guint                           n_slots)
+{
+	if (generation->entries && generation->n_entries > 0) {
+		memset (generation->entries, 0, n_slots * sizeof (TrackerResourceCacheEntry));
+	}
+
+	generation->n_entries = 0;
+	generation->arena_len = 0;
+}
+
+void
+tracker_resource_cache_free (TrackerResourceCache *cache)
+{
+	gint i;
+
+	for (i = 0; i < 2; i++) {
+		g_free (cache->generations[i].entries);
+		g_free (cache->generations[i].arena);
+	}
+
+	g_free (cache->filter);
+	g_slice_free (TrackerResourceCache, cache);
+}
+
+static TrackerResourceCacheEntry *
+generation_lookup (TrackerResourceCacheGeneration *generation,
+                   guint                           n_slots,
+                   guint64                         hash,
+                   const gchar                    *uri,
+                   gsize                           length)
+{
+	TrackerResourceCacheEntry *entry;
+	guint i;
+
+	if (generation->n_entries == 0) {
+		return NULL;
+	}
+
+	for (i = hash & (n_slots - 1); ; i = (i + 1) & (n_slots - 1)) {
+		entry = &generation->entries[i];
+
+		if (entry->id == 0) {
+			return NULL;
+		}
+
+		if (entry->hash == hash && entry->length == length &&
+		    memcmp (generation->arena + entry->offset, uri, length) == 0) {
+			return entry;
+		}
+	}
+}
+
+static void
+filter_add (TrackerResourceCache *cache,
+            guint64               hash)
+{
+	guint64 bit;
+	guint32 h1, h2;
+	gint i;
+
+	h1 = (guint32) hash;
+	h2 = (guint32) (hash >> 32) | 1;
+
+	for (i = 0; i < FILTER_HASHES; i++) {
+		bit = (h1 + (guint64) i * h2) & (cache->filter_bits - 1);
+		cache->filter[bit / 64] |= G_GUINT64_CONSTANT (1) << (bit % 64);
+	}
+
+	/* past its capacity the filter would let too many through,
+	 * better building it again for the current amount of URIs
+	 */
+	if (++cache->filter_count > cache->filter_bits / FILTER_BITS_PER_URI) {
+		tracker_resource_cache_drop_filter (cache);
+	}
+}
+
+static gboolean
+filter_contains (TrackerResourceCache *cache,
+                 guint64               hash)
+{
+	guint64 bit;
+	guint32 h1, h2;
+	gint i;
+
+	h1 = (guint32) hash;
+	h2 = (guint32) (hash >> 32) | 1;
+
+	for (i = 0; i < FILTER_HASHES; i++) {
+		bit = (h1 + (guint64) i * h2) & (cache->filter_bits - 1);
+		if (!(cache->filter[bit / 64] & (G_GUINT64_CONSTANT (1) << (bit % 64)))) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+cache_insert (TrackerResourceCache *cache,
+              guint64               hash,
+              const gchar          *uri,
+              gsize                 length,
+              gint                  id)
+{
+	TrackerResourceCacheGeneration *generation;
+	TrackerResourceCacheEntry *entry;
+	guint i;
+
+	if (length >= cache->arena_size) {
+		return;
+	}
+
+	generation = cache->current;
+
+	if (generation->n_entries >= cache->n_slots / 2 ||
+	    generation->arena_len + length > cache->arena_size) {
+		/* current generation is full, forget the old one */
+		cache->stats.evictions += cache->old->n_entries;
+		generation_clear (cache->old, cache->n_slots);
+
+		cache->current = cache->old;
+		cache->old = generation;
+		generation = cache->current;
+	}
+
+	if (!generation->entries) {
+		generation->entries = g_new0 (TrackerResourceCacheEntry, cache->n_slots);
+		generation->arena = g_malloc (cache->arena_size);
+	}
+
+	for (i = hash & (cache->n_slots - 1); ; i = (i + 1) & (cache->n_slots - 1)) {
+		entry = &generation->entries[i];
+
+		if (entry->id == 0) {
+			break;
+		}
+
+		if (entry->hash == hash && entry->length == length &&
+		    memcmp (generation->arena + entry->offset, uri, length) == 0) {
+			entry->id = id;
+			return;
+		}
+	}
+
+	memcpy (generation->arena + generation->arena_len, uri, length);
+
+	entry->hash = hash;
+	entry->offset = generation->arena_len;
+	entry->length = length;
+	entry->id = id;
+
+	generation->arena_len += length;
+	generation->n_entries++;
+}
+
+/**
+ * tracker_resource_cache_lookup:
+ * @cache: a #TrackerResourceCache
+ * @uri: the URI of a resource
+ * @id: return location for the ID of the resource
+ *
+ * Looks up the ID of the resource @uri. If the URI is not cached, but
+ * the filter tells it was never stored, @id is set to 0.
+ *
+ * Returns: %TRUE if @id is set, %FALSE if the Resource table needs to
+ * be queried, tracker_resource_cache_queried() must then be called.
+ */
+gboolean
+tracker_resource_cache_lookup (TrackerResourceCache *cache,
+                               const gchar          *uri,
+                               gint                 *id)
+{
+	TrackerResourceCacheEntry *entry;
+	guint64 hash;
+	gsize length;
+
+	hash = uri_hash (uri, &length);
+
+	entry = generation_lookup (cache->current, cache->n_slots, hash, uri, length);
+
+	if (!entry) {
+		entry = generation_lookup (cache->old, cache->n_slots, hash, uri, length);
+
+		if (entry) {
+			/* still in use, keep it */
+			*id = entry->id;
+			cache_insert (cache, hash, uri, length, *id);
+			cache->stats.hits++;
+			return TRUE;
+		}
+	}
+
+	if (entry) {
+		*id = entry->id;
+		cache->stats.hits++;
+		return TRUE;
+	}
+
+	if (cache->filter && !filter_contains (cache, hash)) {
+		*id = 0;
+		cache->stats.filtered++;
+		return TRUE;
+	}
+
+	cache->stats.misses++;
+
+	return FALSE;
+}
+
+/**
+ * tracker_resource_cache_queried:
+ * @cache: a #TrackerResourceCache
+ * @uri: the URI of a resource
+ * @id: the ID found in the Resource table, or 0
+ *
+ * Keeps the result of querying the ID of @uri after
+ * tracker_resource_cache_lookup() failed.
+ */
+void
+tracker_resource_cache_queried (TrackerResourceCache *cache,
+                                const gchar          *uri,
+                                gint                  id)
+{
+	guint64 hash;
+	gsize length;
+
+	if (id == 0) {
+		if (cache->filter) {
+			cache->stats.false_positives++;
+		}
+		return;
+	}
+
+	hash = uri_hash (uri, &length);
+	cache_insert (cache, hash, uri, length, id);
+}
+
+/**
+ * tracker_resource_cache_insert:
+ * @cache: a #TrackerResourceCache
+ * @uri: the URI of a resource
+ * @id: the ID of the resource
+ *
+ * Adds a resource just stored in the Resource table.
+ */
+void
+tracker_resource_cache_insert (TrackerResourceCache *cache,
+                               const gchar          *uri,
+                               gint                  id)
+{
+	guint64 hash;
+	gsize length;
+
+	g_return_if_fail (id != 0);
+
+	hash = uri_hash (uri, &length);
+	cache_insert (cache, hash, uri, length, id);
+
+	if (cache->filter) {
+		filter_add (cache, hash);
+	}
+}
+
+/**
+ * tracker_resource_cache_clear:
+ * @cache: a #TrackerResourceCache
+ *
+ * Forgets all cached IDs, e.g. after the resources inserted with
+ * them were rolled back. The filter is kept, URIs in it which were
+ * not stored only cost a query.
+ */
+void
+tracker_resource_cache_clear (TrackerResourceCache *cache)
+{
+	generation_clear (cache->current, cache->n_slots);
+	generation_clear (cache->old, cache->n_slots);
+}
+
+/**
+ * tracker_resource_cache_set_filter:
+ * @cache: a #TrackerResourceCache
+ * @n_uris: the number of URIs in the Resource table
+ *
+ * Starts an empty filter, all URIs in the Resource table must then be
+ * added with tracker_resource_cache_filter_add(). The filter has room
+ * for as many new URIs again before it's dropped.
+ */
+void
+tracker_resource_cache_set_filter (TrackerResourceCache *cache,
+                                   guint                 n_uris)
+{
+	guint64 bits = FILTER_MIN_BITS;
+
+	while (bits < (guint64) n_uris * 2 * FILTER_BITS_PER_URI) {
+		bits *= 2;
+	}
+
+	g_free (cache->filter);
+	cache->filter = g_new0 (guint64, bits / 64);
+	cache->filter_bits = bits;
+	cache->filter_count = 0;
+}
+
+void
+tracker_resource_cache_filter_add (TrackerResourceCache *cache,
+                                   const gchar          *uri)
+{
+	gsize length;
+
+	g_return_if_fail (cache->filter != NULL);
+
+	filter_add (cache, uri_hash (uri, &length));
+}
+
+gboolean
+tracker_resource_cache_has_filter (TrackerResourceCache *cache)
+{
+	return cache->filter != NULL;
+}
+
+/**
+ * tracker_resource_cache_drop_filter:
+ * @cache: a #TrackerResourceCache
+ *
+ * Drops the filter, e.g. when URIs are stored in the Resource table
+ * without going through the cache. All URIs not cached are then
+ * queried.
+ */
+void
+tracker_resource_cache_drop_filter (TrackerResourceCache *cache)
+{
+	g_free (cache->filter);
+	cache->filter = NULL;
+	cache->filter_bits = 0;
+	cache->filter_count = 0;
+}
+
+void
+tracker_resource_cache_get_stats (TrackerResourceCache      *cache,
+                                  TrackerResourceCacheStats *stats)
+{
+	gint i;
+
+	*stats = cache->stats;
+
+	stats->n_entries = cache->current->n_entries + cache->old->n_entries;
+	stats->size = 0;
+
+	for (i = 0; i < 2; i++) {
+		if (cache->generations[i].entries) {
+			stats->size += cache->n_slots * sizeof (TrackerResourceCacheEntry) + cache->arena_size;
+		}
+	}
+
+	stats->filter_size = cache->filter_bits / 8;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_DATA_RESOURCE_CACHE_H__
+#define __LIBTRACKER_DATA_RESOURCE_CACHE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#if !defined (__LIBTRACKER_DATA_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-data/tracker-data.h> must be included directly."
+#endif
+
+typedef struct _TrackerResourceCache TrackerResourceCache;
+
+typedef struct {
+	/* lookups answered from the cache */
+	guint64 hits;
+	/* lookups left to query the database */
+	guint64 misses;
+	/* lookups of URIs the filter knows were never stored */
+	guint64 filtered;
+	/* misses queried for URIs that weren't stored after all */
+	guint64 false_positives;
+	/* entries dropped to stay within the size limit */
+	guint64 evictions;
+	guint n_entries;
+	gsize size;
+	gsize filter_size;
+} TrackerResourceCacheStats;
+
+TrackerResourceCache *tracker_resource_cache_new         (gsize                      max_size);
+void                  tracker_resource_cache_free        (TrackerResourceCache      *cache);
+gboolean              tracker_resource_cache_lookup      (TrackerResourceCache      *cache,
+                                                          const gchar               *uri,
+                                                          gint                      *id);
+void                  tracker_resource_cache_queried     (TrackerResourceCache      *cache,
+                                                          const gchar               *uri,
+                                                          gint                       id);
+void                  tracker_resource_cache_insert      (TrackerResourceCache      *cache,
+                                                          const gchar               *uri,
+                                                          gint                       id);
+void                  tracker_resource_cache_clear       (TrackerResourceCache      *cache);
+
+/* Filter of all stored URIs, telling which were never stored */
+void                  tracker_resource_cache_set_filter  (TrackerResourceCache      *cache,
+                                                          guint                      n_uris);
+void                  tracker_resource_cache_filter_add  (TrackerResourceCache      *cache,
+                                                          const gchar               *uri);
+gboolean              tracker_resource_cache_has_filter  (TrackerResourceCache      *cache);
+void                  tracker_resource_cache_drop_filter (TrackerResourceCache      *cache);
+
+void                  tracker_resource_cache_get_stats   (TrackerResourceCache      *cache,
+                                                          TrackerResourceCacheStats *stats);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_DATA_RESOURCE_CACHE_H__ */
@@ -912,64 +912,70 @@ class Tracker.Sparql.Expression : Object {
 		return type;
 	}
 
+	internal static string unescape_string_literal (string s) {
+		var sb = new StringBuilder ();
+
+		string* p = s;
+		string* end = p + s.length;
+		while ((long) p < (long) end) {
+			string* q = Posix.strchr (p, '\\');
+			if (q == null) {
+				sb.append_len (p, (long) (end - p));
+				p = end;
+			} else {
+				sb.append_len (p, (long) (q - p));
+				p = q + 1;
+				switch (((char*) p)[0]) {
+				case '\'':
+				case '"':
+				case '\\':
+					sb.append_c (((char*) p)[0]);
+					break;
+				case 'b':
+					sb.append_c ('\b');
+					break;
+				case 'f':
+					sb.append_c ('\f');
+					break;
+				case 'n':
+					sb.append_c ('\n');
+					break;
+				case 'r':
+					sb.append_c ('\r');
+					break;
+				case 't':
+					sb.append_c ('\t');
+					break;
+				case 'u':
+					char* ptr = (char*) p + 1;
+					unichar c = (((unichar) ptr[0].xdigit_value () * 16 + ptr[1].xdigit_value ()) * 16 + ptr[2].xdigit_value ()) * 16 + ptr[3].xdigit_value ();
+					sb.append_unichar (c);
+					p += 4;
+					break;
+				}
+				p++;
+			}
+		}
+
+		return sb.str;
+	}
+
 	internal string parse_string_literal (out PropertyType type = null) throws Sparql.Error {
 		type = PropertyType.STRING;
 
 		next ();
+		query.literal_parsed ();
 		switch (last ()) {
 		case SparqlTokenType.STRING_LITERAL1:
 		case SparqlTokenType.STRING_LITERAL2:
-			var sb = new StringBuilder ();
-
-			string s = get_last_string (1);
-			string* p = s;
-			string* end = p + s.length;
-			while ((long) p < (long) end) {
-				string* q = Posix.strchr (p, '\\');
-				if (q == null) {
-					sb.append_len (p, (long) (end - p));
-					p = end;
-				} else {
-					sb.append_len (p, (long) (q - p));
-					p = q + 1;
-					switch (((char*) p)[0]) {
-					case '\'':
-					case '"':
-					case '\\':
-						sb.append_c (((char*) p)[0]);
-						break;
-					case 'b':
-						sb.append_c ('\b');
-						break;
-					case 'f':
-						sb.append_c ('\f');
-						break;
-					case 'n':
-						sb.append_c ('\n');
-						break;
-					case 'r':
-						sb.append_c ('\r');
-						break;
-					case 't':
-						sb.append_c ('\t');
-						break;
-					case 'u':
-						char* ptr = (char*) p + 1;
-						unichar c = (((unichar) ptr[0].xdigit_value () * 16 + ptr[1].xdigit_value ()) * 16 + ptr[2].xdigit_value ()) * 16 + ptr[3].xdigit_value ();
-						sb.append_unichar (c);
-						p += 4;
-						break;
-					}
-					p++;
-				}
-			}
+			string literal = unescape_string_literal (get_last_string (1));
 
 			if (accept (SparqlTokenType.DOUBLE_CIRCUMFLEX)) {
 				// typed literal
 				type = parse_type_uri ();
 			}
 
-			return sb.str;
+			return literal;
 		case SparqlTokenType.STRING_LITERAL_LONG1:
 		case SparqlTokenType.STRING_LITERAL_LONG2:
 			string result = get_last_string (3);
@@ -1072,6 +1078,7 @@ class Tracker.Sparql.Expression : Object {
 				} else {
 					var binding = new LiteralBinding ();
 					binding.literal = literal;
+					binding.parameter_name = query.lift_last_literal ();
 					binding.data_type = type;
 					query.bindings.append (binding);
 					sql.append ("?");
@@ -1083,6 +1090,7 @@ class Tracker.Sparql.Expression : Object {
 				} else {
 					var binding = new LiteralBinding ();
 					binding.literal = literal;
+					binding.parameter_name = query.lift_last_literal ();
 					query.bindings.append (binding);
 					sql.append ("?");
 				}
@@ -1104,6 +1112,18 @@ class Tracker.Sparql.Expression : Object {
 			}
 
 			return PropertyType.INTEGER;
+		case SparqlTokenType.PARAMETER:
+			next ();
+
+			// always bound, even with no_cache, the value
+			// is only known when the statement is executed
+			sql.append ("?");
+
+			var binding = new LiteralBinding ();
+			binding.parameter_name = get_last_string ().substring (1);
+			query.bindings.append (binding);
+
+			return PropertyType.STRING;
 		case SparqlTokenType.VAR:
 			next ();
 			string variable_name = get_last_string ().substring (1);
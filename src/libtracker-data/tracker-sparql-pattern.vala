@@ -1296,8 +1296,22 @@ class Tracker.Sparql.Pattern : Object {
 	void parse_object (StringBuilder sql, bool in_simple_optional = false) throws Sparql.Error {
 		long begin_sql_len = sql.len;
 
-		bool object_is_var;
-		string object = parse_var_or_term (sql, out object_is_var);
+		bool object_is_var = false;
+		bool object_is_parameter = false;
+		string object;
+
+		if (accept (SparqlTokenType.PARAMETER)) {
+			// value provided when the prepared statement is executed
+			object = get_last_string ().substring (1);
+			object_is_parameter = true;
+
+			if (current_predicate_is_var) {
+				throw get_error ("parameters are not supported with variable predicates");
+			}
+		} else {
+			query.forget_last_literal ();
+			object = parse_var_or_term (sql, out object_is_var);
+		}
 
 		string db_table = null;
 		bool rdftype = false;
@@ -1314,7 +1328,7 @@ class Tracker.Sparql.Pattern : Object {
 			prop = Ontologies.get_property_by_uri (current_predicate);
 
 			if (current_predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#type"
-			    && !object_is_var && current_graph == null) {
+			    && !object_is_var && !object_is_parameter && current_graph == null) {
 				// rdf:type query
 				// avoid special casing if GRAPH is used as graph matching is not supported when using class tables
 				rdftype = true;
@@ -1327,6 +1341,9 @@ class Tracker.Sparql.Pattern : Object {
 			} else if (prop == null) {
 				if (current_predicate == "http://www.tracker-project.org/ontologies/fts#match") {
 					// fts:match
+					if (object_is_parameter) {
+						throw get_error ("parameters are not supported with fts:match");
+					}
 					db_table = "fts";
 					share_table = false;
 					is_fts_match = true;
@@ -1337,7 +1354,7 @@ class Tracker.Sparql.Pattern : Object {
 			} else {
 				if (current_predicate == "http://www.w3.org/2000/01/rdf-schema#domain"
 				    && current_subject_is_var
-				    && !object_is_var) {
+				    && !object_is_var && !object_is_parameter) {
 					// rdfs:domain
 					var domain = Ontologies.get_class_by_uri (object);
 					if (domain == null) {
@@ -1521,10 +1538,18 @@ class Tracker.Sparql.Pattern : Object {
 				                   context.get_variable (current_subject).name);
 			} else {
 				var binding = new LiteralBinding ();
-				binding.literal = object;
+				if (object_is_parameter) {
+					binding.parameter_name = object;
+				} else {
+					binding.literal = object;
+				}
 				// binding.data_type = triple.object.type;
 				binding.table = table;
 				if (prop != null) {
+					if (!object_is_parameter && current_predicate != "http://www.w3.org/2000/01/rdf-schema#domain") {
+						// the value of a string literal object is only needed when executing
+						binding.parameter_name = query.lift_last_literal ();
+					}
 					binding.data_type = prop.data_type;
 					binding.sql_db_column_name = prop.name;
 				} else {
@@ -56,6 +56,9 @@ namespace Tracker.Sparql {
 	class LiteralBinding : DataBinding {
 		public bool is_fts_match;
 		public string literal;
+		// set for ~name parameters, literal is taken from the
+		// values passed to execute_prepared instead
+		public string parameter_name;
 	}
 
 	// Represents a mapping of a SPARQL variable to a SQL table and column
@@ -188,7 +191,43 @@ namespace Tracker.Sparql {
 	}
 }
 
+// Translated query in the translation cache, see Query.execute_cursor
+class Tracker.Sparql.CacheEntry {
+	public string key;
+	public Query query;
+
+	// LRU list, most recently used first
+	public unowned CacheEntry? prev;
+	public unowned CacheEntry? next;
+}
+
+// Indexes of the string literals whose value ended up in the
+// translation of a query shape, see Query.lift_last_literal
+class Tracker.Sparql.CacheShape {
+	public int[] baked_literals;
+}
+
 public class Tracker.Sparql.Query : Object {
+	const uint DEFAULT_CACHE_SIZE = 128;
+
+	/* Translations of recent queries, by normalized query text.
+	 * Queries only differing in their string literals share the
+	 * same SQL, the literals are bound when executing. Shared by
+	 * all threads, cached queries are only read once translated.
+	 */
+	static HashTable<string, CacheEntry> cache;
+	static HashTable<string, CacheShape> cache_shapes;
+	static unowned CacheEntry? cache_head;
+	static unowned CacheEntry? cache_tail;
+	static uint cache_size = DEFAULT_CACHE_SIZE;
+	static uint cache_hits;
+	static uint cache_misses;
+	static uint cache_uncacheable;
+	static uint cache_evictions;
+	// bumped by clear_cache (), for prepared queries kept elsewhere
+	static uint cache_generation;
+	static Mutex cache_mutex;
+
 	SparqlScanner scanner;
 
 	// token buffer
@@ -243,6 +282,18 @@ public class Tracker.Sparql.Query : Object {
 
 	public bool no_cache { get; set; }
 
+	// SQL translation kept by prepare (), only read afterwards
+	// so the query may be executed from several threads at once
+	string prepared_sql;
+	PropertyType[] prepared_types;
+	string[] prepared_variable_names;
+
+	// string literals of the query when it goes through the
+	// translation cache, by offset in the query string
+	int[] literal_offsets;
+	bool[] literal_baked;
+	int last_literal_index = -1;
+
 	public Query (string query) {
 		no_cache = false; /* Start with false, expression sets it */
 		tokens = new TokenInfo[BUFFER_SIZE];
@@ -371,6 +422,51 @@ public class Tracker.Sparql.Query : Object {
 		}
 	}
 
+	// called by the translator for every string literal parsed
+	internal void literal_parsed () {
+		last_literal_index = -1;
+
+		if (literal_offsets == null) {
+			return;
+		}
+
+		int last_index = (index + BUFFER_SIZE - 1) % BUFFER_SIZE;
+		int offset = (int) (tokens[last_index].begin.pos - (char*) query_string);
+
+		int low = 0, high = literal_offsets.length - 1;
+		while (low <= high) {
+			int mid = (low + high) / 2;
+			if (literal_offsets[mid] < offset) {
+				low = mid + 1;
+			} else if (literal_offsets[mid] > offset) {
+				high = mid - 1;
+			} else {
+				last_literal_index = mid;
+				break;
+			}
+		}
+	}
+
+	internal void forget_last_literal () {
+		last_literal_index = -1;
+	}
+
+	/* Called where the value of the last string literal is only
+	 * bound into the statement and didn't affect the translation,
+	 * so the translation can be reused with other values. Returns
+	 * the name of the parameter the value is then taken from.
+	 * Literals not lifted this way are part of the cache key.
+	 */
+	internal string? lift_last_literal () {
+		if (last_literal_index < 0) {
+			return null;
+		}
+
+		literal_baked[last_literal_index] = false;
+
+		return last_literal_index.to_string ();
+	}
+
 	internal string get_last_string (int strip = 0) {
 		int last_index = (index + BUFFER_SIZE - 1) % BUFFER_SIZE;
 		return ((string) (tokens[last_index].begin.pos + strip)).substring (0, (int) (tokens[last_index].end.pos - tokens[last_index].begin.pos - 2 * strip));
@@ -414,18 +510,300 @@ public class Tracker.Sparql.Query : Object {
 
 
 	public DBCursor? execute_cursor (bool threadsafe) throws DBInterfaceError, Sparql.Error, DateError {
+		string normalized = null;
+		string key = null;
+		string[] literals = null;
+		HashTable<string,Variant> values = null;
+
+		if (cache_size > 0) {
+			normalized = normalize (out literals);
+		}
+
+		if (normalized != null) {
+			values = new HashTable<string,Variant> (str_hash, str_equal);
+			for (int i = 0; i < literals.length; i++) {
+				values.insert (i.to_string (), new Variant.string (literals[i]));
+			}
+
+			Query cached = null;
+
+			cache_mutex.lock ();
+			var shape = cache_shapes != null ? cache_shapes.lookup (normalized) : null;
+			if (shape != null) {
+				key = get_cache_key (normalized, shape.baked_literals, literals);
+				var entry = cache.lookup (key);
+				if (entry != null) {
+					cache_touch (entry);
+					cached = entry.query;
+				}
+			}
+			if (cached != null) {
+				cache_hits++;
+			} else {
+				cache_misses++;
+			}
+			cache_mutex.unlock ();
+
+			if (cached != null) {
+				return cached.execute_prepared (values, true);
+			}
+
+			literal_baked = new bool[literals.length];
+			for (int i = 0; i < literals.length; i++) {
+				literal_baked[i] = true;
+			}
+		}
+
+		prepare ();
+
+		if (normalized != null) {
+			if (no_cache) {
+				// non-deterministic or too large to share
+				cache_mutex.lock ();
+				cache_uncacheable++;
+				cache_mutex.unlock ();
+			} else {
+				var shape = new CacheShape ();
+				int n_baked = 0;
+				shape.baked_literals = new int[literals.length];
+				for (int i = 0; i < literals.length; i++) {
+					if (literal_baked[i]) {
+						shape.baked_literals[n_baked++] = i;
+					}
+				}
+				shape.baked_literals.resize (n_baked);
+
+				key = get_cache_key (normalized, shape.baked_literals, literals);
+				cache_insert (normalized, shape, key, this);
+			}
+		}
+
+		return execute_prepared (values, true);
+	}
+
+	/* Splits the query in tokens, the normalized text only depends on
+	 * the tokens and not on spacing or comments, and string literals
+	 * are replaced by a placeholder. Their values are returned in order.
+	 */
+	string? normalize (out string[] literals) {
+		literals = null;
+
+		var normalized = new StringBuilder ();
+		var offsets = new int[8];
+		var values = new string[8];
+		int n_literals = 0;
+
+		var token_scanner = new SparqlScanner ((char*) query_string, (long) query_string.length);
+
+		try {
+			while (true) {
+				SourceLocation begin, end;
+				SparqlTokenType type = token_scanner.read_token (out begin, out end);
+				long len = (long) (end.pos - begin.pos);
+
+				if (type == SparqlTokenType.EOF) {
+					break;
+				}
+
+				string value;
+
+				switch (type) {
+				case SparqlTokenType.STRING_LITERAL1:
+				case SparqlTokenType.STRING_LITERAL2:
+					value = Expression.unescape_string_literal (((string) (begin.pos + 1)).substring (0, len - 2));
+					break;
+				case SparqlTokenType.STRING_LITERAL_LONG1:
+				case SparqlTokenType.STRING_LITERAL_LONG2:
+					value = ((string) (begin.pos + 3)).substring (0, len - 6);
+					break;
+				default:
+					normalized.append_printf ("%ld:", len);
+					normalized.append_len ((string) begin.pos, len);
+					continue;
+				}
+
+				if (n_literals == offsets.length) {
+					offsets.resize (2 * n_literals);
+					values.resize (2 * n_literals);
+				}
+
+				offsets[n_literals] = (int) (begin.pos - (char*) query_string);
+				values[n_literals] = (owned) value;
+				n_literals++;
+
+				normalized.append_c ('$');
+			}
+		} catch (Sparql.Error e) {
+			// reported when translating
+			return null;
+		}
+
+		offsets.resize (n_literals);
+		values.resize (n_literals);
+
+		literal_offsets = (owned) offsets;
+		literals = (owned) values;
+
+		return normalized.str;
+	}
+
+	static string get_cache_key (string normalized, int[] baked_literals, string[] literals) {
+		if (baked_literals.length == 0) {
+			return normalized;
+		}
+
+		var key = new StringBuilder (normalized);
+		foreach (int i in baked_literals) {
+			key.append_printf ("\n%d:%ld:", i, literals[i].length);
+			key.append (literals[i]);
+		}
+
+		return key.str;
+	}
+
+	// must be called with cache_mutex held
+	static void cache_unlink (CacheEntry entry) {
+		if (entry.prev != null) {
+			entry.prev.next = entry.next;
+		} else {
+			cache_head = entry.next;
+		}
+
+		if (entry.next != null) {
+			entry.next.prev = entry.prev;
+		} else {
+			cache_tail = entry.prev;
+		}
+
+		entry.prev = null;
+		entry.next = null;
+	}
+
+	// must be called with cache_mutex held
+	static void cache_link_head (CacheEntry entry) {
+		entry.next = cache_head;
+		if (cache_head != null) {
+			cache_head.prev = entry;
+		}
+		cache_head = entry;
+
+		if (cache_tail == null) {
+			cache_tail = entry;
+		}
+	}
+
+	// must be called with cache_mutex held
+	static void cache_touch (CacheEntry entry) {
+		if (entry != cache_head) {
+			cache_unlink (entry);
+			cache_link_head (entry);
+		}
+	}
+
+	static void cache_insert (string normalized, CacheShape shape, string key, Query query) {
+		cache_mutex.lock ();
+
+		if (cache == null) {
+			cache = new HashTable<string, CacheEntry> (str_hash, str_equal);
+			cache_shapes = new HashTable<string, CacheShape> (str_hash, str_equal);
+		}
+
+		cache_shapes.insert (normalized, shape);
+
+		var entry = cache.lookup (key);
+		if (entry != null) {
+			// translated concurrently by another thread
+			cache_touch (entry);
+		} else {
+			entry = new CacheEntry ();
+			entry.key = key;
+			entry.query = query;
+			cache.insert (key, entry);
+			cache_link_head (entry);
+
+			while (cache.size () > cache_size) {
+				unowned CacheEntry oldest = cache_tail;
+				cache_unlink (oldest);
+				cache.remove (oldest.key);
+				cache_evictions++;
+			}
+
+			// shapes are tiny, just don't let them grow unbounded
+			if (cache_shapes.size () > 4 * cache_size) {
+				cache_shapes.remove_all ();
+				cache_shapes.insert (normalized, shape);
+			}
+		}
+
+		cache_mutex.unlock ();
+	}
+
+	/* Drops all translations, they refer to the ontology in use when
+	 * translated and must not be used after it changes.
+	 */
+	public static void clear_cache () {
+		cache_mutex.lock ();
+
+		string env_cache_size = Environment.get_variable ("TRACKER_SPARQL_TRANSLATION_CACHE_SIZE");
+		if (env_cache_size != null) {
+			cache_size = (uint) int.parse (env_cache_size);
+		}
+
+		if (cache != null) {
+			cache_head = null;
+			cache_tail = null;
+			cache.remove_all ();
+			cache_shapes.remove_all ();
+		}
+
+		cache_generation++;
+
+		cache_mutex.unlock ();
+	}
+
+	/* Queries prepared before the generation changes must be
+	 * dropped, same as the translations in the cache.
+	 */
+	public static uint get_cache_generation () {
+		cache_mutex.lock ();
+		uint generation = cache_generation;
+		cache_mutex.unlock ();
+
+		return generation;
+	}
+
+	public static void get_cache_statistics (out uint size, out uint hits, out uint misses, out uint uncacheable, out uint evictions) {
+		cache_mutex.lock ();
+		size = cache != null ? cache.size () : 0;
+		hits = cache_hits;
+		misses = cache_misses;
+		uncacheable = cache_uncacheable;
+		evictions = cache_evictions;
+		cache_mutex.unlock ();
+	}
+
+	// Translates the query once, parameters written as ~name in the
+	// query are left unbound until execute_prepared is called
+	public void prepare () throws DBInterfaceError, Sparql.Error, DateError {
+		SelectContext select_context;
 
 		prepare_execute ();
 
 		switch (current ()) {
 		case SparqlTokenType.SELECT:
-			return execute_select_cursor (threadsafe);
+			prepared_sql = get_select_query (out select_context);
+			prepared_types = select_context.types;
+			prepared_variable_names = select_context.variable_names;
+			break;
+		case SparqlTokenType.ASK:
+			prepared_sql = get_ask_query ();
+			prepared_types = new PropertyType[] { PropertyType.BOOLEAN };
+			prepared_variable_names = new string[] { "result" };
+			break;
 		case SparqlTokenType.CONSTRUCT:
 			throw get_internal_error ("CONSTRUCT is not supported");
 		case SparqlTokenType.DESCRIBE:
 			throw get_internal_error ("DESCRIBE is not supported");
-		case SparqlTokenType.ASK:
-			return execute_ask_cursor (threadsafe);
 		case SparqlTokenType.INSERT:
 		case SparqlTokenType.DELETE:
 		case SparqlTokenType.DROP:
@@ -435,6 +813,14 @@ public class Tracker.Sparql.Query : Object {
 		}
 	}
 
+	public DBCursor? execute_prepared (HashTable<string,Variant>? parameters, bool threadsafe) throws DBInterfaceError, Sparql.Error, DateError {
+		assert (prepared_sql != null);
+
+		var stmt = prepare_for_exec (prepared_sql, parameters);
+
+		return stmt.start_sparql_cursor (prepared_types, prepared_variable_names, threadsafe);
+	}
+
 	public Variant? execute_update (bool blank) throws GLib.Error {
 		Variant result = null;
 		assert (update_extensions);
@@ -489,6 +875,10 @@ public class Tracker.Sparql.Query : Object {
 			// semicolon is used to separate multiple operations in the current SPARQL Update draft
 			// keep it optional for now to reatin backward compatibility
 			accept (SparqlTokenType.SEMICOLON);
+
+			// each operation may carry its own prologue, this is what
+			// allows batches of independent updates to be parsed as one
+			parse_prologue ();
 		}
 
 		if (blank) {
@@ -498,29 +888,55 @@ public class Tracker.Sparql.Query : Object {
 		return result;
 	}
 
-	DBStatement prepare_for_exec (string sql) throws DBInterfaceError, Sparql.Error, DateError {
+	DBStatement prepare_for_exec (string sql, HashTable<string,Variant>? parameters = null) throws DBInterfaceError, Sparql.Error, DateError {
 		var iface = DBManager.get_db_interface ();
 		var stmt = iface.create_statement (no_cache ? DBStatementCacheType.NONE : DBStatementCacheType.SELECT, "%s", sql);
 
 		// set literals specified in query
 		int i = 0;
 		foreach (LiteralBinding binding in bindings) {
-			if (binding.data_type == PropertyType.BOOLEAN) {
-				if (binding.literal == "true" || binding.literal == "1") {
+			string literal = binding.literal;
+			PropertyType data_type = binding.data_type;
+
+			if (binding.parameter_name != null) {
+				Variant value = null;
+
+				if (parameters != null) {
+					value = parameters.lookup (binding.parameter_name);
+				}
+
+				if (value == null) {
+					throw new Sparql.Error.TYPE ("Parameter `%s' has no value bound".printf (binding.parameter_name));
+				}
+
+				if (value.is_of_type (VariantType.INT64)) {
+					literal = value.get_int64 ().to_string ();
+					if (data_type == PropertyType.UNKNOWN) {
+						data_type = PropertyType.INTEGER;
+					}
+				} else if (value.is_of_type (VariantType.STRING)) {
+					literal = value.get_string ();
+				} else {
+					throw new Sparql.Error.TYPE ("Parameter `%s' has an unsupported type".printf (binding.parameter_name));
+				}
+			}
+
+			if (data_type == PropertyType.BOOLEAN) {
+				if (literal == "true" || literal == "1") {
 					stmt.bind_int (i, 1);
-				} else if (binding.literal == "false" || binding.literal == "0") {
+				} else if (literal == "false" || literal == "0") {
 					stmt.bind_int (i, 0);
 				} else {
-					throw new Sparql.Error.TYPE ("`%s' is not a valid boolean".printf (binding.literal));
+					throw new Sparql.Error.TYPE ("`%s' is not a valid boolean".printf (literal));
 				}
-			} else if (binding.data_type == PropertyType.DATE) {
-				stmt.bind_int (i, (int) string_to_date (binding.literal + "T00:00:00Z", null));
-			} else if (binding.data_type == PropertyType.DATETIME) {
-				stmt.bind_double (i, string_to_date (binding.literal, null));
-			} else if (binding.data_type == PropertyType.INTEGER) {
-				stmt.bind_int (i, int.parse (binding.literal));
+			} else if (data_type == PropertyType.DATE) {
+				stmt.bind_int (i, (int) string_to_date (literal + "T00:00:00Z", null));
+			} else if (data_type == PropertyType.DATETIME) {
+				stmt.bind_double (i, string_to_date (literal, null));
+			} else if (data_type == PropertyType.INTEGER) {
+				stmt.bind_int (i, int.parse (literal));
 			} else {
-				stmt.bind_text (i, binding.literal);
+				stmt.bind_text (i, literal);
 			}
 			i++;
 		}
@@ -546,13 +962,6 @@ public class Tracker.Sparql.Query : Object {
 		return sql.str;
 	}
 
-	DBCursor? execute_select_cursor (bool threadsafe) throws DBInterfaceError, Sparql.Error, DateError {
-		SelectContext context;
-		string sql = get_select_query (out context);
-
-		return exec_sql_cursor (sql, context.types, context.variable_names, true);
-	}
-
 	string get_ask_query () throws DBInterfaceError, Sparql.Error, DateError {
 		// ASK query
 
@@ -584,10 +993,6 @@ public class Tracker.Sparql.Query : Object {
 		return sql.str;
 	}
 
-	DBCursor? execute_ask_cursor (bool threadsafe) throws DBInterfaceError, Sparql.Error, DateError {
-		return exec_sql_cursor (get_ask_query (), new PropertyType[] { PropertyType.BOOLEAN }, new string[] { "result" }, true);
-	}
-
 	private void parse_from_or_into_param () throws Sparql.Error {
 		if (accept (SparqlTokenType.IRI_REF)) {
 			current_graph = get_last_string (1);
@@ -542,6 +542,15 @@ public class Tracker.SparqlScanner : Object {
 					current++;
 				}
 				break;
+			case '~':
+				// named parameter of a prepared statement
+				type = SparqlTokenType.NONE;
+				current++;
+				while (current < end && is_varname_char (current[0])) {
+					type = SparqlTokenType.PARAMETER;
+					current++;
+				}
+				break;
 			case '@':
 				type = SparqlTokenType.NONE;
 				current++;
@@ -931,6 +940,7 @@ public enum Tracker.SparqlTokenType {
 	OPTIONAL,
 	OR,
 	ORDER,
+	PARAMETER,
 	PLUS,
 	PN_PREFIX,
 	PREFIX,
@@ -1027,6 +1037,7 @@ public enum Tracker.SparqlTokenType {
 		case OPTIONAL: return "`OPTIONAL'";
 		case OR: return "`OR'";
 		case ORDER: return "`ORDER'";
+		case PARAMETER: return "parameter";
 		case PLUS: return "`+'";
 		case PN_PREFIX: return "prefixed name";
 		case PREFIX: return "`PREFIX'";
@@ -78,6 +78,21 @@ public class Tracker.Direct.Connection : Tracker.Sparql.Connection {
 		}
 	}
 
+	public override Sparql.Statement? query_statement (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		DBManager.lock ();
+		try {
+			var query_object = new Sparql.Query (sparql);
+			query_object.prepare ();
+			return new Statement (this, sparql, query_object);
+		} catch (DBInterfaceError e) {
+			throw new Sparql.Error.INTERNAL (e.message);
+		} catch (DateError e) {
+			throw new Sparql.Error.PARSE (e.message);
+		} finally {
+			DBManager.unlock ();
+		}
+	}
+
 	public override Sparql.Cursor query (string sparql, Cancellable? cancellable) throws Sparql.Error, IOError, DBusError {
 		DBManager.lock ();
 		try {
@@ -135,3 +150,83 @@ public class Tracker.Direct.Connection : Tracker.Sparql.Connection {
 		}
 	}
 }
+
+class Tracker.Direct.Statement : Tracker.Sparql.Statement {
+	// translated once by query_statement, only the
+	// values bound to the SQLite statement change
+	Sparql.Query query_object;
+	HashTable<string,Variant> values = new HashTable<string,Variant> (str_hash, str_equal);
+
+	public Statement (Connection connection, string sparql, Sparql.Query query_object) {
+		Object (connection: connection, sparql: sparql);
+		this.query_object = query_object;
+	}
+
+	public override void bind_int (string name, int64 value) {
+		values.insert (name, new Variant.int64 (value));
+	}
+
+	public override void bind_string (string name, string value) {
+		values.insert (name, new Variant.string (value));
+	}
+
+	public override void clear_bindings () {
+		values.remove_all ();
+	}
+
+	public override Sparql.Cursor execute (Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		DBManager.lock ();
+		try {
+			var cursor = query_object.execute_prepared (values, true);
+			cursor.connection = connection;
+			return cursor;
+		} catch (DBInterfaceError e) {
+			throw new Sparql.Error.INTERNAL (e.message);
+		} catch (DateError e) {
+			throw new Sparql.Error.PARSE (e.message);
+		} finally {
+			DBManager.unlock ();
+		}
+	}
+
+	public async override Sparql.Cursor execute_async (Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		// run in a separate thread
+		Sparql.Error sparql_error = null;
+		IOError io_error = null;
+		DBusError dbus_error = null;
+		Sparql.Cursor result = null;
+		var context = MainContext.get_thread_default ();
+
+		g_io_scheduler_push_job (job => {
+			try {
+				result = execute (cancellable);
+			} catch (IOError e_io) {
+				io_error = e_io;
+			} catch (Sparql.Error e_spql) {
+				sparql_error = e_spql;
+			} catch (DBusError e_dbus) {
+				dbus_error = e_dbus;
+			}
+
+			var source = new IdleSource ();
+			source.set_callback (() => {
+				execute_async.callback ();
+				return false;
+			});
+			source.attach (context);
+
+			return false;
+		});
+		yield;
+
+		if (sparql_error != null) {
+			throw sparql_error;
+		} else if (io_error != null) {
+			throw io_error;
+		} else if (dbus_error != null) {
+			throw dbus_error;
+		} else {
+			return result;
+		}
+	}
+}
@@ -0,0 +1,997 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "tracker-checkpoint.h"
+
+/* The log is a sequence of text records, one per line:
+ *
+ *   R <mtime> <volume uuid> <root uri>   crawling of root started
+ *   P <mtime> <time> <directory uri>     directory found while crawling,
+ *                                        all its contents queued at <time>
+ *   C|U|D <uri>                          item queued as created/updated/deleted
+ *   M <uri> <source uri>                 item queued as moved
+ *   X <uri>                              item processed
+ *   F <root uri>                         every item in root has been queued
+ *
+ * URIs are escaped, so they never contain spaces nor newlines.
+ */
+#define CHECKPOINT_HEADER "tracker-checkpoint 3\n"
+
+/* Records are appended at most every CHECKPOINT_FLUSH_SECS, or on
+ * the next idle once CHECKPOINT_FLUSH_SIZE bytes are pending.
+ */
+#define CHECKPOINT_FLUSH_SECS 2
+#define CHECKPOINT_FLUSH_SIZE 65536
+
+/* The log is compacted again once it grows past
+ * CHECKPOINT_COMPACT_RATIO times its last compacted size.
+ */
+#define CHECKPOINT_COMPACT_RATIO 4
+#define CHECKPOINT_COMPACT_MIN_SIZE (1024 * 1024)
+
+/* Same tolerance as the mtime checks in TrackerFileNotifier */
+#define CHECKPOINT_MTIME_SLACK 2
+
+typedef struct {
+	guint64 mtime;
+	gchar *uuid;
+	guint finished : 1;
+} RootState;
+
+typedef struct {
+	guint64 mtime;
+	guint64 queued;
+} DirectoryState;
+
+typedef struct {
+	TrackerCheckpointEvent event;
+	gchar *uri;
+	gchar *source_uri;
+	guint alive : 1;
+} ItemState;
+
+struct _TrackerCheckpoint {
+	gchar *path;
+	gint fd;
+
+	GString *buffer;
+	guint flush_id;
+	guint flush_idle : 1;
+
+	/* Bytes in the log, and right after the last compaction */
+	gsize size;
+	gsize compacted_size;
+
+	/* State left by the previous run, consumed
+	 * root by root through tracker_checkpoint_resume()
+	 */
+	GHashTable *roots;
+	GHashTable *directories; /* uri -> DirectoryState */
+	GHashTable *items;
+	GPtrArray *item_list;
+};
+
+static void
+root_state_free (RootState *state)
+{
+	g_free (state->uuid);
+	g_slice_free (RootState, state);
+}
+
+static void
+item_state_free (ItemState *state)
+{
+	g_free (state->uri);
+	g_free (state->source_uri);
+	g_slice_free (ItemState, state);
+}
+
+static gboolean
+checkpoint_query_mtime (GFile   *file,
+                        guint64 *mtime)
+{
+	GFileInfo *info;
+
+	info = g_file_query_info (file,
+	                          G_FILE_ATTRIBUTE_TIME_MODIFIED,
+	                          G_FILE_QUERY_INFO_NONE,
+	                          NULL, NULL);
+	if (!info) {
+		return FALSE;
+	}
+
+	*mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	g_object_unref (info);
+
+	return TRUE;
+}
+
+static gboolean
+checkpoint_query_root (GFile    *root,
+                       guint64  *mtime,
+                       gchar   **uuid)
+{
+	GMount *mount;
+
+	if (!checkpoint_query_mtime (root, mtime)) {
+		return FALSE;
+	}
+
+	*uuid = NULL;
+
+	mount = g_file_find_enclosing_mount (root, NULL, NULL);
+
+	if (mount) {
+		*uuid = g_mount_get_uuid (mount);
+
+		if (!*uuid) {
+			GVolume *volume;
+
+			volume = g_mount_get_volume (mount);
+
+			if (volume) {
+				*uuid = g_volume_get_identifier (volume,
+				                                 G_VOLUME_IDENTIFIER_KIND_UUID);
+				g_object_unref (volume);
+			}
+		}
+
+		g_object_unref (mount);
+	}
+
+	if (*uuid) {
+		g_strdelimit (*uuid, " \n", '_');
+	} else {
+		*uuid = g_strdup ("-");
+	}
+
+	return TRUE;
+}
+
+static gboolean
+checkpoint_uri_is_under (const gchar *uri,
+                         const gchar *root_uri)
+{
+	gsize len;
+
+	if (!g_str_has_prefix (uri, root_uri)) {
+		return FALSE;
+	}
+
+	len = strlen (root_uri);
+
+	return (uri[len] == '\0' ||
+	        uri[len] == '/' ||
+	        (len > 0 && root_uri[len - 1] == '/'));
+}
+
+static void
+checkpoint_load_item (TrackerCheckpoint      *checkpoint,
+                      TrackerCheckpointEvent  event,
+                      const gchar            *uri,
+                      const gchar            *source_uri)
+{
+	ItemState *state;
+
+	state = g_hash_table_lookup (checkpoint->items, uri);
+
+	if (state) {
+		/* Updates after a pending creation are merged into it */
+		if (state->event == TRACKER_CHECKPOINT_CREATED &&
+		    event == TRACKER_CHECKPOINT_UPDATED) {
+			return;
+		}
+
+		state->alive = FALSE;
+	}
+
+	state = g_slice_new0 (ItemState);
+	state->event = event;
+	state->uri = g_strdup (uri);
+	state->source_uri = g_strdup (source_uri);
+	state->alive = TRUE;
+
+	g_ptr_array_add (checkpoint->item_list, state);
+	g_hash_table_insert (checkpoint->items, state->uri, state);
+}
+
+static void
+checkpoint_load_record (TrackerCheckpoint *checkpoint,
+                        gchar             *line)
+{
+	gchar **fields;
+	guint n_fields;
+
+	fields = g_strsplit (line, " ", 4);
+	n_fields = g_strv_length (fields);
+
+	if (n_fields < 2 || strlen (fields[0]) != 1) {
+		g_strfreev (fields);
+		return;
+	}
+
+	switch (fields[0][0]) {
+	case 'R':
+		if (n_fields == 4) {
+			RootState *state;
+
+			state = g_slice_new0 (RootState);
+			state->mtime = g_ascii_strtoull (fields[1], NULL, 10);
+			state->uuid = g_strdup (fields[2]);
+			g_hash_table_insert (checkpoint->roots,
+			                     g_strdup (fields[3]), state);
+		}
+		break;
+	case 'F': {
+		RootState *state;
+
+		state = g_hash_table_lookup (checkpoint->roots, fields[1]);
+
+		if (state) {
+			state->finished = TRUE;
+		}
+		break;
+	}
+	case 'P':
+		if (n_fields == 4) {
+			DirectoryState *state;
+
+			state = g_new (DirectoryState, 1);
+			state->mtime = g_ascii_strtoull (fields[1], NULL, 10);
+			state->queued = g_ascii_strtoull (fields[2], NULL, 10);
+			g_hash_table_insert (checkpoint->directories,
+			                     g_strdup (fields[3]), state);
+		}
+		break;
+	case 'C':
+		checkpoint_load_item (checkpoint, TRACKER_CHECKPOINT_CREATED, fields[1], NULL);
+		break;
+	case 'U':
+		checkpoint_load_item (checkpoint, TRACKER_CHECKPOINT_UPDATED, fields[1], NULL);
+		break;
+	case 'D':
+		checkpoint_load_item (checkpoint, TRACKER_CHECKPOINT_DELETED, fields[1], NULL);
+		break;
+	case 'M':
+		if (n_fields == 3) {
+			checkpoint_load_item (checkpoint, TRACKER_CHECKPOINT_MOVED,
+			                      fields[1], fields[2]);
+		}
+		break;
+	case 'X': {
+		ItemState *state;
+
+		state = g_hash_table_lookup (checkpoint->items, fields[1]);
+
+		if (state) {
+			state->alive = FALSE;
+			g_hash_table_remove (checkpoint->items, fields[1]);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	g_strfreev (fields);
+}
+
+static void
+checkpoint_load (TrackerCheckpoint *checkpoint)
+{
+	gchar *contents, *line, *end;
+	gsize len;
+
+	if (!g_file_get_contents (checkpoint->path, &contents, &len, NULL)) {
+		return;
+	}
+
+	if (!g_str_has_prefix (contents, CHECKPOINT_HEADER)) {
+		g_message ("Ignoring checkpoint '%s' with unknown format",
+		           checkpoint->path);
+		g_free (contents);
+		return;
+	}
+
+	line = contents + strlen (CHECKPOINT_HEADER);
+
+	/* A record without its trailing newline
+	 * was torn by a power cut, skip it.
+	 */
+	while ((end = strchr (line, '\n')) != NULL) {
+		*end = '\0';
+		checkpoint_load_record (checkpoint, line);
+		line = end + 1;
+	}
+
+	g_free (contents);
+}
+
+static void
+checkpoint_write_state (TrackerCheckpoint *checkpoint,
+                        GString           *str)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	guint i;
+
+	g_string_append (str, CHECKPOINT_HEADER);
+
+	g_hash_table_iter_init (&iter, checkpoint->roots);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		RootState *state = value;
+
+		g_string_append_printf (str, "R %" G_GUINT64_FORMAT " %s %s\n",
+		                        state->mtime, state->uuid,
+		                        (const gchar *) key);
+	}
+
+	g_hash_table_iter_init (&iter, checkpoint->directories);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		DirectoryState *state = value;
+
+		g_string_append_printf (str, "P %" G_GUINT64_FORMAT
+		                        " %" G_GUINT64_FORMAT " %s\n",
+		                        state->mtime, state->queued,
+		                        (const gchar *) key);
+	}
+
+	for (i = 0; i < checkpoint->item_list->len; i++) {
+		ItemState *state = g_ptr_array_index (checkpoint->item_list, i);
+		const gchar *types = "PCUDM";
+
+		if (!state->alive) {
+			continue;
+		}
+
+		if (state->event == TRACKER_CHECKPOINT_MOVED) {
+			g_string_append_printf (str, "M %s %s\n",
+			                        state->uri, state->source_uri);
+		} else {
+			g_string_append_printf (str, "%c %s\n",
+			                        types[state->event], state->uri);
+		}
+	}
+
+	g_hash_table_iter_init (&iter, checkpoint->roots);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		RootState *state = value;
+
+		if (state->finished) {
+			g_string_append_printf (str, "F %s\n", (const gchar *) key);
+		}
+	}
+}
+
+static gboolean
+checkpoint_write_all (gint         fd,
+                      const gchar *data,
+                      gsize        len)
+{
+	gsize written = 0;
+
+	while (written < len) {
+		gssize retval;
+
+		retval = write (fd, data + written, len - written);
+
+		if (retval < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return FALSE;
+		}
+
+		written += retval;
+	}
+
+	return TRUE;
+}
+
+/* Replaces the log with the compacted state in @str. The
+ * rename() keeps either the old or the new log in place, but
+ * there's no fsync(), on power loss a log emptied by the rename
+ * only means resuming nothing, as with a missing one.
+ */
+static void
+checkpoint_replace (TrackerCheckpoint *checkpoint,
+                    GString           *str)
+{
+	gchar *tmp_path;
+	gint fd;
+
+	if (checkpoint->fd >= 0) {
+		close (checkpoint->fd);
+		checkpoint->fd = -1;
+	}
+
+	tmp_path = g_strconcat (checkpoint->path, ".tmp", NULL);
+	fd = g_open (tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+	if (fd < 0 ||
+	    !checkpoint_write_all (fd, str->str, str->len) ||
+	    close (fd) != 0 ||
+	    g_rename (tmp_path, checkpoint->path) != 0) {
+		g_warning ("Could not write checkpoint '%s': %s",
+		           checkpoint->path, g_strerror (errno));
+		g_unlink (tmp_path);
+	} else {
+		checkpoint->fd = g_open (checkpoint->path,
+		                         O_WRONLY | O_APPEND | O_CLOEXEC, 0);
+		checkpoint->size = checkpoint->compacted_size = str->len;
+	}
+
+	g_free (tmp_path);
+}
+
+static void
+checkpoint_open (TrackerCheckpoint *checkpoint)
+{
+	GString *str;
+	gchar *dirname;
+
+	dirname = g_path_get_dirname (checkpoint->path);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	/* Start every run with a compacted copy of what is
+	 * left to resume, so a second interruption while
+	 * resuming doesn't lose that state.
+	 */
+	str = g_string_new (NULL);
+	checkpoint_write_state (checkpoint, str);
+	checkpoint_replace (checkpoint, str);
+	g_string_free (str, TRUE);
+}
+
+static TrackerCheckpoint *
+checkpoint_alloc (const gchar *path)
+{
+	TrackerCheckpoint *checkpoint;
+
+	checkpoint = g_slice_new0 (TrackerCheckpoint);
+	checkpoint->path = g_strdup (path);
+	checkpoint->fd = -1;
+	checkpoint->buffer = g_string_new (NULL);
+
+	checkpoint->roots = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                           (GDestroyNotify) g_free,
+	                                           (GDestroyNotify) root_state_free);
+	checkpoint->directories = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                                 (GDestroyNotify) g_free,
+	                                                 (GDestroyNotify) g_free);
+	checkpoint->items = g_hash_table_new (g_str_hash, g_str_equal);
+	checkpoint->item_list = g_ptr_array_new_with_free_func ((GDestroyNotify) item_state_free);
+
+	return checkpoint;
+}
+
+/* Records of this run are only in the log, not in the state
+ * loaded at startup, so the log is compacted by loading it
+ * into a scratch state, as the next start would.
+ */
+static void
+checkpoint_compact (TrackerCheckpoint *checkpoint)
+{
+	TrackerCheckpoint *scratch;
+	GString *str;
+
+	scratch = checkpoint_alloc (checkpoint->path);
+	checkpoint_load (scratch);
+
+	str = g_string_new (NULL);
+	checkpoint_write_state (scratch, str);
+	tracker_checkpoint_free (scratch);
+
+	g_debug ("Compacting checkpoint '%s', %" G_GSIZE_FORMAT
+	         " to %" G_GSIZE_FORMAT " bytes",
+	         checkpoint->path, checkpoint->size, str->len);
+
+	checkpoint_replace (checkpoint, str);
+	g_string_free (str, TRUE);
+}
+
+TrackerCheckpoint *
+tracker_checkpoint_new (const gchar *path)
+{
+	TrackerCheckpoint *checkpoint;
+
+	g_return_val_if_fail (path != NULL, NULL);
+
+	checkpoint = checkpoint_alloc (path);
+	checkpoint_load (checkpoint);
+	checkpoint_open (checkpoint);
+
+	if (g_hash_table_size (checkpoint->roots) > 0) {
+		g_message ("Loaded checkpoint '%s', %d roots and %d items to resume",
+		           path,
+		           g_hash_table_size (checkpoint->roots),
+		           g_hash_table_size (checkpoint->items));
+	}
+
+	return checkpoint;
+}
+
+void
+tracker_checkpoint_free (TrackerCheckpoint *checkpoint)
+{
+	g_return_if_fail (checkpoint != NULL);
+
+	tracker_checkpoint_flush (checkpoint);
+
+	if (checkpoint->fd >= 0) {
+		close (checkpoint->fd);
+	}
+
+	g_string_free (checkpoint->buffer, TRUE);
+	g_hash_table_unref (checkpoint->items);
+	g_ptr_array_unref (checkpoint->item_list);
+	g_hash_table_unref (checkpoint->directories);
+	g_hash_table_unref (checkpoint->roots);
+	g_free (checkpoint->path);
+
+	g_slice_free (TrackerCheckpoint, checkpoint);
+}
+
+const gchar *
+tracker_checkpoint_get_path (TrackerCheckpoint *checkpoint)
+{
+	g_return_val_if_fail (checkpoint != NULL, NULL);
+
+	return checkpoint->path;
+}
+
+static gboolean
+checkpoint_flush_cb (gpointer user_data)
+{
+	TrackerCheckpoint *checkpoint = user_data;
+
+	checkpoint->flush_id = 0;
+	tracker_checkpoint_flush (checkpoint);
+
+	return FALSE;
+}
+
+static void
+checkpoint_schedule_flush (TrackerCheckpoint *checkpoint);
+
+static void
+checkpoint_append (TrackerCheckpoint *checkpoint,
+                   gchar              type,
+                   GFile             *file,
+                   GFile             *other_file)
+{
+	gchar *uri;
+
+	if (checkpoint->fd < 0) {
+		return;
+	}
+
+	uri = g_file_get_uri (file);
+	g_string_append_c (checkpoint->buffer, type);
+	g_string_append_c (checkpoint->buffer, ' ');
+	g_string_append (checkpoint->buffer, uri);
+	g_free (uri);
+
+	if (other_file) {
+		uri = g_file_get_uri (other_file);
+		g_string_append_c (checkpoint->buffer, ' ');
+		g_string_append (checkpoint->buffer, uri);
+		g_free (uri);
+	}
+
+	g_string_append_c (checkpoint->buffer, '\n');
+
+	checkpoint_schedule_flush (checkpoint);
+}
+
+static void
+checkpoint_schedule_flush (TrackerCheckpoint *checkpoint)
+{
+	/* Records are added from crawler and queue handlers,
+	 * don't block those on the write.
+	 */
+	if (checkpoint->buffer->len >= CHECKPOINT_FLUSH_SIZE) {
+		if (checkpoint->flush_id != 0 && !checkpoint->flush_idle) {
+			g_source_remove (checkpoint->flush_id);
+			checkpoint->flush_id = 0;
+		}
+
+		if (checkpoint->flush_id == 0) {
+			checkpoint->flush_id = g_idle_add (checkpoint_flush_cb,
+			                                   checkpoint);
+			checkpoint->flush_idle = TRUE;
+		}
+	} else if (checkpoint->flush_id == 0) {
+		checkpoint->flush_id =
+			g_timeout_add_seconds (CHECKPOINT_FLUSH_SECS,
+			                       checkpoint_flush_cb,
+			                       checkpoint);
+		checkpoint->flush_idle = FALSE;
+	}
+}
+
+void
+tracker_checkpoint_root_started (TrackerCheckpoint *checkpoint,
+                                 GFile             *root)
+{
+	guint64 mtime;
+	gchar *uuid, *uri;
+
+	g_return_if_fail (checkpoint != NULL);
+	g_return_if_fail (G_IS_FILE (root));
+
+	if (checkpoint->fd < 0 ||
+	    !checkpoint_query_root (root, &mtime, &uuid)) {
+		return;
+	}
+
+	uri = g_file_get_uri (root);
+	g_string_append_printf (checkpoint->buffer,
+	                        "R %" G_GUINT64_FORMAT " %s %s\n",
+	                        mtime, uuid, uri);
+	g_free (uri);
+	g_free (uuid);
+
+	checkpoint_schedule_flush (checkpoint);
+}
+
+void
+tracker_checkpoint_root_finished (TrackerCheckpoint *checkpoint,
+                                  GFile             *root)
+{
+	g_return_if_fail (checkpoint != NULL);
+	g_return_if_fail (G_IS_FILE (root));
+
+	checkpoint_append (checkpoint, 'F', root, NULL);
+}
+
+/* @mtime is the one @directory had when its contents were listed,
+ * the directory is only skipped on resume if it still matches. Files
+ * in there are queued already, so those modified in place after now
+ * are the only ones to check on resume.
+ */
+void
+tracker_checkpoint_add_directory (TrackerCheckpoint *checkpoint,
+                                  GFile             *directory,
+                                  guint64            mtime)
+{
+	gchar *uri;
+
+	g_return_if_fail (checkpoint != NULL);
+	g_return_if_fail (G_IS_FILE (directory));
+
+	if (checkpoint->fd < 0) {
+		return;
+	}
+
+	uri = g_file_get_uri (directory);
+	g_string_append_printf (checkpoint->buffer,
+	                        "P %" G_GUINT64_FORMAT " %" G_GINT64_FORMAT " %s\n",
+	                        mtime, g_get_real_time () / G_USEC_PER_SEC, uri);
+	g_free (uri);
+
+	checkpoint_schedule_flush (checkpoint);
+}
+
+void
+tracker_checkpoint_add_item (TrackerCheckpoint      *checkpoint,
+                             TrackerCheckpointEvent  event,
+                             GFile                  *file,
+                             GFile                  *source_file)
+{
+	g_return_if_fail (checkpoint != NULL);
+	g_return_if_fail (G_IS_FILE (file));
+
+	switch (event) {
+	case TRACKER_CHECKPOINT_CREATED:
+		checkpoint_append (checkpoint, 'C', file, NULL);
+		break;
+	case TRACKER_CHECKPOINT_UPDATED:
+		checkpoint_append (checkpoint, 'U', file, NULL);
+		break;
+	case TRACKER_CHECKPOINT_DELETED:
+		checkpoint_append (checkpoint, 'D', file, NULL);
+		break;
+	case TRACKER_CHECKPOINT_MOVED:
+		g_return_if_fail (G_IS_FILE (source_file));
+		checkpoint_append (checkpoint, 'M', file, source_file);
+		break;
+	default:
+		g_return_if_reached ();
+	}
+}
+
+void
+tracker_checkpoint_item_done (TrackerCheckpoint *checkpoint,
+                              GFile             *file)
+{
+	g_return_if_fail (checkpoint != NULL);
+	g_return_if_fail (G_IS_FILE (file));
+
+	checkpoint_append (checkpoint, 'X', file, NULL);
+}
+
+/* The mtime of a directory doesn't change when a file in it is
+ * written in place, so its contents are listed again, and files
+ * modified after they were all queued are reported as updated.
+ */
+static void
+checkpoint_check_contents (TrackerCheckpoint     *checkpoint,
+                           GFile                 *directory,
+                           guint64                queued,
+                           TrackerCheckpointFunc  func,
+                           gpointer               user_data)
+{
+	GFileEnumerator *enumerator;
+	GFileInfo *info;
+
+	enumerator = g_file_enumerate_children (directory,
+	                                        G_FILE_ATTRIBUTE_STANDARD_NAME ","
+	                                        G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+	                                        G_FILE_ATTRIBUTE_TIME_MODIFIED,
+	                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                        NULL, NULL);
+	if (!enumerator) {
+		return;
+	}
+
+	while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL) {
+		guint64 mtime;
+		GFile *file;
+		gchar *uri;
+
+		mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+		if (g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR ||
+		    mtime + CHECKPOINT_MTIME_SLACK < queued) {
+			g_object_unref (info);
+			continue;
+		}
+
+		file = g_file_get_child (directory, g_file_info_get_name (info));
+		uri = g_file_get_uri (file);
+
+		/* Still pending, reported with the other items */
+		if (!g_hash_table_lookup (checkpoint->items, uri)) {
+			func (TRACKER_CHECKPOINT_UPDATED, file, NULL, user_data);
+		}
+
+		g_free (uri);
+		g_object_unref (file);
+		g_object_unref (info);
+	}
+
+	g_object_unref (enumerator);
+}
+
+static void
+checkpoint_forget_root (TrackerCheckpoint *checkpoint,
+                        const gchar       *root_uri,
+                        TrackerCheckpointFunc func,
+                        gpointer           user_data)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	guint i;
+
+	g_hash_table_iter_init (&iter, checkpoint->directories);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (!checkpoint_uri_is_under (key, root_uri)) {
+			continue;
+		}
+
+		if (func) {
+			DirectoryState *state = value;
+			GFile *directory;
+			guint64 mtime;
+
+			directory = g_file_new_for_uri (key);
+
+			if (checkpoint_query_mtime (directory, &mtime) &&
+			    mtime == state->mtime) {
+				func (TRACKER_CHECKPOINT_DIRECTORY, directory, NULL, user_data);
+				checkpoint_check_contents (checkpoint, directory,
+				                           state->queued,
+				                           func, user_data);
+
+				/* Stays skippable if this run is interrupted too */
+				tracker_checkpoint_add_directory (checkpoint, directory, mtime);
+			} else {
+				/* Contents changed or directory gone since */
+				func (TRACKER_CHECKPOINT_DIRECTORY_CHANGED, directory, NULL, user_data);
+			}
+
+			g_object_unref (directory);
+		}
+
+		g_hash_table_iter_remove (&iter);
+	}
+
+	for (i = 0; i < checkpoint->item_list->len; i++) {
+		ItemState *state = g_ptr_array_index (checkpoint->item_list, i);
+
+		if (!state->alive ||
+		    !checkpoint_uri_is_under (state->uri, root_uri)) {
+			continue;
+		}
+
+		if (func) {
+			GFile *file, *source_file = NULL;
+
+			file = g_file_new_for_uri (state->uri);
+
+			if (state->source_uri) {
+				source_file = g_file_new_for_uri (state->source_uri);
+			}
+
+			func (state->event, file, source_file, user_data);
+
+			g_object_unref (file);
+
+			if (source_file) {
+				g_object_unref (source_file);
+			}
+		}
+
+		state->alive = FALSE;
+		g_hash_table_remove (checkpoint->items, state->uri);
+	}
+
+	g_hash_table_remove (checkpoint->roots, root_uri);
+}
+
+/* If the crawl of @root was completed in a previous run and its
+ * volume and mtime didn't change since, calls @func for every
+ * directory found and every item still pending in there and returns
+ * %TRUE. Directories are reported as changed if their own mtime
+ * differs from the logged one, their contents must then be checked
+ * again. Otherwise only the files in there modified since are
+ * reported, as updated. Either way, the state left for @root is
+ * consumed.
+ */
+gboolean
+tracker_checkpoint_resume (TrackerCheckpoint     *checkpoint,
+                           GFile                 *root,
+                           TrackerCheckpointFunc  func,
+                           gpointer               user_data)
+{
+	RootState *state;
+	gboolean resumable = FALSE;
+	guint64 mtime;
+	gchar *uri, *uuid;
+
+	g_return_val_if_fail (checkpoint != NULL, FALSE);
+	g_return_val_if_fail (G_IS_FILE (root), FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	if (g_hash_table_size (checkpoint->roots) == 0) {
+		return FALSE;
+	}
+
+	uri = g_file_get_uri (root);
+	state = g_hash_table_lookup (checkpoint->roots, uri);
+
+	if (state && state->finished &&
+	    checkpoint_query_root (root, &mtime, &uuid)) {
+		resumable = (mtime == state->mtime &&
+		             g_strcmp0 (uuid, state->uuid) == 0);
+		g_free (uuid);
+	}
+
+	if (state) {
+		g_debug ("Checkpoint for '%s' %s", uri,
+		         resumable ? "is resumable" : "is stale, discarding");
+	}
+
+	checkpoint_forget_root (checkpoint, uri,
+	                        resumable ? func : NULL,
+	                        user_data);
+	g_free (uri);
+
+	return resumable;
+}
+
+void
+tracker_checkpoint_flush (TrackerCheckpoint *checkpoint)
+{
+	g_return_if_fail (checkpoint != NULL);
+
+	if (checkpoint->flush_id) {
+		g_source_remove (checkpoint->flush_id);
+		checkpoint->flush_id = 0;
+	}
+
+	if (checkpoint->fd < 0) {
+		g_string_truncate (checkpoint->buffer, 0);
+		return;
+	}
+
+	/* No fsync() here, losing the latest records on
+	 * power loss only means resuming from an older state.
+	 */
+	if (!checkpoint_write_all (checkpoint->fd,
+	                           checkpoint->buffer->str,
+	                           checkpoint->buffer->len)) {
+		g_warning ("Could not write checkpoint '%s': %s, disabling",
+		           checkpoint->path, g_strerror (errno));
+		close (checkpoint->fd);
+		checkpoint->fd = -1;
+		g_string_truncate (checkpoint->buffer, 0);
+		return;
+	}
+
+	checkpoint->size += checkpoint->buffer->len;
+	g_string_truncate (checkpoint->buffer, 0);
+
+	/* Items done and directories listed again leave
+	 * dead records behind during a long crawl.
+	 */
+	if (checkpoint->size > CHECKPOINT_COMPACT_MIN_SIZE &&
+	    checkpoint->size > CHECKPOINT_COMPACT_RATIO * checkpoint->compacted_size) {
+		checkpoint_compact (checkpoint);
+	}
+}
+
+/* Called once nothing is left to index, the next
+ * start must go through a regular crawl again.
+ */
+void
+tracker_checkpoint_clear (TrackerCheckpoint *checkpoint)
+{
+	g_return_if_fail (checkpoint != NULL);
+
+	if (checkpoint->flush_id) {
+		g_source_remove (checkpoint->flush_id);
+		checkpoint->flush_id = 0;
+	}
+
+	g_string_truncate (checkpoint->buffer, 0);
+
+	g_hash_table_remove_all (checkpoint->roots);
+	g_hash_table_remove_all (checkpoint->directories);
+	g_hash_table_remove_all (checkpoint->items);
+	g_ptr_array_set_size (checkpoint->item_list, 0);
+
+	if (checkpoint->fd >= 0) {
+		if (ftruncate (checkpoint->fd, 0) != 0) {
+			g_warning ("Could not truncate checkpoint '%s': %s",
+			           checkpoint->path, g_strerror (errno));
+		}
+
+		checkpoint->size = checkpoint->compacted_size = 0;
+
+		g_string_append (checkpoint->buffer, CHECKPOINT_HEADER);
+		tracker_checkpoint_flush (checkpoint);
+	}
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_MINER_CHECKPOINT_H__
+#define __LIBTRACKER_MINER_CHECKPOINT_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Append-only log of the crawl frontier and the pending item queues,
+ * so an interrupted indexing run can be resumed on the next start
+ * instead of crawling and querying every index root again. The log
+ * is never fsync()ed, a torn last record is simply ignored.
+ */
+typedef struct _TrackerCheckpoint TrackerCheckpoint;
+
+typedef enum {
+	TRACKER_CHECKPOINT_DIRECTORY,
+	TRACKER_CHECKPOINT_CREATED,
+	TRACKER_CHECKPOINT_UPDATED,
+	TRACKER_CHECKPOINT_DELETED,
+	TRACKER_CHECKPOINT_MOVED,
+	TRACKER_CHECKPOINT_DIRECTORY_CHANGED
+} TrackerCheckpointEvent;
+
+typedef void (* TrackerCheckpointFunc) (TrackerCheckpointEvent  event,
+                                        GFile                  *file,
+                                        GFile                  *source_file,
+                                        gpointer                user_data);
+
+TrackerCheckpoint * tracker_checkpoint_new            (const gchar            *path);
+void                tracker_checkpoint_free           (TrackerCheckpoint      *checkpoint);
+
+const gchar *       tracker_checkpoint_get_path       (TrackerCheckpoint      *checkpoint);
+
+void                tracker_checkpoint_root_started   (TrackerCheckpoint      *checkpoint,
+                                                       GFile                  *root);
+void                tracker_checkpoint_root_finished  (TrackerCheckpoint      *checkpoint,
+                                                       GFile                  *root);
+void                tracker_checkpoint_add_directory  (TrackerCheckpoint      *checkpoint,
+                                                       GFile                  *directory,
+                                                       guint64                 mtime);
+void                tracker_checkpoint_add_item       (TrackerCheckpoint      *checkpoint,
+                                                       TrackerCheckpointEvent  event,
+                                                       GFile                  *file,
+                                                       GFile                  *source_file);
+void                tracker_checkpoint_item_done      (TrackerCheckpoint      *checkpoint,
+                                                       GFile                  *file);
+
+gboolean            tracker_checkpoint_resume         (TrackerCheckpoint      *checkpoint,
+                                                       GFile                  *root,
+                                                       TrackerCheckpointFunc   func,
+                                                       gpointer                user_data);
+
+void                tracker_checkpoint_flush          (TrackerCheckpoint      *checkpoint);
+void                tracker_checkpoint_clear          (TrackerCheckpoint      *checkpoint);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_MINER_CHECKPOINT_H__ */
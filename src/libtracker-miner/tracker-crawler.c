@@ -49,6 +49,9 @@ struct DirectoryChildData {
 struct DirectoryProcessingData {
 	GNode *node;
 	GSList *children;
+
+	/* Nodes for the regular files found, only when streaming */
+	GSList *file_nodes;
 	guint was_inspected : 1;
 	guint ignored_by_content : 1;
 };
@@ -60,6 +63,12 @@ struct DirectoryRootInfo {
 
 	GQueue *directory_processing_queue;
 
+	/* Subtree to crawl ahead of the rest, if any */
+	GFile *boost_directory;
+
+	/* Subtrees that went away while crawling */
+	GSList *pruned_directories;
+
 	/* Directory stats */
 	guint directories_found;
 	guint directories_ignored;
@@ -82,8 +91,15 @@ struct TrackerCrawlerPrivate {
 
 	gboolean        recurse;
 
+	/* Hand over the contents of each directory as soon as it
+	 * is crawled, and only keep directories in the tree.
+	 */
+	gboolean        streaming;
+
 	/* Statistics */
 	GTimer         *timer;
+	guint           n_nodes;
+	guint           peak_nodes;
 
 	/* Status */
 	gboolean        is_running;
@@ -97,6 +113,7 @@ enum {
 	CHECK_FILE,
 	CHECK_DIRECTORY_CONTENTS,
 	DIRECTORY_CRAWLED,
+	DIRECTORY_CONTENTS_CRAWLED,
 	FINISHED,
 	LAST_SIGNAL
 };
@@ -188,6 +205,17 @@ tracker_crawler_class_init (TrackerCrawlerClass *klass)
 		              G_TYPE_UINT,
 		              G_TYPE_UINT,
 		              G_TYPE_UINT);
+	signals[DIRECTORY_CONTENTS_CRAWLED] =
+		g_signal_new ("directory-contents-crawled",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              G_STRUCT_OFFSET (TrackerCrawlerClass, directory_contents_crawled),
+		              NULL, NULL,
+		              tracker_marshal_VOID__OBJECT_POINTER,
+		              G_TYPE_NONE,
+		              2,
+		              G_TYPE_FILE,
+		              G_TYPE_POINTER);
 	signals[FINISHED] =
 		g_signal_new ("finished",
 		              G_TYPE_FROM_CLASS (klass),
@@ -355,6 +383,7 @@ directory_processing_data_free (DirectoryProcessingData *data)
 {
 	g_slist_foreach (data->children, (GFunc) directory_child_data_free, NULL);
 	g_slist_free (data->children);
+	g_slist_free (data->file_nodes);
 
 	g_slice_free (DirectoryProcessingData, data);
 }
@@ -433,9 +462,101 @@ directory_root_info_free (DirectoryRootInfo *info)
 			 NULL);
 	g_queue_free (info->directory_processing_queue);
 
+	if (info->boost_directory) {
+		g_object_unref (info->boost_directory);
+	}
+
+	g_slist_free_full (info->pruned_directories, g_object_unref);
+
 	g_slice_free (DirectoryRootInfo, info);
 }
 
+static gboolean
+directory_root_info_is_boosted (DirectoryRootInfo *info,
+                                GFile             *file)
+{
+	if (!info->boost_directory) {
+		return FALSE;
+	}
+
+	/* Parents of the boosted directory need crawling first
+	 * for the subtree to be found at all.
+	 */
+	return (g_file_equal (file, info->boost_directory) ||
+	        g_file_has_prefix (file, info->boost_directory) ||
+	        g_file_has_prefix (info->boost_directory, file));
+}
+
+static gboolean
+file_is_within (GFile *file,
+                GFile *directory)
+{
+	return (g_file_equal (file, directory) ||
+	        g_file_has_prefix (file, directory));
+}
+
+static gboolean
+directory_root_info_is_pruned (DirectoryRootInfo *info,
+                               GFile             *file)
+{
+	GSList *l;
+
+	for (l = info->pruned_directories; l; l = l->next) {
+		if (file_is_within (file, l->data)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static void
+crawler_add_nodes (TrackerCrawler *crawler,
+                   guint           n_nodes)
+{
+	TrackerCrawlerPrivate *priv = crawler->priv;
+
+	priv->n_nodes += n_nodes;
+	priv->peak_nodes = MAX (priv->peak_nodes, priv->n_nodes);
+}
+
+static void
+crawler_remove_nodes (TrackerCrawler *crawler,
+                      guint           n_nodes)
+{
+	TrackerCrawlerPrivate *priv = crawler->priv;
+
+	priv->n_nodes -= MIN (priv->n_nodes, n_nodes);
+}
+
+/* Hands over a directory whose contents are fully crawled, the
+ * regular files in it are dropped from the tree afterwards, only
+ * directories are kept, as parents of what is crawled next.
+ */
+static void
+directory_stream_contents (TrackerCrawler          *crawler,
+                           DirectoryProcessingData *dir_data)
+{
+	GSList *l;
+	guint n_nodes = 0;
+
+	g_signal_emit (crawler, signals[DIRECTORY_CONTENTS_CRAWLED], 0,
+	               dir_data->node->data, dir_data->node);
+
+	for (l = dir_data->file_nodes; l; l = l->next) {
+		GNode *node = l->data;
+
+		g_object_unref (node->data);
+		g_node_destroy (node);
+		n_nodes++;
+	}
+
+	g_slist_free (dir_data->file_nodes);
+	dir_data->file_nodes = NULL;
+
+	crawler_remove_nodes (crawler, n_nodes);
+}
+
 static gboolean
 process_func (gpointer data)
 {
@@ -500,7 +621,8 @@ process_func (gpointer data)
 			child_data = dir_data->children->data;
 			dir_data->children = g_slist_remove (dir_data->children, child_data);
 
-			if (((child_data->is_dir &&
+			if (!directory_root_info_is_pruned (info, child_data->child) &&
+			    ((child_data->is_dir &&
 			      check_directory (crawler, info, child_data->child)) ||
 			     (!child_data->is_dir &&
 			      check_file (crawler, info, child_data->child))) &&
@@ -510,6 +632,12 @@ process_func (gpointer data)
 			    priv->is_running) {
 				child_node = g_node_prepend_data (dir_data->node,
 								  g_object_ref (child_data->child));
+				crawler_add_nodes (crawler, 1);
+
+				if (priv->streaming && !child_data->is_dir) {
+					dir_data->file_nodes = g_slist_prepend (dir_data->file_nodes,
+					                                        child_node);
+				}
 			}
 
 			if (info->recurse && priv->is_running &&
@@ -517,13 +645,27 @@ process_func (gpointer data)
 				DirectoryProcessingData *child_dir_data;
 
 				child_dir_data = directory_processing_data_new (child_node);
-				g_queue_push_tail (info->directory_processing_queue, child_dir_data);
+
+				if (directory_root_info_is_boosted (info, child_data->child)) {
+					/* Keep the current directory at the head */
+					g_queue_insert_after (info->directory_processing_queue,
+					                      info->directory_processing_queue->head,
+					                      child_dir_data);
+				} else {
+					g_queue_push_tail (info->directory_processing_queue, child_dir_data);
+				}
 			}
 
 			directory_child_data_free (child_data);
 		} else {
 			/* No (more) children, or directory ignored. stop processing. */
 			g_queue_pop_head (info->directory_processing_queue);
+
+			if (priv->streaming &&
+			    !directory_root_info_is_pruned (info, dir_data->node->data)) {
+				directory_stream_contents (crawler, dir_data);
+			}
+
 			directory_processing_data_free (dir_data);
 		}
 	} else if (!dir_data && info) {
@@ -539,6 +681,7 @@ process_func (gpointer data)
 			       info->files_ignored);
 
 		g_queue_pop_head (priv->directories);
+		crawler_remove_nodes (crawler, g_node_n_nodes (info->tree, G_TRAVERSE_ALL));
 		directory_root_info_free (info);
 	}
 
@@ -877,6 +1020,7 @@ tracker_crawler_start (TrackerCrawler *crawler,
 
 	info = directory_root_info_new (file, recurse, priv->file_attributes);
 	g_queue_push_tail (priv->directories, info);
+	crawler_add_nodes (crawler, 1);
 
 	process_func_start (crawler);
 
@@ -910,6 +1054,7 @@ tracker_crawler_stop (TrackerCrawler *crawler)
 	/* Clean up queue */
 	g_queue_foreach (priv->directories, (GFunc) directory_root_info_free, NULL);
 	g_queue_clear (priv->directories);
+	priv->n_nodes = 0;
 
 	g_signal_emit (crawler, signals[FINISHED], 0,
 	               !priv->is_finished);
@@ -951,6 +1096,261 @@ tracker_crawler_resume (TrackerCrawler *crawler)
 	           crawler->priv->is_running ? "currently running" : "not running");
 }
 
+/**
+ * tracker_crawler_prioritize:
+ * @crawler: a #TrackerCrawler
+ * @directory: a directory within the root being crawled
+ *
+ * Reorders the pending directories of the root currently being
+ * crawled so @directory and everything below it is crawled next.
+ * Directories found later within @directory are also put ahead
+ * of the rest.
+ *
+ * Returns: %TRUE if @directory belongs to the root being crawled.
+ **/
+gboolean
+tracker_crawler_prioritize (TrackerCrawler *crawler,
+                            GFile          *directory)
+{
+	DirectoryRootInfo *info;
+	GQueue *queue;
+	GList *l, *next, *insert_after;
+
+	g_return_val_if_fail (TRACKER_IS_CRAWLER (crawler), FALSE);
+	g_return_val_if_fail (G_IS_FILE (directory), FALSE);
+
+	info = g_queue_peek_head (crawler->priv->directories);
+
+	if (!info ||
+	    (!g_file_equal (directory, info->directory) &&
+	     !g_file_has_prefix (directory, info->directory))) {
+		return FALSE;
+	}
+
+	if (info->boost_directory) {
+		g_object_unref (info->boost_directory);
+	}
+
+	info->boost_directory = g_object_ref (directory);
+
+	queue = info->directory_processing_queue;
+	insert_after = queue->head;
+
+	if (!insert_after) {
+		return TRUE;
+	}
+
+	/* The head is being processed, move the matching
+	 * directories right after it, keeping their order.
+	 */
+	for (l = insert_after->next; l; l = next) {
+		DirectoryProcessingData *dir_data = l->data;
+
+		next = l->next;
+
+		if (!directory_root_info_is_boosted (info, dir_data->node->data)) {
+			continue;
+		}
+
+		if (l != insert_after->next) {
+			g_queue_unlink (queue, l);
+			g_queue_insert_after (queue, insert_after, dir_data);
+			g_list_free_1 (l);
+		}
+
+		insert_after = insert_after->next;
+	}
+
+	return TRUE;
+}
+
+/* Destroys @node and everything below, except @keep and its parents */
+static guint
+directory_tree_prune (GNode *node,
+                      GNode *keep)
+{
+	GNode *child, *next;
+	guint n_pruned = 0;
+
+	if (!keep ||
+	    (node != keep && !g_node_is_ancestor (node, keep))) {
+		n_pruned = g_node_n_nodes (node, G_TRAVERSE_ALL);
+		g_node_traverse (node,
+		                 G_PRE_ORDER,
+		                 G_TRAVERSE_ALL,
+		                 -1,
+		                 directory_tree_free_foreach,
+		                 NULL);
+		g_node_destroy (node);
+
+		return n_pruned;
+	}
+
+	for (child = node->children; child; child = next) {
+		next = child->next;
+		n_pruned += directory_tree_prune (child, keep);
+	}
+
+	return n_pruned;
+}
+
+/* Only descends along the path to @prefix */
+static guint
+directory_tree_prune_prefix (GNode *node,
+                             GFile *prefix,
+                             GNode *keep)
+{
+	GNode *child, *next;
+	guint n_pruned = 0;
+
+	for (child = node->children; child; child = next) {
+		next = child->next;
+
+		if (file_is_within (child->data, prefix)) {
+			n_pruned += directory_tree_prune (child, keep);
+		} else if (g_file_has_prefix (prefix, child->data)) {
+			n_pruned += directory_tree_prune_prefix (child, prefix, keep);
+		}
+	}
+
+	return n_pruned;
+}
+
+/**
+ * tracker_crawler_prune:
+ * @crawler: a #TrackerCrawler
+ * @prefix: a directory within the root being crawled
+ *
+ * Drops everything found so far within @prefix from the root
+ * being crawled, together with the directories pending to be
+ * crawled there, and keeps the crawler out of @prefix from then
+ * on. This is meant for subtrees going away mid-crawl, as in
+ * unmounts, so these don't need to fail one by one.
+ *
+ * Returns: the number of files and directories dropped.
+ **/
+guint
+tracker_crawler_prune (TrackerCrawler *crawler,
+                       GFile          *prefix)
+{
+	DirectoryRootInfo *info;
+	DirectoryProcessingData *head;
+	GQueue *queue;
+	GList *l, *next;
+	GSList *sl, *snext;
+	guint n_pruned = 0;
+
+	g_return_val_if_fail (TRACKER_IS_CRAWLER (crawler), 0);
+	g_return_val_if_fail (G_IS_FILE (prefix), 0);
+
+	info = g_queue_peek_head (crawler->priv->directories);
+
+	if (!info ||
+	    !g_file_has_prefix (prefix, info->directory)) {
+		return 0;
+	}
+
+	info->pruned_directories = g_slist_prepend (info->pruned_directories,
+	                                            g_object_ref (prefix));
+
+	queue = info->directory_processing_queue;
+	head = g_queue_peek_head (queue);
+
+	if (head) {
+		for (l = queue->head->next; l; l = next) {
+			DirectoryProcessingData *dir_data = l->data;
+
+			next = l->next;
+
+			if (file_is_within (dir_data->node->data, prefix)) {
+				g_queue_delete_link (queue, l);
+				directory_processing_data_free (dir_data);
+			}
+		}
+
+		/* Nodes below are about to be destroyed */
+		for (sl = head->file_nodes; sl; sl = snext) {
+			GNode *node = sl->data;
+
+			snext = sl->next;
+
+			if (file_is_within (node->data, prefix)) {
+				head->file_nodes = g_slist_delete_link (head->file_nodes, sl);
+			}
+		}
+
+		if (file_is_within (head->node->data, prefix)) {
+			/* The directory being enumerated went away, stop
+			 * that and have it popped on the next iteration.
+			 * Its node stays, the enumerator still uses it.
+			 */
+			g_list_foreach (crawler->priv->cancellables,
+			                (GFunc) g_cancellable_cancel,
+			                NULL);
+			head->was_inspected = TRUE;
+			head->ignored_by_content = TRUE;
+		}
+	}
+
+	n_pruned = directory_tree_prune_prefix (info->tree, prefix,
+	                                        head ? head->node : NULL);
+	crawler_remove_nodes (crawler, n_pruned);
+
+	return n_pruned;
+}
+
+/**
+ * tracker_crawler_set_streaming:
+ * @crawler: a #TrackerCrawler
+ * @streaming: whether to hand over directories as they are crawled
+ *
+ * When streaming, ::directory-contents-crawled is emitted for each
+ * directory as soon as its contents are crawled, and the regular
+ * files in it are dropped from the tree right after, so memory use
+ * doesn't grow with the number of files in the root being crawled.
+ * ::directory-crawled is still emitted at the end, with a tree
+ * holding only the directories and the files found before
+ * streaming was enabled.
+ **/
+void
+tracker_crawler_set_streaming (TrackerCrawler *crawler,
+                               gboolean        streaming)
+{
+	g_return_if_fail (TRACKER_IS_CRAWLER (crawler));
+
+	crawler->priv->streaming = (streaming != FALSE);
+}
+
+gboolean
+tracker_crawler_get_streaming (TrackerCrawler *crawler)
+{
+	g_return_val_if_fail (TRACKER_IS_CRAWLER (crawler), FALSE);
+
+	return crawler->priv->streaming;
+}
+
+/**
+ * tracker_crawler_get_n_nodes:
+ * @crawler: a #TrackerCrawler
+ * @peak: (out) (allow-none): return location for the highest number
+ *        of nodes held at once, or %NULL
+ *
+ * Returns: the number of files and directories currently held in
+ * the trees of the roots being crawled.
+ **/
+guint
+tracker_crawler_get_n_nodes (TrackerCrawler *crawler,
+                             guint          *peak)
+{
+	g_return_val_if_fail (TRACKER_IS_CRAWLER (crawler), 0);
+
+	if (peak) {
+		*peak = crawler->priv->peak_nodes;
+	}
+
+	return crawler->priv->n_nodes;
+}
+
 void
 tracker_crawler_set_throttle (TrackerCrawler *crawler,
                               gdouble         throttle)
@@ -67,6 +67,9 @@ struct TrackerCrawlerClass {
 	                                       guint           files_ignored);
 	void     (* finished)                 (TrackerCrawler *crawler,
 	                                       gboolean        interrupted);
+	void     (* directory_contents_crawled) (TrackerCrawler *crawler,
+	                                         GFile          *directory,
+	                                         GNode          *node);
 };
 
 GType           tracker_crawler_get_type     (void);
@@ -79,6 +82,15 @@ void            tracker_crawler_pause        (TrackerCrawler *crawler);
 void            tracker_crawler_resume       (TrackerCrawler *crawler);
 void            tracker_crawler_set_throttle (TrackerCrawler *crawler,
                                               gdouble         throttle);
+gboolean        tracker_crawler_prioritize   (TrackerCrawler *crawler,
+                                              GFile          *directory);
+guint           tracker_crawler_prune        (TrackerCrawler *crawler,
+                                              GFile          *prefix);
+void            tracker_crawler_set_streaming (TrackerCrawler *crawler,
+                                               gboolean        streaming);
+gboolean        tracker_crawler_get_streaming (TrackerCrawler *crawler);
+guint           tracker_crawler_get_n_nodes   (TrackerCrawler *crawler,
+                                               guint          *peak);
 
 void            tracker_crawler_set_file_attributes (TrackerCrawler *crawler,
 						     const gchar    *file_attributes);
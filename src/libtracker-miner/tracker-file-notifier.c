@@ -26,6 +26,7 @@
 #include "tracker-miner-common.h"
 #include "tracker-file-notifier.h"
 #include "tracker-file-system.h"
+#include "tracker-checkpoint.h"
 #include "tracker-crawler.h"
 #include "tracker-monitor.h"
 #include "tracker-marshal.h"
@@ -35,6 +36,13 @@ static GQuark quark_property_queried = 0;
 static GQuark quark_property_iri = 0;
 static GQuark quark_property_store_mtime = 0;
 static GQuark quark_property_filesystem_mtime = 0;
+static GQuark quark_property_notified = 0;
+
+/* Rough cost of each file held while crawling, crawled files
+ * carry their GFileInfo, cached ones just the node and properties.
+ */
+#define CRAWLED_FILE_COST 512
+#define CACHED_FILE_COST  256
 
 enum {
 	PROP_0,
@@ -64,6 +72,9 @@ typedef struct {
 	TrackerCrawler *crawler;
 	TrackerMonitor *monitor;
 
+	/* Not owned */
+	TrackerCheckpoint *checkpoint;
+
 	GTimer *timer;
 
 	/* List of pending directory
@@ -224,6 +235,14 @@ file_notifier_traverse_tree_foreach (GFile    *file,
 	disk_mtime = tracker_file_system_get_property (priv->file_system, file,
 	                                               quark_property_filesystem_mtime);
 
+	if (tracker_file_system_get_property (priv->file_system, file,
+	                                      quark_property_notified)) {
+		/* Already notified while streaming, just
+		 * skip the contents of deleted directories.
+		 */
+		return (store_mtime && !disk_mtime);
+	}
+
 	if (store_mtime && !disk_mtime) {
 		/* In store but not in disk, delete */
 		g_signal_emit (notifier, signals[FILE_DELETED], 0, file);
@@ -255,6 +274,25 @@ file_notifier_traverse_tree_foreach (GFile    *file,
 	return FALSE;
 }
 
+static gboolean
+file_notifier_checkpoint_foreach (GFile    *file,
+                                  gpointer  user_data)
+{
+	TrackerFileNotifier *notifier = user_data;
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	guint64 *disk_mtime;
+
+	/* Only directories are left, deleted ones have no mtime */
+	disk_mtime = tracker_file_system_get_property (priv->file_system, file,
+	                                               quark_property_filesystem_mtime);
+
+	if (disk_mtime) {
+		tracker_checkpoint_add_directory (priv->checkpoint, file, *disk_mtime);
+	}
+
+	return FALSE;
+}
+
 static void
 file_notifier_traverse_tree (TrackerFileNotifier *notifier)
 {
@@ -275,6 +313,7 @@ file_notifier_traverse_tree (TrackerFileNotifier *notifier)
 		tracker_file_system_traverse (priv->file_system,
 		                              current_root,
 		                              G_LEVEL_ORDER,
+		                              -1,
 		                              file_notifier_traverse_tree_foreach,
 		                              notifier);
 	}
@@ -289,6 +328,23 @@ file_notifier_traverse_tree (TrackerFileNotifier *notifier)
 	tracker_info ("  Notified files after %2.2f seconds",
 	              g_timer_elapsed (priv->timer, NULL));
 
+	/* Every item in the directories is now queued, so these
+	 * can be skipped on resume as long as their mtime matches.
+	 */
+	if (priv->checkpoint &&
+	    flags & TRACKER_DIRECTORY_FLAG_MONITOR) {
+		tracker_file_system_traverse (priv->file_system,
+		                              current_root,
+		                              G_PRE_ORDER,
+		                              -1,
+		                              file_notifier_checkpoint_foreach,
+		                              notifier);
+	}
+
+	if (priv->checkpoint && config_root == current_root) {
+		tracker_checkpoint_root_finished (priv->checkpoint, current_root);
+	}
+
 	/* We've finished crawling/querying on the first element
 	 * of the pending list, continue onto the next */
 	priv->pending_index_roots = g_list_delete_link (priv->pending_index_roots,
@@ -384,6 +440,120 @@ crawler_directory_crawled_cb (TrackerCrawler *crawler,
 	              files_ignored);
 }
 
+typedef struct {
+	TrackerFileNotifier *notifier;
+	GFile *directory;
+	gboolean notify_directory;
+} StreamDirectoryData;
+
+static gboolean
+file_notifier_stream_foreach (GFile    *file,
+                              gpointer  user_data)
+{
+	StreamDirectoryData *data = user_data;
+	TrackerFileNotifierPrivate *priv;
+	gboolean retval;
+
+	priv = data->notifier->priv;
+
+	if (file == data->directory && !data->notify_directory) {
+		return FALSE;
+	}
+
+	retval = file_notifier_traverse_tree_foreach (file, data->notifier);
+	tracker_file_system_set_property (priv->file_system, file,
+	                                  quark_property_notified,
+	                                  GUINT_TO_POINTER (TRUE));
+	return retval;
+}
+
+/* Notifies the direct children of a crawled directory right
+ * away, rather than when the whole root has been crawled. The
+ * regular files in it are then no longer needed, directories
+ * are kept for the final pass, which skips notified files.
+ */
+static void
+crawler_directory_contents_crawled_cb (TrackerCrawler *crawler,
+                                       GFile          *directory,
+                                       GNode          *node,
+                                       gpointer        user_data)
+{
+	TrackerFileNotifier *notifier;
+	TrackerFileNotifierPrivate *priv;
+	DirectoryCrawledData data = { 0 };
+	StreamDirectoryData stream_data;
+	TrackerDirectoryFlags flags;
+	GFile *current_root, *config_root, *canonical;
+	GSList *files = NULL, *l;
+	GNode *child;
+
+	notifier = data.notifier = user_data;
+	priv = notifier->priv;
+	current_root = priv->pending_index_roots->data;
+
+	/* Not queried yet, leave it all to the final pass */
+	if (!tracker_file_system_get_property (priv->file_system,
+	                                       current_root,
+	                                       quark_property_queried)) {
+		return;
+	}
+
+	g_node_traverse (node,
+	                 G_PRE_ORDER,
+	                 G_TRAVERSE_ALL,
+	                 2,
+	                 file_notifier_add_node_foreach,
+	                 &data);
+
+	canonical = tracker_file_system_peek_file (priv->file_system, directory);
+
+	if (!canonical) {
+		return;
+	}
+
+	config_root = tracker_indexing_tree_get_root (priv->indexing_tree,
+	                                              current_root, &flags);
+
+	if (config_root != current_root ||
+	    flags & TRACKER_DIRECTORY_FLAG_CHECK_MTIME) {
+		stream_data.notifier = notifier;
+		stream_data.directory = canonical;
+		stream_data.notify_directory = (canonical == current_root);
+
+		tracker_file_system_traverse (priv->file_system,
+		                              canonical,
+		                              G_PRE_ORDER,
+		                              2,
+		                              file_notifier_stream_foreach,
+		                              &stream_data);
+	}
+
+	for (child = node->children; child; child = child->next) {
+		GFileInfo *file_info;
+
+		file_info = tracker_crawler_get_file_info (crawler, child->data);
+
+		if (file_info &&
+		    g_file_info_get_file_type (file_info) == G_FILE_TYPE_REGULAR) {
+			canonical = tracker_file_system_peek_file (priv->file_system,
+			                                           child->data);
+			if (canonical) {
+				files = g_slist_prepend (files, canonical);
+			}
+		}
+	}
+
+	/* Forgetting may free the nodes, so it's done
+	 * once the tree is no longer being traversed.
+	 */
+	for (l = files; l; l = l->next) {
+		tracker_file_system_forget_files (priv->file_system, l->data,
+		                                  G_FILE_TYPE_REGULAR);
+	}
+
+	g_slist_free (files);
+}
+
 static void
 sparql_file_query_populate (TrackerFileNotifier *notifier,
                             TrackerSparqlCursor *cursor,
@@ -550,6 +720,126 @@ sparql_file_query_start (TrackerFileNotifier *notifier,
 	g_free (uri);
 }
 
+typedef struct {
+	TrackerFileNotifier *notifier;
+	GList *changed_directories;
+} CheckpointResumeData;
+
+static void
+checkpoint_resume_foreach (TrackerCheckpointEvent  event,
+                           GFile                  *file,
+                           GFile                  *source_file,
+                           gpointer                user_data)
+{
+	CheckpointResumeData *data = user_data;
+	TrackerFileNotifier *notifier = data->notifier;
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	GFile *canonical;
+
+	switch (event) {
+	case TRACKER_CHECKPOINT_DIRECTORY:
+		canonical = tracker_file_system_get_file (priv->file_system,
+		                                          file,
+		                                          G_FILE_TYPE_DIRECTORY,
+		                                          NULL);
+		tracker_monitor_add (priv->monitor, canonical);
+		break;
+	case TRACKER_CHECKPOINT_DIRECTORY_CHANGED:
+		data->changed_directories = g_list_prepend (data->changed_directories,
+		                                            g_object_ref (file));
+		break;
+	case TRACKER_CHECKPOINT_CREATED:
+		g_signal_emit (notifier, signals[FILE_CREATED], 0, file);
+		break;
+	case TRACKER_CHECKPOINT_UPDATED:
+		/* Also files modified in place under unchanged
+		 * directories, these weren't filtered yet.
+		 */
+		if (tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
+		                                             file,
+		                                             G_FILE_TYPE_REGULAR)) {
+			g_signal_emit (notifier, signals[FILE_UPDATED], 0, file, FALSE);
+		}
+		break;
+	case TRACKER_CHECKPOINT_DELETED:
+		g_signal_emit (notifier, signals[FILE_DELETED], 0, file);
+		break;
+	case TRACKER_CHECKPOINT_MOVED:
+		g_signal_emit (notifier, signals[FILE_MOVED], 0, source_file, file);
+		break;
+	}
+}
+
+/* Picks up an index root from where a previous, interrupted
+ * run left it, instead of crawling and querying it again.
+ */
+static gboolean
+crawl_directory_resume (TrackerFileNotifier *notifier,
+                        GFile               *directory)
+{
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	CheckpointResumeData data = { notifier, NULL };
+	GList *l, *other;
+	gchar *uri;
+
+	if (!priv->checkpoint ||
+	    !tracker_indexing_tree_file_is_root (priv->indexing_tree, directory)) {
+		return FALSE;
+	}
+
+	if (!tracker_checkpoint_resume (priv->checkpoint, directory,
+	                                checkpoint_resume_foreach,
+	                                &data)) {
+		return FALSE;
+	}
+
+	/* Directories changed since are crawled and checked against
+	 * the store again, along with everything below them.
+	 */
+	for (l = data.changed_directories; l; l = l->next) {
+		gboolean nested = FALSE;
+		GFile *canonical;
+
+		for (other = data.changed_directories; other; other = other->next) {
+			if (g_file_has_prefix (l->data, other->data)) {
+				nested = TRUE;
+				break;
+			}
+		}
+
+		if (nested ||
+		    g_file_equal (l->data, directory) ||
+		    !tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
+		                                              l->data,
+		                                              G_FILE_TYPE_DIRECTORY)) {
+			continue;
+		}
+
+		canonical = tracker_file_system_get_file (priv->file_system,
+		                                          l->data,
+		                                          G_FILE_TYPE_DIRECTORY,
+		                                          NULL);
+		priv->pending_index_roots = g_list_append (priv->pending_index_roots,
+		                                           canonical);
+	}
+
+	g_list_free_full (data.changed_directories, g_object_unref);
+
+	g_signal_emit (notifier, signals[DIRECTORY_STARTED], 0, directory);
+
+	tracker_checkpoint_root_started (priv->checkpoint, directory);
+	tracker_checkpoint_root_finished (priv->checkpoint, directory);
+
+	g_signal_emit (notifier, signals[DIRECTORY_FINISHED], 0,
+	               directory, 0, 0, 0, 0);
+
+	uri = g_file_get_uri (directory);
+	tracker_info ("Resumed '%s' from checkpoint", uri);
+	g_free (uri);
+
+	return TRUE;
+}
+
 static gboolean
 crawl_directories_start (TrackerFileNotifier *notifier)
 {
@@ -586,11 +876,19 @@ crawl_directories_start (TrackerFileNotifier *notifier)
 		g_cancellable_reset (priv->cancellable);
 
 		if ((flags & TRACKER_DIRECTORY_FLAG_IGNORE) == 0 &&
-		    tracker_crawler_start (priv->crawler,
-		                           directory,
-		                           (flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0)) {
+		    crawl_directory_resume (notifier, directory)) {
+			/* Nothing to crawl, go on with the next root */
+		} else if ((flags & TRACKER_DIRECTORY_FLAG_IGNORE) == 0 &&
+		           tracker_crawler_start (priv->crawler,
+		                                  directory,
+		                                  (flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0)) {
 			gchar *uri;
 
+			if (priv->checkpoint &&
+			    tracker_indexing_tree_file_is_root (priv->indexing_tree, directory)) {
+				tracker_checkpoint_root_started (priv->checkpoint, directory);
+			}
+
 			sparql_file_query_start (notifier, directory,
 			                         G_FILE_TYPE_DIRECTORY,
 			                         (flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0,
@@ -997,6 +1295,40 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 	}
 }
 
+static void
+monitor_directory_contents_changed_cb (TrackerMonitor *monitor,
+                                       GFile          *directory,
+                                       gpointer        user_data)
+{
+	TrackerFileNotifier *notifier = user_data;
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	gboolean start_crawler;
+
+	if (!tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
+	                                              directory,
+	                                              G_FILE_TYPE_DIRECTORY)) {
+		return;
+	}
+
+	/* The monitor got too many events for the directory
+	 * contents, crawl it instead, so the differences with
+	 * the store are found out in one go.
+	 */
+	directory = tracker_file_system_get_file (priv->file_system, directory,
+	                                          G_FILE_TYPE_DIRECTORY, NULL);
+
+	if (g_list_find (priv->pending_index_roots, directory)) {
+		return;
+	}
+
+	start_crawler = (priv->pending_index_roots == NULL);
+	priv->pending_index_roots = g_list_append (priv->pending_index_roots,
+	                                           directory);
+	if (start_crawler) {
+		crawl_directories_start (notifier);
+	}
+}
+
 /* Indexing tree signal handlers */
 static void
 indexing_tree_directory_added (TrackerIndexingTree *indexing_tree,
@@ -1254,6 +1586,9 @@ tracker_file_notifier_class_init (TrackerFileNotifierClass *klass)
 	quark_property_filesystem_mtime = g_quark_from_static_string ("tracker-property-filesystem-mtime");
 	tracker_file_system_register_property (quark_property_filesystem_mtime,
 	                                       g_free);
+
+	quark_property_notified = g_quark_from_static_string ("tracker-property-notified");
+	tracker_file_system_register_property (quark_property_notified, NULL);
 }
 
 static void
@@ -1302,6 +1637,9 @@ tracker_file_notifier_init (TrackerFileNotifier *notifier)
 	g_signal_connect (priv->crawler, "directory-crawled",
 	                  G_CALLBACK (crawler_directory_crawled_cb),
 	                  notifier);
+	g_signal_connect (priv->crawler, "directory-contents-crawled",
+	                  G_CALLBACK (crawler_directory_contents_crawled_cb),
+	                  notifier);
 	g_signal_connect (priv->crawler, "finished",
 	                  G_CALLBACK (crawler_finished_cb),
 	                  notifier);
@@ -1324,6 +1662,9 @@ tracker_file_notifier_init (TrackerFileNotifier *notifier)
 	g_signal_connect (priv->monitor, "item-moved",
 	                  G_CALLBACK (monitor_item_moved_cb),
 	                  notifier);
+	g_signal_connect (priv->monitor, "directory-contents-changed",
+	                  G_CALLBACK (monitor_directory_contents_changed_cb),
+	                  notifier);
 }
 
 TrackerFileNotifier *
@@ -1372,6 +1713,213 @@ tracker_file_notifier_stop (TrackerFileNotifier *notifier)
 	}
 }
 
+void
+tracker_file_notifier_set_throttle (TrackerFileNotifier *notifier,
+                                    gdouble              throttle)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = notifier->priv;
+	tracker_crawler_set_throttle (priv->crawler, throttle);
+}
+
+/* Streaming trades the ordering of notifications for memory, the
+ * contents of each directory are notified as soon as it's crawled,
+ * once the current root has been queried.
+ */
+void
+tracker_file_notifier_set_streaming (TrackerFileNotifier *notifier,
+                                     gboolean             streaming)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = notifier->priv;
+	tracker_crawler_set_streaming (priv->crawler, streaming);
+}
+
+/* Lets the consumer catch up, without dropping what's been
+ * crawled so far as tracker_file_notifier_stop() does.
+ */
+void
+tracker_file_notifier_pause_crawling (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = notifier->priv;
+	tracker_crawler_pause (priv->crawler);
+}
+
+void
+tracker_file_notifier_resume_crawling (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = notifier->priv;
+	tracker_crawler_resume (priv->crawler);
+}
+
+/* Estimated memory held for files being crawled or cached, in
+ * bytes. @peak is set to the highest estimate so far.
+ */
+gsize
+tracker_file_notifier_get_memory_usage (TrackerFileNotifier *notifier,
+                                        gsize               *peak)
+{
+	TrackerFileNotifierPrivate *priv;
+	guint n_nodes, peak_nodes, n_files, peak_files;
+
+	g_return_val_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier), 0);
+
+	priv = notifier->priv;
+	n_nodes = tracker_crawler_get_n_nodes (priv->crawler, &peak_nodes);
+	n_files = tracker_file_system_get_n_files (priv->file_system, &peak_files);
+
+	if (peak) {
+		/* Both peaks don't necessarily happen at once,
+		 * so this is an upper bound.
+		 */
+		*peak = ((gsize) peak_nodes * CRAWLED_FILE_COST +
+		         (gsize) peak_files * CACHED_FILE_COST);
+	}
+
+	return ((gsize) n_nodes * CRAWLED_FILE_COST +
+	        (gsize) n_files * CACHED_FILE_COST);
+}
+
+/* The checkpoint must outlive the notifier, or be unset before
+ * being freed.
+ */
+void
+tracker_file_notifier_set_checkpoint (TrackerFileNotifier *notifier,
+                                      TrackerCheckpoint   *checkpoint)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = notifier->priv;
+	priv->checkpoint = checkpoint;
+}
+
+static gboolean
+file_notifier_root_matches (GFile *root,
+                            GFile *directory)
+{
+	return (g_file_equal (root, directory) ||
+	        g_file_has_prefix (directory, root) ||
+	        g_file_has_prefix (root, directory));
+}
+
+/* Makes @directory be crawled as soon as possible, the pending
+ * roots containing it (or contained in it) are moved right after
+ * the one being crawled, and if that one contains @directory the
+ * crawler is told to go for it next.
+ */
+void
+tracker_file_notifier_boost_directory (TrackerFileNotifier *notifier,
+                                       GFile               *directory)
+{
+	TrackerFileNotifierPrivate *priv;
+	GList *l, *next, *insert_after;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+	g_return_if_fail (G_IS_FILE (directory));
+
+	priv = notifier->priv;
+	insert_after = priv->pending_index_roots;
+
+	if (!insert_after) {
+		return;
+	}
+
+	for (l = insert_after->next; l; l = next) {
+		next = l->next;
+
+		if (!file_notifier_root_matches (l->data, directory)) {
+			continue;
+		}
+
+		if (l != insert_after->next) {
+			GFile *root = l->data;
+
+			priv->pending_index_roots =
+				g_list_delete_link (priv->pending_index_roots, l);
+			priv->pending_index_roots =
+				g_list_insert_before (priv->pending_index_roots,
+				                      insert_after->next, root);
+		}
+
+		insert_after = insert_after->next;
+	}
+
+	tracker_crawler_prioritize (priv->crawler, directory);
+}
+
+/* Drops all crawling work within @prefix: pending roots in it,
+ * the root being crawled if it's in it, or else the subtree the
+ * crawler found so far there. Returns the number of roots, files
+ * and directories dropped.
+ */
+guint
+tracker_file_notifier_cancel_for_prefix (TrackerFileNotifier *notifier,
+                                         GFile               *prefix)
+{
+	TrackerFileNotifierPrivate *priv;
+	GFile *current_root;
+	GList *l, *next;
+	guint n_cancelled = 0;
+
+	g_return_val_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier), 0);
+	g_return_val_if_fail (G_IS_FILE (prefix), 0);
+
+	priv = notifier->priv;
+
+	if (!priv->pending_index_roots) {
+		return 0;
+	}
+
+	for (l = priv->pending_index_roots->next; l; l = next) {
+		next = l->next;
+
+		if (g_file_equal (l->data, prefix) ||
+		    g_file_has_prefix (l->data, prefix)) {
+			priv->pending_index_roots =
+				g_list_delete_link (priv->pending_index_roots, l);
+			n_cancelled++;
+		}
+	}
+
+	current_root = priv->pending_index_roots->data;
+
+	if (g_file_equal (current_root, prefix) ||
+	    g_file_has_prefix (current_root, prefix)) {
+		/* Same as when the root is removed */
+		tracker_crawler_stop (priv->crawler);
+		g_cancellable_cancel (priv->cancellable);
+		n_cancelled++;
+
+		priv->pending_index_roots =
+			g_list_delete_link (priv->pending_index_roots,
+			                    priv->pending_index_roots);
+
+		if (priv->pending_index_roots) {
+			crawl_directories_start (notifier);
+		}
+	} else {
+		n_cancelled += tracker_crawler_prune (priv->crawler, prefix);
+	}
+
+	return n_cancelled;
+}
+
 gboolean
 tracker_file_notifier_is_active (TrackerFileNotifier *notifier)
 {
@@ -28,6 +28,7 @@
 
 #include <gio/gio.h>
 #include "tracker-indexing-tree.h"
+#include "tracker-checkpoint.h"
 
 G_BEGIN_DECLS
 
@@ -80,6 +81,22 @@ TrackerFileNotifier* tracker_file_notifier_new  (TrackerIndexingTree *indexing_t
 gboolean      tracker_file_notifier_start (TrackerFileNotifier *notifier);
 void          tracker_file_notifier_stop  (TrackerFileNotifier *notifier);
 gboolean      tracker_file_notifier_is_active (TrackerFileNotifier *notifier);
+void          tracker_file_notifier_boost_directory (TrackerFileNotifier *notifier,
+                                                     GFile               *directory);
+guint         tracker_file_notifier_cancel_for_prefix (TrackerFileNotifier *notifier,
+                                                       GFile               *prefix);
+
+void          tracker_file_notifier_set_throttle   (TrackerFileNotifier *notifier,
+                                                    gdouble              throttle);
+void          tracker_file_notifier_set_checkpoint (TrackerFileNotifier *notifier,
+                                                    TrackerCheckpoint   *checkpoint);
+
+void          tracker_file_notifier_set_streaming    (TrackerFileNotifier *notifier,
+                                                      gboolean             streaming);
+void          tracker_file_notifier_pause_crawling   (TrackerFileNotifier *notifier);
+void          tracker_file_notifier_resume_crawling  (TrackerFileNotifier *notifier);
+gsize         tracker_file_notifier_get_memory_usage (TrackerFileNotifier *notifier,
+                                                      gsize               *peak);
 
 const gchar * tracker_file_notifier_get_file_iri (TrackerFileNotifier *notifier,
                                                   GFile               *file);
@@ -33,6 +33,10 @@ static GHashTable *properties = NULL;
 
 struct _TrackerFileSystemPrivate {
 	GNode *file_tree;
+
+	/* Accounting, the root node is not counted */
+	guint n_files;
+	guint peak_files;
 };
 
 struct _FileNodeProperty {
@@ -124,6 +128,7 @@ file_node_data_new (TrackerFileSystem *file_system,
                     GFileType          file_type,
                     GNode             *node)
 {
+	TrackerFileSystemPrivate *priv;
 	FileNodeData *data;
 	NodeLookupData lookup_data;
 	GArray *node_data;
@@ -154,6 +159,10 @@ file_node_data_new (TrackerFileSystem *file_system,
 	g_assert (node->data == NULL);
 	node->data = data;
 
+	priv = file_system->priv;
+	priv->n_files++;
+	priv->peak_files = MAX (priv->peak_files, priv->n_files);
+
 	return data;
 }
 
@@ -427,13 +436,32 @@ file_weak_ref_notify (gpointer  user_data,
                       GObject  *prev_location)
 {
 	FileNodeData *data;
+	GArray *node_data;
 	GNode *node;
+	guint i;
 
 	node = user_data;
 	data = node->data;
 
 	g_assert (data->file == (GFile *) prev_location);
 
+	/* Qdata is only cleared after weak refs are notified */
+	node_data = g_object_get_qdata (prev_location, quark_file_node);
+
+	for (i = 0; node_data && i < node_data->len; i++) {
+		NodeLookupData *cur;
+
+		cur = &g_array_index (node_data, NodeLookupData, i);
+
+		if (cur->node == node) {
+			TrackerFileSystemPrivate *priv;
+
+			priv = cur->file_system->priv;
+			priv->n_files--;
+			break;
+		}
+	}
+
 	data->file = NULL;
 	reparent_child_nodes_to_parent (node);
 
@@ -627,6 +655,7 @@ void
 tracker_file_system_traverse (TrackerFileSystem             *file_system,
                               GFile                         *root,
                               GTraverseType                  order,
+                              gint                           max_depth,
                               TrackerFileSystemTraverseFunc  func,
                               gpointer                       user_data)
 {
@@ -652,13 +681,33 @@ tracker_file_system_traverse (TrackerFileSystem             *file_system,
 	g_node_traverse (node,
 	                 order,
 	                 G_TRAVERSE_ALL,
-	                 -1,
+	                 max_depth,
 	                 traverse_filesystem_func,
 	                 &data);
 
 	g_slist_free (data.ignore_children);
 }
 
+/* Returns the number of files currently cached, @peak is
+ * set to the highest number held at once.
+ */
+guint
+tracker_file_system_get_n_files (TrackerFileSystem *file_system,
+                                 guint             *peak)
+{
+	TrackerFileSystemPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_FILE_SYSTEM (file_system), 0);
+
+	priv = file_system->priv;
+
+	if (peak) {
+		*peak = priv->peak_files;
+	}
+
+	return priv->n_files;
+}
+
 void
 tracker_file_system_register_property (GQuark             prop,
                                        GDestroyNotify     destroy_notify)
@@ -68,6 +68,7 @@ GFile *       tracker_file_system_peek_parent    (TrackerFileSystem  *file_syste
 void          tracker_file_system_traverse       (TrackerFileSystem             *file_system,
                                                   GFile                         *root,
                                                   GTraverseType                  order,
+                                                  gint                           max_depth,
                                                   TrackerFileSystemTraverseFunc  func,
                                                   gpointer                       user_data);
 
@@ -75,6 +76,9 @@ void          tracker_file_system_forget_files   (TrackerFileSystem *file_system
 						  GFile             *root,
 						  GFileType          file_type);
 
+guint         tracker_file_system_get_n_files    (TrackerFileSystem *file_system,
+                                                  guint             *peak);
+
 /* properties */
 void      tracker_file_system_register_property (GQuark             prop,
                                                  GDestroyNotify     destroy_notify);
@@ -19,6 +19,8 @@
  * Author: Carlos Garnacho  <carlos@lanedo.com>
  */
 
+#include <string.h>
+
 #include <libtracker-common/tracker-file-utils.h>
 #include "tracker-indexing-tree.h"
 
@@ -36,6 +38,9 @@ typedef struct _TrackerIndexingTreePrivate TrackerIndexingTreePrivate;
 typedef struct _NodeData NodeData;
 typedef struct _PatternData PatternData;
 typedef struct _FindNodeData FindNodeData;
+typedef struct _GlobNfa GlobNfa;
+typedef struct _FilterMatcher FilterMatcher;
+typedef struct _RootTrieNode RootTrieNode;
 
 struct _NodeData
 {
@@ -46,11 +51,47 @@ struct _NodeData
 
 struct _PatternData
 {
-	GPatternSpec *pattern;
+	gchar *glob_string;
 	TrackerFilterType type;
 	GFile *file; /* Only filled in in absolute paths */
 };
 
+/* Globs with up to this number of non-'*' characters are matched
+ * through a bit-parallel NFA, bit k in the state set meaning that
+ * the first k characters of the glob were matched.
+ */
+#define GLOB_NFA_MAX_CHARS 63
+
+struct _GlobNfa
+{
+	guint64 ascii_masks[128]; /* Positions matching each ASCII char */
+	guint64 any_mask;         /* Positions of '?' */
+	guint64 loop_mask;        /* States following a '*' */
+	guint64 accept_mask;
+	gunichar chars[GLOB_NFA_MAX_CHARS];
+	guint n_chars;
+};
+
+/* All filters of a given type, compiled so matching
+ * doesn't need to run every glob on every file.
+ */
+struct _FilterMatcher
+{
+	GHashTable *names;       /* Globs without wildcards */
+	GHashTable *suffixes;    /* "*.ext" style globs, stores ".ext" */
+	GArray *suffix_lengths;  /* Distinct lengths of the above */
+	GArray *globs;           /* GlobNfa, for other globs */
+	GList *specs;            /* GPatternSpec, for globs too long for an NFA */
+	GList *files;            /* GFile, for absolute paths */
+};
+
+/* Path components trie leading to the config tree nodes */
+struct _RootTrieNode
+{
+	GHashTable *children;
+	GNode *node;
+};
+
 struct _FindNodeData
 {
 	GEqualFunc func;
@@ -64,6 +105,10 @@ struct _TrackerIndexingTreePrivate
 	GList *filter_patterns;
 	TrackerFilterPolicy policies[TRACKER_FILTER_PARENT_DIRECTORY + 1];
 
+	/* Both built on demand after changes */
+	FilterMatcher *matchers[TRACKER_FILTER_PARENT_DIRECTORY + 1];
+	RootTrieNode *root_trie;
+
 	guint filter_hidden : 1;
 };
 
@@ -117,7 +162,7 @@ pattern_data_new (const gchar *glob_string,
 	PatternData *data;
 
 	data = g_slice_new0 (PatternData);
-	data->pattern = g_pattern_spec_new (glob_string);
+	data->glob_string = g_strdup (glob_string);
 	data->type = type;
 
 	if (g_path_is_absolute (glob_string)) {
@@ -134,10 +179,446 @@ pattern_data_free (PatternData *data)
 		g_object_unref (data->file);
 	}
 
-	g_pattern_spec_free (data->pattern);
+	g_free (data->glob_string);
 	g_slice_free (PatternData, data);
 }
 
+static gboolean
+glob_nfa_init (GlobNfa     *nfa,
+               const gchar *glob_string)
+{
+	const gchar *p;
+
+	memset (nfa, 0, sizeof (GlobNfa));
+
+	for (p = glob_string; *p; p = g_utf8_next_char (p)) {
+		gunichar ch = g_utf8_get_char (p);
+		guint64 bit;
+
+		bit = G_GUINT64_CONSTANT (1) << nfa->n_chars;
+
+		if (ch == '*') {
+			nfa->loop_mask |= bit;
+			continue;
+		}
+
+		if (nfa->n_chars == GLOB_NFA_MAX_CHARS) {
+			return FALSE;
+		}
+
+		if (ch == '?') {
+			nfa->any_mask |= bit;
+		} else if (ch < 128) {
+			nfa->ascii_masks[ch] |= bit;
+		}
+
+		nfa->chars[nfa->n_chars] = ch;
+		nfa->n_chars++;
+	}
+
+	nfa->accept_mask = G_GUINT64_CONSTANT (1) << nfa->n_chars;
+
+	return TRUE;
+}
+
+static gboolean
+glob_nfa_match (const GlobNfa *nfa,
+                const gchar   *str)
+{
+	guint64 states = 1;
+	const gchar *p;
+
+	for (p = str; *p && states != 0; p = g_utf8_next_char (p)) {
+		gunichar ch = g_utf8_get_char (p);
+		guint64 mask;
+
+		mask = nfa->any_mask;
+
+		if (ch < 128) {
+			mask |= nfa->ascii_masks[ch];
+		} else {
+			guint i;
+
+			for (i = 0; i < nfa->n_chars; i++) {
+				if (nfa->chars[i] == ch) {
+					mask |= G_GUINT64_CONSTANT (1) << i;
+				}
+			}
+		}
+
+		states = (states & nfa->loop_mask) | ((states & mask) << 1);
+	}
+
+	return (states & nfa->accept_mask) != 0;
+}
+
+static FilterMatcher *
+filter_matcher_new (void)
+{
+	FilterMatcher *matcher;
+
+	matcher = g_slice_new0 (FilterMatcher);
+	matcher->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                        g_free, NULL);
+	matcher->suffixes = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                           g_free, NULL);
+	matcher->suffix_lengths = g_array_new (FALSE, FALSE, sizeof (gsize));
+	matcher->globs = g_array_new (FALSE, FALSE, sizeof (GlobNfa));
+
+	return matcher;
+}
+
+static void
+filter_matcher_free (FilterMatcher *matcher)
+{
+	g_hash_table_unref (matcher->names);
+	g_hash_table_unref (matcher->suffixes);
+	g_array_free (matcher->suffix_lengths, TRUE);
+	g_array_free (matcher->globs, TRUE);
+
+	g_list_foreach (matcher->specs, (GFunc) g_pattern_spec_free, NULL);
+	g_list_free (matcher->specs);
+
+	g_list_foreach (matcher->files, (GFunc) g_object_unref, NULL);
+	g_list_free (matcher->files);
+
+	g_slice_free (FilterMatcher, matcher);
+}
+
+static void
+filter_matcher_add_suffix (FilterMatcher *matcher,
+                           const gchar   *suffix)
+{
+	gsize len;
+	guint i;
+
+	if (g_hash_table_lookup (matcher->suffixes, suffix)) {
+		return;
+	}
+
+	g_hash_table_insert (matcher->suffixes, g_strdup (suffix),
+	                     GUINT_TO_POINTER (TRUE));
+	len = strlen (suffix);
+
+	for (i = 0; i < matcher->suffix_lengths->len; i++) {
+		if (g_array_index (matcher->suffix_lengths, gsize, i) == len) {
+			return;
+		}
+	}
+
+	g_array_append_val (matcher->suffix_lengths, len);
+}
+
+static void
+filter_matcher_add (FilterMatcher *matcher,
+                    PatternData   *data)
+{
+	const gchar *glob_string = data->glob_string;
+	GlobNfa nfa;
+
+	if (data->file) {
+		/* Absolute paths are only matched as
+		 * such, never against basenames.
+		 */
+		matcher->files = g_list_prepend (matcher->files,
+		                                 g_object_ref (data->file));
+		return;
+	}
+
+	if (!strpbrk (glob_string, "*?")) {
+		g_hash_table_insert (matcher->names, g_strdup (glob_string),
+		                     GUINT_TO_POINTER (TRUE));
+		return;
+	}
+
+	if (glob_string[0] == '*' && glob_string[1] != '\0' &&
+	    !strpbrk (&glob_string[1], "*?")) {
+		filter_matcher_add_suffix (matcher, &glob_string[1]);
+		return;
+	}
+
+	if (glob_nfa_init (&nfa, glob_string)) {
+		g_array_append_val (matcher->globs, nfa);
+	} else {
+		matcher->specs = g_list_prepend (matcher->specs,
+		                                 g_pattern_spec_new (glob_string));
+	}
+}
+
+static gboolean
+filter_matcher_match_basename (FilterMatcher *matcher,
+                               const gchar   *basename)
+{
+	gsize len;
+	GList *l;
+	guint i;
+
+	if (g_hash_table_lookup (matcher->names, basename)) {
+		return TRUE;
+	}
+
+	len = strlen (basename);
+
+	for (i = 0; i < matcher->suffix_lengths->len; i++) {
+		gsize suffix_len;
+
+		suffix_len = g_array_index (matcher->suffix_lengths, gsize, i);
+
+		if (suffix_len <= len &&
+		    g_hash_table_lookup (matcher->suffixes, &basename[len - suffix_len])) {
+			return TRUE;
+		}
+	}
+
+	for (i = 0; i < matcher->globs->len; i++) {
+		if (glob_nfa_match (&g_array_index (matcher->globs, GlobNfa, i),
+		                    basename)) {
+			return TRUE;
+		}
+	}
+
+	for (l = matcher->specs; l; l = l->next) {
+		if (g_pattern_match (l->data, len, basename, NULL)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static gboolean
+filter_matcher_match (FilterMatcher *matcher,
+                      GFile         *file)
+{
+	gchar *basename;
+	gboolean match;
+	GList *l;
+
+	for (l = matcher->files; l; l = l->next) {
+		if (g_file_equal (file, l->data) ||
+		    g_file_has_prefix (file, l->data)) {
+			return TRUE;
+		}
+	}
+
+	if (g_hash_table_size (matcher->names) == 0 &&
+	    g_hash_table_size (matcher->suffixes) == 0 &&
+	    matcher->globs->len == 0 &&
+	    !matcher->specs) {
+		return FALSE;
+	}
+
+	basename = g_file_get_basename (file);
+	match = filter_matcher_match_basename (matcher, basename);
+	g_free (basename);
+
+	return match;
+}
+
+static void
+indexing_tree_clear_matchers (TrackerIndexingTree *tree)
+{
+	TrackerIndexingTreePrivate *priv = tree->priv;
+	gint i;
+
+	for (i = TRACKER_FILTER_FILE; i <= TRACKER_FILTER_PARENT_DIRECTORY; i++) {
+		if (priv->matchers[i]) {
+			filter_matcher_free (priv->matchers[i]);
+			priv->matchers[i] = NULL;
+		}
+	}
+}
+
+static FilterMatcher *
+indexing_tree_get_matcher (TrackerIndexingTree *tree,
+                           TrackerFilterType    type)
+{
+	TrackerIndexingTreePrivate *priv = tree->priv;
+	GList *l;
+
+	if (!priv->matchers[type]) {
+		priv->matchers[type] = filter_matcher_new ();
+
+		for (l = priv->filter_patterns; l; l = l->next) {
+			PatternData *data = l->data;
+
+			if (data->type == type) {
+				filter_matcher_add (priv->matchers[type], data);
+			}
+		}
+	}
+
+	return priv->matchers[type];
+}
+
+static RootTrieNode *
+root_trie_node_new (void)
+{
+	return g_slice_new0 (RootTrieNode);
+}
+
+static void
+root_trie_node_free (RootTrieNode *trie_node)
+{
+	if (trie_node->children) {
+		g_hash_table_unref (trie_node->children);
+	}
+
+	g_slice_free (RootTrieNode, trie_node);
+}
+
+/* Splits the URI in place into its path components,
+ * returns the pointer to the next component or NULL.
+ */
+static gchar *
+uri_next_component (gchar **uri)
+{
+	gchar *component, *sep;
+
+	component = *uri;
+
+	if (!component) {
+		return NULL;
+	}
+
+	sep = strchr (component, '/');
+
+	if (sep) {
+		*sep = '\0';
+		*uri = sep + 1;
+	} else {
+		*uri = NULL;
+	}
+
+	return component;
+}
+
+static gchar *
+file_get_trie_key (GFile *file)
+{
+	gchar *uri;
+	gsize len;
+
+	uri = g_file_get_uri (file);
+	len = strlen (uri);
+
+	/* So file:/// and file:///foo/ are
+	 * handled the same than file:///foo.
+	 */
+	while (len > 0 && uri[len - 1] == '/') {
+		uri[--len] = '\0';
+	}
+
+	return uri;
+}
+
+static gboolean
+root_trie_add_node (GNode    *node,
+                    gpointer  user_data)
+{
+	RootTrieNode *trie_node = user_data;
+	NodeData *data = node->data;
+	gchar *uri, *str, *component;
+
+	uri = str = file_get_trie_key (data->file);
+
+	while ((component = uri_next_component (&str)) != NULL) {
+		RootTrieNode *child = NULL;
+
+		if (!trie_node->children) {
+			trie_node->children =
+				g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+				                       (GDestroyNotify) root_trie_node_free);
+		} else {
+			child = g_hash_table_lookup (trie_node->children, component);
+		}
+
+		if (!child) {
+			child = root_trie_node_new ();
+			g_hash_table_insert (trie_node->children,
+			                     g_strdup (component), child);
+		}
+
+		trie_node = child;
+	}
+
+	trie_node->node = node;
+	g_free (uri);
+
+	return FALSE;
+}
+
+static RootTrieNode *
+indexing_tree_get_root_trie (TrackerIndexingTree *tree)
+{
+	TrackerIndexingTreePrivate *priv = tree->priv;
+
+	if (!priv->root_trie) {
+		priv->root_trie = root_trie_node_new ();
+		g_node_traverse (priv->config_tree,
+		                 G_PRE_ORDER,
+		                 G_TRAVERSE_ALL,
+		                 -1,
+		                 root_trie_add_node,
+		                 priv->root_trie);
+	}
+
+	return priv->root_trie;
+}
+
+static void
+indexing_tree_clear_root_trie (TrackerIndexingTree *tree)
+{
+	TrackerIndexingTreePrivate *priv = tree->priv;
+
+	if (priv->root_trie) {
+		root_trie_node_free (priv->root_trie);
+		priv->root_trie = NULL;
+	}
+}
+
+/* Returns the deepest config tree node being equal
+ * or a parent of @file, or NULL if none applies. If
+ * @exact is TRUE, only a node equal to @file is returned.
+ */
+static GNode *
+indexing_tree_lookup_node (TrackerIndexingTree *tree,
+                           GFile               *file,
+                           gboolean             exact)
+{
+	RootTrieNode *trie_node;
+	GNode *node = NULL;
+	gchar *uri, *str, *component;
+
+	trie_node = indexing_tree_get_root_trie (tree);
+	uri = str = file_get_trie_key (file);
+
+	while ((component = uri_next_component (&str)) != NULL) {
+		if (!trie_node->children) {
+			trie_node = NULL;
+			break;
+		}
+
+		trie_node = g_hash_table_lookup (trie_node->children, component);
+
+		if (!trie_node) {
+			break;
+		}
+
+		if (trie_node->node && !exact) {
+			node = trie_node->node;
+		}
+	}
+
+	if (exact && trie_node) {
+		node = trie_node->node;
+	}
+
+	g_free (uri);
+
+	return node;
+}
+
 static void
 tracker_indexing_tree_get_property (GObject    *object,
                                     guint       prop_id,
@@ -191,6 +672,9 @@ tracker_indexing_tree_finalize (GObject *object)
 	g_list_foreach (priv->filter_patterns, (GFunc) pattern_data_free, NULL);
 	g_list_free (priv->filter_patterns);
 
+	indexing_tree_clear_matchers (tree);
+	indexing_tree_clear_root_trie (tree);
+
 	g_node_traverse (priv->config_tree,
 	                 G_POST_ORDER,
 	                 G_TRAVERSE_ALL,
@@ -429,6 +913,7 @@ tracker_indexing_tree_add (TrackerIndexingTree   *tree,
 
 	/* Add the new node underneath the parent */
 	g_node_append (parent, node);
+	indexing_tree_clear_root_trie (tree);
 
 	g_signal_emit (tree, signals[DIRECTORY_ADDED], 0, directory);
 
@@ -486,6 +971,7 @@ tracker_indexing_tree_remove (TrackerIndexingTree *tree,
 
 	node_data_free (node->data);
 	g_node_destroy (node);
+	indexing_tree_clear_root_trie (tree);
 }
 
 /**
@@ -511,6 +997,10 @@ tracker_indexing_tree_add_filter (TrackerIndexingTree *tree,
 
 	data = pattern_data_new (glob_string, filter);
 	priv->filter_patterns = g_list_prepend (priv->filter_patterns, data);
+
+	if (priv->matchers[filter]) {
+		filter_matcher_add (priv->matchers[filter], data);
+	}
 }
 
 /**
@@ -543,6 +1033,11 @@ tracker_indexing_tree_clear_filters (TrackerIndexingTree *tree,
 			pattern_data_free (data);
 		}
 	}
+
+	if (priv->matchers[type]) {
+		filter_matcher_free (priv->matchers[type]);
+		priv->matchers[type] = NULL;
+	}
 }
 
 /**
@@ -560,49 +1055,14 @@ tracker_indexing_tree_file_matches_filter (TrackerIndexingTree *tree,
                                            TrackerFilterType    type,
                                            GFile               *file)
 {
-	TrackerIndexingTreePrivate *priv;
-	GList *filters;
-	gchar *basename;
+	FilterMatcher *matcher;
 
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
 
-	priv = tree->priv;
-	filters = priv->filter_patterns;
-	basename = g_file_get_basename (file);
-
-	while (filters) {
-		PatternData *data = filters->data;
-
-		filters = filters->next;
-
-		if (data->type != type)
-			continue;
-
-		if (data->file &&
-		    (g_file_equal (file, data->file) ||
-		     g_file_has_prefix (file, data->file))) {
-			g_free (basename);
-			return TRUE;
-		}
-
-		if (g_pattern_match_string (data->pattern, basename)) {
-			g_free (basename);
-			return TRUE;
-		}
-	}
-
-	g_free (basename);
-	return FALSE;
-}
+	matcher = indexing_tree_get_matcher (tree, type);
 
-static gboolean
-parent_or_equals (GFile *file1,
-                  GFile *file2)
-{
-	return (file1 == file2 ||
-	        g_file_equal (file1, file2) ||
-	        g_file_has_prefix (file1, file2));
+	return filter_matcher_match (matcher, file);
 }
 
 static gboolean
@@ -806,7 +1266,6 @@ tracker_indexing_tree_get_root (TrackerIndexingTree   *tree,
                                 GFile                 *file,
                                 TrackerDirectoryFlags *directory_flags)
 {
-	TrackerIndexingTreePrivate *priv;
 	NodeData *data;
 	GNode *parent;
 
@@ -817,19 +1276,14 @@ tracker_indexing_tree_get_root (TrackerIndexingTree   *tree,
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), NULL);
 	g_return_val_if_fail (G_IS_FILE (file), NULL);
 
-	priv = tree->priv;
-	parent = find_directory_node (priv->config_tree, file,
-	                              (GEqualFunc) parent_or_equals);
+	parent = indexing_tree_lookup_node (tree, file, FALSE);
 	if (!parent) {
 		return NULL;
 	}
 
 	data = parent->data;
 
-	if (!data->shallow &&
-	    (file == data->file ||
-	     g_file_equal (file, data->file) ||
-	     g_file_has_prefix (file, data->file))) {
+	if (!data->shallow) {
 		if (directory_flags) {
 			*directory_flags = data->flags;
 		}
@@ -844,15 +1298,12 @@ gboolean
 tracker_indexing_tree_file_is_root (TrackerIndexingTree *tree,
                                     GFile               *file)
 {
-	TrackerIndexingTreePrivate *priv;
 	GNode *node;
 
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
 
-	priv = tree->priv;
-	node = find_directory_node (priv->config_tree, file,
-	                            (GEqualFunc) g_file_equal);
+	node = indexing_tree_lookup_node (tree, file, TRUE);
 	return node != NULL;
 }
 
@@ -0,0 +1,866 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include "tracker-io-pressure.h"
+
+#define PSI_PATH       "/proc/pressure/io"
+#define DISKSTATS_PATH "/proc/diskstats"
+#define SELF_IO_PATH   "/proc/self/io"
+
+/* Seconds between samples */
+#define SAMPLE_INTERVAL 1
+
+/* Share of the time some task was stalled waiting on I/O (PSI), or
+ * share of the time the busiest indexed device was doing I/O
+ * (diskstats), above which the throttle goes up and below which it
+ * goes down. Within the band it stays put.
+ */
+#define PSI_HIGH       0.20
+#define PSI_LOW        0.05
+#define DISKSTATS_HIGH 0.80
+#define DISKSTATS_LOW  0.40
+
+/* Back off faster than it recovers, but in steps small enough
+ * that a single busy interval doesn't stall indexing.
+ */
+#define THROTTLE_STEP_UP   0.10
+#define THROTTLE_STEP_DOWN 0.05
+
+/* Both PSI and the device busy time are system wide, and include the
+ * I/O done by the miner itself, and by the store and the extractor
+ * on its behalf. If at least this share of the bytes transferred on
+ * the indexed devices was ours, the pressure is taken as self
+ * inflicted and not throttled on, or throttling would only slow the
+ * miner down against itself.
+ */
+#define OWN_IO_SHARE 0.5
+
+typedef enum {
+	SOURCE_NONE,
+	SOURCE_PSI,
+	SOURCE_DISKSTATS
+} PressureSource;
+
+typedef struct {
+	gchar *io_path;
+	gint64 bytes; /* read and written, -1 if unknown */
+} ProcessIO;
+
+typedef struct {
+	TrackerIOPressure *pressure;
+	gchar *name;
+	GCancellable *cancellable;
+	guint watch_id;
+} ProcessWatch;
+
+typedef struct {
+	dev_t device;
+	guint64 io_ticks;
+	guint64 sectors;
+	gboolean valid;
+} DeviceStats;
+
+typedef struct _TrackerIOPressurePrivate TrackerIOPressurePrivate;
+
+struct _TrackerIOPressurePrivate
+{
+	gchar *psi_path;
+	gchar *diskstats_path;
+
+	PressureSource source;
+	GArray *devices;
+
+	/* PSI "some" stall time, in microseconds */
+	guint64 stall_total;
+	gint64 last_sample_time;
+
+	ProcessIO self;
+	GHashTable *helpers; /* name -> ProcessIO */
+	GList *watches;
+
+	gdouble pressure;
+	gdouble throttle;
+
+	guint timeout_id;
+};
+
+enum {
+	PROP_0,
+	PROP_PRESSURE,
+	PROP_THROTTLE
+};
+
+G_DEFINE_TYPE (TrackerIOPressure, tracker_io_pressure, G_TYPE_OBJECT)
+
+static void
+process_io_free (ProcessIO *process)
+{
+	g_free (process->io_path);
+	g_slice_free (ProcessIO, process);
+}
+
+static void
+process_watch_free (ProcessWatch *watch)
+{
+	/* Pending PID lookups won't touch it anymore */
+	g_cancellable_cancel (watch->cancellable);
+	g_object_unref (watch->cancellable);
+	g_bus_unwatch_name (watch->watch_id);
+	g_free (watch->name);
+	g_slice_free (ProcessWatch, watch);
+}
+
+static void
+tracker_io_pressure_finalize (GObject *object)
+{
+	TrackerIOPressurePrivate *priv;
+
+	priv = TRACKER_IO_PRESSURE (object)->priv;
+
+	if (priv->timeout_id) {
+		g_source_remove (priv->timeout_id);
+	}
+
+	g_list_free_full (priv->watches, (GDestroyNotify) process_watch_free);
+	g_hash_table_unref (priv->helpers);
+	g_array_free (priv->devices, TRUE);
+	g_free (priv->psi_path);
+	g_free (priv->diskstats_path);
+	g_free (priv->self.io_path);
+
+	G_OBJECT_CLASS (tracker_io_pressure_parent_class)->finalize (object);
+}
+
+static void
+tracker_io_pressure_get_property (GObject    *object,
+                                  guint       param_id,
+                                  GValue     *value,
+                                  GParamSpec *pspec)
+{
+	TrackerIOPressure *pressure = TRACKER_IO_PRESSURE (object);
+
+	switch (param_id) {
+	case PROP_PRESSURE:
+		g_value_set_double (value,
+		                    tracker_io_pressure_get_pressure (pressure));
+		break;
+	case PROP_THROTTLE:
+		g_value_set_double (value,
+		                    tracker_io_pressure_get_throttle (pressure));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+	}
+}
+
+static void
+tracker_io_pressure_class_init (TrackerIOPressureClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = tracker_io_pressure_finalize;
+	object_class->get_property = tracker_io_pressure_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_PRESSURE,
+	                                 g_param_spec_double ("pressure",
+	                                                      "Pressure",
+	                                                      "Last sampled I/O pressure, between 0 and 1",
+	                                                      0, 1, 0,
+	                                                      G_PARAM_READABLE));
+	g_object_class_install_property (object_class,
+	                                 PROP_THROTTLE,
+	                                 g_param_spec_double ("throttle",
+	                                                      "Throttle",
+	                                                      "Throttle to apply on top of the configured one",
+	                                                      0, 1, 0,
+	                                                      G_PARAM_READABLE));
+
+	g_type_class_add_private (klass, sizeof (TrackerIOPressurePrivate));
+}
+
+static void
+tracker_io_pressure_init (TrackerIOPressure *pressure)
+{
+	TrackerIOPressurePrivate *priv;
+
+	priv = pressure->priv = G_TYPE_INSTANCE_GET_PRIVATE (pressure,
+	                                                     TRACKER_TYPE_IO_PRESSURE,
+	                                                     TrackerIOPressurePrivate);
+	priv->devices = g_array_new (FALSE, FALSE, sizeof (DeviceStats));
+	priv->helpers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                       (GDestroyNotify) process_io_free);
+	priv->self.bytes = -1;
+}
+
+TrackerIOPressure *
+tracker_io_pressure_new (void)
+{
+	return tracker_io_pressure_new_for_paths (PSI_PATH, DISKSTATS_PATH, SELF_IO_PATH);
+}
+
+TrackerIOPressure *
+tracker_io_pressure_new_for_paths (const gchar *psi_path,
+                                   const gchar *diskstats_path,
+                                   const gchar *self_io_path)
+{
+	TrackerIOPressure *pressure;
+	TrackerIOPressurePrivate *priv;
+
+	pressure = g_object_new (TRACKER_TYPE_IO_PRESSURE, NULL);
+
+	priv = pressure->priv;
+	priv->psi_path = g_strdup (psi_path);
+	priv->diskstats_path = g_strdup (diskstats_path);
+	priv->self.io_path = g_strdup (self_io_path);
+
+	return pressure;
+}
+
+/* Reads the total stall time of the "some" line, which looks like:
+ * some avg10=0.00 avg60=0.00 avg300=0.00 total=123456
+ */
+static gboolean
+read_psi (const gchar *path,
+          guint64     *total)
+{
+	gchar *contents, *line, *str;
+	gboolean retval = FALSE;
+
+	if (!path || !g_file_get_contents (path, &contents, NULL, NULL)) {
+		return FALSE;
+	}
+
+	for (line = contents; line && *line; line = strchr (line, '\n')) {
+		if (*line == '\n') {
+			line++;
+		}
+
+		if (!g_str_has_prefix (line, "some ")) {
+			continue;
+		}
+
+		str = strstr (line, "total=");
+
+		if (str) {
+			*total = g_ascii_strtoull (str + strlen ("total="), NULL, 10);
+			retval = TRUE;
+		}
+
+		break;
+	}
+
+	g_free (contents);
+
+	return retval;
+}
+
+/* Reads the bytes a process caused to be fetched from, or sent to,
+ * the storage layer, out of the read_bytes and write_bytes lines.
+ */
+static gboolean
+read_process_io (const gchar *path,
+                 gint64      *bytes)
+{
+	gchar *contents, **lines;
+	gboolean found_read = FALSE, found_write = FALSE;
+	guint i;
+
+	if (!path || !g_file_get_contents (path, &contents, NULL, NULL)) {
+		return FALSE;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+	*bytes = 0;
+
+	for (i = 0; lines[i]; i++) {
+		if (g_str_has_prefix (lines[i], "read_bytes:")) {
+			*bytes += g_ascii_strtoll (lines[i] + strlen ("read_bytes:"), NULL, 10);
+			found_read = TRUE;
+		} else if (g_str_has_prefix (lines[i], "write_bytes:")) {
+			*bytes += g_ascii_strtoll (lines[i] + strlen ("write_bytes:"), NULL, 10);
+			found_write = TRUE;
+		}
+	}
+
+	g_strfreev (lines);
+	g_free (contents);
+
+	return found_read && found_write;
+}
+
+/* Sets @delta to the bytes @process read and wrote since the last
+ * call, returns %FALSE if they are not known.
+ */
+static gboolean
+process_io_update (ProcessIO *process,
+                   gint64    *delta)
+{
+	gboolean retval = FALSE;
+	gint64 bytes;
+
+	if (!read_process_io (process->io_path, &bytes)) {
+		process->bytes = -1;
+		return FALSE;
+	}
+
+	if (process->bytes >= 0 && bytes >= process->bytes) {
+		*delta = bytes - process->bytes;
+		retval = TRUE;
+	}
+
+	process->bytes = bytes;
+
+	return retval;
+}
+
+/* Updates the time spent doing I/O (10th stats field, in ms) and the
+ * sectors read and written (3rd and 7th) for every tracked device.
+ * Returns the share of @elapsed the busiest one was busy for, and
+ * the bytes transferred on all of them since the last call.
+ */
+static gboolean
+read_diskstats (const gchar *path,
+                GArray      *devices,
+                gint64       elapsed,
+                gdouble     *busy,
+                guint64     *bytes)
+{
+#ifdef __linux__
+	gchar *contents, **lines;
+	gboolean found = FALSE;
+	guint i, j;
+
+	if (!path || devices->len == 0 ||
+	    !g_file_get_contents (path, &contents, NULL, NULL)) {
+		return FALSE;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+	*busy = 0;
+	*bytes = 0;
+
+	for (i = 0; lines[i]; i++) {
+		guint dev_major, dev_minor;
+		guint64 io_ticks, sectors;
+		gchar **fields;
+		gint n_fields;
+
+		fields = g_strsplit_set (g_strstrip (lines[i]), " \t", -1);
+		n_fields = 0;
+
+		/* Compact the separators away */
+		for (j = 0; fields[j]; j++) {
+			if (*fields[j]) {
+				fields[n_fields++] = fields[j];
+			} else {
+				g_free (fields[j]);
+			}
+		}
+
+		fields[n_fields] = NULL;
+
+		if (n_fields < 13) {
+			g_strfreev (fields);
+			continue;
+		}
+
+		dev_major = (guint) g_ascii_strtoull (fields[0], NULL, 10);
+		dev_minor = (guint) g_ascii_strtoull (fields[1], NULL, 10);
+		io_ticks = g_ascii_strtoull (fields[12], NULL, 10);
+		sectors = g_ascii_strtoull (fields[5], NULL, 10) +
+			g_ascii_strtoull (fields[9], NULL, 10);
+		g_strfreev (fields);
+
+		for (j = 0; j < devices->len; j++) {
+			DeviceStats *stats;
+
+			stats = &g_array_index (devices, DeviceStats, j);
+
+			if (major (stats->device) != dev_major ||
+			    minor (stats->device) != dev_minor) {
+				continue;
+			}
+
+			if (stats->valid && elapsed > 0 &&
+			    io_ticks >= stats->io_ticks) {
+				*busy = MAX (*busy, (gdouble) (io_ticks - stats->io_ticks) * 1000 / elapsed);
+			}
+
+			/* Sectors are always 512 bytes there */
+			if (stats->valid && sectors >= stats->sectors) {
+				*bytes += (sectors - stats->sectors) * 512;
+			}
+
+			stats->io_ticks = io_ticks;
+			stats->sectors = sectors;
+			stats->valid = TRUE;
+			found = TRUE;
+		}
+	}
+
+	g_strfreev (lines);
+	g_free (contents);
+
+	return found;
+#else
+	return FALSE;
+#endif
+}
+
+static void
+io_pressure_set_throttle (TrackerIOPressure *pressure,
+                          gdouble            throttle)
+{
+	TrackerIOPressurePrivate *priv = pressure->priv;
+
+	/* Don't let rounding leave a residual throttle */
+	if (throttle < 0.001) {
+		throttle = 0;
+	}
+
+	throttle = CLAMP (throttle, 0, 1);
+
+	if (priv->throttle == throttle) {
+		return;
+	}
+
+	g_debug ("I/O pressure at %.2f, throttle %.2f -> %.2f",
+	         priv->pressure, priv->throttle, throttle);
+
+	priv->throttle = throttle;
+	g_object_notify (G_OBJECT (pressure), "throttle");
+}
+
+static void
+io_pressure_update (TrackerIOPressure *pressure,
+                    gdouble            value,
+                    gdouble            high,
+                    gdouble            low,
+                    gboolean           own)
+{
+	TrackerIOPressurePrivate *priv = pressure->priv;
+
+	priv->pressure = CLAMP (value, 0, 1);
+	g_object_notify (G_OBJECT (pressure), "pressure");
+
+	if (own) {
+		/* Nobody else to make room for */
+		io_pressure_set_throttle (pressure, priv->throttle - THROTTLE_STEP_DOWN);
+	} else if (priv->pressure >= high) {
+		io_pressure_set_throttle (pressure, priv->throttle + THROTTLE_STEP_UP);
+	} else if (priv->pressure <= low) {
+		io_pressure_set_throttle (pressure, priv->throttle - THROTTLE_STEP_DOWN);
+	}
+}
+
+/**
+ * tracker_io_pressure_sample:
+ * @pressure: a #TrackerIOPressure
+ *
+ * Samples the I/O pressure, and updates the throttle if there is
+ * a previous sample to compare with. PSI is preferred, diskstats
+ * is only looked up for the pressure if it isn't available. Pressure
+ * is not throttled on while this process and its helpers do most of
+ * the I/O on the tracked devices.
+ *
+ * Returns: %TRUE if any source of pressure information is available.
+ **/
+gboolean
+tracker_io_pressure_sample (TrackerIOPressure *pressure)
+{
+	TrackerIOPressurePrivate *priv;
+	GHashTableIter iter;
+	ProcessIO *helper;
+	gint64 now, elapsed, own_bytes = 0, helper_bytes;
+	guint64 total, bytes;
+	gdouble busy;
+	gboolean had_sample, have_devices, own_known, own = FALSE;
+
+	g_return_val_if_fail (TRACKER_IS_IO_PRESSURE (pressure), FALSE);
+
+	priv = pressure->priv;
+	now = g_get_monotonic_time ();
+	had_sample = (priv->last_sample_time != 0);
+	elapsed = now - priv->last_sample_time;
+	priv->last_sample_time = now;
+
+	/* Milliseconds, as diskstats counts */
+	have_devices = read_diskstats (priv->diskstats_path, priv->devices,
+	                               had_sample ? elapsed / 1000 : 0,
+	                               &busy, &bytes);
+
+	own_known = process_io_update (&priv->self, &own_bytes);
+
+	/* Helpers that just started, or whose I/O can't be
+	 * read, are left out.
+	 */
+	g_hash_table_iter_init (&iter, priv->helpers);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &helper)) {
+		if (process_io_update (helper, &helper_bytes) && own_known) {
+			own_bytes += helper_bytes;
+		}
+	}
+
+	if (own_known && have_devices && had_sample && bytes > 0) {
+		own = ((gdouble) own_bytes / bytes >= OWN_IO_SHARE);
+	}
+
+	if (priv->source != SOURCE_DISKSTATS &&
+	    read_psi (priv->psi_path, &total)) {
+		if (priv->source == SOURCE_PSI && had_sample &&
+		    elapsed > 0 && total >= priv->stall_total) {
+			io_pressure_update (pressure,
+			                    (gdouble) (total - priv->stall_total) / elapsed,
+			                    PSI_HIGH, PSI_LOW, own);
+		}
+
+		priv->source = SOURCE_PSI;
+		priv->stall_total = total;
+
+		return TRUE;
+	}
+
+	if (have_devices) {
+		if (priv->source == SOURCE_DISKSTATS && had_sample) {
+			io_pressure_update (pressure, busy,
+			                    DISKSTATS_HIGH, DISKSTATS_LOW, own);
+		}
+
+		priv->source = SOURCE_DISKSTATS;
+
+		return TRUE;
+	}
+
+	priv->source = SOURCE_NONE;
+
+	return FALSE;
+}
+
+static gboolean
+sample_cb (gpointer user_data)
+{
+	TrackerIOPressure *pressure = user_data;
+	TrackerIOPressurePrivate *priv = pressure->priv;
+
+	if (!tracker_io_pressure_sample (pressure)) {
+		g_debug ("I/O pressure information went away, no longer throttling on it");
+		priv->timeout_id = 0;
+		io_pressure_set_throttle (pressure, 0);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * tracker_io_pressure_add_device:
+ * @pressure: a #TrackerIOPressure
+ * @file: a file on the device to watch
+ *
+ * Adds the device holding @file to the ones looked up in
+ * /proc/diskstats, for their busy time when PSI is not available,
+ * and to tell the I/O done by this process apart from the rest.
+ **/
+void
+tracker_io_pressure_add_device (TrackerIOPressure *pressure,
+                                GFile             *file)
+{
+	TrackerIOPressurePrivate *priv;
+	DeviceStats stats = { 0, };
+	struct stat st;
+	gchar *path;
+	guint i;
+
+	g_return_if_fail (TRACKER_IS_IO_PRESSURE (pressure));
+	g_return_if_fail (G_IS_FILE (file));
+
+	priv = pressure->priv;
+	path = g_file_get_path (file);
+
+	if (!path || g_stat (path, &st) != 0) {
+		g_free (path);
+		return;
+	}
+
+	g_free (path);
+
+	for (i = 0; i < priv->devices->len; i++) {
+		if (g_array_index (priv->devices, DeviceStats, i).device == st.st_dev) {
+			return;
+		}
+	}
+
+	stats.device = st.st_dev;
+	g_array_append_val (priv->devices, stats);
+}
+
+/**
+ * tracker_io_pressure_set_helper:
+ * @pressure: a #TrackerIOPressure
+ * @name: name of a process doing I/O on behalf of this one
+ * @io_path: (allow-none): its I/O accounting file, usually
+ * /proc/&lt;pid&gt;/io, or %NULL if it is gone
+ *
+ * Sets the process whose I/O counts as done by this process when
+ * telling self inflicted pressure apart.
+ **/
+void
+tracker_io_pressure_set_helper (TrackerIOPressure *pressure,
+                                const gchar       *name,
+                                const gchar       *io_path)
+{
+	TrackerIOPressurePrivate *priv;
+	ProcessIO *helper;
+
+	g_return_if_fail (TRACKER_IS_IO_PRESSURE (pressure));
+	g_return_if_fail (name != NULL);
+
+	priv = pressure->priv;
+
+	if (!io_path) {
+		g_hash_table_remove (priv->helpers, name);
+		return;
+	}
+
+	helper = g_slice_new0 (ProcessIO);
+	helper->io_path = g_strdup (io_path);
+	helper->bytes = -1;
+
+	g_hash_table_replace (priv->helpers, g_strdup (name), helper);
+}
+
+static void
+process_watch_pid_cb (GObject      *object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+	ProcessWatch *watch;
+	GVariant *reply;
+	GError *error = NULL;
+	gchar *io_path;
+	guint32 pid;
+
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (object),
+	                                       result, &error);
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		/* The watch is gone already */
+		g_error_free (error);
+		return;
+	}
+
+	watch = user_data;
+
+	if (error) {
+		g_debug ("Could not get the process ID of '%s': %s",
+		         watch->name, error->message);
+		g_error_free (error);
+		return;
+	}
+
+	g_variant_get (reply, "(u)", &pid);
+	g_variant_unref (reply);
+
+	io_path = g_strdup_printf ("/proc/%u/io", pid);
+	tracker_io_pressure_set_helper (watch->pressure, watch->name, io_path);
+	g_free (io_path);
+}
+
+static void
+process_watch_appeared_cb (GDBusConnection *connection,
+                           const gchar     *name,
+                           const gchar     *name_owner,
+                           gpointer         user_data)
+{
+	ProcessWatch *watch = user_data;
+
+	g_dbus_connection_call (connection,
+	                        "org.freedesktop.DBus",
+	                        "/org/freedesktop/DBus",
+	                        "org.freedesktop.DBus",
+	                        "GetConnectionUnixProcessID",
+	                        g_variant_new ("(s)", name_owner),
+	                        G_VARIANT_TYPE ("(u)"),
+	                        G_DBUS_CALL_FLAGS_NONE,
+	                        -1,
+	                        watch->cancellable,
+	                        process_watch_pid_cb,
+	                        watch);
+}
+
+static void
+process_watch_vanished_cb (GDBusConnection *connection,
+                           const gchar     *name,
+                           gpointer         user_data)
+{
+	ProcessWatch *watch = user_data;
+
+	tracker_io_pressure_set_helper (watch->pressure, watch->name, NULL);
+}
+
+/**
+ * tracker_io_pressure_watch_helper:
+ * @pressure: a #TrackerIOPressure
+ * @connection: a #GDBusConnection
+ * @name: well-known bus name of a process doing I/O on behalf
+ * of this one
+ *
+ * Follows the process owning @name on @connection, and sets it as
+ * a helper with tracker_io_pressure_set_helper() while it runs.
+ **/
+void
+tracker_io_pressure_watch_helper (TrackerIOPressure *pressure,
+                                  GDBusConnection   *connection,
+                                  const gchar       *name)
+{
+	TrackerIOPressurePrivate *priv;
+	ProcessWatch *watch;
+
+	g_return_if_fail (TRACKER_IS_IO_PRESSURE (pressure));
+	g_return_if_fail (G_IS_DBUS_CONNECTION (connection));
+	g_return_if_fail (name != NULL);
+
+	priv = pressure->priv;
+
+	watch = g_slice_new0 (ProcessWatch);
+	watch->pressure = pressure;
+	watch->name = g_strdup (name);
+	watch->cancellable = g_cancellable_new ();
+	watch->watch_id = g_bus_watch_name_on_connection (connection, name,
+	                                                  G_BUS_NAME_WATCHER_FLAGS_NONE,
+	                                                  process_watch_appeared_cb,
+	                                                  process_watch_vanished_cb,
+	                                                  watch, NULL);
+
+	priv->watches = g_list_prepend (priv->watches, watch);
+}
+
+/**
+ * tracker_io_pressure_start:
+ * @pressure: a #TrackerIOPressure
+ *
+ * Starts sampling the I/O pressure periodically. Nothing is done
+ * if there is no source of pressure information.
+ **/
+void
+tracker_io_pressure_start (TrackerIOPressure *pressure)
+{
+	TrackerIOPressurePrivate *priv;
+	GHashTableIter iter;
+	ProcessIO *helper;
+
+	g_return_if_fail (TRACKER_IS_IO_PRESSURE (pressure));
+
+	priv = pressure->priv;
+
+	if (priv->timeout_id != 0) {
+		return;
+	}
+
+	/* Take a fresh baseline */
+	priv->last_sample_time = 0;
+	priv->self.bytes = -1;
+
+	g_hash_table_iter_init (&iter, priv->helpers);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &helper)) {
+		helper->bytes = -1;
+	}
+
+	if (!tracker_io_pressure_sample (pressure)) {
+		return;
+	}
+
+	priv->timeout_id = g_timeout_add_seconds (SAMPLE_INTERVAL,
+	                                          sample_cb,
+	                                          pressure);
+}
+
+/**
+ * tracker_io_pressure_stop:
+ * @pressure: a #TrackerIOPressure
+ *
+ * Stops sampling the I/O pressure, and resets the throttle.
+ **/
+void
+tracker_io_pressure_stop (TrackerIOPressure *pressure)
+{
+	TrackerIOPressurePrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_IO_PRESSURE (pressure));
+
+	priv = pressure->priv;
+
+	if (priv->timeout_id != 0) {
+		g_source_remove (priv->timeout_id);
+		priv->timeout_id = 0;
+	}
+
+	priv->pressure = 0;
+	io_pressure_set_throttle (pressure, 0);
+}
+
+gboolean
+tracker_io_pressure_is_running (TrackerIOPressure *pressure)
+{
+	TrackerIOPressurePrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_IO_PRESSURE (pressure), FALSE);
+
+	priv = pressure->priv;
+
+	return priv->timeout_id != 0;
+}
+
+gdouble
+tracker_io_pressure_get_pressure (TrackerIOPressure *pressure)
+{
+	TrackerIOPressurePrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_IO_PRESSURE (pressure), 0);
+
+	priv = pressure->priv;
+
+	return priv->pressure;
+}
+
+gdouble
+tracker_io_pressure_get_throttle (TrackerIOPressure *pressure)
+{
+	TrackerIOPressurePrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_IO_PRESSURE (pressure), 0);
+
+	priv = pressure->priv;
+
+	return priv->throttle;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_MINER_IO_PRESSURE_H__
+#define __LIBTRACKER_MINER_IO_PRESSURE_H__
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TRACKER_TYPE_IO_PRESSURE         (tracker_io_pressure_get_type())
+#define TRACKER_IO_PRESSURE(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), TRACKER_TYPE_IO_PRESSURE, TrackerIOPressure))
+#define TRACKER_IO_PRESSURE_CLASS(c)     (G_TYPE_CHECK_CLASS_CAST ((c),    TRACKER_TYPE_IO_PRESSURE, TrackerIOPressureClass))
+#define TRACKER_IS_IO_PRESSURE(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), TRACKER_TYPE_IO_PRESSURE))
+#define TRACKER_IS_IO_PRESSURE_CLASS(c)  (G_TYPE_CHECK_CLASS_TYPE ((c),    TRACKER_TYPE_IO_PRESSURE))
+#define TRACKER_IO_PRESSURE_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o),  TRACKER_TYPE_IO_PRESSURE, TrackerIOPressureClass))
+
+typedef struct _TrackerIOPressure TrackerIOPressure;
+typedef struct _TrackerIOPressureClass TrackerIOPressureClass;
+
+/* Feedback throttle driven by the I/O pressure of the system, sampled
+ * from /proc/pressure/io (PSI), or from the busy time of the indexed
+ * devices in /proc/diskstats on kernels without PSI. The throttle
+ * goes up under contention and comes back down slowly once the
+ * storage is idle, with a dead band in between so it doesn't flap.
+ * Pressure mostly caused by the I/O of this process, and of helper
+ * processes working for it, is ignored.
+ * Changes are notified through the ::throttle property.
+ */
+struct _TrackerIOPressure
+{
+	GObject parent_instance;
+	gpointer priv;
+};
+
+struct _TrackerIOPressureClass
+{
+	GObjectClass parent_class;
+};
+
+GType               tracker_io_pressure_get_type       (void) G_GNUC_CONST;
+
+TrackerIOPressure * tracker_io_pressure_new            (void);
+TrackerIOPressure * tracker_io_pressure_new_for_paths  (const gchar       *psi_path,
+                                                        const gchar       *diskstats_path,
+                                                        const gchar       *self_io_path);
+
+void                tracker_io_pressure_add_device     (TrackerIOPressure *pressure,
+                                                        GFile             *file);
+void                tracker_io_pressure_set_helper     (TrackerIOPressure *pressure,
+                                                        const gchar       *name,
+                                                        const gchar       *io_path);
+void                tracker_io_pressure_watch_helper   (TrackerIOPressure *pressure,
+                                                        GDBusConnection   *connection,
+                                                        const gchar       *name);
+
+void                tracker_io_pressure_start          (TrackerIOPressure *pressure);
+void                tracker_io_pressure_stop           (TrackerIOPressure *pressure);
+gboolean            tracker_io_pressure_is_running     (TrackerIOPressure *pressure);
+
+gboolean            tracker_io_pressure_sample         (TrackerIOPressure *pressure);
+
+gdouble             tracker_io_pressure_get_pressure   (TrackerIOPressure *pressure);
+gdouble             tracker_io_pressure_get_throttle   (TrackerIOPressure *pressure);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_MINER_IO_PRESSURE_H__ */
@@ -36,6 +36,8 @@
 #include "tracker-task-pool.h"
 #include "tracker-sparql-buffer.h"
 #include "tracker-file-notifier.h"
+#include "tracker-checkpoint.h"
+#include "tracker-io-pressure.h"
 
 /* If defined will print the tree from GNode while running */
 #ifdef CRAWLED_TREE_ENABLE_TRACE
@@ -98,12 +100,38 @@ static gboolean miner_fs_queues_status_trace_timeout_cb (gpointer data);
 #define DEFAULT_WAIT_POOL_LIMIT 1
 #define DEFAULT_READY_POOL_LIMIT 1
 
+/* Status while processing, followed by the commit batch size and
+ * latency if adaptive batching is enabled.
+ */
+#define PROCESSING_STATUS "Processing…"
+
+/* Processes doing I/O on behalf of the miner, the store writing
+ * the data and the extractor reading the files.
+ */
+#define STORE_DBUS_NAME   "org.freedesktop.Tracker1"
+#define EXTRACT_DBUS_NAME "org.freedesktop.Tracker1.Extract"
+
 /* Put tasks processing at a lower priority so other events
  * (timeouts, monitor events, etc...) are guaranteed to be
  * dispatched promptly.
  */
 #define TRACKER_TASK_PRIORITY G_PRIORITY_DEFAULT_IDLE + 10
 
+/* Directories boosted through tracker_miner_fs_boost_directory()
+ * that are remembered so items found later get the same priority.
+ */
+#define MAX_BOOSTED_DIRECTORIES 8
+
+/* With a memory ceiling, usage is checked every second while
+ * crawling. Past the high water mark crawled files are streamed
+ * and crawling pauses, until queues drain to the low water mark.
+ * Queued items are costed on top of what the notifier holds.
+ */
+#define MEMORY_CHECK_INTERVAL 1
+#define MEMORY_HIGH_WATER     90
+#define MEMORY_LOW_WATER      50
+#define QUEUED_ITEM_COST      128
+
 /**
  * SECTION:tracker-miner-fs
  * @short_description: Abstract base class for filesystem miners
@@ -122,6 +150,11 @@ typedef struct {
 	GFile *source_file;
 } ItemMovedData;
 
+typedef struct {
+	GFile *directory;
+	gint priority;
+} BoostedDirectory;
+
 typedef struct {
 	GFile     *file;
 	GPtrArray *results;
@@ -175,7 +208,13 @@ struct _TrackerMinerFSPrivate {
 
 	gdouble         throttle;
 
+	/* Configured throttle plus the I/O pressure one */
+	gdouble         effective_throttle;
+	TrackerIOPressure *io_pressure;
+	gboolean        io_pressure_throttling;
+
 	/* Extraction tasks */
+	guint           wait_pool_limit;
 	TrackerTaskPool *task_pool;
 
 	/* Writeback tasks */
@@ -184,6 +223,21 @@ struct _TrackerMinerFSPrivate {
 	/* Sparql insertion tasks */
 	TrackerSparqlBuffer *sparql_buffer;
 	guint sparql_buffer_limit;
+	guint commit_batch_min;
+	guint commit_batch_max;
+	guint commit_target_latency;
+
+	/* Crawl and queue state, to resume after being killed */
+	TrackerCheckpoint *checkpoint;
+
+	/* BoostedDirectory list, most recent first */
+	GList *boosted_directories;
+
+	/* Memory ceiling in KB, 0 if unlimited, and estimated usage in bytes */
+	guint           memory_ceiling;
+	guint           memory_check_id;
+	gsize           memory_usage;
+	gsize           peak_memory_usage;
 
 	TrackerIndexingTree *indexing_tree;
 
@@ -200,6 +254,10 @@ struct _TrackerMinerFSPrivate {
 	guint           timer_stopped : 1;    /* TRUE if main timer is stopped */
 	guint           extraction_timer_stopped : 1; /* TRUE if the extraction
 						       * timer is stopped */
+	guint           memory_streaming : 1; /* TRUE if crawled files are streamed
+	                                       * due to the memory ceiling */
+	guint           memory_paused : 1;    /* TRUE if crawling is paused
+	                                       * due to the memory ceiling */
 
 	/* Statistics */
 	guint           total_directories_found;
@@ -243,7 +301,16 @@ enum {
 	PROP_WAIT_POOL_LIMIT,
 	PROP_READY_POOL_LIMIT,
 	PROP_MTIME_CHECKING,
-	PROP_INITIAL_CRAWLING
+	PROP_INITIAL_CRAWLING,
+	PROP_COMMIT_BATCH_MIN,
+	PROP_COMMIT_BATCH_MAX,
+	PROP_COMMIT_TARGET_LATENCY,
+	PROP_CHECKPOINT_PATH,
+	PROP_IO_PRESSURE_THROTTLING,
+	PROP_EFFECTIVE_THROTTLE,
+	PROP_MEMORY_CEILING,
+	PROP_MEMORY_USAGE,
+	PROP_PEAK_MEMORY_USAGE
 };
 
 static void           miner_fs_initable_iface_init        (GInitableIface       *iface);
@@ -268,6 +335,9 @@ static ItemMovedData *item_moved_data_new                 (GFile
 static void           item_moved_data_free                (ItemMovedData        *data);
 static void           item_writeback_data_free            (ItemWritebackData    *data);
 
+static void           indexing_tree_directory_added       (TrackerIndexingTree  *indexing_tree,
+                                                           GFile                *directory,
+                                                           gpointer              user_data);
 static void           indexing_tree_directory_removed     (TrackerIndexingTree  *indexing_tree,
                                                            GFile                *directory,
                                                            gpointer              user_data);
@@ -299,6 +369,10 @@ static void           file_notifier_finished              (TrackerFileNotifier *
                                                            gpointer             user_data);
 
 static void           item_queue_handlers_set_up          (TrackerMinerFS       *fs);
+static gboolean       item_queue_handlers_cb              (gpointer              user_data);
+static guint          _tracker_idle_add                   (TrackerMinerFS       *fs,
+                                                           GSourceFunc           func,
+                                                           gpointer              user_data);
 static void           item_update_children_uri            (TrackerMinerFS       *fs,
                                                            RecursiveMoveData    *data,
                                                            const gchar          *source_uri,
@@ -306,9 +380,23 @@ static void           item_update_children_uri            (TrackerMinerFS
 
 static void           task_pool_cancel_foreach                (gpointer        data,
                                                                gpointer        user_data);
+static void           sparql_buffer_latency_notify_cb         (GObject        *object,
+                                                               GParamSpec     *pspec,
+                                                               gpointer        user_data);
+static void           miner_fs_update_commit_batching         (TrackerMinerFS *fs);
+static void           miner_fs_set_checkpoint_path            (TrackerMinerFS *fs,
+                                                               const gchar    *path);
+static void           miner_fs_boosted_directories_clear      (TrackerMinerFS *fs);
+static void           miner_fs_update_throttle                (TrackerMinerFS *fs);
+static void           io_pressure_throttle_notify_cb          (GObject        *object,
+                                                               GParamSpec     *pspec,
+                                                               gpointer        user_data);
 static void           task_pool_limit_reached_notify_cb       (GObject        *object,
                                                                GParamSpec     *pspec,
                                                                gpointer        user_data);
+static void           miner_fs_memory_check_start             (TrackerMinerFS *fs);
+static void           miner_fs_memory_check_stop              (TrackerMinerFS *fs);
+static void           miner_fs_check_memory                   (TrackerMinerFS *fs);
 
 static GInitableIface* miner_fs_initable_parent_iface;
 static guint signals[LAST_SIGNAL] = { 0, };
@@ -370,6 +458,78 @@ tracker_miner_fs_class_init (TrackerMinerFSClass *klass)
 	                                                       "Whether to perform initial crawling or not",
 	                                                       TRUE,
 	                                                       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_COMMIT_BATCH_MIN,
+	                                 g_param_spec_uint ("commit-batch-min",
+	                                                    "Minimum commit batch",
+	                                                    "Minimum number of SPARQL updates merged in a single "
+	                                                    "connection to the store with adaptive batching",
+	                                                    1, G_MAXUINT, 1,
+	                                                    G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_COMMIT_BATCH_MAX,
+	                                 g_param_spec_uint ("commit-batch-max",
+	                                                    "Maximum commit batch",
+	                                                    "Maximum number of SPARQL updates merged in a single "
+	                                                    "connection to the store with adaptive batching",
+	                                                    1, G_MAXUINT, G_MAXUINT,
+	                                                    G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_COMMIT_TARGET_LATENCY,
+	                                 g_param_spec_uint ("commit-target-latency",
+	                                                    "Commit target latency",
+	                                                    "Time in milliseconds each connection to the store "
+	                                                    "should take, 0 disables adaptive batching",
+	                                                    0, G_MAXUINT, 0,
+	                                                    G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_CHECKPOINT_PATH,
+	                                 g_param_spec_string ("checkpoint-path",
+	                                                      "Checkpoint path",
+	                                                      "File where the crawl and queue state is logged, "
+	                                                      "so interrupted indexing can be resumed, or NULL",
+	                                                      NULL,
+	                                                      G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_IO_PRESSURE_THROTTLING,
+	                                 g_param_spec_boolean ("io-pressure-throttling",
+	                                                       "I/O pressure throttling",
+	                                                       "Whether to throttle further while other processes "
+	                                                       "are contending for I/O",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_EFFECTIVE_THROTTLE,
+	                                 g_param_spec_double ("effective-throttle",
+	                                                      "Effective throttle",
+	                                                      "Throttle currently applied, including the one "
+	                                                      "caused by I/O pressure",
+	                                                      0, 1, 0,
+	                                                      G_PARAM_READABLE));
+	g_object_class_install_property (object_class,
+	                                 PROP_MEMORY_CEILING,
+	                                 g_param_spec_uint ("memory-ceiling",
+	                                                    "Memory ceiling",
+	                                                    "Memory in KB to be held for crawled and queued "
+	                                                    "files before crawling is slowed down, 0 for no limit",
+	                                                    0, G_MAXUINT, 0,
+	                                                    G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_MEMORY_USAGE,
+	                                 g_param_spec_uint ("memory-usage",
+	                                                    "Memory usage",
+	                                                    "Estimated memory in KB held for crawled and "
+	                                                    "queued files, as of the last check",
+	                                                    0, G_MAXUINT, 0,
+	                                                    G_PARAM_READABLE));
+	g_object_class_install_property (object_class,
+	                                 PROP_PEAK_MEMORY_USAGE,
+	                                 g_param_spec_uint ("peak-memory-usage",
+	                                                    "Peak memory usage",
+	                                                    "Highest estimated memory in KB held for crawled "
+	                                                    "and queued files",
+	                                                    0, G_MAXUINT, 0,
+	                                                    G_PARAM_READABLE));
 
 	/**
 	 * TrackerMinerFS::process-file:
@@ -549,6 +709,9 @@ tracker_miner_fs_init (TrackerMinerFS *object)
 	priv->timer_stopped = TRUE;
 	priv->extraction_timer_stopped = TRUE;
 
+	priv->commit_batch_min = 1;
+	priv->commit_batch_max = G_MAXUINT;
+
 	priv->items_created = tracker_priority_queue_new ();
 	priv->items_updated = tracker_priority_queue_new ();
 	priv->items_deleted = tracker_priority_queue_new ();
@@ -566,6 +729,7 @@ tracker_miner_fs_init (TrackerMinerFS *object)
 	                                                        (GDestroyNotify) NULL);
 
 	/* Create processing pools */
+	priv->wait_pool_limit = DEFAULT_WAIT_POOL_LIMIT;
 	priv->task_pool = tracker_task_pool_new (DEFAULT_WAIT_POOL_LIMIT);
 	g_signal_connect (priv->task_pool, "notify::limit-reached",
 	                  G_CALLBACK (task_pool_limit_reached_notify_cb), object);
@@ -576,6 +740,9 @@ tracker_miner_fs_init (TrackerMinerFS *object)
 
 	/* Create the indexing tree */
 	priv->indexing_tree = tracker_indexing_tree_new ();
+	g_signal_connect (priv->indexing_tree, "directory-added",
+	                  G_CALLBACK (indexing_tree_directory_added),
+	                  object);
 	g_signal_connect (priv->indexing_tree, "directory-removed",
 	                  G_CALLBACK (indexing_tree_directory_removed),
 	                  object);
@@ -612,6 +779,10 @@ tracker_miner_fs_init (TrackerMinerFS *object)
 
 	priv->mtime_checking = TRUE;
 	priv->initial_crawling = TRUE;
+
+	priv->io_pressure = tracker_io_pressure_new ();
+	g_signal_connect (priv->io_pressure, "notify::throttle",
+	                  G_CALLBACK (io_pressure_throttle_notify_cb), object);
 }
 
 static gboolean
@@ -620,6 +791,7 @@ miner_fs_initable_init (GInitable     *initable,
                         GError       **error)
 {
 	TrackerMinerFSPrivate *priv;
+	GDBusConnection *connection;
 	guint limit;
 
 	if (!miner_fs_initable_parent_iface->init (initable, cancellable, error)) {
@@ -628,12 +800,24 @@ miner_fs_initable_init (GInitable     *initable,
 
 	priv = TRACKER_MINER_FS_GET_PRIVATE (initable);
 
+	/* Their I/O is not pressure to make room for */
+	connection = tracker_miner_get_dbus_connection (TRACKER_MINER (initable));
+
+	if (connection) {
+		tracker_io_pressure_watch_helper (priv->io_pressure, connection, STORE_DBUS_NAME);
+		tracker_io_pressure_watch_helper (priv->io_pressure, connection, EXTRACT_DBUS_NAME);
+	}
+
 	g_object_get (initable, "processing-pool-ready-limit", &limit, NULL);
 	priv->sparql_buffer = tracker_sparql_buffer_new (tracker_miner_get_connection (TRACKER_MINER (initable)),
 	                                                 limit);
 	g_signal_connect (priv->sparql_buffer, "notify::limit-reached",
 	                  G_CALLBACK (task_pool_limit_reached_notify_cb),
 	                  initable);
+	g_signal_connect (priv->sparql_buffer, "notify::last-latency",
+	                  G_CALLBACK (sparql_buffer_latency_notify_cb),
+	                  initable);
+	miner_fs_update_commit_batching (TRACKER_MINER_FS (initable));
 
 	return TRUE;
 }
@@ -708,6 +892,21 @@ fs_finalize (GObject *object)
 	g_object_unref (priv->indexing_tree);
 	g_object_unref (priv->file_notifier);
 
+	if (priv->checkpoint) {
+		tracker_checkpoint_free (priv->checkpoint);
+	}
+
+	miner_fs_boosted_directories_clear (TRACKER_MINER_FS (object));
+
+	g_signal_handlers_disconnect_by_func (priv->io_pressure,
+	                                      io_pressure_throttle_notify_cb,
+	                                      object);
+	g_object_unref (priv->io_pressure);
+
+	if (priv->memory_check_id) {
+		g_source_remove (priv->memory_check_id);
+	}
+
 #ifdef EVENT_QUEUE_ENABLE_TRACE
 	if (priv->queue_status_timeout_id)
 		g_source_remove (priv->queue_status_timeout_id);
@@ -730,8 +929,8 @@ fs_set_property (GObject      *object,
 		                               g_value_get_double (value));
 		break;
 	case PROP_WAIT_POOL_LIMIT:
-		tracker_task_pool_set_limit (fs->priv->task_pool,
-		                             g_value_get_uint (value));
+		fs->priv->wait_pool_limit = g_value_get_uint (value);
+		miner_fs_update_throttle (fs);
 		break;
 	case PROP_READY_POOL_LIMIT:
 		fs->priv->sparql_buffer_limit = g_value_get_uint (value);
@@ -747,6 +946,37 @@ fs_set_property (GObject      *object,
 	case PROP_INITIAL_CRAWLING:
 		fs->priv->initial_crawling = g_value_get_boolean (value);
 		break;
+	case PROP_COMMIT_BATCH_MIN:
+		fs->priv->commit_batch_min = g_value_get_uint (value);
+		miner_fs_update_commit_batching (fs);
+		break;
+	case PROP_COMMIT_BATCH_MAX:
+		fs->priv->commit_batch_max = g_value_get_uint (value);
+		miner_fs_update_commit_batching (fs);
+		break;
+	case PROP_COMMIT_TARGET_LATENCY:
+		fs->priv->commit_target_latency = g_value_get_uint (value);
+		miner_fs_update_commit_batching (fs);
+		break;
+	case PROP_CHECKPOINT_PATH:
+		miner_fs_set_checkpoint_path (fs, g_value_get_string (value));
+		break;
+	case PROP_IO_PRESSURE_THROTTLING:
+		fs->priv->io_pressure_throttling = g_value_get_boolean (value);
+
+		if (!fs->priv->io_pressure_throttling) {
+			tracker_io_pressure_stop (fs->priv->io_pressure);
+		}
+		break;
+	case PROP_MEMORY_CEILING:
+		fs->priv->memory_ceiling = g_value_get_uint (value);
+
+		if (fs->priv->memory_ceiling == 0) {
+			miner_fs_memory_check_stop (fs);
+		} else if (tracker_file_notifier_is_active (fs->priv->file_notifier)) {
+			miner_fs_memory_check_start (fs);
+		}
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -768,8 +998,7 @@ fs_get_property (GObject    *object,
 		g_value_set_double (value, fs->priv->throttle);
 		break;
 	case PROP_WAIT_POOL_LIMIT:
-		g_value_set_uint (value,
-		                  tracker_task_pool_get_limit (fs->priv->task_pool));
+		g_value_set_uint (value, fs->priv->wait_pool_limit);
 		break;
 	case PROP_READY_POOL_LIMIT:
 		g_value_set_uint (value, fs->priv->sparql_buffer_limit);
@@ -780,12 +1009,65 @@ fs_get_property (GObject    *object,
 	case PROP_INITIAL_CRAWLING:
 		g_value_set_boolean (value, fs->priv->initial_crawling);
 		break;
+	case PROP_COMMIT_BATCH_MIN:
+		g_value_set_uint (value, fs->priv->commit_batch_min);
+		break;
+	case PROP_COMMIT_BATCH_MAX:
+		g_value_set_uint (value, fs->priv->commit_batch_max);
+		break;
+	case PROP_COMMIT_TARGET_LATENCY:
+		g_value_set_uint (value, fs->priv->commit_target_latency);
+		break;
+	case PROP_CHECKPOINT_PATH:
+		g_value_set_string (value,
+		                    fs->priv->checkpoint ?
+		                    tracker_checkpoint_get_path (fs->priv->checkpoint) :
+		                    NULL);
+		break;
+	case PROP_IO_PRESSURE_THROTTLING:
+		g_value_set_boolean (value, fs->priv->io_pressure_throttling);
+		break;
+	case PROP_EFFECTIVE_THROTTLE:
+		g_value_set_double (value, fs->priv->effective_throttle);
+		break;
+	case PROP_MEMORY_CEILING:
+		g_value_set_uint (value, fs->priv->memory_ceiling);
+		break;
+	case PROP_MEMORY_USAGE:
+		g_value_set_uint (value, fs->priv->memory_usage / 1024);
+		break;
+	case PROP_PEAK_MEMORY_USAGE:
+		g_value_set_uint (value, fs->priv->peak_memory_usage / 1024);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
 	}
 }
 
+static void
+miner_fs_set_checkpoint_path (TrackerMinerFS *fs,
+                              const gchar    *path)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+
+	if (priv->checkpoint) {
+		if (g_strcmp0 (path, tracker_checkpoint_get_path (priv->checkpoint)) == 0) {
+			return;
+		}
+
+		tracker_file_notifier_set_checkpoint (priv->file_notifier, NULL);
+		tracker_checkpoint_free (priv->checkpoint);
+		priv->checkpoint = NULL;
+	}
+
+	if (path && *path) {
+		priv->checkpoint = tracker_checkpoint_new (path);
+		tracker_file_notifier_set_checkpoint (priv->file_notifier,
+		                                      priv->checkpoint);
+	}
+}
+
 static void
 task_pool_limit_reached_notify_cb (GObject    *object,
 				   GParamSpec *pspec,
@@ -796,6 +1078,243 @@ task_pool_limit_reached_notify_cb (GObject    *object,
 	}
 }
 
+static void
+miner_fs_update_commit_batching (TrackerMinerFS *fs)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+
+	if (!priv->sparql_buffer) {
+		return;
+	}
+
+	tracker_sparql_buffer_set_batch_limits (priv->sparql_buffer,
+	                                        priv->commit_batch_min,
+	                                        priv->commit_batch_max,
+	                                        priv->commit_target_latency);
+}
+
+static gchar *
+miner_fs_processing_status_new (TrackerMinerFS *fs)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+	GString *str;
+	gint latency;
+
+	str = g_string_new (PROCESSING_STATUS);
+	latency = tracker_sparql_buffer_get_last_latency (priv->sparql_buffer);
+
+	if (priv->commit_target_latency != 0 && latency >= 0) {
+		g_string_append_printf (str, " (%u per commit, %d ms",
+		                        tracker_sparql_buffer_get_batch_size (priv->sparql_buffer),
+		                        latency);
+	}
+
+	if (priv->effective_throttle > 0) {
+		g_string_append (str, str->len > strlen (PROCESSING_STATUS) ? ", " : " (");
+		g_string_append_printf (str, "throttle %.2f", priv->effective_throttle);
+	}
+
+	if (str->len > strlen (PROCESSING_STATUS)) {
+		g_string_append_c (str, ')');
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+miner_fs_update_processing_status (TrackerMinerFS *fs)
+{
+	gchar *status, *new_status;
+
+	g_object_get (fs, "status", &status, NULL);
+
+	if (status && g_str_has_prefix (status, PROCESSING_STATUS)) {
+		new_status = miner_fs_processing_status_new (fs);
+
+		if (strcmp (status, new_status) != 0) {
+			g_object_set (fs, "status", new_status, NULL);
+		}
+
+		g_free (new_status);
+	}
+
+	g_free (status);
+}
+
+static void
+sparql_buffer_latency_notify_cb (GObject    *object,
+                                 GParamSpec *pspec,
+                                 gpointer    user_data)
+{
+	TrackerMinerFS *fs = user_data;
+
+	if (fs->priv->commit_target_latency != 0) {
+		miner_fs_update_processing_status (fs);
+	}
+}
+
+/* Applies the configured throttle plus the one caused by I/O
+ * pressure to queue processing, crawling, and the number of
+ * files handed concurrently to the upper layer for extraction.
+ */
+static void
+miner_fs_update_throttle (TrackerMinerFS *fs)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+	gdouble throttle;
+	guint limit;
+
+	throttle = priv->throttle;
+
+	if (priv->io_pressure_throttling) {
+		throttle += tracker_io_pressure_get_throttle (priv->io_pressure);
+	}
+
+	throttle = CLAMP (throttle, 0, 1);
+
+	limit = (guint) (priv->wait_pool_limit * (1 - throttle) + 0.5);
+	tracker_task_pool_set_limit (priv->task_pool, MAX (limit, 1));
+
+	if (priv->effective_throttle == throttle) {
+		return;
+	}
+
+	priv->effective_throttle = throttle;
+
+	/* Update timeouts */
+	if (priv->item_queues_handler_id != 0) {
+		g_source_remove (priv->item_queues_handler_id);
+
+		priv->item_queues_handler_id =
+			_tracker_idle_add (fs,
+			                   item_queue_handlers_cb,
+			                   fs);
+	}
+
+	tracker_file_notifier_set_throttle (priv->file_notifier, throttle);
+
+	g_object_notify (G_OBJECT (fs), "effective-throttle");
+	miner_fs_update_processing_status (fs);
+}
+
+static void
+io_pressure_throttle_notify_cb (GObject    *object,
+                                GParamSpec *pspec,
+                                gpointer    user_data)
+{
+	miner_fs_update_throttle (TRACKER_MINER_FS (user_data));
+}
+
+static void
+miner_fs_io_pressure_start (TrackerMinerFS *fs)
+{
+	if (fs->priv->io_pressure_throttling) {
+		tracker_io_pressure_start (fs->priv->io_pressure);
+	}
+}
+
+static guint
+miner_fs_get_n_queued (TrackerMinerFS *fs)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+
+	return (tracker_priority_queue_get_length (priv->items_deleted) +
+	        tracker_priority_queue_get_length (priv->items_created) +
+	        tracker_priority_queue_get_length (priv->items_updated) +
+	        tracker_priority_queue_get_length (priv->items_moved) +
+	        tracker_priority_queue_get_length (priv->items_writeback));
+}
+
+/* Keeps the files held while crawling under the memory ceiling,
+ * switching to streaming crawled directories when approaching it,
+ * and pausing crawling until enough queued items are processed.
+ */
+static void
+miner_fs_check_memory (TrackerMinerFS *fs)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+	gsize usage, high_water, low_water;
+	guint n_queued;
+
+	if (priv->memory_check_id == 0) {
+		return;
+	}
+
+	n_queued = miner_fs_get_n_queued (fs);
+	usage = tracker_file_notifier_get_memory_usage (priv->file_notifier, NULL);
+	usage += (gsize) n_queued * QUEUED_ITEM_COST;
+
+	priv->memory_usage = usage;
+	priv->peak_memory_usage = MAX (priv->peak_memory_usage, usage);
+
+	high_water = (gsize) priv->memory_ceiling * 1024 / 100 * MEMORY_HIGH_WATER;
+	low_water = (gsize) priv->memory_ceiling * 1024 / 100 * MEMORY_LOW_WATER;
+
+	if (usage >= high_water && !priv->memory_streaming) {
+		tracker_info ("Memory ceiling approached (%" G_GSIZE_FORMAT " KB of %u KB), "
+		              "streaming crawled directories",
+		              usage / 1024, priv->memory_ceiling);
+		tracker_file_notifier_set_streaming (priv->file_notifier, TRUE);
+		priv->memory_streaming = TRUE;
+	}
+
+	if (!priv->memory_paused) {
+		/* Pausing only helps if there's something to drain */
+		if (usage >= high_water && n_queued > 0) {
+			tracker_file_notifier_pause_crawling (priv->file_notifier);
+			priv->memory_paused = TRUE;
+		}
+	} else if (usage <= low_water || n_queued == 0) {
+		tracker_file_notifier_resume_crawling (priv->file_notifier);
+		priv->memory_paused = FALSE;
+	}
+}
+
+static gboolean
+memory_check_cb (gpointer user_data)
+{
+	miner_fs_check_memory (TRACKER_MINER_FS (user_data));
+
+	return TRUE;
+}
+
+static void
+miner_fs_memory_check_start (TrackerMinerFS *fs)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+
+	if (priv->memory_ceiling == 0 || priv->memory_check_id != 0) {
+		return;
+	}
+
+	priv->memory_check_id =
+		g_timeout_add_seconds (MEMORY_CHECK_INTERVAL,
+		                       memory_check_cb, fs);
+}
+
+static void
+miner_fs_memory_check_stop (TrackerMinerFS *fs)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+
+	if (priv->memory_check_id == 0) {
+		return;
+	}
+
+	g_source_remove (priv->memory_check_id);
+	priv->memory_check_id = 0;
+
+	if (priv->memory_paused) {
+		tracker_file_notifier_resume_crawling (priv->file_notifier);
+		priv->memory_paused = FALSE;
+	}
+
+	if (priv->memory_streaming) {
+		tracker_file_notifier_set_streaming (priv->file_notifier, FALSE);
+		priv->memory_streaming = FALSE;
+	}
+}
+
 static void
 miner_started (TrackerMiner *miner)
 {
@@ -838,6 +1357,7 @@ miner_paused (TrackerMiner *miner)
 	fs->priv->is_paused = TRUE;
 
 	tracker_file_notifier_stop (fs->priv->file_notifier);
+	tracker_io_pressure_stop (fs->priv->io_pressure);
 
 	if (fs->priv->item_queues_handler_id) {
 		g_source_remove (fs->priv->item_queues_handler_id);
@@ -907,6 +1427,12 @@ process_print_stats (TrackerMinerFS *fs)
 		              fs->priv->total_files_processed,
 		              fs->priv->total_files_notified,
 		              fs->priv->total_files_notified_error);
+
+		if (fs->priv->memory_ceiling > 0) {
+			tracker_info ("Peak memory       : %" G_GSIZE_FORMAT " KB (ceiling %u KB)",
+			              fs->priv->peak_memory_usage / 1024,
+			              fs->priv->memory_ceiling);
+		}
 		tracker_info ("--------------------------------------------------\n");
 	}
 }
@@ -947,6 +1473,16 @@ process_stop (TrackerMinerFS *fs)
 	fs->priv->total_files_ignored = 0;
 
 	fs->priv->been_crawled = TRUE;
+
+	/* Nothing left to resume */
+	if (fs->priv->checkpoint) {
+		tracker_checkpoint_clear (fs->priv->checkpoint);
+	}
+
+	miner_fs_boosted_directories_clear (fs);
+
+	tracker_io_pressure_stop (fs->priv->io_pressure);
+	miner_fs_memory_check_stop (fs);
 }
 
 static ItemMovedData *
@@ -1029,14 +1565,22 @@ sparql_buffer_task_finished_cb (GObject      *object,
 
 	if (g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result),
 	                                           &error)) {
-		g_critical ("Could not execute sparql: %s", error->message);
-		priv->total_files_notified_error++;
+		/* Cancelled tasks were discarded on purpose */
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_critical ("Could not execute sparql: %s", error->message);
+			priv->total_files_notified_error++;
+		}
+
 		g_error_free (error);
 	}
 
 	task = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result));
 	task_file = tracker_task_get_file (task);
 
+	if (priv->checkpoint) {
+		tracker_checkpoint_item_done (priv->checkpoint, task_file);
+	}
+
 	if (item_queue_is_blocked_by_file (fs, task_file)) {
 		g_object_unref (priv->item_queue_blocker);
 		priv->item_queue_blocker = NULL;
@@ -2216,14 +2760,18 @@ item_queue_handlers_cb (gpointer user_data)
 			/* CLAMP progress so it doesn't go back below
 			 * 2% (which we use for crawling)
 			 */
-			if (g_strcmp0 (status, "Processing…") != 0) {
+			if (!status || !g_str_has_prefix (status, PROCESSING_STATUS)) {
+				gchar *new_status;
+
 				/* Don't spam this */
-				tracker_info ("Processing…");
+				tracker_info (PROCESSING_STATUS);
+				new_status = miner_fs_processing_status_new (fs);
 				g_object_set (fs,
-				              "status", "Processing…",
+				              "status", new_status,
 				              "progress", CLAMP (progress_now, 0.02, 1.00),
 				              "remaining-time", remaining_time,
 				              NULL);
+				g_free (new_status);
 			} else {
 				g_object_set (fs,
 				              "progress", CLAMP (progress_now, 0.02, 1.00),
@@ -2359,7 +2907,7 @@ _tracker_idle_add (TrackerMinerFS *fs,
 {
 	guint interval;
 
-	interval = TRACKER_MAX_TIMEOUT_INTERVAL * fs->priv->throttle;
+	interval = TRACKER_MAX_TIMEOUT_INTERVAL * fs->priv->effective_throttle;
 
 	if (interval == 0) {
 		return g_idle_add_full (TRACKER_TASK_PRIORITY, func, user_data, NULL);
@@ -2371,6 +2919,9 @@ _tracker_idle_add (TrackerMinerFS *fs,
 static void
 item_queue_handlers_set_up (TrackerMinerFS *fs)
 {
+	/* Catch up with queues draining or growing */
+	miner_fs_check_memory (fs);
+
 	trace_eq ("Setting up queue handlers...");
 	if (fs->priv->item_queues_handler_id != 0) {
 		trace_eq ("   cancelled: already one active");
@@ -2415,14 +2966,21 @@ item_queue_handlers_set_up (TrackerMinerFS *fs)
 		              NULL);
 
 		/* Don't spam this */
-		if (progress > 0.01 && g_strcmp0 (status, "Processing…") != 0) {
-			tracker_info ("Processing…");
-			g_object_set (fs, "status", "Processing…", NULL);
+		if (progress > 0.01 &&
+		    (!status || !g_str_has_prefix (status, PROCESSING_STATUS))) {
+			gchar *new_status;
+
+			tracker_info (PROCESSING_STATUS);
+			new_status = miner_fs_processing_status_new (fs);
+			g_object_set (fs, "status", new_status, NULL);
+			g_free (new_status);
 		}
 
 		g_free (status);
 	}
 
+	miner_fs_io_pressure_start (fs);
+
 	trace_eq ("   scheduled in idle");
 	fs->priv->item_queues_handler_id =
 		_tracker_idle_add (fs,
@@ -2442,6 +3000,49 @@ should_check_file (TrackerMinerFS *fs,
 	                                                file, file_type);
 }
 
+static void
+boosted_directory_free (BoostedDirectory *boosted)
+{
+	g_object_unref (boosted->directory);
+	g_slice_free (BoostedDirectory, boosted);
+}
+
+static void
+miner_fs_boosted_directories_clear (TrackerMinerFS *fs)
+{
+	g_list_free_full (fs->priv->boosted_directories,
+	                  (GDestroyNotify) boosted_directory_free);
+	fs->priv->boosted_directories = NULL;
+}
+
+static gboolean
+file_is_under_directory (GFile *file,
+                         GFile *directory)
+{
+	return (g_file_equal (file, directory) ||
+	        g_file_has_prefix (file, directory));
+}
+
+/* Priority for newly queued items, boosted directories
+ * are looked up most recent first.
+ */
+static gint
+miner_fs_get_item_priority (TrackerMinerFS *fs,
+                            GFile          *file)
+{
+	GList *l;
+
+	for (l = fs->priv->boosted_directories; l; l = l->next) {
+		BoostedDirectory *boosted = l->data;
+
+		if (file_is_under_directory (file, boosted->directory)) {
+			return boosted->priority;
+		}
+	}
+
+	return G_PRIORITY_DEFAULT;
+}
+
 static gboolean
 moved_files_equal (gconstpointer a,
                    gconstpointer b)
@@ -2453,6 +3054,16 @@ moved_files_equal (gconstpointer a,
 	return g_file_equal (data->file, file);
 }
 
+static gboolean
+moved_files_under_directory (gconstpointer a,
+                             gconstpointer b)
+{
+	const ItemMovedData *data = a;
+
+	/* Compare with dest file */
+	return file_is_under_directory (data->file, G_FILE (b));
+}
+
 static gboolean
 writeback_files_equal (gconstpointer a,
                        gconstpointer b)
@@ -2464,6 +3075,15 @@ writeback_files_equal (gconstpointer a,
 	return g_file_equal (data->file, file);
 }
 
+static gboolean
+writeback_files_under_directory (gconstpointer a,
+                                 gconstpointer b)
+{
+	const ItemWritebackData *data = a;
+
+	return file_is_under_directory (data->file, G_FILE (b));
+}
+
 static gboolean
 remove_writeback_task (TrackerMinerFS *fs,
                        GFile          *file)
@@ -2661,6 +3281,18 @@ check_item_queues (TrackerMinerFS *fs,
 	return TRUE;
 }
 
+static void
+miner_fs_checkpoint_item (TrackerMinerFS         *fs,
+                          TrackerCheckpointEvent  event,
+                          GFile                  *file,
+                          GFile                  *source_file)
+{
+	if (fs->priv->checkpoint) {
+		tracker_checkpoint_add_item (fs->priv->checkpoint,
+		                             event, file, source_file);
+	}
+}
+
 static void
 file_notifier_file_created (TrackerFileNotifier  *notifier,
                             GFile                *file,
@@ -2671,7 +3303,8 @@ file_notifier_file_created (TrackerFileNotifier  *notifier,
 	if (check_item_queues (fs, QUEUE_CREATED, file, NULL)) {
 		tracker_priority_queue_add (fs->priv->items_created,
 		                            g_object_ref (file),
-		                            G_PRIORITY_DEFAULT);
+		                            miner_fs_get_item_priority (fs, file));
+		miner_fs_checkpoint_item (fs, TRACKER_CHECKPOINT_CREATED, file, NULL);
 		item_queue_handlers_set_up (fs);
 	}
 }
@@ -2686,7 +3319,8 @@ file_notifier_file_deleted (TrackerFileNotifier  *notifier,
 	if (check_item_queues (fs, QUEUE_DELETED, file, NULL)) {
 		tracker_priority_queue_add (fs->priv->items_deleted,
 		                            g_object_ref (file),
-		                            G_PRIORITY_DEFAULT);
+		                            miner_fs_get_item_priority (fs, file));
+		miner_fs_checkpoint_item (fs, TRACKER_CHECKPOINT_DELETED, file, NULL);
 		item_queue_handlers_set_up (fs);
 	}
 }
@@ -2719,7 +3353,8 @@ file_notifier_file_updated (TrackerFileNotifier  *notifier,
 
 		tracker_priority_queue_add (fs->priv->items_updated,
 		                            g_object_ref (file),
-		                            G_PRIORITY_DEFAULT);
+		                            miner_fs_get_item_priority (fs, file));
+		miner_fs_checkpoint_item (fs, TRACKER_CHECKPOINT_UPDATED, file, NULL);
 		item_queue_handlers_set_up (fs);
 	}
 }
@@ -2735,7 +3370,8 @@ file_notifier_file_moved (TrackerFileNotifier *notifier,
 	if (check_item_queues (fs, QUEUE_MOVED, source, dest)) {
 		tracker_priority_queue_add (fs->priv->items_moved,
 		                            item_moved_data_new (dest, source),
-		                            G_PRIORITY_DEFAULT);
+		                            miner_fs_get_item_priority (fs, dest));
+		miner_fs_checkpoint_item (fs, TRACKER_CHECKPOINT_MOVED, dest, source);
 		item_queue_handlers_set_up (fs);
 	}
 }
@@ -2753,6 +3389,9 @@ file_notifier_directory_started (TrackerFileNotifier *notifier,
 	tracker_indexing_tree_get_root (fs->priv->indexing_tree,
 					directory, &flags);
 
+	miner_fs_io_pressure_start (fs);
+	miner_fs_memory_check_start (fs);
+
 	if ((flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0) {
                 str = g_strdup_printf ("Crawling recursively directory '%s'", uri);
         } else {
@@ -2932,6 +3571,17 @@ writeback_pool_cancel_foreach (gpointer data,
 	}
 }
 
+static void
+indexing_tree_directory_added (TrackerIndexingTree *indexing_tree,
+                               GFile               *directory,
+                               gpointer             user_data)
+{
+	TrackerMinerFS *fs = user_data;
+
+	/* Only looked up in /proc/diskstats if there's no PSI */
+	tracker_io_pressure_add_device (fs->priv->io_pressure, directory);
+}
+
 static void
 indexing_tree_directory_removed (TrackerIndexingTree *indexing_tree,
                                  GFile               *directory,
@@ -3348,6 +3998,177 @@ tracker_miner_fs_check_directory (TrackerMinerFS *fs,
 	                                                check_parents);
 }
 
+/**
+ * tracker_miner_fs_boost_directory:
+ * @fs: a #TrackerMinerFS
+ * @directory: #GFile for the directory to boost
+ * @priority: the priority to raise items to
+ *
+ * Raises the priority of everything within @directory, so it gets
+ * indexed ahead of the rest. Items already queued with a less
+ * urgent priority are moved to @priority, the crawler goes for
+ * @directory next, and items found later within @directory are
+ * queued at @priority too until the miner becomes idle.
+ *
+ * Returns: the number of already queued items that were boosted.
+ *
+ * Since: 0.16
+ **/
+guint
+tracker_miner_fs_boost_directory (TrackerMinerFS *fs,
+                                  GFile          *directory,
+                                  gint            priority)
+{
+	BoostedDirectory *boosted;
+	GList *l, *last;
+	guint n_boosted;
+	gchar *uri;
+
+	g_return_val_if_fail (TRACKER_IS_MINER_FS (fs), 0);
+	g_return_val_if_fail (G_IS_FILE (directory), 0);
+
+	n_boosted = tracker_priority_queue_boost (fs->priv->items_deleted,
+	                                          (GEqualFunc) file_is_under_directory,
+	                                          directory, priority);
+	n_boosted += tracker_priority_queue_boost (fs->priv->items_created,
+	                                           (GEqualFunc) file_is_under_directory,
+	                                           directory, priority);
+	n_boosted += tracker_priority_queue_boost (fs->priv->items_updated,
+	                                           (GEqualFunc) file_is_under_directory,
+	                                           directory, priority);
+	n_boosted += tracker_priority_queue_boost (fs->priv->items_moved,
+	                                           (GEqualFunc) moved_files_under_directory,
+	                                           directory, priority);
+
+	/* Replace any previous boost for the same directory */
+	for (l = fs->priv->boosted_directories; l; l = l->next) {
+		boosted = l->data;
+
+		if (g_file_equal (boosted->directory, directory)) {
+			boosted_directory_free (boosted);
+			fs->priv->boosted_directories =
+				g_list_delete_link (fs->priv->boosted_directories, l);
+			break;
+		}
+	}
+
+	if (g_list_length (fs->priv->boosted_directories) >= MAX_BOOSTED_DIRECTORIES) {
+		last = g_list_last (fs->priv->boosted_directories);
+		boosted_directory_free (last->data);
+		fs->priv->boosted_directories =
+			g_list_delete_link (fs->priv->boosted_directories, last);
+	}
+
+	boosted = g_slice_new (BoostedDirectory);
+	boosted->directory = g_object_ref (directory);
+	boosted->priority = priority;
+	fs->priv->boosted_directories =
+		g_list_prepend (fs->priv->boosted_directories, boosted);
+
+	tracker_file_notifier_boost_directory (fs->priv->file_notifier,
+	                                       directory);
+
+	uri = g_file_get_uri (directory);
+	g_debug ("Boosted '%s' to priority %d, %d queued items moved",
+	         uri, priority, n_boosted);
+	g_free (uri);
+
+	item_queue_handlers_set_up (fs);
+
+	return n_boosted;
+}
+
+static guint
+miner_fs_queue_remove_under_directory (TrackerPriorityQueue *queue,
+                                       GEqualFunc            compare_func,
+                                       GFile                *directory,
+                                       GDestroyNotify        destroy_notify)
+{
+	guint length;
+
+	length = tracker_priority_queue_get_length (queue);
+	tracker_priority_queue_foreach_remove (queue, compare_func,
+	                                       directory, destroy_notify);
+
+	return length - tracker_priority_queue_get_length (queue);
+}
+
+/**
+ * tracker_miner_fs_cancel_for_prefix:
+ * @fs: a #TrackerMinerFS
+ * @prefix: #GFile for a directory that went away
+ *
+ * Discards in one go all pending work within @prefix, as needed
+ * when a mount point disappears without notice. Crawling in
+ * @prefix is stopped, queued items are dropped, items being
+ * processed are cancelled and SPARQL updates waiting to be
+ * committed are discarded. Deletions are kept, as these don't
+ * need @prefix to be accessible.
+ *
+ * Returns: the number of crawled, queued and buffered items
+ * that were discarded.
+ *
+ * Since: 0.16
+ **/
+guint
+tracker_miner_fs_cancel_for_prefix (TrackerMinerFS *fs,
+                                    GFile          *prefix)
+{
+	TrackerMinerFSPrivate *priv;
+	guint n_crawled, n_queued, n_buffered;
+	GTimer *timer;
+	gchar *uri;
+
+	g_return_val_if_fail (TRACKER_IS_MINER_FS (fs), 0);
+	g_return_val_if_fail (G_IS_FILE (prefix), 0);
+
+	priv = fs->priv;
+	timer = g_timer_new ();
+
+	/* Stop crawling first, so nothing new gets queued */
+	n_crawled = tracker_file_notifier_cancel_for_prefix (priv->file_notifier,
+	                                                     prefix);
+
+	tracker_task_pool_foreach (priv->task_pool,
+	                           task_pool_cancel_foreach,
+	                           prefix);
+	tracker_task_pool_foreach (priv->writeback_pool,
+	                           writeback_pool_cancel_foreach,
+	                           prefix);
+
+	n_queued = miner_fs_queue_remove_under_directory (priv->items_created,
+	                                                  (GEqualFunc) file_is_under_directory,
+	                                                  prefix,
+	                                                  (GDestroyNotify) g_object_unref);
+	n_queued += miner_fs_queue_remove_under_directory (priv->items_updated,
+	                                                   (GEqualFunc) file_is_under_directory,
+	                                                   prefix,
+	                                                   (GDestroyNotify) g_object_unref);
+	n_queued += miner_fs_queue_remove_under_directory (priv->items_moved,
+	                                                   (GEqualFunc) moved_files_under_directory,
+	                                                   prefix,
+	                                                   (GDestroyNotify) item_moved_data_free);
+	n_queued += miner_fs_queue_remove_under_directory (priv->items_writeback,
+	                                                   (GEqualFunc) writeback_files_under_directory,
+	                                                   prefix,
+	                                                   (GDestroyNotify) item_writeback_data_free);
+
+	n_buffered = tracker_sparql_buffer_cancel_for_prefix (priv->sparql_buffer,
+	                                                      prefix);
+
+	uri = g_file_get_uri (prefix);
+	g_message ("Discarded work under '%s' in %f seconds: "
+	           "%u crawled, %u queued and %u buffered items",
+	           uri, g_timer_elapsed (timer, NULL),
+	           n_crawled, n_queued, n_buffered);
+	g_free (uri);
+	g_timer_destroy (timer);
+
+	item_queue_handlers_set_up (fs);
+
+	return n_crawled + n_queued + n_buffered;
+}
+
 /**
  * tracker_miner_fs_file_notify:
  * @fs: a #TrackerMinerFS
@@ -3425,16 +4246,7 @@ tracker_miner_fs_set_throttle (TrackerMinerFS *fs,
 	}
 
 	fs->priv->throttle = throttle;
-
-	/* Update timeouts */
-	if (fs->priv->item_queues_handler_id != 0) {
-		g_source_remove (fs->priv->item_queues_handler_id);
-
-		fs->priv->item_queues_handler_id =
-			_tracker_idle_add (fs,
-			                   item_queue_handlers_cb,
-			                   fs);
-	}
+	miner_fs_update_throttle (fs);
 }
 
 /**
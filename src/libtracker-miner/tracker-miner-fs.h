@@ -122,6 +122,11 @@ void                  tracker_miner_fs_writeback_notify     (TrackerMinerFS *fs,
 void                  tracker_miner_fs_check_directory      (TrackerMinerFS *fs,
                                                              GFile          *file,
                                                              gboolean        check_parents);
+guint                 tracker_miner_fs_boost_directory      (TrackerMinerFS *fs,
+                                                             GFile          *directory,
+                                                             gint            priority);
+guint                 tracker_miner_fs_cancel_for_prefix    (TrackerMinerFS *fs,
+                                                             GFile          *prefix);
 void                  tracker_miner_fs_file_notify          (TrackerMinerFS *fs,
                                                              GFile          *file,
                                                              const GError   *error);
@@ -0,0 +1,805 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_FANOTIFY
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/fanotify.h>
+#include <sys/statfs.h>
+
+#endif /* HAVE_FANOTIFY */
+
+#include <gio/gio.h>
+
+#include "tracker-monitor-fanotify.h"
+
+#ifdef HAVE_FANOTIFY
+
+/* Events we want on every marked filesystem. Writes are reported
+ * as CHANGED like Inotify does, once per file until it is closed,
+ * TrackerMonitor then waits for the CHANGES_DONE_HINT.
+ */
+#define FANOTIFY_EVENT_MASK (FAN_CREATE | FAN_DELETE | FAN_ATTRIB | \
+                             FAN_MODIFY | FAN_CLOSE_WRITE | FAN_ONDIR)
+#define FANOTIFY_MOVE_MASK  (FAN_MOVED_FROM | FAN_MOVED_TO)
+
+#define FANOTIFY_BUFFER_SIZE 16384
+
+#define TRACKER_TYPE_FANOTIFY_DIR_MONITOR (tracker_fanotify_dir_monitor_get_type ())
+#define TRACKER_FANOTIFY_DIR_MONITOR(o)   (G_TYPE_CHECK_INSTANCE_CAST ((o), TRACKER_TYPE_FANOTIFY_DIR_MONITOR, TrackerFanotifyDirMonitor))
+
+typedef struct _TrackerFanotifyDirMonitor TrackerFanotifyDirMonitor;
+typedef struct _TrackerFanotifyDirMonitorClass TrackerFanotifyDirMonitorClass;
+
+struct _TrackerFanotifyDirMonitor {
+	GFileMonitor parent_instance;
+
+	TrackerMonitorFanotify *fanotify;
+	GFile *file;
+	GBytes *fsid;
+	GBytes *key;
+};
+
+struct _TrackerFanotifyDirMonitorClass {
+	GFileMonitorClass parent_class;
+};
+
+typedef struct {
+	gchar *path;
+	guint n_directories;
+} FilesystemData;
+
+struct _TrackerMonitorFanotify {
+	gint fd;
+	GIOChannel *channel;
+	guint watch_id;
+
+	/* Whether FAN_RENAME can be used, this allows
+	 * reporting moves as a single event (Linux >= 5.17)
+	 */
+	gboolean use_rename;
+
+	/* Set once a filesystem mark was refused, every other
+	 * directory then goes straight to the fallback
+	 */
+	gboolean denied;
+
+	/* File CHANGED was last reported for, further writes
+	 * to it are not reported again until something else
+	 * happens, only compared against
+	 */
+	TrackerFanotifyDirMonitor *modified_dir_monitor;
+	gchar *modified_name;
+
+	GHashTable *filesystems; /* GBytes (fsid) -> FilesystemData */
+	GHashTable *directories; /* GBytes (fsid + handle) -> TrackerFanotifyDirMonitor */
+	GHashTable *monitors;    /* Set of all live TrackerFanotifyDirMonitor */
+};
+
+GType tracker_fanotify_dir_monitor_get_type (void) G_GNUC_CONST;
+
+static void fanotify_dir_monitor_detach (TrackerFanotifyDirMonitor *dir_monitor);
+
+G_DEFINE_TYPE (TrackerFanotifyDirMonitor, tracker_fanotify_dir_monitor, G_TYPE_FILE_MONITOR)
+
+static gboolean
+tracker_fanotify_dir_monitor_cancel (GFileMonitor *monitor)
+{
+	fanotify_dir_monitor_detach (TRACKER_FANOTIFY_DIR_MONITOR (monitor));
+
+	return TRUE;
+}
+
+static void
+tracker_fanotify_dir_monitor_finalize (GObject *object)
+{
+	TrackerFanotifyDirMonitor *dir_monitor;
+
+	dir_monitor = TRACKER_FANOTIFY_DIR_MONITOR (object);
+	fanotify_dir_monitor_detach (dir_monitor);
+
+	g_object_unref (dir_monitor->file);
+	g_bytes_unref (dir_monitor->fsid);
+	g_bytes_unref (dir_monitor->key);
+
+	G_OBJECT_CLASS (tracker_fanotify_dir_monitor_parent_class)->finalize (object);
+}
+
+static void
+tracker_fanotify_dir_monitor_class_init (TrackerFanotifyDirMonitorClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	GFileMonitorClass *monitor_class = G_FILE_MONITOR_CLASS (klass);
+
+	object_class->finalize = tracker_fanotify_dir_monitor_finalize;
+	monitor_class->cancel = tracker_fanotify_dir_monitor_cancel;
+}
+
+static void
+tracker_fanotify_dir_monitor_init (TrackerFanotifyDirMonitor *dir_monitor)
+{
+}
+
+static void
+filesystem_data_free (FilesystemData *data)
+{
+	g_free (data->path);
+	g_slice_free (FilesystemData, data);
+}
+
+static GBytes *
+fsid_for_path (const gchar  *path,
+               GError      **error)
+{
+	struct statfs buf;
+
+	G_STATIC_ASSERT (sizeof (buf.f_fsid) == sizeof (__kernel_fsid_t));
+
+	if (statfs (path, &buf) != 0) {
+		gint saved_errno = errno;
+
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (saved_errno),
+		             "Could not stat filesystem: %s",
+		             g_strerror (saved_errno));
+		return NULL;
+	}
+
+	return g_bytes_new (&buf.f_fsid, sizeof (buf.f_fsid));
+}
+
+static GBytes *
+directory_key_new (gconstpointer             fsid,
+                   const struct file_handle *handle)
+{
+	GByteArray *array;
+
+	array = g_byte_array_sized_new (sizeof (__kernel_fsid_t) +
+	                                sizeof (handle->handle_type) +
+	                                handle->handle_bytes);
+	g_byte_array_append (array, fsid, sizeof (__kernel_fsid_t));
+	g_byte_array_append (array,
+	                     (const guint8 *) &handle->handle_type,
+	                     sizeof (handle->handle_type));
+	g_byte_array_append (array, handle->f_handle, handle->handle_bytes);
+
+	return g_byte_array_free_to_bytes (array);
+}
+
+static gint
+fanotify_mark_filesystem (TrackerMonitorFanotify *fanotify,
+                          guint                   flags,
+                          const gchar            *path)
+{
+	guint64 mask = FANOTIFY_EVENT_MASK;
+
+#ifdef FAN_RENAME
+	if (fanotify->use_rename) {
+		mask |= FAN_RENAME;
+	} else
+#endif /* FAN_RENAME */
+	{
+		mask |= FANOTIFY_MOVE_MASK;
+	}
+
+	return fanotify_mark (fanotify->fd,
+	                      flags | FAN_MARK_FILESYSTEM,
+	                      mask, AT_FDCWD, path);
+}
+
+static gboolean
+filesystem_acquire (TrackerMonitorFanotify  *fanotify,
+                    GBytes                  *fsid,
+                    const gchar             *path,
+                    GError                 **error)
+{
+	FilesystemData *data;
+	gint retval;
+
+	data = g_hash_table_lookup (fanotify->filesystems, fsid);
+
+	if (data) {
+		data->n_directories++;
+		return TRUE;
+	}
+
+	retval = fanotify_mark_filesystem (fanotify, FAN_MARK_ADD, path);
+
+	if (retval != 0 && errno == EINVAL && fanotify->use_rename) {
+		/* Kernel knows about fanotify directory entry
+		 * events, but not about FAN_RENAME, fall back to
+		 * separate MOVED_FROM/MOVED_TO events.
+		 */
+		fanotify->use_rename = FALSE;
+		retval = fanotify_mark_filesystem (fanotify, FAN_MARK_ADD, path);
+	}
+
+	if (retval != 0) {
+		gint saved_errno = errno;
+
+		if (saved_errno == EPERM) {
+			/* Filesystem marks need CAP_SYS_ADMIN, which
+			 * the probe in tracker_monitor_fanotify_new()
+			 * had, but may be dropped since.
+			 */
+			g_message ("fanotify filesystem marks are not permitted, "
+			           "using Inotify for all directories");
+			fanotify->denied = TRUE;
+		}
+
+		/* Typically ENODEV/EOPNOTSUPP/EXDEV for filesystems
+		 * not providing a fsid or exportable file handles.
+		 */
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (saved_errno),
+		             "Could not add fanotify mark: %s",
+		             g_strerror (saved_errno));
+		return FALSE;
+	}
+
+	g_debug ("Added fanotify filesystem mark through path:'%s'", path);
+
+	data = g_slice_new0 (FilesystemData);
+	data->path = g_strdup (path);
+	data->n_directories = 1;
+	g_hash_table_insert (fanotify->filesystems, g_bytes_ref (fsid), data);
+
+	return TRUE;
+}
+
+static void
+filesystem_release (TrackerMonitorFanotify *fanotify,
+                    GBytes                 *fsid)
+{
+	FilesystemData *data;
+	GBytes *current_fsid;
+
+	data = g_hash_table_lookup (fanotify->filesystems, fsid);
+
+	if (!data) {
+		return;
+	}
+
+	data->n_directories--;
+
+	if (data->n_directories > 0) {
+		return;
+	}
+
+	/* Marks go away together with the filesystem on unmount,
+	 * in that case the path may now point to the filesystem
+	 * underneath, which we may be monitoring for other
+	 * directories, so only remove the mark if the fsid still
+	 * matches.
+	 */
+	current_fsid = fsid_for_path (data->path, NULL);
+
+	if (current_fsid && g_bytes_equal (current_fsid, fsid)) {
+		g_debug ("Removing fanotify filesystem mark through path:'%s'",
+		         data->path);
+		fanotify_mark_filesystem (fanotify, FAN_MARK_REMOVE, data->path);
+	}
+
+	if (current_fsid) {
+		g_bytes_unref (current_fsid);
+	}
+
+	g_hash_table_remove (fanotify->filesystems, fsid);
+}
+
+static void
+fanotify_dir_monitor_detach (TrackerFanotifyDirMonitor *dir_monitor)
+{
+	TrackerMonitorFanotify *fanotify;
+
+	fanotify = dir_monitor->fanotify;
+
+	if (!fanotify) {
+		return;
+	}
+
+	/* A directory moved within the filesystem keeps its file
+	 * handle, TrackerMonitor adds the monitor for the new
+	 * location before removing the old one, so only drop the
+	 * handle mapping if it still points to this monitor.
+	 */
+	if (g_hash_table_lookup (fanotify->directories, dir_monitor->key) == dir_monitor) {
+		g_hash_table_remove (fanotify->directories, dir_monitor->key);
+	}
+
+	g_hash_table_remove (fanotify->monitors, dir_monitor);
+	filesystem_release (fanotify, dir_monitor->fsid);
+
+	if (fanotify->modified_dir_monitor == dir_monitor) {
+		fanotify->modified_dir_monitor = NULL;
+	}
+
+	dir_monitor->fanotify = NULL;
+}
+
+static void
+fanotify_dir_monitor_emit (TrackerFanotifyDirMonitor *dir_monitor,
+                           const gchar               *name,
+                           GFile                     *other_file,
+                           GFileMonitorEvent          event_type)
+{
+	GFile *child;
+
+	/* Events on the directory itself are reported as "." */
+	if (!name || strcmp (name, ".") == 0) {
+		child = g_object_ref (dir_monitor->file);
+	} else {
+		child = g_file_get_child (dir_monitor->file, name);
+	}
+
+	g_file_monitor_emit_event (G_FILE_MONITOR (dir_monitor),
+	                           child, other_file, event_type);
+	g_object_unref (child);
+}
+
+static TrackerFanotifyDirMonitor *
+fanotify_lookup_directory (TrackerMonitorFanotify                *fanotify,
+                           const struct fanotify_event_info_fid  *fid,
+                           const gchar                          **name)
+{
+	const struct file_handle *handle;
+	TrackerFanotifyDirMonitor *dir_monitor;
+	GBytes *key;
+
+	handle = (const struct file_handle *) fid->handle;
+	key = directory_key_new (&fid->fsid, handle);
+	dir_monitor = g_hash_table_lookup (fanotify->directories, key);
+	g_bytes_unref (key);
+
+	if (name) {
+		*name = (const gchar *) handle->f_handle + handle->handle_bytes;
+	}
+
+	return dir_monitor;
+}
+
+/* Returns whether CHANGED is to be reported for writes to @name,
+ * this is only the case for the first of a row of writes.
+ */
+static gboolean
+fanotify_coalesce_modify (TrackerMonitorFanotify    *fanotify,
+                          TrackerFanotifyDirMonitor *dir_monitor,
+                          const gchar               *name,
+                          guint64                    mask)
+{
+	if ((mask & FAN_MODIFY) == 0 || (mask & ~FAN_MODIFY) != 0) {
+		/* Anything else ends the row, writes merged
+		 * with the close are reported by the hint.
+		 */
+		g_free (fanotify->modified_name);
+		fanotify->modified_name = NULL;
+		fanotify->modified_dir_monitor = NULL;
+		return FALSE;
+	}
+
+	if (fanotify->modified_dir_monitor == dir_monitor &&
+	    g_strcmp0 (fanotify->modified_name, name) == 0) {
+		return FALSE;
+	}
+
+	g_free (fanotify->modified_name);
+	fanotify->modified_name = g_strdup (name);
+	fanotify->modified_dir_monitor = dir_monitor;
+
+	return TRUE;
+}
+
+static void
+fanotify_handle_event (TrackerMonitorFanotify               *fanotify,
+                       const struct fanotify_event_metadata *metadata)
+{
+	TrackerFanotifyDirMonitor *dir_monitor = NULL;
+	TrackerFanotifyDirMonitor *old_dir_monitor = NULL;
+	TrackerFanotifyDirMonitor *new_dir_monitor = NULL;
+	const gchar *name = NULL, *old_name = NULL, *new_name = NULL;
+	const gchar *ptr, *end;
+	gboolean deleted, created;
+
+	ptr = (const gchar *) metadata + metadata->metadata_len;
+	end = (const gchar *) metadata + metadata->event_len;
+
+	while (ptr + sizeof (struct fanotify_event_info_header) <= end) {
+		const struct fanotify_event_info_header *header;
+		const struct fanotify_event_info_fid *fid;
+
+		header = (const struct fanotify_event_info_header *) ptr;
+
+		if (header->len == 0 || ptr + header->len > end) {
+			break;
+		}
+
+		fid = (const struct fanotify_event_info_fid *) ptr;
+
+		switch (header->info_type) {
+		case FAN_EVENT_INFO_TYPE_DFID_NAME:
+			dir_monitor = fanotify_lookup_directory (fanotify, fid, &name);
+			break;
+		case FAN_EVENT_INFO_TYPE_DFID:
+		case FAN_EVENT_INFO_TYPE_FID:
+			dir_monitor = fanotify_lookup_directory (fanotify, fid, NULL);
+			break;
+#ifdef FAN_EVENT_INFO_TYPE_OLD_DFID_NAME
+		case FAN_EVENT_INFO_TYPE_OLD_DFID_NAME:
+			old_dir_monitor = fanotify_lookup_directory (fanotify, fid, &old_name);
+			break;
+		case FAN_EVENT_INFO_TYPE_NEW_DFID_NAME:
+			new_dir_monitor = fanotify_lookup_directory (fanotify, fid, &new_name);
+			break;
+#endif /* FAN_EVENT_INFO_TYPE_OLD_DFID_NAME */
+		default:
+			break;
+		}
+
+		ptr += header->len;
+	}
+
+#ifdef FAN_RENAME
+	if (metadata->mask & FAN_RENAME) {
+		if (old_dir_monitor && new_dir_monitor) {
+			GFile *other_file;
+
+			other_file = g_file_get_child (new_dir_monitor->file, new_name);
+			fanotify_dir_monitor_emit (old_dir_monitor, old_name, other_file,
+			                           G_FILE_MONITOR_EVENT_MOVED);
+			g_object_unref (other_file);
+		} else if (old_dir_monitor) {
+			/* Moved out of the monitored directories */
+			fanotify_dir_monitor_emit (old_dir_monitor, old_name, NULL,
+			                           G_FILE_MONITOR_EVENT_DELETED);
+		} else if (new_dir_monitor) {
+			/* Moved into the monitored directories */
+			fanotify_dir_monitor_emit (new_dir_monitor, new_name, NULL,
+			                           G_FILE_MONITOR_EVENT_CREATED);
+		}
+	}
+#endif /* FAN_RENAME */
+
+	if (!dir_monitor) {
+		/* Not an event on a monitored directory */
+		return;
+	}
+
+	created = (metadata->mask & (FAN_CREATE | FAN_MOVED_TO)) != 0;
+	deleted = (metadata->mask & (FAN_DELETE | FAN_MOVED_FROM)) != 0;
+
+	/* The kernel merges consecutive events on the same
+	 * directory entry, if the entry was both created and
+	 * deleted, check what the final state is.
+	 */
+	if (created && deleted) {
+		GFile *child;
+
+		child = g_file_get_child (dir_monitor->file, name);
+
+		if (g_file_query_exists (child, NULL)) {
+			fanotify_dir_monitor_emit (dir_monitor, name, NULL,
+			                           G_FILE_MONITOR_EVENT_DELETED);
+			deleted = FALSE;
+		} else {
+			created = FALSE;
+		}
+
+		g_object_unref (child);
+	}
+
+	if (created) {
+		fanotify_dir_monitor_emit (dir_monitor, name, NULL,
+		                           G_FILE_MONITOR_EVENT_CREATED);
+	}
+
+	if (fanotify_coalesce_modify (fanotify, dir_monitor, name, metadata->mask)) {
+		fanotify_dir_monitor_emit (dir_monitor, name, NULL,
+		                           G_FILE_MONITOR_EVENT_CHANGED);
+	}
+
+	if (metadata->mask & FAN_ATTRIB) {
+		fanotify_dir_monitor_emit (dir_monitor, name, NULL,
+		                           G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED);
+	}
+
+	if (metadata->mask & FAN_CLOSE_WRITE) {
+		fanotify_dir_monitor_emit (dir_monitor, name, NULL,
+		                           G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT);
+	}
+
+	if (deleted) {
+		fanotify_dir_monitor_emit (dir_monitor, name, NULL,
+		                           G_FILE_MONITOR_EVENT_DELETED);
+	}
+}
+
+static gboolean
+fanotify_read_cb (GIOChannel   *channel,
+                  GIOCondition  condition,
+                  gpointer      user_data)
+{
+	TrackerMonitorFanotify *fanotify;
+	guint64 buffer[FANOTIFY_BUFFER_SIZE / sizeof (guint64)];
+	struct fanotify_event_metadata *metadata;
+	gssize len;
+
+	fanotify = user_data;
+
+	if (condition & (G_IO_HUP | G_IO_ERR)) {
+		g_warning ("fanotify descriptor was closed, no more events will be received");
+		fanotify->watch_id = 0;
+		return FALSE;
+	}
+
+	while ((len = read (fanotify->fd, buffer, sizeof (buffer))) > 0) {
+		for (metadata = (struct fanotify_event_metadata *) buffer;
+		     FAN_EVENT_OK (metadata, len);
+		     metadata = FAN_EVENT_NEXT (metadata, len)) {
+			if (metadata->vers != FANOTIFY_METADATA_VERSION) {
+				g_warning ("Unexpected fanotify metadata version %d",
+				           metadata->vers);
+				continue;
+			}
+
+			if (metadata->fd >= 0) {
+				close (metadata->fd);
+			}
+
+			if (metadata->mask & FAN_Q_OVERFLOW) {
+				g_warning ("fanotify event queue overflowed, "
+				           "some changes may have been missed");
+				continue;
+			}
+
+			fanotify_handle_event (fanotify, metadata);
+		}
+	}
+
+	if (len < 0 && errno != EAGAIN && errno != EINTR) {
+		g_warning ("Could not read fanotify events: %s",
+		           g_strerror (errno));
+	}
+
+	return TRUE;
+}
+
+/* fanotify_init() is permitted to unprivileged processes since
+ * Linux 5.13, but filesystem marks still need CAP_SYS_ADMIN, try
+ * adding one so the backend isn't used just to fail on every
+ * directory.
+ */
+static gboolean
+fanotify_probe_filesystem_mark (gint fd)
+{
+	const gchar *path;
+
+	path = g_get_home_dir ();
+
+	if (fanotify_mark (fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+	                   FAN_CREATE, AT_FDCWD, path) == 0) {
+		fanotify_mark (fd, FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM,
+		               FAN_CREATE, AT_FDCWD, path);
+		return TRUE;
+	}
+
+	/* Other errors are specific to the filesystem of the
+	 * home directory, directories elsewhere may work.
+	 */
+	return errno != EPERM;
+}
+
+#endif /* HAVE_FANOTIFY */
+
+TrackerMonitorFanotify *
+tracker_monitor_fanotify_new (void)
+{
+#ifdef HAVE_FANOTIFY
+	TrackerMonitorFanotify *fanotify;
+	gint fd;
+
+	/* Filesystem marks need CAP_SYS_ADMIN, and directory entry
+	 * events with names need Linux >= 5.9, if any of these is
+	 * missing we just stay with per-directory monitors.
+	 */
+	fd = fanotify_init (FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK |
+	                    FAN_REPORT_DFID_NAME,
+	                    O_RDONLY | O_LARGEFILE);
+
+	if (fd < 0) {
+		g_debug ("fanotify is not available: %s", g_strerror (errno));
+		return NULL;
+	}
+
+	if (!fanotify_probe_filesystem_mark (fd)) {
+		g_debug ("fanotify filesystem marks are not permitted");
+		close (fd);
+		return NULL;
+	}
+
+	fanotify = g_slice_new0 (TrackerMonitorFanotify);
+	fanotify->fd = fd;
+#ifdef FAN_RENAME
+	fanotify->use_rename = TRUE;
+#endif /* FAN_RENAME */
+
+	fanotify->filesystems =
+		g_hash_table_new_full (g_bytes_hash,
+		                       g_bytes_equal,
+		                       (GDestroyNotify) g_bytes_unref,
+		                       (GDestroyNotify) filesystem_data_free);
+	fanotify->directories =
+		g_hash_table_new_full (g_bytes_hash,
+		                       g_bytes_equal,
+		                       (GDestroyNotify) g_bytes_unref,
+		                       NULL);
+	fanotify->monitors = g_hash_table_new (NULL, NULL);
+
+	fanotify->channel = g_io_channel_unix_new (fd);
+	fanotify->watch_id = g_io_add_watch (fanotify->channel,
+	                                     G_IO_IN | G_IO_HUP | G_IO_ERR,
+	                                     fanotify_read_cb,
+	                                     fanotify);
+
+	return fanotify;
+#else  /* HAVE_FANOTIFY */
+	return NULL;
+#endif /* HAVE_FANOTIFY */
+}
+
+void
+tracker_monitor_fanotify_free (TrackerMonitorFanotify *fanotify)
+{
+#ifdef HAVE_FANOTIFY
+	GHashTableIter iter;
+	gpointer key;
+
+	g_return_if_fail (fanotify != NULL);
+
+	/* Monitors still alive just stop receiving events */
+	g_hash_table_iter_init (&iter, fanotify->monitors);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		TRACKER_FANOTIFY_DIR_MONITOR (key)->fanotify = NULL;
+	}
+
+	if (fanotify->watch_id) {
+		g_source_remove (fanotify->watch_id);
+	}
+
+	g_io_channel_unref (fanotify->channel);
+	close (fanotify->fd);
+
+	g_hash_table_unref (fanotify->monitors);
+	g_hash_table_unref (fanotify->directories);
+	g_hash_table_unref (fanotify->filesystems);
+	g_free (fanotify->modified_name);
+
+	g_slice_free (TrackerMonitorFanotify, fanotify);
+#endif /* HAVE_FANOTIFY */
+}
+
+GFileMonitor *
+tracker_monitor_fanotify_monitor_directory (TrackerMonitorFanotify  *fanotify,
+                                            GFile                   *file,
+                                            GError                 **error)
+{
+#ifdef HAVE_FANOTIFY
+	TrackerFanotifyDirMonitor *dir_monitor;
+	struct file_handle *handle;
+	GBytes *fsid, *key;
+	gchar *path;
+	gint mount_id;
+
+	g_return_val_if_fail (fanotify != NULL, NULL);
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	if (fanotify->denied) {
+		g_set_error_literal (error,
+		                     G_IO_ERROR,
+		                     G_IO_ERROR_PERMISSION_DENIED,
+		                     "fanotify filesystem marks are not permitted");
+		return NULL;
+	}
+
+	path = g_file_get_path (file);
+
+	if (!path) {
+		g_set_error_literal (error,
+		                     G_IO_ERROR,
+		                     G_IO_ERROR_NOT_SUPPORTED,
+		                     "File has no local path");
+		return NULL;
+	}
+
+	fsid = fsid_for_path (path, error);
+
+	if (!fsid) {
+		g_free (path);
+		return NULL;
+	}
+
+	handle = g_malloc0 (sizeof (struct file_handle) + MAX_HANDLE_SZ);
+	handle->handle_bytes = MAX_HANDLE_SZ;
+
+	if (name_to_handle_at (AT_FDCWD, path, handle, &mount_id, 0) != 0) {
+		gint saved_errno = errno;
+
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (saved_errno),
+		             "Could not get file handle: %s",
+		             g_strerror (saved_errno));
+		g_bytes_unref (fsid);
+		g_free (handle);
+		g_free (path);
+		return NULL;
+	}
+
+	if (!filesystem_acquire (fanotify, fsid, path, error)) {
+		g_bytes_unref (fsid);
+		g_free (handle);
+		g_free (path);
+		return NULL;
+	}
+
+	key = directory_key_new (g_bytes_get_data (fsid, NULL), handle);
+
+	dir_monitor = g_object_new (TRACKER_TYPE_FANOTIFY_DIR_MONITOR, NULL);
+	dir_monitor->fanotify = fanotify;
+	dir_monitor->file = g_object_ref (file);
+	dir_monitor->fsid = fsid;
+	dir_monitor->key = key;
+
+	g_hash_table_replace (fanotify->directories, g_bytes_ref (key), dir_monitor);
+	g_hash_table_insert (fanotify->monitors, dir_monitor, dir_monitor);
+
+	g_free (handle);
+	g_free (path);
+
+	return G_FILE_MONITOR (dir_monitor);
+#else  /* HAVE_FANOTIFY */
+	g_set_error_literal (error,
+	                     G_IO_ERROR,
+	                     G_IO_ERROR_NOT_SUPPORTED,
+	                     "fanotify support was not compiled in");
+	return NULL;
+#endif /* HAVE_FANOTIFY */
+}
+
+guint
+tracker_monitor_fanotify_get_n_directories (TrackerMonitorFanotify *fanotify)
+{
+#ifdef HAVE_FANOTIFY
+	g_return_val_if_fail (fanotify != NULL, 0);
+
+	return g_hash_table_size (fanotify->monitors);
+#else  /* HAVE_FANOTIFY */
+	return 0;
+#endif /* HAVE_FANOTIFY */
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_MINER_MONITOR_FANOTIFY_H__
+#define __LIBTRACKER_MINER_MONITOR_FANOTIFY_H__
+
+#if !defined (__LIBTRACKER_MINER_H_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "Only <libtracker-miner/tracker-miner.h> can be included directly."
+#endif
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Whole-filesystem monitoring backend. A single fanotify descriptor
+ * receives the events for every filesystem holding a monitored
+ * directory, those are mapped back to the per-directory GFileMonitor
+ * through the kernel file handle of the parent directory, so the
+ * GFileMonitor::changed signal is emitted just like with the
+ * inotify based monitors.
+ */
+typedef struct _TrackerMonitorFanotify TrackerMonitorFanotify;
+
+TrackerMonitorFanotify * tracker_monitor_fanotify_new               (void);
+void                     tracker_monitor_fanotify_free              (TrackerMonitorFanotify  *fanotify);
+
+GFileMonitor *           tracker_monitor_fanotify_monitor_directory (TrackerMonitorFanotify  *fanotify,
+                                                                     GFile                   *file,
+                                                                     GError                 **error);
+
+guint                    tracker_monitor_fanotify_get_n_directories (TrackerMonitorFanotify  *fanotify);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_MINER_MONITOR_FANOTIFY_H__ */
@@ -31,6 +31,7 @@
 #endif
 
 #include "tracker-monitor.h"
+#include "tracker-monitor-fanotify.h"
 #include "tracker-marshal.h"
 
 #define TRACKER_MONITOR_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TRACKER_TYPE_MONITOR, TrackerMonitorPrivate))
@@ -64,6 +65,65 @@
  */
 #undef  PAUSE_ON_IO
 
+/* Maximum number of events kept in the cache waiting to be paired
+ * or expired. If an event burst goes beyond that, the oldest events
+ * are notified right away to make room for the new ones.
+ */
+#define MAX_CACHED_EVENTS      4096
+
+/* If a directory receives more than this number of file events
+ * within EVENT_WINDOW_SECONDS, further events there are no longer
+ * notified one by one, a single DIRECTORY_CONTENTS_CHANGED is
+ * emitted instead once the directory gets quiet, so the upper
+ * layers can recrawl it.
+ */
+#define DIRECTORY_EVENTS_THRESHOLD 100
+#define EVENT_WINDOW_SECONDS   2
+
+/* Maximum time a busy directory may hold back its notification */
+#define DIRECTORY_EVENTS_MAX_SECONDS 30
+
+typedef struct _EventData EventData;
+
+/* All expirable events in pre_update/pre_delete, in the order
+ * they will expire. Slots of events that were removed from the
+ * caches meanwhile are left NULL, these holes are included in
+ * len until they are reclaimed.
+ */
+typedef struct {
+	EventData **slots;
+	guint       head;
+	guint       len;
+	guint       n_holes;
+} EventRing;
+
+struct _EventData {
+	GFile    *file;
+	gchar    *file_uri;
+	GFile    *other_file;
+	gchar    *other_file_uri;
+	gboolean  is_directory;
+	GTimeVal  start_time;
+	guint32   event_type;
+	gboolean  expirable;
+
+	/* Set while the event is cached, expirable events are
+	 * in the ring and the other ones in the held queue.
+	 */
+	GHashTable *cache;
+	EventRing  *ring;
+	guint       ring_slot;
+	GQueue     *held;
+	GList      *held_link;
+};
+
+typedef struct {
+	guint     n_events;
+	GTimeVal  start_time;
+	GTimeVal  last_time;
+	gboolean  saturated;
+} DirectoryEvents;
+
 struct TrackerMonitorPrivate {
 	GHashTable    *monitors;
 
@@ -71,6 +131,11 @@ struct TrackerMonitorPrivate {
 
 	GType          monitor_backend;
 
+	/* If available, used instead of one inotify
+	 * watch per directory, see directory_monitor_new()
+	 */
+	TrackerMonitorFanotify *fanotify;
+
 	guint          monitor_limit;
 	gboolean       monitor_limit_warned;
 	guint          monitors_ignored;
@@ -89,26 +154,29 @@ struct TrackerMonitorPrivate {
 	GHashTable    *pre_delete;
 	guint          event_pairs_timeout_id;
 
+	EventRing      event_ring;
+
+	/* Events waiting for a CHANGES_DONE_HINT before they can
+	 * expire, oldest first. They still count towards
+	 * MAX_CACHED_EVENTS.
+	 */
+	GQueue        *held_events;
+
+	/* GFile -> DirectoryEvents, for the parent
+	 * directories of recent file events.
+	 */
+	GHashTable    *directory_events;
+
 	TrackerIndexingTree *tree;
 };
 
-typedef struct {
-	GFile    *file;
-	gchar    *file_uri;
-	GFile    *other_file;
-	gchar    *other_file_uri;
-	gboolean  is_directory;
-	GTimeVal  start_time;
-	guint32   event_type;
-	gboolean  expirable;
-} EventData;
-
 enum {
 	ITEM_CREATED,
 	ITEM_UPDATED,
 	ITEM_ATTRIBUTE_UPDATED,
 	ITEM_DELETED,
 	ITEM_MOVED,
+	DIRECTORY_CONTENTS_CHANGED,
 	LAST_SIGNAL
 };
 
@@ -134,6 +202,7 @@ static void           directory_monitor_cancel     (GFileMonitor     *dir_monito
 
 
 static void           event_data_free              (gpointer        data);
+static void           directory_events_free        (gpointer        data);
 static void           emit_signal_for_event        (TrackerMonitor *monitor,
                                                     EventData      *event_data);
 static gboolean       monitor_cancel_recursively   (TrackerMonitor *monitor,
@@ -211,6 +280,16 @@ tracker_monitor_class_init (TrackerMonitorClass *klass)
 		              G_TYPE_OBJECT,
 		              G_TYPE_BOOLEAN,
 		              G_TYPE_BOOLEAN);
+	signals[DIRECTORY_CONTENTS_CHANGED] =
+		g_signal_new ("directory-contents-changed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__OBJECT,
+		              G_TYPE_NONE,
+		              1,
+		              G_TYPE_OBJECT);
 
 	g_object_class_install_property (object_class,
 	                                 PROP_ENABLED,
@@ -257,6 +336,14 @@ tracker_monitor_init (TrackerMonitor *object)
 		                       (GDestroyNotify) g_object_unref,
 		                       event_data_free);
 
+	priv->event_ring.slots = g_new0 (EventData *, MAX_CACHED_EVENTS);
+	priv->held_events = g_queue_new ();
+	priv->directory_events =
+		g_hash_table_new_full (g_file_hash,
+		                       (GEqualFunc) g_file_equal,
+		                       (GDestroyNotify) g_object_unref,
+		                       directory_events_free);
+
 	/* For the first monitor we get the type and find out if we
 	 * are using inotify, FAM, polling, etc.
 	 */
@@ -283,8 +370,17 @@ tracker_monitor_init (TrackerMonitor *object)
 
 		/* Set limits based on backend... */
 		if (strcmp (name, "GInotifyDirectoryMonitor") == 0) {
-			/* Using inotify */
-			g_message ("Monitor backend is Inotify");
+			/* Using inotify, try first to get whole
+			 * filesystem events through fanotify.
+			 */
+			priv->fanotify = tracker_monitor_fanotify_new ();
+
+			if (priv->fanotify) {
+				g_message ("Monitor backend is fanotify, "
+				           "Inotify for unsupported filesystems");
+			} else {
+				g_message ("Monitor backend is Inotify");
+			}
 
 			/* Setting limit based on kernel
 			 * settings in /proc...
@@ -369,10 +465,20 @@ tracker_monitor_finalize (GObject *object)
 		g_source_remove (priv->event_pairs_timeout_id);
 	}
 
+	/* Cached events point back to their ring slot or held
+	 * queue, so these must be freed after the caches.
+	 */
 	g_hash_table_unref (priv->pre_update);
 	g_hash_table_unref (priv->pre_delete);
+	g_free (priv->event_ring.slots);
+	g_queue_free (priv->held_events);
+	g_hash_table_unref (priv->directory_events);
 	g_hash_table_unref (priv->monitors);
 
+	if (priv->fanotify) {
+		tracker_monitor_fanotify_free (priv->fanotify);
+	}
+
 	G_OBJECT_CLASS (tracker_monitor_parent_class)->finalize (object);
 }
 
@@ -530,12 +636,30 @@ event_data_new (GFile    *file,
 	return event;
 }
 
+static void
+event_data_unlink (EventData *event)
+{
+	if (event->ring) {
+		/* Leave a hole in the ring, it is reclaimed
+		 * when reached or when the ring is full.
+		 */
+		event->ring->slots[event->ring_slot] = NULL;
+		event->ring->n_holes++;
+		event->ring = NULL;
+	} else if (event->held) {
+		g_queue_delete_link (event->held, event->held_link);
+		event->held = NULL;
+		event->held_link = NULL;
+	}
+}
+
 static void
 event_data_free (gpointer data)
 {
 	EventData *event;
 
 	event = data;
+	event_data_unlink (event);
 
 	g_object_unref (event->file);
 	g_free (event->file_uri);
@@ -779,48 +903,247 @@ emit_signal_for_event (TrackerMonitor *monitor,
 }
 
 static void
-event_pairs_process_in_ht (TrackerMonitor *monitor,
-                           GHashTable     *ht,
-                           GTimeVal       *now)
+event_cache_steal (EventData *event_data)
 {
-	GHashTableIter iter;
-	gpointer key, value;
+	gpointer key;
+
+	/* Take the event out of its cache, without
+	 * calling the value destroy function.
+	 */
+	if (g_hash_table_lookup_extended (event_data->cache,
+	                                  event_data->file,
+	                                  &key, NULL)) {
+		g_hash_table_steal (event_data->cache, event_data->file);
+		g_object_unref (key);
+	}
+
+	event_data->cache = NULL;
+}
+
+static EventData *
+event_ring_pop (TrackerMonitor *monitor)
+{
+	EventRing *ring;
+	EventData *event_data;
+
+	ring = &monitor->priv->event_ring;
+
+	event_data = ring->slots[ring->head];
+	ring->slots[ring->head] = NULL;
+	ring->head = (ring->head + 1) % MAX_CACHED_EVENTS;
+	ring->len--;
+
+	if (event_data) {
+		event_data->ring = NULL;
+	} else {
+		ring->n_holes--;
+	}
+
+	return event_data;
+}
+
+static void
+event_ring_compact (TrackerMonitor *monitor)
+{
+	EventRing *ring;
+	guint i, n_events = 0;
+
+	ring = &monitor->priv->event_ring;
+
+	/* Move all events towards the head, keeping their order */
+	for (i = 0; i < ring->len; i++) {
+		EventData *event_data;
+		guint slot;
+
+		slot = (ring->head + i) % MAX_CACHED_EVENTS;
+		event_data = ring->slots[slot];
+
+		if (!event_data) {
+			continue;
+		}
+
+		ring->slots[slot] = NULL;
+		slot = (ring->head + n_events) % MAX_CACHED_EVENTS;
+		ring->slots[slot] = event_data;
+		event_data->ring_slot = slot;
+		n_events++;
+	}
+
+	ring->len = n_events;
+	ring->n_holes = 0;
+}
+
+static void
+event_cache_flush_oldest (TrackerMonitor *monitor)
+{
+	EventData *event_data;
+
+	/* Expirable events go first, held ones are
+	 * only flushed if there is nothing else.
+	 */
+	if (monitor->priv->event_ring.len > 0) {
+		event_data = event_ring_pop (monitor);
+	} else {
+		event_data = g_queue_peek_head (monitor->priv->held_events);
+		event_data_unlink (event_data);
+	}
+
+	/* The cache is full, notify the oldest event
+	 * without waiting for it to expire.
+	 */
+	g_debug ("Too many cached events, flushing '%s' for URI '%s'",
+	         monitor_event_to_string (event_data->event_type),
+	         event_data->file_uri);
+
+	event_cache_steal (event_data);
+	emit_signal_for_event (monitor, event_data);
+	event_data_free (event_data);
+}
+
+static void
+event_cache_make_room (TrackerMonitor *monitor)
+{
+	TrackerMonitorPrivate *priv;
+	EventRing *ring;
+
+	priv = monitor->priv;
+	ring = &priv->event_ring;
+
+	while (ring->len + g_queue_get_length (priv->held_events) >= MAX_CACHED_EVENTS) {
+		if (ring->len > 0 && !ring->slots[ring->head]) {
+			/* Holes at the head are reclaimed right away */
+			event_ring_pop (monitor);
+		} else if (ring->n_holes > 0) {
+			/* Other holes need moving the events after them,
+			 * this only happens with a full cache.
+			 */
+			event_ring_compact (monitor);
+		} else {
+			event_cache_flush_oldest (monitor);
+		}
+	}
+}
+
+static void
+event_data_link (TrackerMonitor *monitor,
+                 EventData      *event_data)
+{
+	TrackerMonitorPrivate *priv;
+	EventRing *ring;
+
+	priv = monitor->priv;
+	ring = &priv->event_ring;
+
+	event_cache_make_room (monitor);
+
+	if (!event_data->expirable) {
+		/* Kept out of the ring, so the expiration
+		 * timeout doesn't need to look at it.
+		 */
+		g_queue_push_tail (priv->held_events, event_data);
+		event_data->held = priv->held_events;
+		event_data->held_link = g_queue_peek_tail_link (priv->held_events);
+		return;
+	}
+
+	event_data->ring_slot = (ring->head + ring->len) % MAX_CACHED_EVENTS;
+	event_data->ring = ring;
+	ring->slots[event_data->ring_slot] = event_data;
+	ring->len++;
+}
+
+static void
+event_cache_insert (TrackerMonitor *monitor,
+                    GHashTable     *cache,
+                    GFile          *file,
+                    EventData      *event_data)
+{
+	event_data_link (monitor, event_data);
+	event_data->cache = cache;
+
+	/* Any previous event for the file is freed here */
+	g_hash_table_replace (cache, g_object_ref (file), event_data);
+}
+
+static void
+event_data_touch (TrackerMonitor *monitor,
+                  EventData      *event_data)
+{
+	g_get_current_time (&event_data->start_time);
+
+	/* Move to the tail, so the ring stays sorted by expiration time */
+	event_data_unlink (event_data);
+	event_data_link (monitor, event_data);
+}
+
+#ifdef GIO_ALWAYS_SENDS_CHANGES_DONE_HINT_AFTER_CREATED
+static void
+event_data_hold (TrackerMonitor *monitor,
+                 EventData      *event_data)
+{
+	if (!event_data->expirable) {
+		return;
+	}
+
+	event_data->expirable = FALSE;
+	event_data_unlink (event_data);
+	event_data_link (monitor, event_data);
+}
+#endif /* GIO_ALWAYS_SENDS_CHANGES_DONE_HINT_AFTER_CREATED */
+
+static void
+event_ring_process (TrackerMonitor *monitor,
+                    GTimeVal       *now)
+{
+	EventRing *ring;
 	GList *expired_events = NULL;
 	GList *l;
 
-	/* Start iterating the HT of events, and see if any of them was expired.
-	 * If so, STEAL the item from the HT, add it in an auxiliary list, and
-	 * once the whole HT has been iterated, emit the signals for the stolen
-	 * items. If the signal is emitted WHILE iterating the HT, we may end up
-	 * with some upper layer action modifying the HT we are iterating, and
-	 * that is not good. */
-	g_hash_table_iter_init (&iter, ht);
-	while (g_hash_table_iter_next (&iter, &key, &value)) {
-		EventData *event_data = value;
+	ring = &monitor->priv->event_ring;
+
+	/* Look at the head of the ring (i.e. the oldest events) and see
+	 * if any of them expired. If so, STEAL the item from its HT, add
+	 * it in an auxiliary list, and once done, emit the signals for the
+	 * stolen items. If the signal is emitted WHILE looking at the
+	 * cache, we may end up with some upper layer action modifying it,
+	 * and that is not good.
+	 *
+	 * Non expirable events are in the held queue instead, so they
+	 * are not looked at here.
+	 */
+	while (ring->len > 0) {
+		EventData *event_data;
 		glong seconds;
 
-		/* If event is not yet expirable, keep it */
-		if (!event_data->expirable)
+		event_data = ring->slots[ring->head];
+
+		if (!event_data) {
+			/* Removed from the cache meanwhile */
+			event_ring_pop (monitor);
 			continue;
+		}
 
-		/* If event is expirable, but didn't expire yet, keep it */
+		/* If event didn't expire yet, neither
+		 * did any of the ones after it.
+		 */
 		seconds = now->tv_sec - event_data->start_time.tv_sec;
-		if (seconds < 2)
-			continue;
+		if (seconds < EVENT_WINDOW_SECONDS)
+			break;
 
 		g_debug ("Event '%s' for URI '%s' has timed out (%ld seconds have elapsed)",
 		         monitor_event_to_string (event_data->event_type),
 		         event_data->file_uri,
 		         seconds);
-		/* STEAL the item from the HT, so that disposal methods
-		 * for key and value are not called. */
-		g_hash_table_iter_steal (&iter);
-		/* Unref the key, as no longer needed */
-		g_object_unref (key);
+
+		event_ring_pop (monitor);
+		event_cache_steal (event_data);
+
 		/* Add the expired event to our temp list */
-		expired_events = g_list_append (expired_events, event_data);
+		expired_events = g_list_prepend (expired_events, event_data);
 	}
 
+	expired_events = g_list_reverse (expired_events);
+
 	for (l = expired_events; l; l = g_list_next (l)) {
 		/* Emit signal for the expired event */
 		emit_signal_for_event (monitor, l->data);
@@ -830,6 +1153,167 @@ event_pairs_process_in_ht (TrackerMonitor *monitor,
 	g_list_free (expired_events);
 }
 
+static void
+directory_events_free (gpointer data)
+{
+	g_slice_free (DirectoryEvents, data);
+}
+
+static void
+event_cache_remove_children (TrackerMonitor *monitor,
+                             GFile          *dir)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init (&iter, monitor->priv->pre_update);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		EventData *event_data = value;
+
+		if (!event_data->is_directory &&
+		    g_file_has_parent (key, dir)) {
+			g_hash_table_iter_remove (&iter);
+		}
+	}
+}
+
+/* Accounts a file event in its parent directory, returns
+ * TRUE if the event must not be handled on its own because
+ * the whole directory will be notified as changed.
+ */
+static gboolean
+directory_events_account (TrackerMonitor    *monitor,
+                          GFile             *file,
+                          GFileMonitorEvent  event_type)
+{
+	DirectoryEvents *data;
+	GFile *parent;
+	GTimeVal now;
+	gchar *uri;
+
+	if (event_type == G_FILE_MONITOR_EVENT_MOVED ||
+	    event_type == G_FILE_MONITOR_EVENT_PRE_UNMOUNT ||
+	    event_type == G_FILE_MONITOR_EVENT_UNMOUNTED) {
+		return FALSE;
+	}
+
+	/* Files with pending events are not accounted,
+	 * so a single busy file doesn't trigger this.
+	 */
+	if (g_hash_table_lookup (monitor->priv->pre_update, file)) {
+		return FALSE;
+	}
+
+	parent = g_file_get_parent (file);
+
+	if (!parent) {
+		return FALSE;
+	}
+
+	g_get_current_time (&now);
+	data = g_hash_table_lookup (monitor->priv->directory_events, parent);
+
+	if (!data) {
+		data = g_slice_new0 (DirectoryEvents);
+		data->start_time = now;
+		g_hash_table_insert (monitor->priv->directory_events,
+		                     g_object_ref (parent), data);
+	}
+
+	data->n_events++;
+	data->last_time = now;
+
+	if (data->saturated) {
+		g_object_unref (parent);
+		return TRUE;
+	}
+
+	if (data->n_events <= DIRECTORY_EVENTS_THRESHOLD) {
+		g_object_unref (parent);
+		return FALSE;
+	}
+
+	uri = g_file_get_uri (parent);
+	g_debug ("More than %d events in '%s', collapsing them "
+	         "into a single DIRECTORY_CONTENTS_CHANGED",
+	         DIRECTORY_EVENTS_THRESHOLD, uri);
+	g_free (uri);
+
+	/* The pending events for the directory
+	 * contents are covered by the recrawl too.
+	 */
+	data->saturated = TRUE;
+	event_cache_remove_children (monitor, parent);
+	g_object_unref (parent);
+
+	return TRUE;
+}
+
+static void
+directory_events_process (TrackerMonitor *monitor,
+                          GTimeVal       *now)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	GList *changed_dirs = NULL;
+	GList *l;
+
+	g_hash_table_iter_init (&iter, monitor->priv->directory_events);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		DirectoryEvents *data = value;
+
+		if (!data->saturated) {
+			/* Start over counting on every window */
+			if (now->tv_sec - data->start_time.tv_sec >= EVENT_WINDOW_SECONDS) {
+				g_hash_table_iter_remove (&iter);
+			}
+
+			continue;
+		}
+
+		/* Wait for the directory to get quiet, unless
+		 * it's been busy for too long already.
+		 */
+		if (now->tv_sec - data->last_time.tv_sec < EVENT_WINDOW_SECONDS &&
+		    now->tv_sec - data->start_time.tv_sec < DIRECTORY_EVENTS_MAX_SECONDS) {
+			continue;
+		}
+
+		changed_dirs = g_list_prepend (changed_dirs, g_object_ref (key));
+		g_hash_table_iter_remove (&iter);
+	}
+
+	for (l = changed_dirs; l; l = l->next) {
+		GFile *dir = l->data;
+		gchar *uri;
+
+		/* The directory itself might be gone meanwhile,
+		 * in which case it was already notified.
+		 */
+		if (g_file_query_exists (dir, NULL)) {
+			uri = g_file_get_uri (dir);
+			g_debug ("Emitting DIRECTORY_CONTENTS_CHANGED for '%s'", uri);
+			g_free (uri);
+
+			g_signal_emit (monitor,
+			               signals[DIRECTORY_CONTENTS_CHANGED], 0,
+			               dir);
+		}
+
+		g_object_unref (dir);
+	}
+
+	g_list_free (changed_dirs);
+}
+
+static gboolean
+event_pairs_pending (TrackerMonitor *monitor)
+{
+	return (g_hash_table_size (monitor->priv->pre_update) > 0 ||
+	        g_hash_table_size (monitor->priv->pre_delete) > 0 ||
+	        g_hash_table_size (monitor->priv->directory_events) > 0);
+}
+
 static gboolean
 event_pairs_timeout_cb (gpointer user_data)
 {
@@ -839,14 +1323,13 @@ event_pairs_timeout_cb (gpointer user_data)
 	monitor = user_data;
 	g_get_current_time (&now);
 
-	/* Process PRE-UPDATE hash table */
-	event_pairs_process_in_ht (monitor, monitor->priv->pre_update, &now);
+	/* Process PRE-UPDATE and PRE-DELETE events */
+	event_ring_process (monitor, &now);
 
-	/* Process PRE-DELETE hash table */
-	event_pairs_process_in_ht (monitor, monitor->priv->pre_delete, &now);
+	/* Process busy directories */
+	directory_events_process (monitor, &now);
 
-	if (g_hash_table_size (monitor->priv->pre_update) > 0 ||
-	    g_hash_table_size (monitor->priv->pre_delete) > 0) {
+	if (event_pairs_pending (monitor)) {
 		return TRUE;
 	}
 
@@ -878,9 +1361,7 @@ monitor_event_file_created (TrackerMonitor *monitor,
 	new_event->expirable = FALSE;
 #endif /* GIO_ALWAYS_SENDS_CHANGES_DONE_HINT_AFTER_CREATED */
 
-	g_hash_table_replace (monitor->priv->pre_update,
-	                      g_object_ref (file),
-	                      new_event);
+	event_cache_insert (monitor, monitor->priv->pre_update, file, new_event);
 }
 
 static void
@@ -907,7 +1388,7 @@ monitor_event_file_changed (TrackerMonitor *monitor,
 				/* If we got a CHANGED event before the CREATED was expired,
 				 * set the CREATED as not expirable, as we expect a CHANGES_DONE_HINT
 				 * afterwards. */
-				previous_update_event_data->expirable = FALSE;
+				event_data_hold (monitor, previous_update_event_data);
 #endif /* GIO_ALWAYS_SENDS_CHANGES_DONE_HINT_AFTER_CREATED */
 			}
 		}
@@ -919,26 +1400,26 @@ monitor_event_file_changed (TrackerMonitor *monitor,
 
 	if (!previous_update_event_data) {
 		/* If no previous one, insert it */
-		g_hash_table_insert (monitor->priv->pre_update,
-		                     g_object_ref (file),
-		                     event_data_new (file,
-		                                     NULL,
-		                                     FALSE,
-		                                     G_FILE_MONITOR_EVENT_CHANGED));
+		event_cache_insert (monitor, monitor->priv->pre_update,
+		                    file,
+		                    event_data_new (file,
+		                                    NULL,
+		                                    FALSE,
+		                                    G_FILE_MONITOR_EVENT_CHANGED));
 		return;
 	}
 
 	if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) {
 		/* Replace the previous ATTRIBUTE_CHANGED event with a CHANGED one. */
-		g_hash_table_replace (monitor->priv->pre_update,
-		                      g_object_ref (file),
-		                      event_data_new (file,
-		                                      NULL,
-		                                      FALSE,
-		                                      G_FILE_MONITOR_EVENT_CHANGED));
+		event_cache_insert (monitor, monitor->priv->pre_update,
+		                    file,
+		                    event_data_new (file,
+		                                    NULL,
+		                                    FALSE,
+		                                    G_FILE_MONITOR_EVENT_CHANGED));
 	} else {
 		/* Update the start_time of the previous one */
-		g_get_current_time (&(previous_update_event_data->start_time));
+		event_data_touch (monitor, previous_update_event_data);
 	}
 }
 
@@ -952,19 +1433,19 @@ monitor_event_file_attribute_changed (TrackerMonitor *monitor,
 	previous_update_event_data = g_hash_table_lookup (monitor->priv->pre_update, file);
 	if (!previous_update_event_data) {
 		/* If no previous one, insert it */
-		g_hash_table_insert (monitor->priv->pre_update,
-		                     g_object_ref (file),
-		                     event_data_new (file,
-		                                     NULL,
-		                                     FALSE,
-		                                     G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED));
+		event_cache_insert (monitor, monitor->priv->pre_update,
+		                    file,
+		                    event_data_new (file,
+		                                    NULL,
+		                                    FALSE,
+		                                    G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED));
 		return;
 	}
 
 	if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) {
 		/* Update the start_time of the previous one, if it is an ATTRIBUTE_CHANGED
 		 * event. */
-		g_get_current_time (&(previous_update_event_data->start_time));
+		event_data_touch (monitor, previous_update_event_data);
 
 		/* No need to update event time in CREATED, as these events
 		 * only expire when there is a CHANGES_DONE_HINT.
@@ -982,18 +1463,18 @@ monitor_event_file_changes_done (TrackerMonitor *monitor,
 	previous_update_event_data = g_hash_table_lookup (monitor->priv->pre_update, file);
 	if (!previous_update_event_data) {
 		/* Insert new update item in cache */
-		g_hash_table_insert (monitor->priv->pre_update,
-		                     g_object_ref (file),
-		                     event_data_new (file,
-		                                     NULL,
-		                                     FALSE,
-		                                     G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
+		event_cache_insert (monitor, monitor->priv->pre_update,
+		                    file,
+		                    event_data_new (file,
+		                                    NULL,
+		                                    FALSE,
+		                                    G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
 		return;
 	}
 
-	/* Refresh event timer, and make sure the event is now set as expirable */
-	g_get_current_time (&(previous_update_event_data->start_time));
+	/* Make sure the event is now set as expirable, and refresh event timer */
 	previous_update_event_data->expirable = TRUE;
+	event_data_touch (monitor, previous_update_event_data);
 }
 
 static void
@@ -1076,12 +1557,12 @@ monitor_event_file_moved (TrackerMonitor *monitor,
 			 * miners' eyes.
 			 */
 			g_hash_table_remove (monitor->priv->pre_update, src_file);
-			g_hash_table_replace (monitor->priv->pre_update,
-			                      g_object_ref (dst_file),
-			                      event_data_new (dst_file,
-			                                      NULL,
-			                                      FALSE,
-			                                      G_FILE_MONITOR_EVENT_CHANGED));
+			event_cache_insert (monitor, monitor->priv->pre_update,
+			                    dst_file,
+			                    event_data_new (dst_file,
+			                                    NULL,
+			                                    FALSE,
+			                                    G_FILE_MONITOR_EVENT_CHANGED));
 
 			/* Do not notify the moved event now */
 			return;
@@ -1091,12 +1572,12 @@ monitor_event_file_moved (TrackerMonitor *monitor,
 		 *   (c) ATTR_UPDATED(A) + MOVED(A->B)  = MOVED(A->B) + UPDATED(B)
 		 *
 		 * We setup here the UPDATED(B) event, added to the cache */
-		g_hash_table_replace (monitor->priv->pre_update,
-		                      g_object_ref (dst_file),
-		                      event_data_new (dst_file,
-		                                      NULL,
-		                                      FALSE,
-		                                      G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
+		event_cache_insert (monitor, monitor->priv->pre_update,
+		                    dst_file,
+		                    event_data_new (dst_file,
+		                                    NULL,
+		                                    FALSE,
+		                                    G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
 		/* Remove previous event */
 		g_hash_table_remove (monitor->priv->pre_update, src_file);
 
@@ -1127,12 +1608,12 @@ monitor_event_directory_created_or_changed (TrackerMonitor    *monitor,
 	}
 
 	if (!g_hash_table_lookup (monitor->priv->pre_update, dir)) {
-		g_hash_table_insert (monitor->priv->pre_update,
-		                     g_object_ref (dir),
-		                     event_data_new (dir,
-		                                     NULL,
-		                                     TRUE,
-		                                     event_type));
+		event_cache_insert (monitor, monitor->priv->pre_update,
+		                    dir,
+		                    event_data_new (dir,
+		                                    NULL,
+		                                    TRUE,
+		                                    event_type));
 	}
 }
 
@@ -1164,12 +1645,12 @@ monitor_event_directory_deleted (TrackerMonitor *monitor,
 	}
 
 	/* If no previous, add to HT */
-	g_hash_table_replace (monitor->priv->pre_delete,
-	                      g_object_ref (dir),
-	                      event_data_new (dir,
-	                                      NULL,
-	                                      TRUE,
-	                                      G_FILE_MONITOR_EVENT_DELETED));
+	event_cache_insert (monitor, monitor->priv->pre_delete,
+	                    dir,
+	                    event_data_new (dir,
+	                                    NULL,
+	                                    TRUE,
+	                                    G_FILE_MONITOR_EVENT_DELETED));
 }
 
 static void
@@ -1210,12 +1691,12 @@ monitor_event_directory_moved (TrackerMonitor *monitor,
 	}
 
 	/* If no previous, add to HT */
-	g_hash_table_replace (monitor->priv->pre_delete,
-	                      g_object_ref (src_dir),
-	                      event_data_new (src_dir,
-	                                      dst_dir,
-	                                      TRUE,
-	                                      G_FILE_MONITOR_EVENT_MOVED));
+	event_cache_insert (monitor, monitor->priv->pre_delete,
+	                    src_dir,
+	                    event_data_new (src_dir,
+	                                    dst_dir,
+	                                    TRUE,
+	                                    G_FILE_MONITOR_EVENT_MOVED));
 }
 
 static void
@@ -1309,30 +1790,34 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 #endif /* PAUSE_ON_IO */
 
 	if (!is_directory) {
-		/* FILE Events */
-		switch (event_type) {
-		case G_FILE_MONITOR_EVENT_CREATED:
-			monitor_event_file_created (monitor, file);
-			break;
-		case G_FILE_MONITOR_EVENT_CHANGED:
-			monitor_event_file_changed (monitor, file);
-			break;
-		case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
-			monitor_event_file_attribute_changed (monitor, file);
-			break;
-		case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
-			monitor_event_file_changes_done (monitor, file);
-			break;
-		case G_FILE_MONITOR_EVENT_DELETED:
-			monitor_event_file_deleted (monitor, file);
-			break;
-		case G_FILE_MONITOR_EVENT_MOVED:
-			monitor_event_file_moved (monitor, file, other_file);
-			break;
-		case G_FILE_MONITOR_EVENT_PRE_UNMOUNT:
-		case G_FILE_MONITOR_EVENT_UNMOUNTED:
-			/* Do nothing */
-			break;
+		/* FILE Events, unless the parent directory
+		 * is busy enough to be notified as a whole.
+		 */
+		if (!directory_events_account (monitor, file, event_type)) {
+			switch (event_type) {
+			case G_FILE_MONITOR_EVENT_CREATED:
+				monitor_event_file_created (monitor, file);
+				break;
+			case G_FILE_MONITOR_EVENT_CHANGED:
+				monitor_event_file_changed (monitor, file);
+				break;
+			case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+				monitor_event_file_attribute_changed (monitor, file);
+				break;
+			case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+				monitor_event_file_changes_done (monitor, file);
+				break;
+			case G_FILE_MONITOR_EVENT_DELETED:
+				monitor_event_file_deleted (monitor, file);
+				break;
+			case G_FILE_MONITOR_EVENT_MOVED:
+				monitor_event_file_moved (monitor, file, other_file);
+				break;
+			case G_FILE_MONITOR_EVENT_PRE_UNMOUNT:
+			case G_FILE_MONITOR_EVENT_UNMOUNTED:
+				/* Do nothing */
+				break;
+			}
 		}
 	} else {
 		/* DIRECTORY Events */
@@ -1357,8 +1842,7 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 		}
 	}
 
-	if (g_hash_table_size (monitor->priv->pre_update) > 0 ||
-	    g_hash_table_size (monitor->priv->pre_delete) > 0) {
+	if (event_pairs_pending (monitor)) {
 		if (monitor->priv->event_pairs_timeout_id == 0) {
 			g_debug ("Waiting for event pairs");
 			monitor->priv->event_pairs_timeout_id =
@@ -1382,13 +1866,33 @@ static GFileMonitor *
 directory_monitor_new (TrackerMonitor *monitor,
                        GFile          *file)
 {
-	GFileMonitor *file_monitor;
+	GFileMonitor *file_monitor = NULL;
 	GError *error = NULL;
 
-	file_monitor = g_file_monitor_directory (file,
-	                                         G_FILE_MONITOR_SEND_MOVED | G_FILE_MONITOR_WATCH_MOUNTS,
-	                                         NULL,
-	                                         &error);
+	if (monitor->priv->fanotify) {
+		file_monitor = tracker_monitor_fanotify_monitor_directory (monitor->priv->fanotify,
+		                                                           file,
+		                                                           &error);
+
+		if (error) {
+			gchar *uri;
+
+			uri = g_file_get_uri (file);
+			g_debug ("Could not use fanotify for path:'%s', %s. "
+			         "Falling back to Inotify",
+			         uri, error->message);
+
+			g_clear_error (&error);
+			g_free (uri);
+		}
+	}
+
+	if (!file_monitor) {
+		file_monitor = g_file_monitor_directory (file,
+		                                         G_FILE_MONITOR_SEND_MOVED | G_FILE_MONITOR_WATCH_MOUNTS,
+		                                         NULL,
+		                                         &error);
+	}
 
 	if (error) {
 		gchar *uri;
@@ -1500,6 +2004,24 @@ tracker_monitor_set_enabled (TrackerMonitor *monitor,
 	g_list_free (keys);
 }
 
+static guint
+get_limited_count (TrackerMonitor *monitor)
+{
+	guint count;
+
+	count = g_hash_table_size (monitor->priv->monitors);
+
+	/* Directories handled through fanotify don't
+	 * use up any kernel watch.
+	 */
+	if (monitor->priv->fanotify) {
+		count -= MIN (count,
+		              tracker_monitor_fanotify_get_n_directories (monitor->priv->fanotify));
+	}
+
+	return count;
+}
+
 gboolean
 tracker_monitor_add (TrackerMonitor *monitor,
                      GFile          *file)
@@ -1515,7 +2037,7 @@ tracker_monitor_add (TrackerMonitor *monitor,
 	}
 
 	/* Cap the number of monitors */
-	if (g_hash_table_size (monitor->priv->monitors) >= monitor->priv->monitor_limit) {
+	if (get_limited_count (monitor) >= monitor->priv->monitor_limit) {
 		monitor->priv->monitors_ignored++;
 
 		if (!monitor->priv->monitor_limit_warned) {
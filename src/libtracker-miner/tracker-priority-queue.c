@@ -237,6 +237,150 @@ tracker_priority_queue_foreach_remove (TrackerPriorityQueue *queue,
 	return updated;
 }
 
+/* Inserts the chain of links from @first to @last, @length long,
+ * at the start of the @priority segment, which is created if there
+ * is none.
+ */
+static void
+priority_segment_splice_head (TrackerPriorityQueue *queue,
+                              GList                *first,
+                              GList                *last,
+                              guint                 length,
+                              gint                  priority)
+{
+	PrioritySegment *segment = NULL;
+	GList *sibling = NULL;
+	guint c;
+
+	for (c = 0; c < queue->segments->len; c++) {
+		segment = &g_array_index (queue->segments, PrioritySegment, c);
+
+		if (segment->priority >= priority) {
+			sibling = segment->first_elem;
+			break;
+		}
+	}
+
+	if (sibling) {
+		first->prev = sibling->prev;
+		last->next = sibling;
+
+		if (sibling->prev) {
+			sibling->prev->next = first;
+		} else {
+			queue->queue.head = first;
+		}
+
+		sibling->prev = last;
+	} else {
+		/* All queued elements are more urgent */
+		first->prev = queue->queue.tail;
+		last->next = NULL;
+
+		if (queue->queue.tail) {
+			queue->queue.tail->next = first;
+		} else {
+			queue->queue.head = first;
+		}
+
+		queue->queue.tail = last;
+	}
+
+	queue->queue.length += length;
+
+	if (sibling && segment->priority == priority) {
+		segment->first_elem = first;
+	} else {
+		PrioritySegment new_segment = { 0 };
+
+		new_segment.priority = priority;
+		new_segment.first_elem = first;
+		new_segment.last_elem = last;
+		g_array_insert_val (queue->segments, c, new_segment);
+	}
+}
+
+/* Moves every element matching @compare_func that is queued with
+ * a less urgent priority than @priority to the start of the @priority
+ * segment, as a block keeping their relative order, so they are next
+ * in line. Returns the number of elements moved.
+ */
+guint
+tracker_priority_queue_boost (TrackerPriorityQueue *queue,
+                              GEqualFunc            compare_func,
+                              gpointer              compare_user_data,
+                              gint                  priority)
+{
+	PrioritySegment *segment;
+	GList *first = NULL, *last = NULL;
+	gint n_segment = 0;
+	guint n_boosted = 0;
+	GList *list;
+
+	g_return_val_if_fail (queue != NULL, 0);
+	g_return_val_if_fail (compare_func != NULL, 0);
+
+	list = queue->queue.head;
+
+	if (!list) {
+		return 0;
+	}
+
+	segment = &g_array_index (queue->segments, PrioritySegment, n_segment);
+
+	while (list) {
+		gboolean last_in_segment;
+		GList *elem;
+
+		elem = list;
+		list = list->next;
+		last_in_segment = (elem == segment->last_elem);
+
+		if (segment->priority > priority &&
+		    (compare_func) (elem->data, compare_user_data)) {
+			if (elem == segment->first_elem && last_in_segment) {
+				/* Segment is left empty, the next
+				 * one takes its index.
+				 */
+				g_array_remove_index (queue->segments, n_segment);
+			} else if (elem == segment->first_elem) {
+				segment->first_elem = elem->next;
+			} else if (last_in_segment) {
+				segment->last_elem = elem->prev;
+				n_segment++;
+			}
+
+			/* Keep the link, it is spliced back in below */
+			g_queue_unlink (&queue->queue, elem);
+
+			if (last) {
+				last->next = elem;
+				elem->prev = last;
+			} else {
+				first = elem;
+			}
+
+			last = elem;
+			n_boosted++;
+		} else if (last_in_segment) {
+			n_segment++;
+		}
+
+		if (list && last_in_segment) {
+			g_assert (n_segment < queue->segments->len);
+			segment = &g_array_index (queue->segments,
+			                          PrioritySegment,
+			                          n_segment);
+		}
+	}
+
+	if (first) {
+		priority_segment_splice_head (queue, first, last, n_boosted, priority);
+	}
+
+	return n_boosted;
+}
+
 gboolean
 tracker_priority_queue_is_empty (TrackerPriorityQueue *queue)
 {
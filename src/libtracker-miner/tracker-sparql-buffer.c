@@ -28,6 +28,9 @@
 /* Maximum time (seconds) before forcing a sparql buffer flush */
 #define MAX_SPARQL_BUFFER_TIME  15
 
+/* Weight of the last commit in the per-task cost estimate */
+#define TASK_COST_WEIGHT 0.3
+
 typedef struct _TrackerSparqlBufferPrivate TrackerSparqlBufferPrivate;
 typedef struct _SparqlTaskData SparqlTaskData;
 typedef struct _UpdateArrayData UpdateArrayData;
@@ -36,7 +39,9 @@ typedef struct _BulkOperationMerge BulkOperationMerge;
 
 enum {
 	PROP_0,
-	PROP_CONNECTION
+	PROP_CONNECTION,
+	PROP_BATCH_SIZE,
+	PROP_LAST_LATENCY
 };
 
 enum {
@@ -51,6 +56,17 @@ struct _TrackerSparqlBufferPrivate
 	guint flush_timeout_id;
 	GPtrArray *tasks;
 	gint n_updates;
+
+	/* Adaptive batching, the batch size is tuned after
+	 * each commit so commits take about target_latency.
+	 */
+	guint min_batch_size;
+	guint max_batch_size;
+	guint target_latency;
+	guint batch_size;
+	gdouble task_cost;
+	gint last_latency;
+	gint64 flush_time;
 };
 
 struct _SparqlTaskData
@@ -143,6 +159,12 @@ tracker_sparql_buffer_get_property (GObject    *object,
 		g_value_set_object (value,
 		                    priv->connection);
 		break;
+	case PROP_BATCH_SIZE:
+		g_value_set_uint (value, priv->batch_size);
+		break;
+	case PROP_LAST_LATENCY:
+		g_value_set_int (value, priv->last_latency);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -166,6 +188,22 @@ tracker_sparql_buffer_class_init (TrackerSparqlBufferClass *klass)
 	                                                      TRACKER_SPARQL_TYPE_CONNECTION,
 	                                                      G_PARAM_READWRITE |
 	                                                      G_PARAM_CONSTRUCT_ONLY));
+	g_object_class_install_property (object_class,
+	                                 PROP_BATCH_SIZE,
+	                                 g_param_spec_uint ("batch-size",
+	                                                    "Batch size",
+	                                                    "Number of tasks merged in a single update "
+	                                                    "when adaptive batching is enabled",
+	                                                    0, G_MAXUINT, 0,
+	                                                    G_PARAM_READABLE));
+	g_object_class_install_property (object_class,
+	                                 PROP_LAST_LATENCY,
+	                                 g_param_spec_int ("last-latency",
+	                                                   "Last latency",
+	                                                   "Time in milliseconds the last update took, "
+	                                                   "or -1 if none finished yet",
+	                                                   -1, G_MAXINT, -1,
+	                                                   G_PARAM_READABLE));
 
 	g_type_class_add_private (object_class,
 	                          sizeof (TrackerSparqlBufferPrivate));
@@ -202,9 +240,12 @@ reset_flush_timeout (TrackerSparqlBuffer *buffer)
 static void
 tracker_sparql_buffer_init (TrackerSparqlBuffer *buffer)
 {
-	buffer->priv = G_TYPE_INSTANCE_GET_PRIVATE (buffer,
-	                                            TRACKER_TYPE_SPARQL_BUFFER,
-	                                            TrackerSparqlBufferPrivate);
+	TrackerSparqlBufferPrivate *priv;
+
+	buffer->priv = priv = G_TYPE_INSTANCE_GET_PRIVATE (buffer,
+	                                                   TRACKER_TYPE_SPARQL_BUFFER,
+	                                                   TrackerSparqlBufferPrivate);
+	priv->last_latency = -1;
 }
 
 TrackerSparqlBuffer *
@@ -251,6 +292,57 @@ update_array_data_free (UpdateArrayData *update_data)
 	g_slice_free (UpdateArrayData, update_data);
 }
 
+static void
+sparql_buffer_adapt_batch_size (TrackerSparqlBuffer *buffer,
+                                guint                n_tasks,
+                                gint64               elapsed)
+{
+	TrackerSparqlBufferPrivate *priv = buffer->priv;
+	gdouble cost, ideal;
+	guint batch_size;
+
+	priv->last_latency = (gint) MIN (elapsed / 1000, G_MAXINT);
+
+	if (priv->target_latency == 0 || n_tasks == 0) {
+		g_object_notify (G_OBJECT (buffer), "last-latency");
+		return;
+	}
+
+	/* Flushes of partial batches (timeouts, blocked queues) carry
+	 * too much fixed overhead per task to tell anything about the
+	 * throughput, those are only used to back off.
+	 */
+	if (n_tasks >= priv->batch_size / 2 ||
+	    priv->last_latency > priv->target_latency) {
+		cost = (gdouble) elapsed / n_tasks;
+
+		if (priv->task_cost > 0) {
+			priv->task_cost = (1 - TASK_COST_WEIGHT) * priv->task_cost +
+				TASK_COST_WEIGHT * cost;
+		} else {
+			priv->task_cost = cost;
+		}
+
+		/* Move towards the ideal size, at most doubling
+		 * or halving the batch on each commit.
+		 */
+		ideal = (priv->target_latency * 1000.0) / MAX (priv->task_cost, 1);
+		ideal = CLAMP (ideal, priv->batch_size / 2.0, priv->batch_size * 2.0);
+		batch_size = (guint) CLAMP (ideal, priv->min_batch_size, priv->max_batch_size);
+
+		if (batch_size != priv->batch_size) {
+			g_debug ("(Sparql buffer) Commit of %u tasks took %d ms, "
+			         "batch size %u -> %u",
+			         n_tasks, priv->last_latency,
+			         priv->batch_size, batch_size);
+			priv->batch_size = batch_size;
+			g_object_notify (G_OBJECT (buffer), "batch-size");
+		}
+	}
+
+	g_object_notify (G_OBJECT (buffer), "last-latency");
+}
+
 static void
 tracker_sparql_buffer_update_array_cb (GObject      *object,
                                        GAsyncResult *result,
@@ -270,6 +362,10 @@ tracker_sparql_buffer_update_array_cb (GObject      *object,
 	g_debug ("(Sparql buffer) Finished array-update with %u tasks",
 	         update_data->tasks->len);
 
+	sparql_buffer_adapt_batch_size (update_data->buffer,
+	                                update_data->tasks->len,
+	                                g_get_monotonic_time () - priv->flush_time);
+
 	sparql_array_errors = tracker_sparql_connection_update_array_finish (priv->connection,
 	                                                                     result,
 	                                                                     &global_error);
@@ -607,6 +703,7 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 	g_ptr_array_unref (priv->tasks);
 	priv->tasks = NULL;
 	priv->n_updates++;
+	priv->flush_time = g_get_monotonic_time ();
 
 	/* Start the update */
 	tracker_sparql_connection_update_array_async (priv->connection,
@@ -620,6 +717,152 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 	return TRUE;
 }
 
+/**
+ * tracker_sparql_buffer_cancel_for_prefix:
+ * @buffer: a #TrackerSparqlBuffer
+ * @prefix: a directory
+ *
+ * Drops the tasks for @prefix and the files within it that are
+ * waiting for the next flush, these are completed right away with
+ * a %G_IO_ERROR_CANCELLED error. Bulk operations are kept, and so
+ * are the tasks being already committed.
+ *
+ * Returns: the number of tasks dropped.
+ **/
+guint
+tracker_sparql_buffer_cancel_for_prefix (TrackerSparqlBuffer *buffer,
+                                         GFile               *prefix)
+{
+	TrackerSparqlBufferPrivate *priv;
+	GPtrArray *cancelled;
+	guint i;
+
+	g_return_val_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer), 0);
+	g_return_val_if_fail (G_IS_FILE (prefix), 0);
+
+	priv = buffer->priv;
+
+	if (!priv->tasks ||
+	    priv->tasks->len == 0) {
+		return 0;
+	}
+
+	cancelled = g_ptr_array_new_with_free_func ((GDestroyNotify) tracker_task_unref);
+
+	/* Take the tasks out first, the finished handlers
+	 * may push or flush while they are being completed.
+	 */
+	i = 0;
+
+	while (i < priv->tasks->len) {
+		SparqlTaskData *task_data;
+		TrackerTask *task;
+		GFile *file;
+
+		task = g_ptr_array_index (priv->tasks, i);
+		task_data = tracker_task_get_data (task);
+		file = tracker_task_get_file (task);
+
+		if (task_data->type == TASK_TYPE_BULK ||
+		    (!g_file_equal (file, prefix) &&
+		     !g_file_has_prefix (file, prefix))) {
+			i++;
+			continue;
+		}
+
+		g_ptr_array_add (cancelled, tracker_task_ref (task));
+		g_ptr_array_remove_index (priv->tasks, i);
+	}
+
+	for (i = 0; i < cancelled->len; i++) {
+		SparqlTaskData *task_data;
+		TrackerTask *task;
+
+		task = g_ptr_array_index (cancelled, i);
+		task_data = tracker_task_get_data (task);
+
+		g_simple_async_result_set_op_res_gpointer (task_data->result,
+		                                           task, NULL);
+		g_simple_async_result_set_error (task_data->result,
+		                                 G_IO_ERROR,
+		                                 G_IO_ERROR_CANCELLED,
+		                                 "Task was cancelled");
+		g_simple_async_result_complete (task_data->result);
+
+		tracker_task_pool_remove (TRACKER_TASK_POOL (buffer), task);
+	}
+
+	i = cancelled->len;
+	g_ptr_array_unref (cancelled);
+
+	return i;
+}
+
+/**
+ * tracker_sparql_buffer_set_batch_limits:
+ * @buffer: a #TrackerSparqlBuffer
+ * @min_batch_size: minimum number of tasks per update
+ * @max_batch_size: maximum number of tasks per update
+ * @target_latency: time in milliseconds updates should take, or 0
+ *
+ * Enables adaptive batching, the number of tasks merged in each
+ * update is tuned between @min_batch_size and @max_batch_size so
+ * updates take about @target_latency. The buffer is still flushed
+ * when the pool limit is reached. If @target_latency is 0, the
+ * buffer is flushed once half the pool limit is reached.
+ **/
+void
+tracker_sparql_buffer_set_batch_limits (TrackerSparqlBuffer *buffer,
+                                        guint                min_batch_size,
+                                        guint                max_batch_size,
+                                        guint                target_latency)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
+
+	priv = buffer->priv;
+	priv->min_batch_size = MAX (min_batch_size, 1);
+	priv->max_batch_size = MAX (max_batch_size, priv->min_batch_size);
+	priv->target_latency = target_latency;
+	priv->task_cost = 0;
+
+	if (target_latency == 0) {
+		priv->batch_size = 0;
+	} else {
+		/* Start low and grow as commits prove fast enough */
+		priv->batch_size = CLAMP (priv->batch_size,
+		                          priv->min_batch_size,
+		                          priv->max_batch_size);
+	}
+
+	g_object_notify (G_OBJECT (buffer), "batch-size");
+}
+
+guint
+tracker_sparql_buffer_get_batch_size (TrackerSparqlBuffer *buffer)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer), 0);
+
+	priv = buffer->priv;
+
+	return priv->batch_size;
+}
+
+gint
+tracker_sparql_buffer_get_last_latency (TrackerSparqlBuffer *buffer)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer), -1);
+
+	priv = buffer->priv;
+
+	return priv->last_latency;
+}
+
 static void
 tracker_sparql_buffer_update_cb (GObject      *object,
                                  GAsyncResult *result,
@@ -707,6 +950,10 @@ tracker_sparql_buffer_push (TrackerSparqlBuffer *buffer,
 
 		if (tracker_task_pool_limit_reached (TRACKER_TASK_POOL (buffer))) {
 			tracker_sparql_buffer_flush (buffer, "SPARQL buffer limit reached");
+		} else if (priv->target_latency > 0) {
+			if (priv->tasks->len >= priv->batch_size) {
+				tracker_sparql_buffer_flush (buffer, "SPARQL buffer batch size reached");
+			}
 		} else if (priv->tasks->len > tracker_task_pool_get_limit (TRACKER_TASK_POOL (buffer)) / 2) {
 			/* We've filled half of the buffer, flush it as we receive more tasks */
 			tracker_sparql_buffer_flush (buffer, "SPARQL buffer half-full");
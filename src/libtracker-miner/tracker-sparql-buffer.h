@@ -66,6 +66,15 @@ TrackerSparqlBuffer *tracker_sparql_buffer_new   (TrackerSparqlConnection *conne
 
 gboolean             tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
                                                   const gchar         *reason);
+guint                tracker_sparql_buffer_cancel_for_prefix (TrackerSparqlBuffer *buffer,
+                                                              GFile               *prefix);
+
+void                 tracker_sparql_buffer_set_batch_limits (TrackerSparqlBuffer *buffer,
+                                                             guint                min_batch_size,
+                                                             guint                max_batch_size,
+                                                             guint                target_latency);
+guint                tracker_sparql_buffer_get_batch_size   (TrackerSparqlBuffer *buffer);
+gint                 tracker_sparql_buffer_get_last_latency (TrackerSparqlBuffer *buffer);
 
 void                 tracker_sparql_buffer_push  (TrackerSparqlBuffer *buffer,
                                                   TrackerTask         *task,
@@ -256,6 +256,28 @@ public abstract class Tracker.Sparql.Connection : Object {
 	 */
 	public async abstract Cursor query_async (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError;
 
+	/**
+	 * tracker_sparql_connection_query_statement:
+	 * @self: a #TrackerSparqlConnection
+	 * @sparql: string containing the SPARQL query, with ~name parameters
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Prepares a SPARQL query to be executed several times, with
+	 * different values for its parameters, without translating it
+	 * again every time. See #TrackerSparqlStatement.
+	 *
+	 * Returns: a #TrackerSparqlStatement. On error, #NULL is returned
+	 * and the @error is set accordingly. Call g_object_unref() on the
+	 * returned statement when no longer needed.
+	 *
+	 * Since: 0.16
+	 */
+	public virtual Statement? query_statement (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'query_statement' not implemented");
+		return null;
+	}
+
 	/**
 	 * tracker_sparql_connection_update:
 	 * @self: a #TrackerSparqlConnection
@@ -202,6 +202,11 @@ public abstract class Tracker.Sparql.Cursor : Object {
 	 *
 	 * Resets the iterator to point back to the first result.
 	 *
+	 * Cursors of connections to the store over D-Bus don't keep the
+	 * results they already went past, rewinding them runs the query
+	 * again. The results may then differ if the store was updated in
+	 * the meantime.
+	 *
 	 * Since: 0.10
 	 */
 	public abstract void rewind ();
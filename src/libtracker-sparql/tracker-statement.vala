@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * SECTION: tracker-sparql-statement
+ * @short_description: Prepared SPARQL queries
+ * @title: TrackerSparqlStatement
+ * @stability: Unstable
+ * @include: tracker-sparql.h
+ *
+ * <para>
+ * #TrackerSparqlStatement represents a SPARQL query which is translated
+ * once and may then be executed many times with different values. Those
+ * values are given as parameters, written as <literal>~name</literal>
+ * in the query where a literal would otherwise be, e.g.:
+ * </para>
+ * <programlisting>
+ * SELECT ?song WHERE {
+ *   ?song nmm:musicAlbum ?album .
+ *   ?album nmm:albumTitle ~title
+ * }
+ * </programlisting>
+ * <para>
+ * Parameters are given a value with tracker_sparql_statement_bind_string()
+ * or tracker_sparql_statement_bind_int() before calling
+ * tracker_sparql_statement_execute(). Values are kept between executions
+ * until they are bound again or tracker_sparql_statement_clear_bindings()
+ * is called.
+ * </para>
+ */
+
+/**
+ * TrackerSparqlStatement:
+ *
+ * The <structname>TrackerSparqlStatement</structname> object represents
+ * a prepared SPARQL query.
+ */
+public abstract class Tracker.Sparql.Statement : Object {
+
+	/**
+	 * TrackerSparqlStatement:connection:
+	 *
+	 * The #TrackerSparqlConnection the statement was prepared on.
+	 *
+	 * Since: 0.16
+	 */
+	public Connection connection { get; construct set; }
+
+	/**
+	 * TrackerSparqlStatement:sparql:
+	 *
+	 * The SPARQL query of the statement, including its parameters.
+	 *
+	 * Since: 0.16
+	 */
+	public string sparql { get; construct set; }
+
+	/**
+	 * tracker_sparql_statement_bind_int:
+	 * @self: a #TrackerSparqlStatement
+	 * @name: the name of the parameter, without the leading ~
+	 * @value: the value
+	 *
+	 * Binds the integer @value to the parameter @name.
+	 *
+	 * Since: 0.16
+	 */
+	public abstract void bind_int (string name, int64 value);
+
+	/**
+	 * tracker_sparql_statement_bind_string:
+	 * @self: a #TrackerSparqlStatement
+	 * @name: the name of the parameter, without the leading ~
+	 * @value: the value
+	 *
+	 * Binds the string @value to the parameter @name. Strings are
+	 * converted as needed where the parameter stands for a boolean,
+	 * date or resource.
+	 *
+	 * Since: 0.16
+	 */
+	public abstract void bind_string (string name, string value);
+
+	/**
+	 * tracker_sparql_statement_clear_bindings:
+	 * @self: a #TrackerSparqlStatement
+	 *
+	 * Removes the values of all parameters.
+	 *
+	 * Since: 0.16
+	 */
+	public abstract void clear_bindings ();
+
+	/**
+	 * tracker_sparql_statement_execute:
+	 * @self: a #TrackerSparqlStatement
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Executes the statement with the values currently bound. All
+	 * parameters of the query must have a value. The API call is
+	 * completely synchronous, so it may block.
+	 *
+	 * Returns: a #TrackerSparqlCursor if results were found, #NULL otherwise.
+	 * On error, #NULL is returned and the @error is set accordingly.
+	 * Call g_object_unref() on the returned cursor when no longer needed.
+	 *
+	 * Since: 0.16
+	 */
+	public abstract Cursor execute (Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError;
+
+	/**
+	 * tracker_sparql_statement_execute_async:
+	 * @self: a #TrackerSparqlStatement
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @_callback_: user-defined #GAsyncReadyCallback to be called when
+	 *              asynchronous operation is finished.
+	 * @_user_data_: user-defined data to be passed to @_callback_
+	 *
+	 * Executes asynchronously the statement with the values currently
+	 * bound.
+	 *
+	 * Since: 0.16
+	 */
+
+	/**
+	 * tracker_sparql_statement_execute_finish:
+	 * @self: a #TrackerSparqlStatement
+	 * @_res_: a #GAsyncResult with the result of the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Finishes the asynchronous execution of the statement.
+	 *
+	 * Returns: a #TrackerSparqlCursor if results were found, #NULL otherwise.
+	 * On error, #NULL is returned and the @error is set accordingly.
+	 * Call g_object_unref() on the returned cursor when no longer needed.
+	 *
+	 * Since: 0.16
+	 */
+	public async abstract Cursor execute_async (Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError;
+}
@@ -39,6 +39,8 @@
 #define DEFAULT_INITIAL_SLEEP                    15       /* 0->1000 */
 #define DEFAULT_ENABLE_MONITORS                  TRUE
 #define DEFAULT_THROTTLE                         0        /* 0->20 */
+#define DEFAULT_IO_PRESSURE_THROTTLING           FALSE
+#define DEFAULT_MEMORY_CEILING                   0        /* 0->4096 */
 #define DEFAULT_INDEX_REMOVABLE_DEVICES          FALSE
 #define DEFAULT_INDEX_OPTICAL_DISCS              FALSE
 #define DEFAULT_INDEX_ON_BATTERY                 FALSE
@@ -46,6 +48,12 @@
 #define DEFAULT_LOW_DISK_SPACE_LIMIT             1        /* 0->100 / -1 */
 #define DEFAULT_CRAWLING_INTERVAL                -1       /* 0->365 / -1 / -2 */
 #define DEFAULT_REMOVABLE_DAYS_THRESHOLD         3        /* 1->365 / 0  */
+#define DEFAULT_DEFER_EMBEDDED_METADATA          FALSE
+#define DEFAULT_ENABLE_CONTENT_FINGERPRINT       FALSE
+#define DEFAULT_ENABLE_CHECKPOINT                TRUE
+#define DEFAULT_COMMIT_BATCH_MIN                 10       /* 1->100000 */
+#define DEFAULT_COMMIT_BATCH_MAX                 1000     /* 1->100000 */
+#define DEFAULT_COMMIT_TARGET_LATENCY            500      /* 0->60000 */
 #define DEFAULT_ENABLE_WRITEBACK                 FALSE
 
 typedef struct {
@@ -110,6 +118,8 @@ enum {
 
 	/* Indexing */
 	PROP_THROTTLE,
+	PROP_IO_PRESSURE_THROTTLING,
+	PROP_MEMORY_CEILING,
 	PROP_INDEX_ON_BATTERY,
 	PROP_INDEX_ON_BATTERY_FIRST_TIME,
 	PROP_INDEX_REMOVABLE_DEVICES,
@@ -122,6 +132,12 @@ enum {
 	PROP_IGNORED_FILES,
 	PROP_CRAWLING_INTERVAL,
 	PROP_REMOVABLE_DAYS_THRESHOLD,
+	PROP_DEFER_EMBEDDED_METADATA,
+	PROP_ENABLE_CONTENT_FINGERPRINT,
+	PROP_ENABLE_CHECKPOINT,
+	PROP_COMMIT_BATCH_MIN,
+	PROP_COMMIT_BATCH_MAX,
+	PROP_COMMIT_TARGET_LATENCY,
 
 	/* Writeback */
 	PROP_ENABLE_WRITEBACK
@@ -134,6 +150,8 @@ static TrackerConfigMigrationEntry migration[] = {
 	{ G_TYPE_INT,     "General",   "InitialSleep",                  "initial-sleep"                    },
 	{ G_TYPE_BOOLEAN, "Monitors",  "EnableMonitors",                "enable-monitors"                  },
 	{ G_TYPE_INT,     "Indexing",  "Throttle",                      "throttle"                         },
+	{ G_TYPE_BOOLEAN, "Indexing",  "IOPressureThrottling",          "io-pressure-throttling"           },
+	{ G_TYPE_INT,     "Indexing",  "MemoryCeiling",                 "memory-ceiling"                   },
 	{ G_TYPE_BOOLEAN, "Indexing",  "IndexOnBattery",                "index-on-battery"                 },
 	{ G_TYPE_BOOLEAN, "Indexing",  "IndexOnBatteryFirstTime",       "index-on-battery-first-time"      },
 	{ G_TYPE_BOOLEAN, "Indexing",  "IndexRemovableMedia",           "index-removable-devices"          },
@@ -146,6 +164,12 @@ static TrackerConfigMigrationEntry migration[] = {
 	{ G_TYPE_POINTER, "Indexing",  "IgnoredFiles",                  "ignored-files"                    },
 	{ G_TYPE_INT,     "Indexing",  "CrawlingInterval",              "crawling-interval"                },
 	{ G_TYPE_INT,     "Indexing",  "RemovableDaysThreshold",        "removable-days-threshold"         },
+	{ G_TYPE_BOOLEAN, "Indexing",  "DeferEmbeddedMetadata",         "defer-embedded-metadata"          },
+	{ G_TYPE_BOOLEAN, "Indexing",  "EnableContentFingerprint",      "enable-content-fingerprint"       },
+	{ G_TYPE_BOOLEAN, "Indexing",  "EnableCheckpoint",              "enable-checkpoint"                },
+	{ G_TYPE_INT,     "Indexing",  "CommitBatchMin",                "commit-batch-min"                 },
+	{ G_TYPE_INT,     "Indexing",  "CommitBatchMax",                "commit-batch-max"                 },
+	{ G_TYPE_INT,     "Indexing",  "CommitTargetLatency",           "commit-target-latency"            },
 	{ G_TYPE_BOOLEAN, "Writeback", "EnableWriteback",               "enable-writeback"                 },
 	{ 0 }
 };
@@ -208,6 +232,24 @@ tracker_config_class_init (TrackerConfigClass *klass)
 	                                                   20,
 	                                                   DEFAULT_THROTTLE,
 	                                                   G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_IO_PRESSURE_THROTTLING,
+	                                 g_param_spec_boolean ("io-pressure-throttling",
+	                                                       "I/O pressure throttling",
+	                                                       "Set to true to slow indexing down further while other"
+	                                                       " processes are contending for I/O",
+	                                                       DEFAULT_IO_PRESSURE_THROTTLING,
+	                                                       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_MEMORY_CEILING,
+	                                 g_param_spec_int ("memory-ceiling",
+	                                                   "Memory ceiling",
+	                                                   "Memory in MB for files being crawled and queued,"
+	                                                   " crawling slows down when approaching it (0=no limit)",
+	                                                   0,
+	                                                   4096,
+	                                                   DEFAULT_MEMORY_CEILING,
+	                                                   G_PARAM_READWRITE));
 	g_object_class_install_property (object_class,
 	                                 PROP_INDEX_ON_BATTERY,
 	                                 g_param_spec_boolean ("index-on-battery",
@@ -318,6 +360,59 @@ tracker_config_class_init (TrackerConfigClass *klass)
 	                                                   365,
 	                                                   DEFAULT_REMOVABLE_DAYS_THRESHOLD,
 	                                                   G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_DEFER_EMBEDDED_METADATA,
+	                                 g_param_spec_boolean ("defer-embedded-metadata",
+	                                                       "Defer embedded metadata",
+	                                                       "Set to true to store the file level data of all crawled files first,"
+	                                                       " and extract embedded metadata afterwards in the background",
+	                                                       DEFAULT_DEFER_EMBEDDED_METADATA,
+	                                                       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_ENABLE_CONTENT_FINGERPRINT,
+	                                 g_param_spec_boolean ("enable-content-fingerprint",
+	                                                       "Enable content fingerprint",
+	                                                       "Set to true to copy the embedded metadata of files"
+	                                                       " already indexed elsewhere with the same content,"
+	                                                       " instead of extracting it again",
+	                                                       DEFAULT_ENABLE_CONTENT_FINGERPRINT,
+	                                                       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_ENABLE_CHECKPOINT,
+	                                 g_param_spec_boolean ("enable-checkpoint",
+	                                                       "Enable checkpoint",
+	                                                       "Set to true to log the indexing progress to disk,"
+	                                                       " so it resumes where it was left if the miner is killed",
+	                                                       DEFAULT_ENABLE_CHECKPOINT,
+	                                                       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_COMMIT_BATCH_MIN,
+	                                 g_param_spec_int ("commit-batch-min",
+	                                                   "Minimum commit batch",
+	                                                   " Minimum number of files committed to the store at once",
+	                                                   1,
+	                                                   100000,
+	                                                   DEFAULT_COMMIT_BATCH_MIN,
+	                                                   G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_COMMIT_BATCH_MAX,
+	                                 g_param_spec_int ("commit-batch-max",
+	                                                   "Maximum commit batch",
+	                                                   " Maximum number of files committed to the store at once",
+	                                                   1,
+	                                                   100000,
+	                                                   DEFAULT_COMMIT_BATCH_MAX,
+	                                                   G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_COMMIT_TARGET_LATENCY,
+	                                 g_param_spec_int ("commit-target-latency",
+	                                                   "Commit target latency",
+	                                                   " Time in milliseconds each commit to the store should take,"
+	                                                   " the number of files per commit is adapted to it. 0 disables it",
+	                                                   0,
+	                                                   60000,
+	                                                   DEFAULT_COMMIT_TARGET_LATENCY,
+	                                                   G_PARAM_READWRITE));
 
 	/* Writeback */
 	g_object_class_install_property (object_class,
@@ -448,6 +543,12 @@ config_get_property (GObject    *object,
 	case PROP_THROTTLE:
 		g_value_set_int (value, tracker_config_get_throttle (config));
 		break;
+	case PROP_IO_PRESSURE_THROTTLING:
+		g_value_set_boolean (value, tracker_config_get_io_pressure_throttling (config));
+		break;
+	case PROP_MEMORY_CEILING:
+		g_value_set_int (value, tracker_config_get_memory_ceiling (config));
+		break;
 	case PROP_INDEX_ON_BATTERY:
 		g_value_set_boolean (value, tracker_config_get_index_on_battery (config));
 		break;
@@ -484,6 +585,24 @@ config_get_property (GObject    *object,
 	case PROP_REMOVABLE_DAYS_THRESHOLD:
 		g_value_set_int (value, tracker_config_get_removable_days_threshold (config));
 		break;
+	case PROP_DEFER_EMBEDDED_METADATA:
+		g_value_set_boolean (value, tracker_config_get_defer_embedded_metadata (config));
+		break;
+	case PROP_ENABLE_CONTENT_FINGERPRINT:
+		g_value_set_boolean (value, tracker_config_get_enable_content_fingerprint (config));
+		break;
+	case PROP_ENABLE_CHECKPOINT:
+		g_value_set_boolean (value, tracker_config_get_enable_checkpoint (config));
+		break;
+	case PROP_COMMIT_BATCH_MIN:
+		g_value_set_int (value, tracker_config_get_commit_batch_min (config));
+		break;
+	case PROP_COMMIT_BATCH_MAX:
+		g_value_set_int (value, tracker_config_get_commit_batch_max (config));
+		break;
+	case PROP_COMMIT_TARGET_LATENCY:
+		g_value_set_int (value, tracker_config_get_commit_target_latency (config));
+		break;
 
 	/* Writeback */
 	case PROP_ENABLE_WRITEBACK:
@@ -732,10 +851,18 @@ config_constructed (GObject *object)
 	g_settings_bind (settings, "sched-idle", object, "sched-idle", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "initial-sleep", object, "initial-sleep", G_SETTINGS_BIND_GET_NO_CHANGES);
 	g_settings_bind (settings, "throttle", object, "throttle", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "io-pressure-throttling", object, "io-pressure-throttling", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "memory-ceiling", object, "memory-ceiling", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "low-disk-space-limit", object, "low-disk-space-limit", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "crawling-interval", object, "crawling-interval", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "low-disk-space-limit", object, "low-disk-space-limit", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "removable-days-threshold", object, "removable-days-threshold", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "defer-embedded-metadata", object, "defer-embedded-metadata", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "enable-content-fingerprint", object, "enable-content-fingerprint", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "enable-checkpoint", object, "enable-checkpoint", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "commit-batch-min", object, "commit-batch-min", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "commit-batch-max", object, "commit-batch-max", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "commit-target-latency", object, "commit-target-latency", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "enable-monitors", object, "enable-monitors", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "enable-writeback", object, "enable-writeback", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "index-removable-devices", object, "index-removable-devices", G_SETTINGS_BIND_GET);
@@ -838,6 +965,22 @@ tracker_config_get_throttle (TrackerConfig *config)
 	return g_settings_get_int (G_SETTINGS (config), "throttle");
 }
 
+gboolean
+tracker_config_get_io_pressure_throttling (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_IO_PRESSURE_THROTTLING);
+
+	return g_settings_get_boolean (G_SETTINGS (config), "io-pressure-throttling");
+}
+
+gint
+tracker_config_get_memory_ceiling (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_MEMORY_CEILING);
+
+	return g_settings_get_int (G_SETTINGS (config), "memory-ceiling");
+}
+
 gboolean
 tracker_config_get_index_on_battery (TrackerConfig *config)
 {
@@ -954,6 +1097,54 @@ tracker_config_get_removable_days_threshold (TrackerConfig *config)
 	return g_settings_get_int (G_SETTINGS (config), "removable-days-threshold");
 }
 
+gboolean
+tracker_config_get_defer_embedded_metadata (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_DEFER_EMBEDDED_METADATA);
+
+	return g_settings_get_boolean (G_SETTINGS (config), "defer-embedded-metadata");
+}
+
+gboolean
+tracker_config_get_enable_content_fingerprint (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_ENABLE_CONTENT_FINGERPRINT);
+
+	return g_settings_get_boolean (G_SETTINGS (config), "enable-content-fingerprint");
+}
+
+gboolean
+tracker_config_get_enable_checkpoint (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_ENABLE_CHECKPOINT);
+
+	return g_settings_get_boolean (G_SETTINGS (config), "enable-checkpoint");
+}
+
+gint
+tracker_config_get_commit_batch_min (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_COMMIT_BATCH_MIN);
+
+	return g_settings_get_int (G_SETTINGS (config), "commit-batch-min");
+}
+
+gint
+tracker_config_get_commit_batch_max (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_COMMIT_BATCH_MAX);
+
+	return g_settings_get_int (G_SETTINGS (config), "commit-batch-max");
+}
+
+gint
+tracker_config_get_commit_target_latency (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_COMMIT_TARGET_LATENCY);
+
+	return g_settings_get_int (G_SETTINGS (config), "commit-target-latency");
+}
+
 void
 tracker_config_set_verbosity (TrackerConfig *config,
                               gint           value)
@@ -54,6 +54,8 @@ gint           tracker_config_get_sched_idle                       (TrackerConfi
 gint           tracker_config_get_initial_sleep                    (TrackerConfig *config);
 gboolean       tracker_config_get_enable_monitors                  (TrackerConfig *config);
 gint           tracker_config_get_throttle                         (TrackerConfig *config);
+gboolean       tracker_config_get_io_pressure_throttling           (TrackerConfig *config);
+gint           tracker_config_get_memory_ceiling                   (TrackerConfig *config);
 gboolean       tracker_config_get_index_on_battery                 (TrackerConfig *config);
 gboolean       tracker_config_get_index_on_battery_first_time      (TrackerConfig *config);
 gboolean       tracker_config_get_index_removable_devices          (TrackerConfig *config);
@@ -67,6 +69,12 @@ GSList *       tracker_config_get_ignored_directories_with_content (TrackerConfi
 GSList *       tracker_config_get_ignored_files                    (TrackerConfig *config);
 gint           tracker_config_get_crawling_interval                (TrackerConfig *config);
 gint           tracker_config_get_removable_days_threshold         (TrackerConfig *config);
+gboolean       tracker_config_get_defer_embedded_metadata          (TrackerConfig *config);
+gboolean       tracker_config_get_enable_content_fingerprint       (TrackerConfig *config);
+gboolean       tracker_config_get_enable_checkpoint                (TrackerConfig *config);
+gint           tracker_config_get_commit_batch_min                 (TrackerConfig *config);
+gint           tracker_config_get_commit_batch_max                 (TrackerConfig *config);
+gint           tracker_config_get_commit_target_latency            (TrackerConfig *config);
 gboolean       tracker_config_get_enable_writeback                 (TrackerConfig *config);
 
 void           tracker_config_set_verbosity                        (TrackerConfig *config,
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include "tracker-extraction-queue.h"
+
+struct _TrackerExtractionQueue {
+	GQueue queue;
+	GHashTable *mounts;
+};
+
+TrackerExtractionQueue *
+tracker_extraction_queue_new (void)
+{
+	TrackerExtractionQueue *queue;
+
+	queue = g_slice_new0 (TrackerExtractionQueue);
+	g_queue_init (&queue->queue);
+	queue->mounts = g_hash_table_new_full (g_str_hash,
+	                                       g_str_equal,
+	                                       (GDestroyNotify) g_free,
+	                                       (GDestroyNotify) g_queue_free);
+
+	return queue;
+}
+
+/* Items are not freed, they belong to the caller */
+void
+tracker_extraction_queue_free (TrackerExtractionQueue *queue)
+{
+	g_return_if_fail (queue != NULL);
+
+	g_hash_table_unref (queue->mounts);
+	g_slice_free (TrackerExtractionQueue, queue);
+}
+
+void
+tracker_extraction_queue_add (TrackerExtractionQueue *queue,
+                              TrackerExtractionItem  *item,
+                              const gchar            *mount_uuid)
+{
+	GQueue *mount_queue;
+
+	g_return_if_fail (queue != NULL);
+	g_return_if_fail (item != NULL);
+	g_return_if_fail (item->queue_link.data == NULL);
+
+	item->queue_link.data = item;
+	g_queue_push_head_link (&queue->queue, &item->queue_link);
+
+	if (!mount_uuid) {
+		return;
+	}
+
+	mount_queue = g_hash_table_lookup (queue->mounts, mount_uuid);
+
+	if (!mount_queue) {
+		mount_queue = g_queue_new ();
+		g_hash_table_insert (queue->mounts,
+		                     g_strdup (mount_uuid), mount_queue);
+	}
+
+	item->mount_uuid = g_strdup (mount_uuid);
+	item->mount_link.data = item;
+	g_queue_push_head_link (mount_queue, &item->mount_link);
+}
+
+/* Removes @item from the queue, it is still kept in its
+ * mount queue until released, so unmounts can cancel
+ * failsafe extractions too.
+ */
+void
+tracker_extraction_queue_remove (TrackerExtractionQueue *queue,
+                                 TrackerExtractionItem  *item)
+{
+	g_return_if_fail (queue != NULL);
+	g_return_if_fail (item != NULL);
+
+	if (!item->queue_link.data) {
+		return;
+	}
+
+	g_queue_unlink (&queue->queue, &item->queue_link);
+	item->queue_link.data = NULL;
+}
+
+/* Removes @item from everywhere, it must be called
+ * before the memory holding it is freed.
+ */
+void
+tracker_extraction_queue_release (TrackerExtractionQueue *queue,
+                                  TrackerExtractionItem  *item)
+{
+	GQueue *mount_queue;
+
+	g_return_if_fail (queue != NULL);
+	g_return_if_fail (item != NULL);
+
+	tracker_extraction_queue_remove (queue, item);
+
+	if (!item->mount_uuid) {
+		return;
+	}
+
+	mount_queue = g_hash_table_lookup (queue->mounts, item->mount_uuid);
+	g_queue_unlink (mount_queue, &item->mount_link);
+	item->mount_link.data = NULL;
+
+	if (g_queue_is_empty (mount_queue)) {
+		g_hash_table_remove (queue->mounts, item->mount_uuid);
+	}
+
+	g_free (item->mount_uuid);
+	item->mount_uuid = NULL;
+}
+
+gboolean
+tracker_extraction_queue_is_empty (TrackerExtractionQueue *queue)
+{
+	g_return_val_if_fail (queue != NULL, TRUE);
+
+	return g_queue_is_empty (&queue->queue);
+}
+
+guint
+tracker_extraction_queue_get_n_for_mount (TrackerExtractionQueue *queue,
+                                          const gchar            *mount_uuid)
+{
+	GQueue *mount_queue;
+
+	g_return_val_if_fail (queue != NULL, 0);
+	g_return_val_if_fail (mount_uuid != NULL, 0);
+
+	mount_queue = g_hash_table_lookup (queue->mounts, mount_uuid);
+
+	return mount_queue ? g_queue_get_length (mount_queue) : 0;
+}
+
+/* Cancels every item in @mount_uuid, including the ones
+ * already removed from the queue but not released yet.
+ */
+guint
+tracker_extraction_queue_cancel_for_mount (TrackerExtractionQueue *queue,
+                                           const gchar            *mount_uuid)
+{
+	GPtrArray *cancellables;
+	GQueue *mount_queue;
+	GList *link;
+	guint i, n_cancelled;
+
+	g_return_val_if_fail (queue != NULL, 0);
+	g_return_val_if_fail (mount_uuid != NULL, 0);
+
+	mount_queue = g_hash_table_lookup (queue->mounts, mount_uuid);
+
+	if (!mount_queue) {
+		return 0;
+	}
+
+	/* Cancelling might complete requests right away,
+	 * which would modify the queue under our feet.
+	 */
+	cancellables = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (link = mount_queue->head; link; link = link->next) {
+		TrackerExtractionItem *item = link->data;
+
+		g_ptr_array_add (cancellables, g_object_ref (item->cancellable));
+	}
+
+	n_cancelled = cancellables->len;
+
+	for (i = 0; i < cancellables->len; i++) {
+		g_cancellable_cancel (g_ptr_array_index (cancellables, i));
+	}
+
+	g_ptr_array_unref (cancellables);
+
+	return n_cancelled;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_MINER_FS_EXTRACTION_QUEUE_H__
+#define __TRACKER_MINER_FS_EXTRACTION_QUEUE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Files being processed, indexed by the UUID of the mount they are
+ * in so unmounts only need to look at their own items. Items are
+ * embedded in the caller's own data, so adding and removing them
+ * is O(1).
+ */
+typedef struct _TrackerExtractionQueue TrackerExtractionQueue;
+typedef struct _TrackerExtractionItem TrackerExtractionItem;
+
+struct _TrackerExtractionItem {
+	/* Set by the caller, not owned */
+	GCancellable *cancellable;
+
+	/*< private >*/
+	GList queue_link;
+	GList mount_link;
+	gchar *mount_uuid;
+};
+
+TrackerExtractionQueue * tracker_extraction_queue_new              (void);
+void                     tracker_extraction_queue_free             (TrackerExtractionQueue *queue);
+
+void                     tracker_extraction_queue_add              (TrackerExtractionQueue *queue,
+                                                                    TrackerExtractionItem  *item,
+                                                                    const gchar            *mount_uuid);
+void                     tracker_extraction_queue_remove           (TrackerExtractionQueue *queue,
+                                                                    TrackerExtractionItem  *item);
+void                     tracker_extraction_queue_release          (TrackerExtractionQueue *queue,
+                                                                    TrackerExtractionItem  *item);
+
+gboolean                 tracker_extraction_queue_is_empty         (TrackerExtractionQueue *queue);
+guint                    tracker_extraction_queue_get_n_for_mount  (TrackerExtractionQueue *queue,
+                                                                    const gchar            *mount_uuid);
+guint                    tracker_extraction_queue_cancel_for_mount (TrackerExtractionQueue *queue,
+                                                                    const gchar            *mount_uuid);
+
+G_END_DECLS
+
+#endif /* __TRACKER_MINER_FS_EXTRACTION_QUEUE_H__ */
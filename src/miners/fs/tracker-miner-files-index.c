@@ -36,6 +36,10 @@ static const gchar introspection_xml[] =
   "    <method name='IndexFile'>"
   "      <arg type='s' name='file_uri' direction='in' />"
   "    </method>"
+  "    <method name='BoostDirectory'>"
+  "      <arg type='s' name='directory_uri' direction='in' />"
+  "      <arg type='i' name='priority' direction='in' />"
+  "    </method>"
   "  </interface>"
   "</node>";
 
@@ -377,6 +381,68 @@ handle_method_call_index_file (TrackerMinerFilesIndex *miner,
 	g_object_unref (file);
 }
 
+static void
+handle_method_call_boost_directory (TrackerMinerFilesIndex *miner,
+                                    GDBusMethodInvocation  *invocation,
+                                    GVariant               *parameters)
+{
+	TrackerMinerFilesIndexPrivate *priv;
+	TrackerDBusRequest *request;
+	GFile *file;
+	GFileInfo *file_info;
+	GError *internal_error = NULL;
+	const gchar *directory_uri;
+	gint priority;
+	guint n_boosted;
+
+	priv = TRACKER_MINER_FILES_INDEX_GET_PRIVATE (miner);
+
+	g_variant_get (parameters, "(&si)", &directory_uri, &priority);
+
+	tracker_gdbus_async_return_if_fail (directory_uri != NULL, invocation);
+
+	request = tracker_g_dbus_request_begin (invocation, "%s(uri:'%s', priority:%d)",
+	                                        __FUNCTION__, directory_uri, priority);
+
+	file = g_file_new_for_uri (directory_uri);
+
+	file_info = g_file_query_info (file,
+	                               G_FILE_ATTRIBUTE_STANDARD_TYPE,
+	                               G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                               NULL, NULL);
+
+	if (!file_info) {
+		internal_error = g_error_new_literal (1, 0, "Directory does not exist");
+	} else if (g_file_info_get_file_type (file_info) != G_FILE_TYPE_DIRECTORY) {
+		internal_error = g_error_new_literal (1, 0, "File is not a directory");
+	} else if (!tracker_miner_files_is_file_eligible (priv->files_miner, file)) {
+		internal_error = g_error_new_literal (1, 0, "Directory is not eligible to be indexed");
+	}
+
+	if (file_info) {
+		g_object_unref (file_info);
+	}
+
+	if (internal_error) {
+		tracker_dbus_request_end (request, internal_error);
+		g_dbus_method_invocation_return_gerror (invocation, internal_error);
+
+		g_error_free (internal_error);
+
+		g_object_unref (file);
+
+		return;
+	}
+
+	n_boosted = tracker_miner_files_boost_directory (priv->files_miner, file, priority);
+	tracker_dbus_request_debug (request, "Boosted %u queued items", n_boosted);
+
+	tracker_dbus_request_end (request, NULL);
+	g_dbus_method_invocation_return_value (invocation, NULL);
+
+	g_object_unref (file);
+}
+
 static void
 handle_method_call (GDBusConnection       *connection,
                     const gchar           *sender,
@@ -396,6 +462,8 @@ handle_method_call (GDBusConnection       *connection,
 		tracker_miner_files_index_reindex_mime_types (miner, invocation, parameters);
 	} else if (g_strcmp0 (method_name, "IndexFile") == 0) {
 		handle_method_call_index_file (miner, invocation, parameters);
+	} else if (g_strcmp0 (method_name, "BoostDirectory") == 0) {
+		handle_method_call_boost_directory (miner, invocation, parameters);
 	} else {
 		g_assert_not_reached ();
 	}
@@ -39,6 +39,7 @@
 #include <libtracker-common/tracker-type-utils.h>
 #include <libtracker-common/tracker-utils.h>
 #include <libtracker-common/tracker-file-utils.h>
+#include <libtracker-common/tracker-log.h>
 
 #include <libtracker-data/tracker-db-manager.h>
 
@@ -48,11 +49,26 @@
 #include "tracker-power.h"
 #include "tracker-miner-files.h"
 #include "tracker-config.h"
+#include "tracker-extraction-queue.h"
 #include "tracker-marshal.h"
 
 #define DISK_SPACE_CHECK_FREQUENCY 10
 #define SECONDS_PER_DAY 86400
 
+/* When embedded metadata extraction is deferred, the file level
+ * updates are small, so these can be batched much more aggressively.
+ * The ready pool limit is a lower bound, it's raised further if
+ * adaptive commits need room for larger batches.
+ */
+#define DEFERRED_WAIT_POOL_LIMIT 100
+#define DEFERRED_READY_POOL_LIMIT 1000
+
+/* Maximum number of concurrent extraction requests for the
+ * deferred embedded metadata queue, scaled down by the miner
+ * throttle.
+ */
+#define DEFERRED_EXTRACTION_MAX_REQUESTS 2
+
 #define TRACKER_MINER_FILES_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), TRACKER_TYPE_MINER_FILES, TrackerMinerFilesPrivate))
 
 static GQuark miner_files_error_quark = 0;
@@ -65,6 +81,17 @@ struct ProcessFileData {
 	GCancellable *cancellable;
 	GFile *file;
 	gchar *mime_type;
+
+	TrackerExtractionItem item;
+};
+
+typedef struct DeferredExtractionData DeferredExtractionData;
+
+struct DeferredExtractionData {
+	TrackerMinerFiles *miner;
+	GFile *file;
+	gchar *mime_type;
+	gchar *fingerprint;
 };
 
 struct TrackerMinerFilesPrivate {
@@ -101,10 +128,38 @@ struct TrackerMinerFilesPrivate {
 	guint stale_volumes_check_id;
 
 	guint failed_extraction_pause_cookie;
-	GList *extraction_queue;
+
+	/* Files being processed, items are ProcessFileData */
+	TrackerExtractionQueue *extraction_queue;
 	GList *failed_extraction_queue;
 
 	gboolean failsafe_extraction;
+
+	/* Deferred embedded metadata extraction, items are
+	 * DeferredExtractionData, indexed by GFile.
+	 */
+	gboolean defer_embedded_metadata;
+	GQueue *deferred_extraction_queue;
+	GHashTable *deferred_extraction_files;
+	GCancellable *deferred_extraction_cancellable;
+	guint deferred_extraction_requests;
+	guint deferred_extraction_total;
+	guint deferred_extraction_done;
+	gboolean deferred_extraction_running;
+	GFile *deferred_extraction_boost;
+
+	/* Content fingerprints, used to copy the embedded metadata
+	 * of files already indexed elsewhere instead of extracting
+	 * it again.
+	 */
+	gboolean content_fingerprint;
+	guint content_fingerprint_lookups;
+	guint content_fingerprint_matches;
+
+	/* AttachVolume calls waiting for a reply, cancellables
+	 * indexed by volume UUID.
+	 */
+	GHashTable *volume_attach_requests;
 };
 
 enum {
@@ -114,7 +169,9 @@ enum {
 
 enum {
 	PROP_0,
-	PROP_CONFIG
+	PROP_CONFIG,
+	PROP_CONTENT_FINGERPRINT_LOOKUPS,
+	PROP_CONTENT_FINGERPRINT_MATCHES
 };
 
 static void        miner_files_set_property             (GObject              *object,
@@ -126,6 +183,12 @@ static void        miner_files_get_property             (GObject              *o
                                                          GValue               *value,
                                                          GParamSpec           *pspec);
 static void        miner_files_finalize                 (GObject              *object);
+static void        miner_files_resumed_cb               (TrackerMiner         *miner,
+                                                         gpointer              user_data);
+static void        deferred_extraction_data_free        (gpointer              data);
+static void        deferred_extraction_process          (TrackerMinerFiles    *mf);
+static guint       deferred_extraction_cancel_for_prefix (TrackerMinerFiles    *mf,
+                                                         GFile                *prefix);
 static void        miner_files_initable_iface_init      (GInitableIface       *iface);
 static gboolean    miner_files_initable_init            (GInitable            *initable,
                                                          GCancellable         *cancellable,
@@ -161,6 +224,24 @@ static void        disk_space_check_stop                (TrackerMinerFiles    *m
 static void        low_disk_space_limit_cb              (GObject              *gobject,
                                                          GParamSpec           *arg1,
                                                          gpointer              user_data);
+static void        commit_batching_cb                   (GObject              *gobject,
+                                                         GParamSpec           *arg1,
+                                                         gpointer              user_data);
+static void        io_pressure_throttling_cb            (GObject              *gobject,
+                                                         GParamSpec           *arg1,
+                                                         gpointer              user_data);
+static void        enable_content_fingerprint_cb        (GObject              *gobject,
+                                                         GParamSpec           *arg1,
+                                                         gpointer              user_data);
+static void        enable_checkpoint_cb                 (GObject              *gobject,
+                                                         GParamSpec           *arg1,
+                                                         gpointer              user_data);
+static void        memory_ceiling_cb                    (GObject              *gobject,
+                                                         GParamSpec           *arg1,
+                                                         gpointer              user_data);
+static void        effective_throttle_cb                (GObject              *gobject,
+                                                         GParamSpec           *arg1,
+                                                         gpointer              user_data);
 static void        index_recursive_directories_cb       (GObject              *gobject,
                                                          GParamSpec           *arg1,
                                                          gpointer              user_data);
@@ -238,6 +319,21 @@ tracker_miner_files_class_init (TrackerMinerFilesClass *klass)
 	                                                      "Config",
 	                                                      TRACKER_TYPE_CONFIG,
 	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+	g_object_class_install_property (object_class,
+	                                 PROP_CONTENT_FINGERPRINT_LOOKUPS,
+	                                 g_param_spec_uint ("content-fingerprint-lookups",
+	                                                    "Content fingerprint lookups",
+	                                                    "Number of files looked up by content fingerprint",
+	                                                    0, G_MAXUINT, 0,
+	                                                    G_PARAM_READABLE));
+	g_object_class_install_property (object_class,
+	                                 PROP_CONTENT_FINGERPRINT_MATCHES,
+	                                 g_param_spec_uint ("content-fingerprint-matches",
+	                                                    "Content fingerprint matches",
+	                                                    "Number of files whose embedded metadata was copied "
+	                                                    "from an indexed file with the same contents",
+	                                                    0, G_MAXUINT, 0,
+	                                                    G_PARAM_READABLE));
 
 	g_type_class_add_private (klass, sizeof (TrackerMinerFilesPrivate));
 
@@ -282,6 +378,25 @@ tracker_miner_files_init (TrackerMinerFiles *mf)
 	                  mf);
 
 	priv->quark_mount_point_uuid = g_quark_from_static_string ("tracker-mount-point-uuid");
+
+	priv->extraction_queue = tracker_extraction_queue_new ();
+
+	priv->volume_attach_requests = g_hash_table_new_full (g_str_hash,
+	                                                      g_str_equal,
+	                                                      (GDestroyNotify) g_free,
+	                                                      (GDestroyNotify) g_object_unref);
+
+	priv->deferred_extraction_queue = g_queue_new ();
+	priv->deferred_extraction_files = g_hash_table_new ((GHashFunc) g_file_hash,
+	                                                    (GEqualFunc) g_file_equal);
+	priv->deferred_extraction_cancellable = g_cancellable_new ();
+
+	g_signal_connect (mf, "resumed",
+	                  G_CALLBACK (miner_files_resumed_cb),
+	                  NULL);
+	g_signal_connect (mf, "notify::effective-throttle",
+	                  G_CALLBACK (effective_throttle_cb),
+	                  NULL);
 }
 
 static void
@@ -291,6 +406,77 @@ miner_files_initable_iface_init (GInitableIface *iface)
 	iface->init = miner_files_initable_init;
 }
 
+static void
+miner_files_update_checkpoint (TrackerMinerFiles *mf)
+{
+	gchar *checkpoint_path = NULL;
+
+	/* Lets indexing resume where it was left if the
+	 * miner gets killed, i.e. on ignition-off.
+	 */
+	if (tracker_config_get_enable_checkpoint (mf->private->config)) {
+		gchar *name, *lower, *filename;
+
+		g_object_get (mf, "name", &name, NULL);
+		lower = g_ascii_strdown (name, -1);
+		filename = g_strdup_printf ("miner-%s.checkpoint", lower);
+		checkpoint_path = g_build_filename (g_get_user_cache_dir (),
+		                                    "tracker",
+		                                    filename,
+		                                    NULL);
+		g_free (filename);
+		g_free (lower);
+		g_free (name);
+	}
+
+	/* A NULL path drops the checkpoint */
+	g_object_set (mf, "checkpoint-path", checkpoint_path, NULL);
+	g_free (checkpoint_path);
+}
+
+static void
+miner_files_update_commit_batching (TrackerMinerFiles *mf)
+{
+	gint batch_min, batch_max, target_latency;
+	guint wait_limit, ready_limit;
+
+	batch_min = tracker_config_get_commit_batch_min (mf->private->config);
+	batch_max = tracker_config_get_commit_batch_max (mf->private->config);
+	target_latency = tracker_config_get_commit_target_latency (mf->private->config);
+
+	g_object_get (mf,
+	              "processing-pool-wait-limit", &wait_limit,
+	              "processing-pool-ready-limit", &ready_limit,
+	              NULL);
+
+	if (mf->private->defer_embedded_metadata) {
+		wait_limit = MAX (wait_limit, DEFERRED_WAIT_POOL_LIMIT);
+		ready_limit = MAX (ready_limit, DEFERRED_READY_POOL_LIMIT);
+	}
+
+	if (target_latency > 0) {
+		g_message ("Adapting commits to take %d ms, with %d to %d files each",
+		           target_latency, batch_min, MAX (batch_min, batch_max));
+
+		/* Leave room for the next batch while one is being committed */
+		ready_limit = MAX (ready_limit, 2 * (guint) MAX (batch_min, batch_max));
+	}
+
+	g_message ("Processing pool limits are %u waiting and %u ready files",
+	           wait_limit, ready_limit);
+
+	g_object_set (mf,
+	              "processing-pool-wait-limit", wait_limit,
+	              "processing-pool-ready-limit", ready_limit,
+	              NULL);
+
+	g_object_set (mf,
+	              "commit-batch-min", batch_min,
+	              "commit-batch-max", MAX (batch_min, batch_max),
+	              "commit-target-latency", target_latency,
+	              NULL);
+}
+
 static gboolean
 miner_files_initable_init (GInitable     *initable,
                            GCancellable  *cancellable,
@@ -340,6 +526,29 @@ miner_files_initable_init (GInitable     *initable,
 		return FALSE;
 	}
 
+	/* Commit the file level data first and extract embedded
+	 * metadata afterwards, the SPARQL updates are small then, so
+	 * merge many more of them per connection to the store.
+	 */
+	mf->private->defer_embedded_metadata = tracker_config_get_defer_embedded_metadata (mf->private->config);
+	if (mf->private->defer_embedded_metadata) {
+		g_message ("Embedded metadata extraction is deferred until files are indexed");
+	}
+
+	/* Sets the processing pool limits for both */
+	miner_files_update_commit_batching (mf);
+
+	mf->private->content_fingerprint = tracker_config_get_enable_content_fingerprint (mf->private->config);
+
+	miner_files_update_checkpoint (mf);
+
+	g_object_set (fs,
+	              "io-pressure-throttling",
+	              tracker_config_get_io_pressure_throttling (mf->private->config),
+	              "memory-ceiling",
+	              tracker_config_get_memory_ceiling (mf->private->config) * 1024,
+	              NULL);
+
 	/* If this happened AFTER we have initialized mount points, initialize
 	 * stale volume removal now. */
 	if (mf->private->mount_points_initialized) {
@@ -535,6 +744,27 @@ miner_files_initable_init (GInitable     *initable,
 	g_signal_connect (mf->private->config, "notify::removable-days-threshold",
 	                  G_CALLBACK (index_volumes_changed_cb),
 	                  mf);
+	g_signal_connect (mf->private->config, "notify::commit-batch-min",
+	                  G_CALLBACK (commit_batching_cb),
+	                  mf);
+	g_signal_connect (mf->private->config, "notify::commit-batch-max",
+	                  G_CALLBACK (commit_batching_cb),
+	                  mf);
+	g_signal_connect (mf->private->config, "notify::commit-target-latency",
+	                  G_CALLBACK (commit_batching_cb),
+	                  mf);
+	g_signal_connect (mf->private->config, "notify::io-pressure-throttling",
+	                  G_CALLBACK (io_pressure_throttling_cb),
+	                  mf);
+	g_signal_connect (mf->private->config, "notify::enable-content-fingerprint",
+	                  G_CALLBACK (enable_content_fingerprint_cb),
+	                  mf);
+	g_signal_connect (mf->private->config, "notify::enable-checkpoint",
+	                  G_CALLBACK (enable_checkpoint_cb),
+	                  mf);
+	g_signal_connect (mf->private->config, "notify::memory-ceiling",
+	                  G_CALLBACK (memory_ceiling_cb),
+	                  mf);
 
 #if defined(HAVE_UPOWER) || defined(HAVE_HAL)
 
@@ -589,6 +819,12 @@ miner_files_get_property (GObject    *object,
 	case PROP_CONFIG:
 		g_value_set_object (value, priv->config);
 		break;
+	case PROP_CONTENT_FINGERPRINT_LOOKUPS:
+		g_value_set_uint (value, priv->content_fingerprint_lookups);
+		break;
+	case PROP_CONTENT_FINGERPRINT_MATCHES:
+		g_value_set_uint (value, priv->content_fingerprint_matches);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -650,9 +886,30 @@ miner_files_finalize (GObject *object)
 		priv->stale_volumes_check_id = 0;
 	}
 
-	g_list_free (priv->extraction_queue);
+	/* Same as below, every ProcessFileData holds a
+	 * reference on the miner, so these are empty.
+	 */
+	tracker_extraction_queue_free (priv->extraction_queue);
 	g_list_free (priv->failed_extraction_queue);
 
+	/* Pending AttachVolume calls hold a reference too */
+	g_hash_table_unref (priv->volume_attach_requests);
+
+	/* Ongoing requests hold a reference on the miner, so
+	 * there can't be any left at this point.
+	 */
+	g_cancellable_cancel (priv->deferred_extraction_cancellable);
+	g_object_unref (priv->deferred_extraction_cancellable);
+	g_queue_foreach (priv->deferred_extraction_queue,
+	                 (GFunc) deferred_extraction_data_free,
+	                 NULL);
+	g_queue_free (priv->deferred_extraction_queue);
+	g_hash_table_unref (priv->deferred_extraction_files);
+
+	if (priv->deferred_extraction_boost) {
+		g_object_unref (priv->deferred_extraction_boost);
+	}
+
 	G_OBJECT_CLASS (tracker_miner_files_parent_class)->finalize (object);
 }
 
@@ -1149,17 +1406,43 @@ mount_point_removed_cb (TrackerStorage *storage,
 {
 	TrackerMinerFiles *miner = user_data;
 	TrackerIndexingTree *indexing_tree;
+	GCancellable *attach_cancellable;
 	gchar *urn;
 	GFile *mount_point_file;
+	guint n_cancelled;
 
 	urn = g_strdup_printf (TRACKER_DATASOURCE_URN_PREFIX "%s", uuid);
 	g_debug ("Mount point removed for URN '%s'", urn);
 
 	mount_point_file = g_file_new_for_path (mount_point);
 
+	/* Don't start crawling the mount point if the store
+	 * replies after it went away.
+	 */
+	attach_cancellable = g_hash_table_lookup (miner->private->volume_attach_requests, uuid);
+
+	if (attach_cancellable) {
+		g_cancellable_cancel (attach_cancellable);
+	}
+
 	/* Notify extractor about cancellation of all tasks under the mount point */
 	tracker_extract_client_cancel_for_prefix (mount_point_file);
 
+	/* Cancel our own requests for files in the mount */
+	n_cancelled = tracker_extraction_queue_cancel_for_mount (miner->private->extraction_queue, uuid);
+	n_cancelled += deferred_extraction_cancel_for_prefix (miner, mount_point_file);
+
+	if (n_cancelled > 0) {
+		g_debug ("  Cancelled %u pending extraction(s) in the mount point",
+		         n_cancelled);
+	}
+
+	/* Drop everything else queued, buffered or being crawled
+	 * there at once, instead of having it fail item by item.
+	 */
+	tracker_miner_fs_cancel_for_prefix (TRACKER_MINER_FS (miner),
+	                                    mount_point_file);
+
 	/* Tell TrackerMinerFS to skip monitoring everything under the mount
 	 *  point (in case there was no pre-unmount notification) */
 	indexing_tree = tracker_miner_fs_get_indexing_tree (TRACKER_MINER_FS (miner));
@@ -1546,6 +1829,68 @@ low_disk_space_limit_cb (GObject    *gobject,
 	disk_space_check_cb (mf);
 }
 
+static void
+commit_batching_cb (GObject    *gobject,
+                    GParamSpec *arg1,
+                    gpointer    user_data)
+{
+	miner_files_update_commit_batching (user_data);
+}
+
+static void
+io_pressure_throttling_cb (GObject    *gobject,
+                           GParamSpec *arg1,
+                           gpointer    user_data)
+{
+	TrackerMinerFiles *mf = user_data;
+
+	g_object_set (mf,
+	              "io-pressure-throttling",
+	              tracker_config_get_io_pressure_throttling (mf->private->config),
+	              NULL);
+}
+
+static void
+memory_ceiling_cb (GObject    *gobject,
+                   GParamSpec *arg1,
+                   gpointer    user_data)
+{
+	TrackerMinerFiles *mf = user_data;
+
+	/* Configured in MB, the miner takes KB */
+	g_object_set (mf,
+	              "memory-ceiling",
+	              tracker_config_get_memory_ceiling (mf->private->config) * 1024,
+	              NULL);
+}
+
+static void
+enable_content_fingerprint_cb (GObject    *gobject,
+                               GParamSpec *arg1,
+                               gpointer    user_data)
+{
+	TrackerMinerFiles *mf = user_data;
+
+	mf->private->content_fingerprint = tracker_config_get_enable_content_fingerprint (mf->private->config);
+}
+
+static void
+enable_checkpoint_cb (GObject    *gobject,
+                      GParamSpec *arg1,
+                      gpointer    user_data)
+{
+	miner_files_update_checkpoint (user_data);
+}
+
+static void
+effective_throttle_cb (GObject    *gobject,
+                       GParamSpec *arg1,
+                       gpointer    user_data)
+{
+	/* More deferred extraction requests may fit now */
+	deferred_extraction_process (TRACKER_MINER_FILES (gobject));
+}
+
 static void
 indexing_tree_update_filter (TrackerIndexingTree *indexing_tree,
 			     TrackerFilterType    filter,
@@ -1981,6 +2326,8 @@ miner_files_add_to_datasource (TrackerMinerFiles    *mf,
 static void
 process_file_data_free (ProcessFileData *data)
 {
+	tracker_extraction_queue_release (data->miner->private->extraction_queue, &data->item);
+
 	g_object_unref (data->miner);
 	g_object_unref (data->sparql);
 	g_object_unref (data->cancellable);
@@ -2203,7 +2550,7 @@ extractor_check_process_failsafe (TrackerMinerFiles *miner)
 		return;
 	}
 
-	if (priv->extraction_queue ||
+	if (!tracker_extraction_queue_is_empty (priv->extraction_queue) ||
 	    !priv->failed_extraction_queue) {
 		/* No reasons (yet) to start failsafe extraction */
 		return;
@@ -2228,7 +2575,7 @@ extractor_get_embedded_metadata_cb (GObject      *object,
 
 	miner = data->miner;
 	priv = miner->private;
-	priv->extraction_queue = g_list_remove (priv->extraction_queue, data);
+	tracker_extraction_queue_remove (priv->extraction_queue, &data->item);
 	info = tracker_extract_client_get_metadata_finish (G_FILE (object), res, &error);
 
 	if (error) {
@@ -2284,128 +2631,853 @@ extractor_get_embedded_metadata_cb (GObject      *object,
 }
 
 static void
-process_file_cb (GObject      *object,
-                 GAsyncResult *result,
-                 gpointer      user_data)
+content_fingerprint_thread (GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
 {
-	TrackerMinerFilesPrivate *priv;
-	TrackerSparqlBuilder *sparql;
-	ProcessFileData *data;
-	const gchar *mime_type, *urn, *parent_urn;
-	GFileInfo *file_info;
-	guint64 time_;
-	GFile *file;
-	gchar *uri;
 	GError *error = NULL;
-	gboolean is_iri;
-	gboolean is_directory;
-
-	data = user_data;
-	file = G_FILE (object);
-	sparql = data->sparql;
-	file_info = g_file_query_info_finish (file, result, &error);
-	priv = TRACKER_MINER_FILES (data->miner)->private;
+	gchar *fingerprint;
 
-	if (error) {
-		/* Something bad happened, notify about the error */
-		tracker_miner_fs_file_notify (TRACKER_MINER_FS (data->miner), file, error);
-		priv->extraction_queue = g_list_remove (priv->extraction_queue, data);
-		process_file_data_free (data);
-		g_error_free (error);
+	fingerprint = tracker_file_get_content_fingerprint (task_data, cancellable, &error);
 
-		return;
+	if (fingerprint) {
+		g_task_return_pointer (task, fingerprint, g_free);
+	} else {
+		g_task_return_error (task, error);
 	}
+}
 
-	uri = g_file_get_uri (file);
-	mime_type = g_file_info_get_content_type (file_info);
-	urn = miner_files_get_file_urn (TRACKER_MINER_FILES (data->miner), file, &is_iri);
+static void
+content_fingerprint_compute_async (GFile               *file,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+	GTask *task;
 
-	data->mime_type = g_strdup (mime_type);
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+	g_task_run_in_thread (task, content_fingerprint_thread);
+	g_object_unref (task);
+}
 
-	tracker_sparql_builder_insert_silent_open (sparql, NULL);
-	tracker_sparql_builder_graph_open (sparql, TRACKER_MINER_FS_GRAPH_URN);
+static gchar *
+content_fingerprint_compute_finish (GAsyncResult  *result,
+                                    GError       **error)
+{
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
 
-	if (is_iri) {
-		tracker_sparql_builder_subject_iri (sparql, urn);
-	} else {
-		tracker_sparql_builder_subject (sparql, urn);
-	}
+/* Looks up another file with @fingerprint, only copies
+ * that went through extraction are any use.
+ */
+static gchar *
+content_fingerprint_build_query (GFile       *file,
+                                 const gchar *fingerprint)
+{
+	gchar *uri, *escaped_uri, *query;
 
-	tracker_sparql_builder_predicate (sparql, "a");
-	tracker_sparql_builder_object (sparql, "ivi:File");
+	uri = g_file_get_uri (file);
+	escaped_uri = tracker_sparql_escape_string (uri);
+
+	query = g_strdup_printf ("SELECT ?s WHERE { "
+	                         "  ?s ivi:filefingerprint \"%s\" ; "
+	                         "     a ?type ; "
+	                         "     ivi:fileurl ?url . "
+	                         "  FILTER (?type IN (ivi:Track, ivi:Image, ivi:Video) && "
+	                         "          ?url != \"%s\") "
+	                         "} LIMIT 1",
+	                         fingerprint, escaped_uri);
+
+	g_free (escaped_uri);
+	g_free (uri);
 
-	is_directory = (g_file_info_get_file_type (file_info) == G_FILE_TYPE_DIRECTORY ?
-	                TRUE : FALSE);
+	return query;
+}
 
-/*	if (is_directory) {
-		tracker_sparql_builder_object (sparql, "ivi:Folder");
-	}
-*/
-	parent_urn = tracker_miner_fs_get_parent_urn (TRACKER_MINER_FS (data->miner), file);
-/*
-	if (parent_urn) {
-		tracker_sparql_builder_predicate (sparql, "nfo:belongsToContainer");
-		tracker_sparql_builder_object_iri (sparql, parent_urn);
+/* Copies everything but the file level data from @source, an already
+ * indexed file with the same contents, replacing earlier values.
+ */
+static gchar *
+content_fingerprint_build_copy (GFile       *file,
+                                const gchar *source)
+{
+	gchar *uri, *escaped_uri, *update;
+
+	uri = g_file_get_uri (file);
+	escaped_uri = tracker_sparql_escape_string (uri);
+
+	update = g_strdup_printf ("INSERT OR REPLACE { GRAPH <%s> {"
+	                          "  ?f ?p ?o "
+	                          "} } WHERE { "
+	                          "  ?f ivi:fileurl \"%s\" . "
+	                          "  <%s> ?p ?o . "
+	                          "  FILTER (?p NOT IN (ivi:filename, ivi:fileurl, ivi:mimetype, "
+	                          "                     ivi:fileLastModified, ivi:filecreated, "
+	                          "                     ivi:filefingerprint, nie:dataSource, "
+	                          "                     nfo:belongsToContainer, nfo:fileLastAccessed, "
+	                          "                     tracker:available, tracker:added, "
+	                          "                     tracker:modified)) "
+	                          "}",
+	                          TRACKER_MINER_FS_GRAPH_URN, escaped_uri, source);
+
+	g_free (escaped_uri);
+	g_free (uri);
+
+	return update;
+}
+
+static void
+content_fingerprint_print_stats (TrackerMinerFiles *mf)
+{
+	TrackerMinerFilesPrivate *priv = mf->private;
+
+	if (priv->content_fingerprint_lookups > 0) {
+		tracker_info ("Content fingerprints : %u looked up, %u matched (%.1f%%)",
+		              priv->content_fingerprint_lookups,
+		              priv->content_fingerprint_matches,
+		              100.0 * priv->content_fingerprint_matches /
+		              priv->content_fingerprint_lookups);
 	}
-*/
-	tracker_sparql_builder_predicate (sparql, "ivi:filename");
-	tracker_sparql_builder_object_string (sparql, g_file_info_get_display_name (file_info));
+}
 
-/*	tracker_sparql_builder_predicate (sparql, "nfo:fileSize");
-	tracker_sparql_builder_object_int64 (sparql, g_file_info_get_size (file_info));
-*/
-	time_ = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
-	tracker_sparql_builder_predicate (sparql, "ivi:fileLastModified");
-	tracker_sparql_builder_object_date (sparql, (time_t *) &time_);
+static void
+deferred_extraction_data_free (gpointer user_data)
+{
+	DeferredExtractionData *data = user_data;
 
-/*
-	time_ = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_ACCESS);
-	tracker_sparql_builder_predicate (sparql, "nfo:fileLastAccessed");
-	tracker_sparql_builder_object_date (sparql, (time_t *) &time_);
-*/
-	/* Laying the link between the IE and the DO. We use IE = DO */
-//	tracker_sparql_builder_predicate (sparql, "nie:isStoredAs");
-//	if (is_iri) {
-//		tracker_sparql_builder_object_iri (sparql, urn);
-//	} else {
-//		tracker_sparql_builder_object (sparql, urn);
-//	}
+	g_object_unref (data->file);
+	g_free (data->mime_type);
+	g_free (data->fingerprint);
+	g_slice_free (DeferredExtractionData, data);
+}
 
-	/* The URL of the DataObject (because IE = DO, this is correct) */
-	tracker_sparql_builder_predicate (sparql, "ivi:fileurl");
-	tracker_sparql_builder_object_string (sparql, uri);
+static gboolean
+deferred_extraction_is_boosted (GFile *file,
+                                GFile *directory)
+{
+	return (directory &&
+	        (g_file_equal (file, directory) ||
+	         g_file_has_prefix (file, directory)));
+}
 
-	tracker_sparql_builder_predicate (sparql, "ivi:mimetype");
-	tracker_sparql_builder_object_string (sparql, mime_type);
+/* Queues embedded metadata extraction for a file whose file level
+ * data was already handed to the store. Files changed while the
+ * queue is being processed go first, so recent changes aren't held
+ * up by the backlog of the initial crawl, and so do files within
+ * the last boosted directory.
+ */
+static void
+deferred_extraction_push (TrackerMinerFiles *mf,
+                          GFile             *file,
+                          const gchar       *mime_type)
+{
+	TrackerMinerFilesPrivate *priv;
+	DeferredExtractionData *data;
+	GList *link;
 
-	miner_files_add_to_datasource (data->miner, file, sparql);
+	priv = mf->private;
+	link = g_hash_table_lookup (priv->deferred_extraction_files, file);
 
-	if (tracker_extract_module_manager_mimetype_is_handled (mime_type)) {
-		/* Next step, if handled by the extractor, get embedded metadata */
-		tracker_extract_client_get_metadata (data->file,
-		                                     mime_type,
-		                                     TRACKER_MINER_FS_GRAPH_URN,
-		                                     data->cancellable,
-		                                     extractor_get_embedded_metadata_cb,
-		                                     data);
+	if (link) {
+		data = link->data;
+
+		g_free (data->mime_type);
+		data->mime_type = g_strdup (mime_type);
+		g_queue_unlink (priv->deferred_extraction_queue, link);
 	} else {
-		/* Otherwise, don't request embedded metadata extraction. */
-		g_debug ("Avoiding embedded metadata request for uri '%s'", uri);
-		sparql_builder_finish (data, NULL, NULL, NULL, NULL);
-		tracker_miner_fs_file_notify (TRACKER_MINER_FS (data->miner), data->file, NULL);
+		data = g_slice_new0 (DeferredExtractionData);
+		data->miner = mf;
+		data->file = g_object_ref (file);
+		data->mime_type = g_strdup (mime_type);
 
-		priv->extraction_queue = g_list_remove (priv->extraction_queue, data);
-		extractor_check_process_failsafe (data->miner);
-		process_file_data_free (data);
+		link = g_list_alloc ();
+		link->data = data;
+
+		g_hash_table_insert (priv->deferred_extraction_files, data->file, link);
+		priv->deferred_extraction_total++;
 	}
 
-	g_object_unref (file_info);
-	g_free (uri);
+	if (priv->deferred_extraction_running ||
+	    deferred_extraction_is_boosted (file, priv->deferred_extraction_boost)) {
+		g_queue_push_head_link (priv->deferred_extraction_queue, link);
+	} else {
+		g_queue_push_tail_link (priv->deferred_extraction_queue, link);
+	}
 }
 
-static gboolean
-miner_files_process_file (TrackerMinerFS       *fs,
-                          GFile                *file,
+static void
+deferred_extraction_update_progress (TrackerMinerFiles *mf)
+{
+	TrackerMinerFilesPrivate *priv;
+	gdouble progress;
+
+	priv = mf->private;
+
+	/* Leave the status alone while the file level data is
+	 * being processed, that takes precedence.
+	 */
+	if (tracker_miner_fs_has_items_to_process (TRACKER_MINER_FS (mf))) {
+		return;
+	}
+
+	if (!priv->deferred_extraction_running) {
+		/* Second phase done, report it as the miner going idle */
+		g_object_set (mf,
+		              "status", "Idle",
+		              "progress", 1.0,
+		              "remaining-time", 0,
+		              NULL);
+		return;
+	}
+
+	progress = (gdouble) priv->deferred_extraction_done /
+		MAX (priv->deferred_extraction_total, 1);
+
+	/* 0.0 and 1.0 have special meanings for the miner status */
+	g_object_set (mf,
+	              "status", "Extracting metadata…",
+	              "progress", CLAMP (progress, 0.01, 0.99),
+	              NULL);
+}
+
+/* The file level data went in without it, it's only known now */
+static void
+deferred_extraction_append_fingerprint (DeferredExtractionData *data,
+                                        GString                *str)
+{
+	gchar *uri, *escaped_uri;
+
+	if (!data->fingerprint) {
+		return;
+	}
+
+	uri = g_file_get_uri (data->file);
+	escaped_uri = tracker_sparql_escape_string (uri);
+
+	g_string_append_printf (str,
+	                        " INSERT OR REPLACE { GRAPH <%s> { ?file ivi:filefingerprint \"%s\" } } "
+	                        "WHERE { ?file ivi:fileurl \"%s\" } ",
+	                        TRACKER_MINER_FS_GRAPH_URN,
+	                        data->fingerprint,
+	                        escaped_uri);
+
+	g_free (escaped_uri);
+	g_free (uri);
+}
+
+static gchar *
+deferred_extraction_build_update (DeferredExtractionData *data,
+                                  TrackerExtractInfo     *info)
+{
+	const gchar *preupdate, *postupdate, *sparql, *where;
+	gchar *uri, *escaped_uri;
+	GString *str;
+
+	sparql = tracker_sparql_builder_get_result (tracker_extract_info_get_metadata_builder (info));
+
+	if (!sparql || !*sparql) {
+		return NULL;
+	}
+
+	preupdate = tracker_sparql_builder_get_result (tracker_extract_info_get_preupdate_builder (info));
+	postupdate = tracker_sparql_builder_get_result (tracker_extract_info_get_postupdate_builder (info));
+	where = tracker_extract_info_get_where_clause (info);
+
+	uri = g_file_get_uri (data->file);
+	escaped_uri = tracker_sparql_escape_string (uri);
+	str = g_string_new (preupdate);
+
+	/* The file level data is already in the store, add the
+	 * embedded metadata to the existing resource. Values left
+	 * from an earlier extraction are replaced, errors are not
+	 * silenced so they reach deferred_extraction_update_cb().
+	 */
+	g_string_append_printf (str,
+	                        "INSERT OR REPLACE { GRAPH <%s> { ?file %s } } "
+	                        "WHERE { ?file ivi:fileurl \"%s\" . %s } ",
+	                        TRACKER_MINER_FS_GRAPH_URN,
+	                        sparql,
+	                        escaped_uri,
+	                        where ? where : "");
+
+	if (postupdate) {
+		g_string_append (str, postupdate);
+	}
+
+	g_free (escaped_uri);
+	g_free (uri);
+
+	deferred_extraction_append_fingerprint (data, str);
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+deferred_extraction_finish (DeferredExtractionData *data)
+{
+	TrackerMinerFiles *mf = data->miner;
+
+	mf->private->deferred_extraction_requests--;
+	mf->private->deferred_extraction_done++;
+	deferred_extraction_data_free (data);
+
+	deferred_extraction_process (mf);
+	g_object_unref (mf);
+}
+
+static void
+deferred_extraction_update_cb (GObject      *object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+	DeferredExtractionData *data = user_data;
+	GError *error = NULL;
+
+	tracker_sparql_connection_update_finish (TRACKER_SPARQL_CONNECTION (object),
+	                                         result,
+	                                         &error);
+
+	if (error) {
+		gchar *uri;
+
+		uri = g_file_get_uri (data->file);
+		g_warning ("Could not store embedded metadata for '%s': %s",
+		           uri, error->message);
+		g_error_free (error);
+		g_free (uri);
+	}
+
+	deferred_extraction_finish (data);
+}
+
+static void
+deferred_extraction_store (DeferredExtractionData *data,
+                           const gchar            *update)
+{
+	tracker_sparql_connection_update_async (tracker_miner_get_connection (TRACKER_MINER (data->miner)),
+	                                        update,
+	                                        G_PRIORITY_LOW,
+	                                        data->miner->private->deferred_extraction_cancellable,
+	                                        deferred_extraction_update_cb,
+	                                        data);
+}
+
+static void
+deferred_extraction_get_metadata_cb (GObject      *object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+	DeferredExtractionData *data = user_data;
+	TrackerExtractInfo *info;
+	GError *error = NULL;
+	gchar *update;
+
+	info = tracker_extract_client_get_metadata_finish (G_FILE (object), result, &error);
+
+	if (error) {
+		gchar *uri;
+
+		uri = g_file_get_uri (data->file);
+		g_message ("Could not extract embedded metadata for '%s': %s",
+		           uri, error->message);
+		g_error_free (error);
+		g_free (uri);
+
+		deferred_extraction_finish (data);
+		return;
+	}
+
+	update = deferred_extraction_build_update (data, info);
+
+	if (!update) {
+		deferred_extraction_finish (data);
+		return;
+	}
+
+	deferred_extraction_store (data, update);
+	g_free (update);
+}
+
+static void
+deferred_extraction_extract (DeferredExtractionData *data)
+{
+	tracker_extract_client_get_metadata (data->file,
+	                                     data->mime_type,
+	                                     TRACKER_MINER_FS_GRAPH_URN,
+	                                     data->miner->private->deferred_extraction_cancellable,
+	                                     deferred_extraction_get_metadata_cb,
+	                                     data);
+}
+
+static void
+deferred_extraction_query_cb (GObject      *object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+	DeferredExtractionData *data = user_data;
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+
+	cursor = tracker_sparql_connection_query_finish (TRACKER_SPARQL_CONNECTION (object),
+	                                                 result, &error);
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		deferred_extraction_finish (data);
+	} else if (cursor && tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		const gchar *source;
+		gchar *uri, *copy;
+		GString *update;
+
+		source = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+		data->miner->private->content_fingerprint_matches++;
+
+		uri = g_file_get_uri (data->file);
+		g_debug ("Copying embedded metadata for '%s' from <%s>", uri, source);
+		g_free (uri);
+
+		copy = content_fingerprint_build_copy (data->file, source);
+		update = g_string_new (copy);
+		deferred_extraction_append_fingerprint (data, update);
+		deferred_extraction_store (data, update->str);
+		g_string_free (update, TRUE);
+		g_free (copy);
+	} else {
+		if (error) {
+			g_debug ("Could not look up content fingerprint: %s",
+			         error->message);
+		}
+
+		/* No copy indexed yet, extract it */
+		deferred_extraction_extract (data);
+	}
+
+	g_clear_error (&error);
+	g_clear_object (&cursor);
+}
+
+static void
+deferred_extraction_fingerprint_cb (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+	DeferredExtractionData *data = user_data;
+	TrackerMinerFilesPrivate *priv;
+	GError *error = NULL;
+	gchar *query;
+
+	priv = data->miner->private;
+	data->fingerprint = content_fingerprint_compute_finish (result, &error);
+
+	if (!data->fingerprint) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			deferred_extraction_finish (data);
+		} else {
+			g_debug ("Could not compute content fingerprint: %s",
+			         error->message);
+			deferred_extraction_extract (data);
+		}
+
+		g_error_free (error);
+		return;
+	}
+
+	query = content_fingerprint_build_query (data->file, data->fingerprint);
+	priv->content_fingerprint_lookups++;
+
+	tracker_sparql_connection_query_async (tracker_miner_get_connection (TRACKER_MINER (data->miner)),
+	                                       query,
+	                                       priv->deferred_extraction_cancellable,
+	                                       deferred_extraction_query_cb,
+	                                       data);
+	g_free (query);
+}
+
+/* Second indexing phase, runs once the miner has gone through all
+ * pending files, and whenever it goes idle again afterwards. New
+ * requests are held back while there is file level data to process.
+ */
+static void
+deferred_extraction_process (TrackerMinerFiles *mf)
+{
+	TrackerMinerFilesPrivate *priv;
+	gdouble throttle;
+	guint max_requests;
+
+	priv = mf->private;
+
+	g_object_get (mf, "effective-throttle", &throttle, NULL);
+	max_requests = (guint) (DEFERRED_EXTRACTION_MAX_REQUESTS * (1 - throttle) + 0.5);
+	max_requests = MAX (max_requests, 1);
+
+	while (priv->deferred_extraction_requests < max_requests &&
+	       !g_queue_is_empty (priv->deferred_extraction_queue) &&
+	       !tracker_miner_is_paused (TRACKER_MINER (mf)) &&
+	       !tracker_miner_fs_has_items_to_process (TRACKER_MINER_FS (mf))) {
+		DeferredExtractionData *data;
+
+		if (!priv->deferred_extraction_running) {
+			g_message ("Files indexed, extracting embedded metadata for %u files",
+			           g_queue_get_length (priv->deferred_extraction_queue));
+			priv->deferred_extraction_running = TRUE;
+		}
+
+		data = g_queue_pop_head (priv->deferred_extraction_queue);
+		g_hash_table_remove (priv->deferred_extraction_files, data->file);
+		priv->deferred_extraction_requests++;
+
+		/* Keep the miner alive while the request is ongoing */
+		g_object_ref (mf);
+
+		if (priv->content_fingerprint) {
+			/* Look for an indexed copy first, extract otherwise */
+			content_fingerprint_compute_async (data->file,
+			                                   priv->deferred_extraction_cancellable,
+			                                   deferred_extraction_fingerprint_cb,
+			                                   data);
+		} else {
+			deferred_extraction_extract (data);
+		}
+	}
+
+	if (!priv->deferred_extraction_running) {
+		return;
+	}
+
+	if (priv->deferred_extraction_requests == 0 &&
+	    g_queue_is_empty (priv->deferred_extraction_queue)) {
+		g_message ("Embedded metadata extracted for %u files",
+		           priv->deferred_extraction_done);
+		content_fingerprint_print_stats (mf);
+
+		priv->deferred_extraction_running = FALSE;
+		priv->deferred_extraction_total = 0;
+		priv->deferred_extraction_done = 0;
+
+		if (priv->deferred_extraction_boost) {
+			g_object_unref (priv->deferred_extraction_boost);
+			priv->deferred_extraction_boost = NULL;
+		}
+	}
+
+	deferred_extraction_update_progress (mf);
+}
+
+/* Moves the pending extraction requests for files within
+ * @directory to the head of the queue, keeping their order.
+ */
+static guint
+deferred_extraction_boost (TrackerMinerFiles *mf,
+                           GFile             *directory)
+{
+	TrackerMinerFilesPrivate *priv;
+	GQueue boosted = G_QUEUE_INIT;
+	GList *link, *next;
+	guint n_boosted;
+
+	priv = mf->private;
+
+	if (priv->deferred_extraction_boost) {
+		g_object_unref (priv->deferred_extraction_boost);
+	}
+
+	priv->deferred_extraction_boost = g_object_ref (directory);
+
+	for (link = priv->deferred_extraction_queue->head; link; link = next) {
+		DeferredExtractionData *data = link->data;
+
+		next = link->next;
+
+		if (deferred_extraction_is_boosted (data->file, directory)) {
+			g_queue_unlink (priv->deferred_extraction_queue, link);
+			g_queue_push_tail_link (&boosted, link);
+		}
+	}
+
+	n_boosted = boosted.length;
+
+	while ((link = g_queue_pop_tail_link (&boosted)) != NULL) {
+		g_queue_push_head_link (priv->deferred_extraction_queue, link);
+	}
+
+	return n_boosted;
+}
+
+static guint
+deferred_extraction_cancel_for_prefix (TrackerMinerFiles *mf,
+                                       GFile             *prefix)
+{
+	TrackerMinerFilesPrivate *priv;
+	GList *link, *next;
+	guint n_cancelled = 0;
+
+	priv = mf->private;
+
+	for (link = priv->deferred_extraction_queue->head; link; link = next) {
+		DeferredExtractionData *data = link->data;
+
+		next = link->next;
+
+		if (!g_file_equal (data->file, prefix) &&
+		    !g_file_has_prefix (data->file, prefix)) {
+			continue;
+		}
+
+		g_hash_table_remove (priv->deferred_extraction_files, data->file);
+		g_queue_delete_link (priv->deferred_extraction_queue, link);
+		deferred_extraction_data_free (data);
+
+		priv->deferred_extraction_total--;
+		n_cancelled++;
+	}
+
+	return n_cancelled;
+}
+
+static void
+miner_files_resumed_cb (TrackerMiner *miner,
+                        gpointer      user_data)
+{
+	deferred_extraction_process (TRACKER_MINER_FILES (miner));
+}
+
+static void
+process_file_data_finish (ProcessFileData *data,
+                          const gchar     *postupdate,
+                          const GError    *error)
+{
+	sparql_builder_finish (data, NULL, postupdate, NULL, NULL);
+	tracker_miner_fs_file_notify (TRACKER_MINER_FS (data->miner), data->file, error);
+
+	tracker_extraction_queue_remove (data->miner->private->extraction_queue, &data->item);
+	extractor_check_process_failsafe (data->miner);
+	process_file_data_free (data);
+}
+
+static void
+process_file_data_extract (ProcessFileData *data)
+{
+	tracker_extract_client_get_metadata (data->file,
+	                                     data->mime_type,
+	                                     TRACKER_MINER_FS_GRAPH_URN,
+	                                     data->cancellable,
+	                                     extractor_get_embedded_metadata_cb,
+	                                     data);
+}
+
+static void
+content_fingerprint_query_cb (GObject      *object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+	ProcessFileData *data = user_data;
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+
+	cursor = tracker_sparql_connection_query_finish (TRACKER_SPARQL_CONNECTION (object),
+	                                                 result, &error);
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		process_file_data_finish (data, NULL, error);
+	} else if (cursor && tracker_sparql_cursor_next (cursor, data->cancellable, NULL)) {
+		const gchar *source;
+		gchar *uri, *update;
+
+		source = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+		data->miner->private->content_fingerprint_matches++;
+
+		uri = g_file_get_uri (data->file);
+		g_debug ("Copying embedded metadata for '%s' from <%s>", uri, source);
+		g_free (uri);
+
+		update = content_fingerprint_build_copy (data->file, source);
+		process_file_data_finish (data, update, NULL);
+		g_free (update);
+	} else {
+		if (error) {
+			g_debug ("Could not look up content fingerprint: %s",
+			         error->message);
+		}
+
+		/* No copy indexed yet, extract it */
+		process_file_data_extract (data);
+	}
+
+	g_clear_error (&error);
+	g_clear_object (&cursor);
+}
+
+static void
+content_fingerprint_cb (GObject      *object,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+	ProcessFileData *data = user_data;
+	TrackerMinerFilesPrivate *priv;
+	gchar *fingerprint, *query;
+	GError *error = NULL;
+
+	priv = data->miner->private;
+	fingerprint = content_fingerprint_compute_finish (result, &error);
+
+	if (!fingerprint) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			process_file_data_finish (data, NULL, error);
+		} else {
+			g_debug ("Could not compute content fingerprint: %s",
+			         error->message);
+			process_file_data_extract (data);
+		}
+
+		g_error_free (error);
+		return;
+	}
+
+	tracker_sparql_builder_predicate (data->sparql, "ivi:filefingerprint");
+	tracker_sparql_builder_object_string (data->sparql, fingerprint);
+
+	query = content_fingerprint_build_query (data->file, fingerprint);
+	priv->content_fingerprint_lookups++;
+
+	tracker_sparql_connection_query_async (tracker_miner_get_connection (TRACKER_MINER (data->miner)),
+	                                       query,
+	                                       data->cancellable,
+	                                       content_fingerprint_query_cb,
+	                                       data);
+
+	g_free (query);
+	g_free (fingerprint);
+}
+
+static void
+process_file_cb (GObject      *object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+	TrackerMinerFilesPrivate *priv;
+	TrackerSparqlBuilder *sparql;
+	ProcessFileData *data;
+	const gchar *mime_type, *urn, *parent_urn;
+	GFileInfo *file_info;
+	guint64 time_;
+	GFile *file;
+	gchar *uri;
+	GError *error = NULL;
+	gboolean is_iri;
+	gboolean is_directory;
+
+	data = user_data;
+	file = G_FILE (object);
+	sparql = data->sparql;
+	file_info = g_file_query_info_finish (file, result, &error);
+	priv = TRACKER_MINER_FILES (data->miner)->private;
+
+	if (error) {
+		/* Something bad happened, notify about the error */
+		tracker_miner_fs_file_notify (TRACKER_MINER_FS (data->miner), file, error);
+		process_file_data_free (data);
+		g_error_free (error);
+
+		return;
+	}
+
+	uri = g_file_get_uri (file);
+	mime_type = g_file_info_get_content_type (file_info);
+	urn = miner_files_get_file_urn (TRACKER_MINER_FILES (data->miner), file, &is_iri);
+
+	data->mime_type = g_strdup (mime_type);
+
+	tracker_sparql_builder_insert_silent_open (sparql, NULL);
+	tracker_sparql_builder_graph_open (sparql, TRACKER_MINER_FS_GRAPH_URN);
+
+	if (is_iri) {
+		tracker_sparql_builder_subject_iri (sparql, urn);
+	} else {
+		tracker_sparql_builder_subject (sparql, urn);
+	}
+
+	tracker_sparql_builder_predicate (sparql, "a");
+	tracker_sparql_builder_object (sparql, "ivi:File");
+
+	is_directory = (g_file_info_get_file_type (file_info) == G_FILE_TYPE_DIRECTORY ?
+	                TRUE : FALSE);
+
+/*	if (is_directory) {
+		tracker_sparql_builder_object (sparql, "ivi:Folder");
+	}
+*/
+	parent_urn = tracker_miner_fs_get_parent_urn (TRACKER_MINER_FS (data->miner), file);
+/*
+	if (parent_urn) {
+		tracker_sparql_builder_predicate (sparql, "nfo:belongsToContainer");
+		tracker_sparql_builder_object_iri (sparql, parent_urn);
+	}
+*/
+	tracker_sparql_builder_predicate (sparql, "ivi:filename");
+	tracker_sparql_builder_object_string (sparql, g_file_info_get_display_name (file_info));
+
+/*	tracker_sparql_builder_predicate (sparql, "nfo:fileSize");
+	tracker_sparql_builder_object_int64 (sparql, g_file_info_get_size (file_info));
+*/
+	time_ = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	tracker_sparql_builder_predicate (sparql, "ivi:fileLastModified");
+	tracker_sparql_builder_object_date (sparql, (time_t *) &time_);
+
+/*
+	time_ = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_ACCESS);
+	tracker_sparql_builder_predicate (sparql, "nfo:fileLastAccessed");
+	tracker_sparql_builder_object_date (sparql, (time_t *) &time_);
+*/
+	/* Laying the link between the IE and the DO. We use IE = DO */
+//	tracker_sparql_builder_predicate (sparql, "nie:isStoredAs");
+//	if (is_iri) {
+//		tracker_sparql_builder_object_iri (sparql, urn);
+//	} else {
+//		tracker_sparql_builder_object (sparql, urn);
+//	}
+
+	/* The URL of the DataObject (because IE = DO, this is correct) */
+	tracker_sparql_builder_predicate (sparql, "ivi:fileurl");
+	tracker_sparql_builder_object_string (sparql, uri);
+
+	tracker_sparql_builder_predicate (sparql, "ivi:mimetype");
+	tracker_sparql_builder_object_string (sparql, mime_type);
+
+	miner_files_add_to_datasource (data->miner, file, sparql);
+
+	if (tracker_extract_module_manager_mimetype_is_handled (mime_type) &&
+	    !priv->defer_embedded_metadata) {
+		if (priv->content_fingerprint && !is_directory) {
+			/* Look for an indexed copy first, extract otherwise */
+			content_fingerprint_compute_async (data->file,
+			                                   data->cancellable,
+			                                   content_fingerprint_cb,
+			                                   data);
+		} else {
+			/* Next step, if handled by the extractor, get embedded metadata */
+			process_file_data_extract (data);
+		}
+	} else {
+		if (tracker_extract_module_manager_mimetype_is_handled (mime_type)) {
+			/* Store the file level data now, embedded metadata comes later */
+			g_debug ("Deferring embedded metadata request for uri '%s'", uri);
+			deferred_extraction_push (data->miner, file, mime_type);
+		} else {
+			/* Otherwise, don't request embedded metadata extraction. */
+			g_debug ("Avoiding embedded metadata request for uri '%s'", uri);
+		}
+
+		process_file_data_finish (data, NULL, NULL);
+	}
+
+	g_object_unref (file_info);
+	g_free (uri);
+}
+
+static gboolean
+miner_files_process_file (TrackerMinerFS       *fs,
+                          GFile                *file,
                           TrackerSparqlBuilder *sparql,
                           GCancellable         *cancellable)
 {
@@ -2420,7 +3492,9 @@ miner_files_process_file (TrackerMinerFS       *fs,
 	data->file = g_object_ref (file);
 
 	priv = TRACKER_MINER_FILES (fs)->private;
-	priv->extraction_queue = g_list_prepend (priv->extraction_queue, data);
+	data->item.cancellable = data->cancellable;
+	tracker_extraction_queue_add (priv->extraction_queue, &data->item,
+	                              tracker_storage_get_uuid_for_file (priv->storage, file));
 
 	attrs = G_FILE_ATTRIBUTE_STANDARD_TYPE ","
 		G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
@@ -2639,6 +3713,11 @@ static void
 miner_files_finished (TrackerMinerFS *fs)
 {
 	tracker_db_manager_set_last_crawl_done (TRUE);
+
+	content_fingerprint_print_stats (TRACKER_MINER_FILES (fs));
+
+	/* First phase done, all file level data is in the store */
+	deferred_extraction_process (TRACKER_MINER_FILES (fs));
 }
 
 TrackerMiner *
@@ -2854,6 +3933,183 @@ remove_files_in_removable_media_cb (GObject      *object,
 	}
 }
 
+/* Returns FALSE only if the call was cancelled */
+static gboolean
+miner_files_volume_call_finish (GObject      *object,
+                                GAsyncResult *result,
+                                const gchar  *method)
+{
+	GVariant *retval;
+	GError *error = NULL;
+
+	retval = g_dbus_connection_call_finish (G_DBUS_CONNECTION (object), result, &error);
+
+	if (retval) {
+		g_variant_unref (retval);
+		return TRUE;
+	}
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_error_free (error);
+		return FALSE;
+	}
+
+	/* Expected if volume databases are disabled in the store,
+	 * resources are then stored in the main database.
+	 */
+	g_debug ("Could not call %s on the store: %s",
+	         method, error->message);
+	g_error_free (error);
+
+	return TRUE;
+}
+
+/* The store may keep the resources of each removable volume in a
+ * separate database, attaching it before the volume is crawled
+ * makes new resources end up there, and forgetting it drops all
+ * of them at once.
+ */
+static void
+miner_files_volume_call (TrackerMinerFiles   *mf,
+                         const gchar         *method,
+                         const gchar         *uuid,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
+{
+	g_dbus_connection_call (mf->private->connection,
+	                        "org.freedesktop.Tracker1",
+	                        "/org/freedesktop/Tracker1/Resources",
+	                        "org.freedesktop.Tracker1.Resources",
+	                        method,
+	                        g_variant_new ("(s)", uuid),
+	                        NULL,
+	                        G_DBUS_CALL_FLAGS_NONE,
+	                        -1,
+	                        cancellable,
+	                        callback,
+	                        user_data);
+}
+
+typedef struct {
+	TrackerMinerFiles *miner;
+	gchar *volume_pattern;
+	guint n_pending;
+} RemoveVolumesData;
+
+static void
+remove_volumes_delete (RemoveVolumesData *data)
+{
+	GString *queries;
+
+	/* Resources stored in the main database are still deleted
+	 * one by one, this is cheap if the volume databases were
+	 * dropped before.
+	 */
+	queries = g_string_new ("");
+	g_string_append_printf (queries,
+	                        "DELETE { "
+	                        "  ?f a rdfs:Resource . "
+	                        "  ?ie a rdfs:Resource "
+	                        "} WHERE { "
+	                        "  %s "
+	                        "  ?f nie:dataSource ?v . "
+	                        "  ?ie nie:isStoredAs ?f "
+	                        "}",
+	                        data->volume_pattern);
+
+	tracker_sparql_connection_update_async (tracker_miner_get_connection (TRACKER_MINER (data->miner)),
+	                                        queries->str,
+	                                        G_PRIORITY_LOW,
+	                                        NULL,
+	                                        remove_files_in_removable_media_cb,
+	                                        NULL);
+
+	g_string_free (queries, TRUE);
+	g_object_unref (data->miner);
+	g_free (data->volume_pattern);
+	g_slice_free (RemoveVolumesData, data);
+}
+
+static void
+remove_volumes_forget_cb (GObject      *object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+	RemoveVolumesData *data = user_data;
+
+	miner_files_volume_call_finish (object, result, "ForgetVolume");
+
+	/* The DELETE would otherwise go through the volume
+	 * databases resource by resource.
+	 */
+	if (--data->n_pending == 0) {
+		remove_volumes_delete (data);
+	}
+}
+
+static void
+remove_volumes_query_cb (GObject      *object,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+	RemoveVolumesData *data = user_data;
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+
+	cursor = tracker_sparql_connection_query_finish (TRACKER_SPARQL_CONNECTION (object),
+	                                                 result, &error);
+
+	while (cursor && tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		const gchar *urn;
+
+		urn = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+
+		if (urn && g_str_has_prefix (urn, TRACKER_DATASOURCE_URN_PREFIX)) {
+			data->n_pending++;
+			miner_files_volume_call (data->miner, "ForgetVolume",
+			                         urn + strlen (TRACKER_DATASOURCE_URN_PREFIX),
+			                         NULL,
+			                         remove_volumes_forget_cb,
+			                         data);
+		}
+	}
+
+	if (error) {
+		g_debug ("Could not query volumes to remove: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_clear_object (&cursor);
+
+	if (data->n_pending == 0) {
+		remove_volumes_delete (data);
+	}
+}
+
+/* Removes all resources in the volumes matching @volume_pattern,
+ * a graph pattern binding ?v to a tracker:Volume.
+ */
+static void
+miner_files_in_removable_media_remove (TrackerMinerFiles *miner,
+                                       const gchar       *volume_pattern)
+{
+	RemoveVolumesData *data;
+	gchar *query;
+
+	data = g_slice_new0 (RemoveVolumesData);
+	data->miner = g_object_ref (miner);
+	data->volume_pattern = g_strdup (volume_pattern);
+
+	query = g_strdup_printf ("SELECT ?v WHERE { %s }", volume_pattern);
+	tracker_sparql_connection_query_async (tracker_miner_get_connection (TRACKER_MINER (miner)),
+	                                       query,
+	                                       NULL,
+	                                       remove_volumes_query_cb,
+	                                       data);
+	g_free (query);
+}
+
 static gboolean
 miner_files_in_removable_media_remove_by_type (TrackerMinerFiles  *miner,
                                                TrackerStorageType  type)
@@ -2866,37 +4122,21 @@ miner_files_in_removable_media_remove_by_type (TrackerMinerFiles  *miner,
 
 	/* Only remove if any of the flags was TRUE */
 	if (removable || optical) {
-		GString *queries;
+		gchar *pattern;
 
 		g_debug ("  Removing all resources in store from %s ",
 		         optical ? "optical discs" : "removable devices");
 
-		queries = g_string_new ("");
-
 		/* Delete all resources where nie:dataSource is a volume
 		 * of the given type */
-		g_string_append_printf (queries,
-		                        "DELETE { "
-		                        "  ?f a rdfs:Resource . "
-		                        "  ?ie a rdfs:Resource "
-		                        "} WHERE { "
-		                        "  ?v a tracker:Volume ; "
-		                        "     tracker:isRemovable %s ; "
-		                        "     tracker:isOptical %s . "
-		                        "  ?f nie:dataSource ?v . "
-		                        "  ?ie nie:isStoredAs ?f "
-		                        "}",
-		                        removable ? "true" : "false",
-		                        optical ? "true" : "false");
-
-		tracker_sparql_connection_update_async (tracker_miner_get_connection (TRACKER_MINER (miner)),
-		                                        queries->str,
-		                                        G_PRIORITY_LOW,
-		                                        NULL,
-		                                        remove_files_in_removable_media_cb,
-		                                        NULL);
+		pattern = g_strdup_printf ("?v a tracker:Volume ; "
+		                           "   tracker:isRemovable %s ; "
+		                           "   tracker:isOptical %s . ",
+		                           removable ? "true" : "false",
+		                           optical ? "true" : "false");
 
-		g_string_free (queries, TRUE);
+		miner_files_in_removable_media_remove (miner, pattern);
+		g_free (pattern);
 
 		return TRUE;
 	}
@@ -2908,39 +4148,70 @@ static void
 miner_files_in_removable_media_remove_by_date (TrackerMinerFiles  *miner,
                                                const gchar        *date)
 {
-	GString *queries;
+	gchar *pattern;
 
 	g_debug ("  Removing all resources in store from removable or "
 	         "optical devices not mounted after '%s'",
 	         date);
 
-	queries = g_string_new ("");
-
 	/* Delete all resources where nie:dataSource is a volume
 	 * which was last unmounted before the given date */
-	g_string_append_printf (queries,
-	                        "DELETE { "
-	                        "  ?f a rdfs:Resource . "
-	                        "  ?ie a rdfs:Resource "
-	                        "} WHERE { "
-	                        "  ?v a tracker:Volume ; "
-	                        "     tracker:isRemovable true ; "
-	                        "     tracker:isMounted false ; "
-	                        "     tracker:unmountDate ?d . "
-	                        "  ?f nie:dataSource ?v . "
-	                        "  ?ie nie:isStoredAs ?f "
-	                        "  FILTER ( ?d < \"%s\") "
-	                        "}",
-	                        date);
+	pattern = g_strdup_printf ("?v a tracker:Volume ; "
+	                           "   tracker:isRemovable true ; "
+	                           "   tracker:isMounted false ; "
+	                           "   tracker:unmountDate ?d . "
+	                           "FILTER ( ?d < \"%s\") ",
+	                           date);
+
+	miner_files_in_removable_media_remove (miner, pattern);
+	g_free (pattern);
+}
 
-	tracker_sparql_connection_update_async (tracker_miner_get_connection (TRACKER_MINER (miner)),
-	                                        queries->str,
-	                                        G_PRIORITY_LOW,
-	                                        NULL,
-	                                        remove_files_in_removable_media_cb,
-	                                        NULL);
+typedef struct {
+	TrackerMinerFiles *miner;
+	GFile *mount_point;
+	TrackerDirectoryFlags flags;
+	gchar *uuid;
+	GCancellable *cancellable;
+} AttachVolumeData;
 
-	g_string_free (queries, TRUE);
+static void
+attach_volume_cb (GObject      *object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+	AttachVolumeData *data = user_data;
+	TrackerMinerFilesPrivate *priv = data->miner->private;
+
+	/* The request may have been replaced if the volume was
+	 * quickly removed and added again.
+	 */
+	if (g_hash_table_lookup (priv->volume_attach_requests, data->uuid) == data->cancellable) {
+		g_hash_table_remove (priv->volume_attach_requests, data->uuid);
+	}
+
+	/* Only start crawling once the volume database is attached,
+	 * or new resources would go to the main database.
+	 */
+	if (miner_files_volume_call_finish (object, result, "AttachVolume")) {
+		TrackerIndexingTree *indexing_tree;
+		gchar *mount_path;
+
+		mount_path = g_file_get_path (data->mount_point);
+		g_message ("  Adding removable/optical: '%s'", mount_path);
+		g_free (mount_path);
+
+		indexing_tree = tracker_miner_fs_get_indexing_tree (TRACKER_MINER_FS (data->miner));
+		tracker_indexing_tree_add (indexing_tree,
+		                           data->mount_point,
+		                           data->flags);
+	}
+
+	g_object_unref (data->cancellable);
+	g_free (data->uuid);
+	g_object_unref (data->mount_point);
+	g_object_unref (data->miner);
+	g_slice_free (AttachVolumeData, data);
 }
 
 static void
@@ -2948,9 +4219,9 @@ miner_files_add_removable_or_optical_directory (TrackerMinerFiles *mf,
                                                 const gchar       *mount_path,
                                                 const gchar       *uuid)
 {
-	TrackerIndexingTree *indexing_tree;
 	TrackerDirectoryFlags flags;
 	GFile *mount_point_file;
+	AttachVolumeData *data;
 
 	mount_point_file = g_file_new_for_path (mount_path);
 
@@ -2966,7 +4237,6 @@ miner_files_add_removable_or_optical_directory (TrackerMinerFiles *mf,
 		}
 	}
 
-	indexing_tree = tracker_miner_fs_get_indexing_tree (TRACKER_MINER_FS (mf));
 	flags = TRACKER_DIRECTORY_FLAG_RECURSE |
 		TRACKER_DIRECTORY_FLAG_CHECK_MTIME |
 		TRACKER_DIRECTORY_FLAG_PRESERVE;
@@ -2980,11 +4250,22 @@ miner_files_add_removable_or_optical_directory (TrackerMinerFiles *mf,
 	                         g_strdup (uuid),
 	                         (GDestroyNotify) g_free);
 
-	g_message ("  Adding removable/optical: '%s'", mount_path);
-	tracker_indexing_tree_add (indexing_tree,
-				   mount_point_file,
-				   flags);
-	g_object_unref (mount_point_file);
+	data = g_slice_new0 (AttachVolumeData);
+	data->miner = g_object_ref (mf);
+	data->mount_point = mount_point_file;
+	data->flags = flags;
+	data->uuid = g_strdup (uuid);
+	data->cancellable = g_cancellable_new ();
+
+	g_hash_table_insert (mf->private->volume_attach_requests,
+	                     g_strdup (uuid),
+	                     g_object_ref (data->cancellable));
+
+	g_debug ("  Attaching volume '%s' before adding '%s'", uuid, mount_path);
+	miner_files_volume_call (mf, "AttachVolume", uuid,
+	                         data->cancellable,
+	                         attach_volume_cb,
+	                         data);
 }
 
 gboolean
@@ -3087,3 +4368,24 @@ tracker_miner_files_is_file_eligible (TrackerMinerFiles *miner,
 	/* file is eligible to be indexed */
 	return TRUE;
 }
+
+/* Raises the indexing priority of everything within @directory,
+ * see tracker_miner_fs_boost_directory(). Pending embedded metadata
+ * extraction requests for files within it are moved ahead too.
+ */
+guint
+tracker_miner_files_boost_directory (TrackerMinerFiles *mf,
+                                     GFile             *directory,
+                                     gint               priority)
+{
+	guint n_boosted;
+
+	g_return_val_if_fail (TRACKER_IS_MINER_FILES (mf), 0);
+	g_return_val_if_fail (G_IS_FILE (directory), 0);
+
+	n_boosted = tracker_miner_fs_boost_directory (TRACKER_MINER_FS (mf),
+	                                              directory, priority);
+	n_boosted += deferred_extraction_boost (mf, directory);
+
+	return n_boosted;
+}
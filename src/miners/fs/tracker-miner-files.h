@@ -68,6 +68,9 @@ gboolean      tracker_miner_files_monitor_directory        (GFile             *f
                                                             GSList            *directories_to_check);
 gboolean      tracker_miner_files_is_file_eligible         (TrackerMinerFiles *miner,
                                                             GFile             *file);
+guint         tracker_miner_files_boost_directory          (TrackerMinerFiles *mf,
+                                                            GFile             *directory,
+                                                            gint               priority);
 
 G_END_DECLS
 
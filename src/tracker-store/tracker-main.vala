@@ -114,6 +114,11 @@ License which can be viewed at:
 		Posix.sigaction (Posix.SIGTERM, act, null);
 		Posix.sigaction (Posix.SIGINT, act, null);
 		Posix.sigaction (Posix.SIGHUP, act, null);
+
+		/* Clients may close the pipe before reading all the results
+		 * of their query, that must only fail the query.
+		 */
+		Posix.signal (Posix.SIGPIPE, Posix.SIG_IGN);
 	}
 
 	static void initialize_priority () {
@@ -222,6 +227,10 @@ License which can be viewed at:
 			flags |= DBManagerFlags.FORCE_REINDEX;
 		}
 
+		if (db_config.volume_databases) {
+			flags |= DBManagerFlags.VOLUME_DATABASES;
+		}
+
 		var notifier = Tracker.DBus.register_notifier ();
 		var busy_callback = notifier.get_callback ();
 
@@ -199,6 +199,46 @@ public class Tracker.Resources : Object {
 		/* no longer needed, just return */
 	}
 
+	public async void attach_volume (BusName sender, string uuid) throws Error {
+		var request = DBusRequest.begin (sender, "Resources.AttachVolume (uuid: '%s')", uuid);
+
+		/* The UUID names files in the data directory */
+		if (!DBManager.volume_uuid_is_valid (uuid)) {
+			var e = new DBusError.INVALID_ARGS ("'%s' is not a valid volume UUID".printf (uuid));
+			request.end (e);
+			throw e;
+		}
+
+		try {
+			yield Tracker.Store.attach_volume (uuid);
+
+			request.end ();
+		} catch (Error e) {
+			request.end (e);
+			throw new Sparql.Error.INTERNAL (e.message);
+		}
+	}
+
+	public async void forget_volume (BusName sender, string uuid) throws Error {
+		var request = DBusRequest.begin (sender, "Resources.ForgetVolume (uuid: '%s')", uuid);
+
+		/* The UUID names files in the data directory */
+		if (!DBManager.volume_uuid_is_valid (uuid)) {
+			var e = new DBusError.INVALID_ARGS ("'%s' is not a valid volume UUID".printf (uuid));
+			request.end (e);
+			throw e;
+		}
+
+		try {
+			yield Tracker.Store.forget_volume (uuid);
+
+			request.end ();
+		} catch (Error e) {
+			request.end (e);
+			throw new Sparql.Error.INTERNAL (e.message);
+		}
+	}
+
 	bool emit_graph_updated (Class cl) {
 		if (cl.has_insert_events () || cl.has_delete_events ()) {
 			var builder = new VariantBuilder ((VariantType) "a(iiii)");
@@ -68,4 +68,31 @@ public class Tracker.Statistics : Object {
 
 		return builder.end ();
 	}
+
+	[DBus (signature = "aas")]
+	public Variant get_query_cache (BusName sender) throws GLib.Error {
+		var request = DBusRequest.begin (sender, "Statistics.GetQueryCache");
+
+		uint size, hits, misses, uncacheable, evictions;
+		Sparql.Query.get_cache_statistics (out size, out hits, out misses, out uncacheable, out evictions);
+
+		var builder = new VariantBuilder ((VariantType) "aas");
+
+		add_counter (builder, "size", size);
+		add_counter (builder, "hits", hits);
+		add_counter (builder, "misses", misses);
+		add_counter (builder, "uncacheable", uncacheable);
+		add_counter (builder, "evictions", evictions);
+
+		request.end ();
+
+		return builder.end ();
+	}
+
+	static void add_counter (VariantBuilder builder, string name, uint value) {
+		builder.open ((VariantType) "as");
+		builder.add ("s", name);
+		builder.add ("s", value.to_string ());
+		builder.close ();
+	}
 }
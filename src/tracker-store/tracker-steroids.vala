@@ -18,12 +18,31 @@
  * Boston, MA  02110-1301, USA.
  */
 
+/* Queries and updates with the data passed through pipes rather than
+ * in D-Bus messages. Of the query methods, libtracker-sparql uses
+ * StreamQuery, which also takes the values of the parameters of
+ * prepared statements, and SharedQuery for large results. Query, which
+ * only replies once all results are written, is kept unchanged for
+ * clients of earlier versions.
+ */
 [DBus (name = "org.freedesktop.Tracker1.Steroids")]
 public class Tracker.Steroids : Object {
 	public const string PATH = "/org/freedesktop/Tracker1/Steroids";
 
 	public const int BUFFER_SIZE = 65536;
 
+	// formats of streamed results, see stream_query
+	public const int RESULT_FORMAT_ROWS = 1;
+	public const int RESULT_FORMAT_BLOCKS = 2;
+
+	// rows flushed at once when streaming results
+	const int FIRST_ROWS = 16;
+
+	// bytes of results written to the pipe before the rest is
+	// written to shared memory, see shared_query
+	const size_t SHARED_THRESHOLD = 262144;
+	const int SHARED_BUFFER_SIZE = 1048576;
+
 	public async string[] query (BusName sender, string query, UnixOutputStream output_stream) throws Error {
 		var request = DBusRequest.begin (sender, "Steroids.Query");
 		request.debug ("query: %s", query);
@@ -31,50 +50,82 @@ public class Tracker.Steroids : Object {
 			string[] variable_names = null;
 
 			yield Tracker.Store.sparql_query (query, Tracker.Store.Priority.HIGH, cursor => {
-				var data_output_stream = new DataOutputStream (new BufferedOutputStream.sized (output_stream, BUFFER_SIZE));
-				data_output_stream.set_byte_order (DataStreamByteOrder.HOST_ENDIAN);
+				variable_names = write_cursor (cursor, output_stream);
+			}, sender);
 
-				int n_columns = cursor.n_columns;
+			request.end ();
 
-				int[] column_sizes = new int[n_columns];
-				int[] column_offsets = new int[n_columns];
-				string[] column_data = new string[n_columns];
+			return variable_names;
+		} catch (Error e) {
+			request.end (e);
+			if (e is Sparql.Error) {
+				throw e;
+			} else {
+				throw new Sparql.Error.INTERNAL (e.message);
+			}
+		}
+	}
 
-				variable_names = new string[n_columns];
-				for (int i = 0; i < n_columns; i++) {
-					variable_names[i] = cursor.get_variable_name (i);
-				}
+	/* Like query, but with the values of the parameters of the query,
+	 * if any, and results written so the client can read them while
+	 * they are produced: a header comes first, as [4 bytes for the
+	 * format, 4 bytes for number of columns, then for each column 4
+	 * bytes for the length of the name and the name, nul terminated],
+	 * and is flushed right away as are the first rows. The format is
+	 * the highest one both the client, which asks for @format, and the
+	 * store know. Format 1 writes rows as query does, format 2 writes
+	 * blocks of rows, see ResultBlock. The pipe is closed after the last
+	 * row, the reply tells whether the query succeeded.
+	 */
+	public async string[] stream_query (BusName sender, string query, HashTable<string,Variant> arguments, int format, UnixOutputStream output_stream) throws Error {
+		var request = DBusRequest.begin (sender, "Steroids.StreamQuery");
+		request.debug ("query: %s", query);
+		try {
+			string[] variable_names = null;
 
-				while (cursor.next ()) {
-					int last_offset = -1;
+			format = format.clamp (RESULT_FORMAT_ROWS, RESULT_FORMAT_BLOCKS);
 
-					for (int i = 0; i < n_columns ; i++) {
-						unowned string str = cursor.get_string (i);
+			yield Tracker.Store.sparql_query (query, Tracker.Store.Priority.HIGH, cursor => {
+				variable_names = write_cursor (cursor, output_stream, format);
+			}, sender, arguments.size () > 0 ? arguments : null);
 
-						column_sizes[i] = str != null ? str.length : 0;
-						column_data[i]  = str;
+			request.end ();
 
-						last_offset += column_sizes[i] + 1;
-						column_offsets[i] = last_offset;
-					}
+			return variable_names;
+		} catch (Error e) {
+			request.end (e);
+			if (e is Sparql.Error) {
+				throw e;
+			} else {
+				throw new Sparql.Error.INTERNAL (e.message);
+			}
+		}
+	}
 
-					data_output_stream.put_int32 (n_columns);
+	/* Like stream_query, in format 2, but meant for large results:
+	 * once SHARED_THRESHOLD bytes of results are written to the pipe,
+	 * a block with no rows is written to it and the following blocks
+	 * go to a memory file instead, returned in @shared_results with
+	 * the reply once it is sealed. The client can then map it and read
+	 * the rows in place, rather than copy them out of the pipe. For
+	 * smaller results, @shared_results is empty and should be ignored.
+	 */
+	public async string[] shared_query (BusName sender, string query, HashTable<string,Variant> arguments, UnixOutputStream output_stream, out UnixInputStream shared_results) throws Error {
+		var request = DBusRequest.begin (sender, "Steroids.SharedQuery");
+		request.debug ("query: %s", query);
+		try {
+			string[] variable_names = null;
+			var shared = new SharedResults ();
 
-					for (int i = 0; i < n_columns ; i++) {
-						/* Cast from enum to int */
-						data_output_stream.put_int32 ((int) cursor.get_value_type (i));
-					}
+			yield Tracker.Store.sparql_query (query, Tracker.Store.Priority.HIGH, cursor => {
+				variable_names = write_cursor (cursor, output_stream, RESULT_FORMAT_BLOCKS, shared);
+			}, sender, arguments.size () > 0 ? arguments : null);
 
-					for (int i = 0; i < n_columns ; i++) {
-						data_output_stream.put_int32 (column_offsets[i]);
-					}
+			shared_results = shared.finish ();
 
-					for (int i = 0; i < n_columns ; i++) {
-						data_output_stream.put_string (column_data[i] != null ? column_data[i] : "");
-						data_output_stream.put_byte (0);
-					}
-				}
-			}, sender);
+			if (shared.size > 0) {
+				request.debug ("%s bytes of results in shared memory", shared.size.to_string ());
+			}
 
 			request.end ();
 
@@ -89,6 +140,288 @@ public class Tracker.Steroids : Object {
 		}
 	}
 
+	/* Memory file the results of shared_query go to once they get
+	 * large. It grows as blocks are written to it.
+	 */
+	class SharedResults {
+		public OutputStream? output;
+		public uint64 size;
+
+		int fd = -1;
+
+		~SharedResults () {
+			if (fd >= 0) {
+				Posix.close (fd);
+			}
+		}
+
+		// returns false if memory files are not supported, results
+		// then keep going through the pipe
+		public bool open () {
+			fd = Memfd.create ("tracker-results");
+			if (fd < 0) {
+				return false;
+			}
+
+			output = new BufferedOutputStream.sized (new UnixOutputStream (fd, false), SHARED_BUFFER_SIZE);
+			return true;
+		}
+
+		public UnixInputStream finish () throws Error {
+			if (output == null) {
+				// the reply needs a file anyway
+				open ();
+			}
+
+			if (output != null) {
+				output.close ();
+				output = null;
+
+				Posix.Stat st;
+				if (Posix.fstat (fd, out st) == 0) {
+					size = (uint64) st.st_size;
+				}
+
+				if (!Memfd.seal (fd)) {
+					throw new IOError.FAILED ("Could not seal shared results");
+				}
+			} else {
+				fd = Posix.open ("/dev/null", Posix.O_RDONLY);
+				if (fd < 0) {
+					throw new IOError.FAILED ("Could not open /dev/null");
+				}
+			}
+
+			var stream = new UnixInputStream (fd, true);
+			fd = -1;
+
+			return stream;
+		}
+	}
+
+	/* Block of rows in format 2, written as [varint number of rows,
+	 * varint size of the values, for each column a byte with the type
+	 * of its values in all rows, or MIXED_TYPES and a byte per row,
+	 * then the values, row by row: nothing if unbound, 8 bytes for
+	 * integers and doubles, 1 byte for booleans, the varint length
+	 * and the nul terminated string otherwise]. Integers, sizes and
+	 * doubles are in host byte order.
+	 */
+	class ResultBlock {
+		public const int MAX_ROWS = 64;
+		public const uint MAX_SIZE = 16384;
+		public const uint8 MIXED_TYPES = 0xff;
+
+		public int n_rows;
+
+		int n_columns;
+		uint8[] types;
+		ByteArray values = new ByteArray.sized (MAX_SIZE);
+		ByteArray header = new ByteArray ();
+		uint8[] scratch = new uint8[16];
+
+		public ResultBlock (int n_columns) {
+			this.n_columns = n_columns;
+			types = new uint8[MAX_ROWS * n_columns];
+		}
+
+		public bool is_full () {
+			return n_rows == MAX_ROWS || values.len >= MAX_SIZE;
+		}
+
+		void append_varint (ByteArray buffer, uint64 value) {
+			int n = 0;
+			while (value >= 0x80) {
+				scratch[n++] = (uint8) (value | 0x80);
+				value >>= 7;
+			}
+			scratch[n++] = (uint8) value;
+			buffer.append (scratch[0:n]);
+		}
+
+		void append_byte (ByteArray buffer, uint8 value) {
+			scratch[0] = value;
+			buffer.append (scratch[0:1]);
+		}
+
+		public void add_row (DBCursor cursor) {
+			for (int i = 0; i < n_columns; i++) {
+				var type = cursor.get_value_type (i);
+
+				types[n_rows * n_columns + i] = (uint8) type;
+
+				switch (type) {
+				case Sparql.ValueType.UNBOUND:
+					break;
+				case Sparql.ValueType.INTEGER:
+					int64 integer = cursor.get_integer (i);
+					Memory.copy (scratch, &integer, sizeof (int64));
+					values.append (scratch[0:(int) sizeof (int64)]);
+					break;
+				case Sparql.ValueType.DOUBLE:
+					double number = cursor.get_double (i);
+					Memory.copy (scratch, &number, sizeof (double));
+					values.append (scratch[0:(int) sizeof (double)]);
+					break;
+				case Sparql.ValueType.BOOLEAN:
+					append_byte (values, cursor.get_boolean (i) ? 1 : 0);
+					break;
+				default:
+					long length;
+					unowned string str = cursor.get_string (i, out length);
+					append_varint (values, length);
+					values.append (((uint8[]) str)[0:(int) length + 1]);
+					break;
+				}
+			}
+
+			n_rows++;
+		}
+
+		// returns the number of bytes written
+		public size_t write (OutputStream output) throws Error {
+			size_t bytes_written;
+
+			header.set_size (0);
+			append_varint (header, n_rows);
+			append_varint (header, values.len);
+
+			for (int i = 0; i < n_columns; i++) {
+				uint8 type = types[i];
+				bool mixed = false;
+
+				for (int row = 1; row < n_rows && !mixed; row++) {
+					mixed = (types[row * n_columns + i] != type);
+				}
+
+				if (!mixed) {
+					append_byte (header, type);
+				} else {
+					append_byte (header, MIXED_TYPES);
+					for (int row = 0; row < n_rows; row++) {
+						append_byte (header, types[row * n_columns + i]);
+					}
+				}
+			}
+
+			output.write_all (header.data, out bytes_written);
+			output.write_all (values.data, out bytes_written);
+
+			size_t size = header.len + values.len;
+
+			n_rows = 0;
+			values.set_size (0);
+
+			return size;
+		}
+	}
+
+	static string[] write_cursor (DBCursor cursor, UnixOutputStream output_stream, int format = 0, SharedResults? shared = null) throws Error {
+		var data_output_stream = new DataOutputStream (new BufferedOutputStream.sized (output_stream, BUFFER_SIZE));
+		data_output_stream.set_byte_order (DataStreamByteOrder.HOST_ENDIAN);
+
+		int n_columns = cursor.n_columns;
+
+		int[] column_sizes = new int[n_columns];
+		int[] column_offsets = new int[n_columns];
+		string[] column_data = new string[n_columns];
+
+		string[] variable_names = new string[n_columns];
+		for (int i = 0; i < n_columns; i++) {
+			variable_names[i] = cursor.get_variable_name (i);
+		}
+
+		if (format != 0) {
+			data_output_stream.put_int32 (format);
+			data_output_stream.put_int32 (n_columns);
+			for (int i = 0; i < n_columns; i++) {
+				data_output_stream.put_int32 (variable_names[i].length);
+				data_output_stream.put_string (variable_names[i]);
+				data_output_stream.put_byte (0);
+			}
+			data_output_stream.flush ();
+		}
+
+		if (format == RESULT_FORMAT_BLOCKS) {
+			var block = new ResultBlock (n_columns);
+			bool first_block = true;
+			OutputStream output = data_output_stream;
+			size_t pipe_size = 0;
+
+			while (cursor.next ()) {
+				block.add_row (cursor);
+
+				if (block.is_full () || (first_block && block.n_rows == FIRST_ROWS)) {
+					size_t size = block.write (output);
+
+					// don't keep the client waiting for a
+					// full buffer before it can show anything
+					if (first_block) {
+						data_output_stream.flush ();
+						first_block = false;
+					}
+
+					if (shared != null && output == data_output_stream) {
+						pipe_size += size;
+						if (pipe_size >= SHARED_THRESHOLD && shared.open ()) {
+							// an empty block tells the client
+							// the rest is in shared memory
+							block.write (data_output_stream);
+							data_output_stream.flush ();
+							output = shared.output;
+						}
+					}
+				}
+			}
+
+			if (block.n_rows > 0) {
+				block.write (output);
+			}
+
+			return variable_names;
+		}
+
+		int n_rows = 0;
+
+		while (cursor.next ()) {
+			int last_offset = -1;
+
+			for (int i = 0; i < n_columns ; i++) {
+				unowned string str = cursor.get_string (i);
+
+				column_sizes[i] = str != null ? str.length : 0;
+				column_data[i]  = str;
+
+				last_offset += column_sizes[i] + 1;
+				column_offsets[i] = last_offset;
+			}
+
+			data_output_stream.put_int32 (n_columns);
+
+			for (int i = 0; i < n_columns ; i++) {
+				/* Cast from enum to int */
+				data_output_stream.put_int32 ((int) cursor.get_value_type (i));
+			}
+
+			for (int i = 0; i < n_columns ; i++) {
+				data_output_stream.put_int32 (column_offsets[i]);
+			}
+
+			for (int i = 0; i < n_columns ; i++) {
+				data_output_stream.put_string (column_data[i] != null ? column_data[i] : "");
+				data_output_stream.put_byte (0);
+			}
+
+			// don't keep the client waiting for a full buffer
+			// before it can show anything
+			if (format != 0 && ++n_rows == FIRST_ROWS) {
+				data_output_stream.flush ();
+			}
+		}
+
+		return variable_names;
+	}
+
 	async Variant? update_internal (BusName sender, Tracker.Store.Priority priority, bool blank, UnixInputStream input_stream) throws Error {
 		var request = DBusRequest.begin (sender,
 			"Steroids.%sUpdate%s",
@@ -155,6 +488,41 @@ public class Tracker.Steroids : Object {
 		return yield update_internal (sender, Tracker.Store.Priority.LOW, true, input_stream);
 	}
 
+	class UpdateArrayBatch {
+		public string[] queries;
+		public string?[] errors;
+	}
+
+	/* Applies queries [start, end) in one transaction. If that fails the
+	 * range is split in halves until the failing queries are isolated,
+	 * their error messages are stored in batch.errors.
+	 */
+	async void update_range (UpdateArrayBatch batch, int start, int end, string sender) {
+		var combined_query = new StringBuilder ();
+
+		for (int i = start; i < end; i++) {
+			combined_query.append (batch.queries[i]);
+			combined_query.append_c ('\n');
+		}
+
+		try {
+			yield Tracker.Store.sparql_update (combined_query.str, Tracker.Store.Priority.LOW, sender);
+			return;
+		} catch (Error e) {
+			if (end - start == 1) {
+				batch.errors[start] = e.message;
+				return;
+			}
+		}
+
+		combined_query = null;
+
+		int middle = start + (end - start) / 2;
+
+		yield update_range (batch, start, middle, sender);
+		yield update_range (batch, middle, end, sender);
+	}
+
 	[DBus (signature = "as")]
 	public async Variant update_array (BusName sender, UnixInputStream input_stream) throws Error {
 		var request = DBusRequest.begin (sender, "Steroids.UpdateArray");
@@ -165,8 +533,9 @@ public class Tracker.Steroids : Object {
 
 			int query_count = data_input_stream.read_int32 ();
 
-			var combined_query = new StringBuilder ();
-			string[] query_array = new string[query_count];
+			var batch = new UpdateArrayBatch ();
+			batch.queries = new string[query_count];
+			batch.errors = new string[query_count];
 
 			int i;
 			for (i = 0; i < query_count; i++) {
@@ -175,49 +544,31 @@ public class Tracker.Steroids : Object {
 				int query_size = data_input_stream.read_int32 ();
 
 				/* We malloc one more char to ensure string is 0 terminated */
-				query_array[i] = (string) new uint8[query_size + 1];
+				batch.queries[i] = (string) new uint8[query_size + 1];
 
-				data_input_stream.read_all (((uint8[]) query_array[i])[0:query_size], out bytes_read);
+				data_input_stream.read_all (((uint8[]) batch.queries[i])[0:query_size], out bytes_read);
 
-				request.debug ("query: %s", query_array[i]);
-				combined_query.append (query_array[i]);
+				request.debug ("query: %s", batch.queries[i]);
 			}
 
 			data_input_stream = null;
 
-			var builder = new VariantBuilder ((VariantType) "as");
-
-			// first try combined query for best possible performance
-			try {
-				yield Tracker.Store.sparql_update (combined_query.str, Tracker.Store.Priority.LOW, sender);
-
-				// combined query was successful
-				for (i = 0; i < query_count; i++) {
-					builder.add ("s", "");
-					builder.add ("s", "");
-				}
-
-				request.end ();
-
-				return builder.end ();
-			} catch {
-				// combined query was not successful
-				combined_query = null;
+			// the whole array is first applied as a single update, so
+			// the common case costs one parse and one commit
+			if (query_count > 0) {
+				yield update_range (batch, 0, query_count, sender);
 			}
 
-			// combined query was not successful, try queries one by one
-			for (i = 0; i < query_count; i++) {
-				request.debug ("query: %s", query_array[i]);
+			var builder = new VariantBuilder ((VariantType) "as");
 
-				try {
-					yield Tracker.Store.sparql_update (query_array[i], Tracker.Store.Priority.LOW, sender);
+			for (i = 0; i < query_count; i++) {
+				if (batch.errors[i] == null) {
 					builder.add ("s", "");
 					builder.add ("s", "");
-				} catch (Error e1) {
+				} else {
 					builder.add ("s", "org.freedesktop.Tracker1.SparqlError.Internal");
-					builder.add ("s", e1.message);
+					builder.add ("s", batch.errors[i]);
 				}
-
 			}
 
 			request.end ();
@@ -20,14 +20,43 @@
  */
 
 public class Tracker.Store {
-	const int MAX_CONCURRENT_QUERIES = 2;
-
 	const int MAX_TASK_TIME = 30;
+	const uint MAX_PREPARED_QUERIES = 64;
+
+	/* Updates queued with the same priority are committed together,
+	 * up to this many in one transaction. The update thread stops
+	 * adding updates to the transaction after MAX_GROUP_TIME, in
+	 * milliseconds, or as soon as an update with a higher priority
+	 * is waiting, so those don't wait longer than for a single update.
+	 */
+	const int MAX_GROUP_SIZE = 32;
+	const int MAX_GROUP_TIME = 100;
+
+	/* Pending queries are queued per client, and clients are served
+	 * round robin within each priority, so a busy client can't hold
+	 * back the others. Query threads pick up the next query right
+	 * away, so the state below is protected by query_mutex.
+	 */
+	static Queue<ClientQueue> query_clients[3 /* TRACKER_STORE_N_PRIORITIES */];
+	static HashTable<string, ClientQueue> query_client_map[3 /* TRACKER_STORE_N_PRIORITIES */];
+	static uint n_queries_queued;
+	static int n_queries_running;
+	static int max_concurrent_queries;
+	static Mutex query_mutex;
+
+	/* Queries sent as prepared statements, by SPARQL text. They are
+	 * only read once translated, so query threads share them. They
+	 * are dropped along with the translation cache, whenever the
+	 * ontology may have changed.
+	 */
+	static HashTable<string, Sparql.Query> prepared_queries;
+	static uint prepared_generation;
+	static Mutex prepared_mutex;
 
-	static Queue<Task> query_queues[3 /* TRACKER_STORE_N_PRIORITIES */];
 	static Queue<Task> update_queues[3 /* TRACKER_STORE_N_PRIORITIES */];
-	static int n_queries_running;
 	static bool update_running;
+	// read by the update thread
+	static int high_updates_queued;
 	static ThreadPool<Task> update_pool;
 	static ThreadPool<Task> query_pool;
 	static ThreadPool<bool> checkpoint_pool;
@@ -47,6 +76,7 @@ public class Tracker.Store {
 		QUERY,
 		UPDATE,
 		UPDATE_BLANK,
+		UPDATE_GROUP,
 		TURTLE,
 	}
 
@@ -61,6 +91,7 @@ public class Tracker.Store {
 
 	class QueryTask : Task {
 		public string query;
+		public HashTable<string, Variant> parameters;
 		public Cancellable cancellable;
 		public uint watchdog_id;
 		public unowned SparqlQueryInThread in_thread;
@@ -76,52 +107,106 @@ public class Tracker.Store {
 		public string query;
 		public Variant blank_nodes;
 		public Priority priority;
+		// set once it failed in a group, to find out which one failed
+		public bool run_alone;
+	}
+
+	class UpdateGroup : Task {
+		public Priority priority;
+		public UpdateTask[] tasks;
+		// updates applied, the others go back to the queue
+		public int n_run;
+		public bool failed;
 	}
 
 	class TurtleTask : Task {
 		public string path;
 	}
 
-	static void sched () {
-		Task task = null;
+	class ClientQueue {
+		public string client_id;
+		public Queue<Task> tasks = new Queue<Task> ();
+	}
 
-		if (!active) {
-			return;
+	// must be called with query_mutex held
+	static void query_queue_push (Task task, Priority priority) {
+		string client_id = task.client_id ?? "";
+		ClientQueue client = query_client_map[priority].lookup (client_id);
+
+		if (client == null) {
+			client = new ClientQueue ();
+			client.client_id = client_id;
+			query_client_map[priority].insert (client_id, client);
+			query_clients[priority].push_tail (client);
 		}
 
-		while (n_queries_running < MAX_CONCURRENT_QUERIES) {
-			for (int i = 0; i < Priority.N_PRIORITIES; i++) {
-				task = query_queues[i].pop_head ();
-				if (task != null) {
-					break;
-				}
-			}
-			if (task == null) {
-				/* no pending query */
-				break;
+		client.tasks.push_tail (task);
+		n_queries_queued++;
+	}
+
+	// must be called with query_mutex held
+	static Task? query_queue_pop () {
+		for (int i = 0; i < Priority.N_PRIORITIES; i++) {
+			ClientQueue client = query_clients[i].pop_head ();
+
+			if (client == null) {
+				continue;
 			}
-			running_tasks.add (task);
 
-			if (max_task_time != 0) {
-				var query_task = (QueryTask) task;
-				query_task.watchdog_id = Timeout.add_seconds (max_task_time, () => {
-					query_task.cancellable.cancel ();
-					return false;
-				});
+			Task task = client.tasks.pop_head ();
+
+			if (client.tasks.is_empty ()) {
+				query_client_map[i].remove (client.client_id);
+			} else {
+				// back of the line
+				query_clients[i].push_tail (client);
 			}
 
+			n_queries_queued--;
+			return task;
+		}
+
+		return null;
+	}
+
+	// must be called with query_mutex held
+	static Task? query_queue_next () {
+		if (!active || n_queries_running >= max_concurrent_queries) {
+			return null;
+		}
+
+		Task task = query_queue_pop ();
+
+		if (task != null) {
+			running_tasks.add (task);
 			n_queries_running++;
+		}
+
+		return task;
+	}
+
+	static void sched () {
+		Task task = null;
+
+		if (!active) {
+			return;
+		}
+
+		query_mutex.lock ();
+		while ((task = query_queue_next ()) != null) {
 			try {
 				query_pool.push (task);
 			} catch (Error e) {
 				// ignore harmless thread creation error
 			}
 		}
+		query_mutex.unlock ();
 
 		if (!update_running) {
 			for (int i = 0; i < Priority.N_PRIORITIES; i++) {
 				task = update_queues[i].pop_head ();
 				if (task != null) {
+					task = update_group_new (task, update_queues[i]);
 					break;
 				}
 			}
@@ -134,13 +219,49 @@ public class Tracker.Store {
 				}
 			}
 		}
+
+		AtomicInt.set (ref high_updates_queued, (int) update_queues[Priority.HIGH].get_length ());
+	}
+
+	static bool can_group (Task task) {
+		return (task.type == TaskType.UPDATE || task.type == TaskType.UPDATE_BLANK) &&
+		       !((UpdateTask) task).run_alone;
+	}
+
+	/* Returns a group with @task and the updates queued after it, or
+	 * @task alone if there are none.
+	 */
+	static Task update_group_new (Task task, Queue<Task> queue) {
+		if (!can_group (task) || queue.is_empty () || !can_group (queue.peek_head ())) {
+			return task;
+		}
+
+		var group = new UpdateGroup ();
+		group.type = TaskType.UPDATE_GROUP;
+		group.priority = ((UpdateTask) task).priority;
+		group.tasks += (UpdateTask) task;
+
+		while (group.tasks.length < MAX_GROUP_SIZE && !queue.is_empty () && can_group (queue.peek_head ())) {
+			group.tasks += (UpdateTask) queue.pop_head ();
+		}
+
+		return group;
 	}
 
 	static Tracker.Data.CommitType commit_type (Task task) {
 		switch (task.type) {
 			case TaskType.UPDATE:
 			case TaskType.UPDATE_BLANK:
-				if (((UpdateTask) task).priority == Priority.HIGH) {
+			case TaskType.UPDATE_GROUP:
+				Priority priority;
+
+				if (task.type == TaskType.UPDATE_GROUP) {
+					priority = ((UpdateGroup) task).priority;
+				} else {
+					priority = ((UpdateTask) task).priority;
+				}
+
+				if (priority == Priority.HIGH) {
 					return Tracker.Data.CommitType.REGULAR;
 				} else if (update_queues[Priority.LOW].get_length () > 0) {
 					return Tracker.Data.CommitType.BATCH;
@@ -174,8 +295,9 @@ public class Tracker.Store {
 			task.callback ();
 			task.error = null;
 
+			query_mutex.lock ();
 			running_tasks.remove (task);
-			n_queries_running--;
+			query_mutex.unlock ();
 		} else if (task.type == TaskType.UPDATE || task.type == TaskType.UPDATE_BLANK) {
 			if (task.error == null) {
 				Tracker.Data.notify_transaction (commit_type (task));
@@ -184,6 +306,10 @@ public class Tracker.Store {
 			task.callback ();
 			task.error = null;
 
+			update_running = false;
+		} else if (task.type == TaskType.UPDATE_GROUP) {
+			update_group_finish ((UpdateGroup) task);
+
 			update_running = false;
 		} else if (task.type == TaskType.TURTLE) {
 			if (task.error == null) {
@@ -196,7 +322,7 @@ public class Tracker.Store {
 			update_running = false;
 		}
 
-		if (n_queries_running == 0 && !update_running && active_callback != null) {
+		if (!queries_running () && !update_running && active_callback != null) {
 			active_callback ();
 		}
 
@@ -205,47 +331,212 @@ public class Tracker.Store {
 		return false;
 	}
 
-	static void pool_dispatch_cb (Task task) {
-		try {
-			if (task.type == TaskType.QUERY) {
-				var query_task = (QueryTask) task;
+	static void update_group_finish (UpdateGroup group) {
+		unowned Queue<Task> queue = update_queues[group.priority];
+
+		if (group.failed) {
+			// the whole transaction was rolled back, run the
+			// updates again one by one so only the failing
+			// ones get an error
+			for (int i = group.tasks.length - 1; i >= 0; i--) {
+				group.tasks[i].run_alone = true;
+				queue.push_head (group.tasks[i]);
+			}
+
+			return;
+		}
+
+		// the updates left out of the transaction are still first
+		for (int i = group.tasks.length - 1; i >= group.n_run; i--) {
+			queue.push_head (group.tasks[i]);
+		}
+
+		if (group.error == null) {
+			Tracker.Data.notify_transaction (commit_type (group));
+		}
+
+		for (int i = 0; i < group.n_run; i++) {
+			var task = group.tasks[i];
+
+			task.error = group.error;
+			task.callback ();
+			task.error = null;
+		}
+	}
+
+	static bool queries_running () {
+		bool running;
+
+		query_mutex.lock ();
+		running = (n_queries_running > 0);
+		query_mutex.unlock ();
+
+		return running;
+	}
+
+	static void task_finish (Task task) {
+		Idle.add (() => {
+			task_finish_cb (task);
+			return false;
+		});
+	}
+
+	static void query_run (QueryTask query_task) {
+		if (max_task_time != 0) {
+			query_task.watchdog_id = Timeout.add_seconds (max_task_time, () => {
+				query_task.cancellable.cancel ();
+				return false;
+			});
+		}
 
-				var cursor = Tracker.Data.query_sparql_cursor (query_task.query);
+		try {
+			DBCursor cursor;
 
-				query_task.in_thread (cursor);
+			if (query_task.parameters != null) {
+				cursor = get_prepared_query (query_task.query).execute_prepared (query_task.parameters, false);
 			} else {
-				var iface = DBManager.get_db_interface ();
-				iface.sqlite_wal_hook (wal_hook);
+				cursor = Tracker.Data.query_sparql_cursor (query_task.query);
+			}
+
+			query_task.in_thread (cursor);
+		} catch (Error e) {
+			query_task.error = e;
+		}
+	}
 
-				if (task.type == TaskType.UPDATE) {
-					var update_task = (UpdateTask) task;
+	// must be called with prepared_mutex held
+	static void check_prepared_generation (uint generation) {
+		if (generation != prepared_generation) {
+			prepared_queries.remove_all ();
+			prepared_generation = generation;
+		}
+	}
 
-					Tracker.Data.update_sparql (update_task.query);
-				} else if (task.type == TaskType.UPDATE_BLANK) {
-					var update_task = (UpdateTask) task;
+	static Sparql.Query get_prepared_query (string sparql) throws Error {
+		uint generation = Sparql.Query.get_cache_generation ();
 
-					update_task.blank_nodes = Tracker.Data.update_sparql_blank (update_task.query);
-				} else if (task.type == TaskType.TURTLE) {
-					var turtle_task = (TurtleTask) task;
+		prepared_mutex.lock ();
+		check_prepared_generation (generation);
+		var query = prepared_queries.lookup (sparql);
+		prepared_mutex.unlock ();
 
-					var file = File.new_for_path (turtle_task.path);
+		if (query == null) {
+			query = new Sparql.Query (sparql);
+			query.prepare ();
 
-					Tracker.Events.freeze ();
-					try {
-						Tracker.Data.load_turtle_file (file);
-					} finally {
-						Tracker.Events.reset_pending ();
-					}
+			prepared_mutex.lock ();
+			// not kept if the cache was cleared while preparing
+			if (generation == Sparql.Query.get_cache_generation ()) {
+				check_prepared_generation (generation);
+				if (prepared_queries.size () >= MAX_PREPARED_QUERIES) {
+					prepared_queries.remove_all ();
+				}
+				prepared_queries.insert (sparql, query);
+			}
+			prepared_mutex.unlock ();
+		}
+
+		return query;
+	}
+
+	static void query_dispatch_cb (Task task) {
+		// run in query thread
+
+		Task next = task;
+
+		while (next != null) {
+			Task done = next;
+
+			query_run ((QueryTask) done);
+
+			/* Pick up the next query here, the main loop is
+			 * only needed to complete the finished one.
+			 */
+			query_mutex.lock ();
+			n_queries_running--;
+			next = query_queue_next ();
+			query_mutex.unlock ();
+
+			task_finish (done);
+		}
+	}
+
+	static void pool_dispatch_cb (Task task) {
+		// run in update thread
+
+		try {
+			var iface = DBManager.get_db_interface ();
+			iface.sqlite_wal_hook (wal_hook);
+
+			if (task.type == TaskType.UPDATE) {
+				var update_task = (UpdateTask) task;
+
+				Tracker.Data.update_sparql (update_task.query);
+			} else if (task.type == TaskType.UPDATE_BLANK) {
+				var update_task = (UpdateTask) task;
+
+				update_task.blank_nodes = Tracker.Data.update_sparql_blank (update_task.query);
+			} else if (task.type == TaskType.UPDATE_GROUP) {
+				update_group_run ((UpdateGroup) task);
+			} else if (task.type == TaskType.TURTLE) {
+				var turtle_task = (TurtleTask) task;
+
+				var file = File.new_for_path (turtle_task.path);
+
+				Tracker.Events.freeze ();
+				try {
+					Tracker.Data.load_turtle_file (file);
+				} finally {
+					Tracker.Events.reset_pending ();
 				}
 			}
 		} catch (Error e) {
 			task.error = e;
 		}
 
-		Idle.add (() => {
-			task_finish_cb (task);
-			return false;
-		});
+		task_finish (task);
+	}
+
+	static void update_group_run (UpdateGroup group) throws Error {
+		// run in update thread
+
+		int64 deadline = get_monotonic_time () + MAX_GROUP_TIME * 1000;
+
+		try {
+			Tracker.Data.begin_transaction ();
+		} catch (Error e) {
+			// fails the same way for all of them
+			group.n_run = group.tasks.length;
+			throw e;
+		}
+
+		try {
+			foreach (var task in group.tasks) {
+				if (group.n_run > 0 &&
+				    (get_monotonic_time () > deadline ||
+				     (group.priority != Priority.HIGH && AtomicInt.get (ref high_updates_queued) > 0))) {
+					break;
+				}
+
+				var query = new Sparql.Query.update (task.query);
+				task.blank_nodes = query.execute_update (task.type == TaskType.UPDATE_BLANK);
+
+				// so errors writing the update show up here and
+				// not in the commit
+				Tracker.Data.update_buffer_flush ();
+
+				group.n_run++;
+			}
+		} catch (Error e) {
+			Tracker.Data.rollback_transaction ();
+			group.failed = true;
+			return;
+		}
+
+		// one commit, and one journal write, for all of them
+		Tracker.Data.commit_transaction ();
+
+		debug ("Committed %d of %d queued updates at once", group.n_run, group.tasks.length);
 	}
 
 	public static void wal_checkpoint () {
@@ -299,15 +590,22 @@ public class Tracker.Store {
 		}
 
 		running_tasks = new GenericArray<Task> ();
+		prepared_queries = new HashTable<string, Sparql.Query> (str_hash, str_equal);
+		prepared_generation = Sparql.Query.get_cache_generation ();
 
 		for (int i = 0; i < Priority.N_PRIORITIES; i++) {
-			query_queues[i] = new Queue<Task> ();
+			query_clients[i] = new Queue<ClientQueue> ();
+			query_client_map[i] = new HashTable<string, ClientQueue> (str_hash, str_equal);
 			update_queues[i] = new Queue<Task> ();
 		}
 
+		/* One query thread per read connection */
+		max_concurrent_queries = (int) DBManager.get_max_read_interfaces ();
+		debug ("Running up to %d queries concurrently", max_concurrent_queries);
+
 		try {
 			update_pool = new ThreadPool<Task> (pool_dispatch_cb, 1, true);
-			query_pool = new ThreadPool<Task> (pool_dispatch_cb, MAX_CONCURRENT_QUERIES, true);
+			query_pool = new ThreadPool<Task> (query_dispatch_cb, max_concurrent_queries, true);
 			checkpoint_pool = new ThreadPool<bool> (checkpoint_dispatch_cb, 1, true);
 		} catch (Error e) {
 			warning (e.message);
@@ -324,23 +622,28 @@ public class Tracker.Store {
 		query_pool = null;
 		update_pool = null;
 		checkpoint_pool = null;
+		prepared_queries = null;
 
 		for (int i = 0; i < Priority.N_PRIORITIES; i++) {
-			query_queues[i] = null;
+			query_clients[i] = null;
+			query_client_map[i] = null;
 			update_queues[i] = null;
 		}
 	}
 
-	public static async void sparql_query (string sparql, Priority priority, SparqlQueryInThread in_thread, string client_id) throws Error {
+	public static async void sparql_query (string sparql, Priority priority, SparqlQueryInThread in_thread, string client_id, HashTable<string, Variant>? parameters = null) throws Error {
 		var task = new QueryTask ();
 		task.type = TaskType.QUERY;
 		task.query = sparql;
+		task.parameters = parameters;
 		task.cancellable = new Cancellable ();
 		task.in_thread = in_thread;
 		task.callback = sparql_query.callback;
 		task.client_id = client_id;
 
-		query_queues[priority].push_tail (task);
+		query_mutex.lock ();
+		query_queue_push (task, priority);
+		query_mutex.unlock ();
 
 		sched ();
 
@@ -412,8 +715,11 @@ public class Tracker.Store {
 	public uint get_queue_size () {
 		uint result = 0;
 
+		query_mutex.lock ();
+		result += n_queries_queued;
+		query_mutex.unlock ();
+
 		for (int i = 0; i < Priority.N_PRIORITIES; i++) {
-			result += query_queues[i].get_length ();
 			result += update_queues[i].get_length ();
 		}
 		return result;
@@ -422,6 +728,9 @@ public class Tracker.Store {
 	public static void unreg_batches (string client_id) {
 		unowned List<Task> list, cur;
 		unowned Queue<Task> queue;
+		var dropped = new Queue<Task> ();
+
+		query_mutex.lock ();
 
 		for (int i = 0; i < running_tasks.length; i++) {
 			unowned QueryTask task = running_tasks[i] as QueryTask;
@@ -431,21 +740,29 @@ public class Tracker.Store {
 		}
 
 		for (int i = 0; i < Priority.N_PRIORITIES; i++) {
-			queue = query_queues[i];
-			list = queue.head;
-			while (list != null) {
-				cur = list;
-				list = list.next;
-				unowned Task task = cur.data;
+			ClientQueue client = query_client_map[i].lookup (client_id ?? "");
 
-				if (task != null && task.client_id == client_id) {
-					queue.delete_link (cur);
+			if (client != null) {
+				query_client_map[i].remove (client.client_id);
+				query_clients[i].remove (client);
 
-					task.error = new DBusError.FAILED ("Client disappeared");
-					task.callback ();
+				Task queued;
+				while ((queued = client.tasks.pop_head ()) != null) {
+					n_queries_queued--;
+					dropped.push_tail (queued);
 				}
 			}
+		}
 
+		query_mutex.unlock ();
+
+		Task dropped_task;
+		while ((dropped_task = dropped.pop_head ()) != null) {
+			dropped_task.error = new DBusError.FAILED ("Client disappeared");
+			dropped_task.callback ();
+		}
+
+		for (int i = 0; i < Priority.N_PRIORITIES; i++) {
 			queue = update_queues[i];
 			list = queue.head;
 			while (list != null) {
@@ -466,9 +783,11 @@ public class Tracker.Store {
 	}
 
 	public static async void pause () {
+		query_mutex.lock ();
 		Tracker.Store.active = false;
+		query_mutex.unlock ();
 
-		if (n_queries_running > 0 || update_running) {
+		if (queries_running () || update_running) {
 			active_callback = pause.callback;
 			yield;
 			active_callback = null;
@@ -490,8 +809,34 @@ public class Tracker.Store {
 	}
 
 	public static void resume () {
+		query_mutex.lock ();
 		Tracker.Store.active = true;
+		query_mutex.unlock ();
 
 		sched ();
 	}
+
+	public static async void attach_volume (string uuid) throws Error {
+		yield pause ();
+
+		try {
+			DBManager.attach_volume (uuid);
+		} finally {
+			resume ();
+		}
+	}
+
+	public static async bool forget_volume (string uuid) throws Error {
+		bool forgotten = false;
+
+		yield pause ();
+
+		try {
+			forgotten = Data.forget_volume (uuid);
+		} finally {
+			resume ();
+		}
+
+		return forgotten;
+	}
 }
@@ -0,0 +1,169 @@
+#!/usr/bin/python
+#
+# Copyright (C) 2026, Pelagicore AB
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+"""
+Benchmark queries sent concurrently by several clients, each with
+its own bus connection, to check the query scheduler throughput and
+that a client flooding the store doesn't hold back the others.
+"""
+import sys,os,dbus
+import unittest
+import time
+import gobject
+from dbus.mainloop.glib import DBusGMainLoop
+
+from common.utils import configuration as cfg
+import unittest2 as ut
+#import unittest as ut
+from common.utils.storetest import CommonTrackerStoreTest as CommonTrackerStoreTest
+
+AMOUNT_OF_TEST_INSTANCES = 1000
+BURST_QUERIES = 200
+LIGHT_QUERIES = 10
+
+# Client name, number of queries sent at once
+CLIENTS = [("hmi", BURST_QUERIES),
+           ("voice", LIGHT_QUERIES),
+           ("media", LIGHT_QUERIES)]
+
+QUERY = """
+SELECT ?u ?name WHERE {
+    ?u a nco:PersonContact ;
+       nco:fullname ?name .
+    FILTER (fn:starts-with (?name, 'client-18'))
+} ORDER BY ?name
+"""
+
+class Client:
+    def __init__ (self, name, n_queries):
+        self.name = name
+        self.n_queries = n_queries
+        self.latencies = []
+        self.finished = None
+        self.errors = 0
+
+        # A private connection gets its own sender on the bus
+        self.bus = dbus.SessionBus (private=True, mainloop=DBusGMainLoop ())
+        tracker = self.bus.get_object (cfg.TRACKER_BUSNAME, cfg.TRACKER_OBJ_PATH)
+        self.resources = dbus.Interface (tracker, dbus_interface=cfg.RESOURCES_IFACE)
+
+    def start (self, done_cb):
+        for i in range (0, self.n_queries):
+            sent = time.time ()
+            self.resources.SparqlQuery (QUERY,
+                                        reply_handler=lambda results, sent=sent: self.reply_cb (results, sent, done_cb),
+                                        error_handler=lambda error: self.error_cb (error, done_cb))
+
+    def reply_cb (self, results, sent, done_cb):
+        assert len (results) == AMOUNT_OF_TEST_INSTANCES
+        self.latencies.append (time.time () - sent)
+        self.check_done (done_cb)
+
+    def error_cb (self, error, done_cb):
+        print "ERROR in DBus call for client %s: %s" % (self.name, error)
+        self.errors += 1
+        self.check_done (done_cb)
+
+    def check_done (self, done_cb):
+        if len (self.latencies) + self.errors == self.n_queries:
+            self.finished = time.time ()
+            done_cb (self)
+
+    def percentile (self, p):
+        latencies = sorted (self.latencies)
+        return latencies[min (len (latencies) - 1, int (len (latencies) * p))]
+
+    def close (self):
+        self.bus.close ()
+
+
+class TestConcurrentClients (CommonTrackerStoreTest):
+    """
+    Several clients send queries at the same time, one of them
+    flooding the store with many more than the others
+    """
+    def setUp (self):
+        self.main_loop = gobject.MainLoop ()
+        self.mock_data_insert ()
+
+    def tearDown (self):
+        self.mock_data_delete ()
+
+    def mock_data_insert (self):
+        query = "INSERT {\n"
+        for i in range (0, AMOUNT_OF_TEST_INSTANCES):
+            query += "<test-18:instance-%d> a nco:PersonContact ; nco:fullname 'client-18 %d'.\n" % (i, i)
+        query += "}"
+        self.tracker.update (query)
+
+    def mock_data_delete (self):
+        query = "DELETE {\n"
+        for i in range (0, AMOUNT_OF_TEST_INSTANCES):
+            query += "<test-18:instance-%d> a rdfs:Resource.\n" % (i)
+        query += "}"
+        self.tracker.update (query)
+
+    def client_done_cb (self, client):
+        self.n_running -= 1
+        if self.n_running == 0:
+            self.main_loop.quit ()
+
+    def timeout_cb (self):
+        self.timed_out = True
+        self.main_loop.quit ()
+        return False
+
+    def test_concurrent_clients (self):
+        clients = [Client (name, n) for (name, n) in CLIENTS]
+        self.n_running = len (clients)
+        self.timed_out = False
+
+        start = time.time ()
+        for client in clients:
+            client.start (self.client_done_cb)
+
+        gobject.timeout_add_seconds (120, self.timeout_cb)
+        self.main_loop.run ()
+        elapsed = time.time () - start
+
+        self.assertFalse (self.timed_out)
+
+        total = sum ([len (c.latencies) for c in clients])
+        print ""
+        print "%d queries from %d clients in %.2f s (%.1f queries/s)" % \
+            (total, len (clients), elapsed, total / elapsed)
+
+        for client in clients:
+            print "  %-6s %4d queries, latency p50 %.3f s, p95 %.3f s, done after %.2f s" % \
+                (client.name, client.n_queries,
+                 client.percentile (0.5), client.percentile (0.95),
+                 client.finished - start)
+            self.assertEquals (client.errors, 0)
+
+        # Light clients are served in turns with the flooding one,
+        # they must not wait for its whole burst to be processed
+        heavy = clients[0]
+        for client in clients[1:]:
+            self.assertTrue (client.finished < heavy.finished)
+
+        for client in clients:
+            client.close ()
+
+if __name__ == "__main__":
+    ut.main ()
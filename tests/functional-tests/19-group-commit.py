@@ -0,0 +1,120 @@
+#!/usr/bin/python
+#
+# Copyright (C) 2026, Pelagicore AB
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+"""
+Send many updates at once, so the store commits them in groups, and
+check that a failing update only fails itself.
+"""
+import sys,os,dbus
+import unittest
+import time
+import gobject
+from dbus.mainloop.glib import DBusGMainLoop
+
+from common.utils import configuration as cfg
+import unittest2 as ut
+#import unittest as ut
+from common.utils.storetest import CommonTrackerStoreTest as CommonTrackerStoreTest
+
+AMOUNT_OF_UPDATES = 500
+
+# Every FAILING_UPDATE-th update is invalid
+FAILING_UPDATE = 100
+
+UPDATE = "INSERT { <test-19:instance-%d> a nco:PersonContact ; nco:fullname 'group-19 %d' }"
+INVALID_UPDATE = "INSERT { <test-19:instance-%d> a nco:PersonContact ; nco:nonExistingProperty 'group-19 %d' }"
+
+class TestGroupCommit (CommonTrackerStoreTest):
+    """
+    Updates sent without waiting for the previous ones to finish
+    """
+    def setUp (self):
+        self.main_loop = gobject.MainLoop ()
+
+        self.bus = dbus.SessionBus (private=True, mainloop=DBusGMainLoop ())
+        tracker = self.bus.get_object (cfg.TRACKER_BUSNAME, cfg.TRACKER_OBJ_PATH)
+        self.resources = dbus.Interface (tracker, dbus_interface=cfg.RESOURCES_IFACE)
+
+    def tearDown (self):
+        self.tracker.update ("DELETE { ?u a rdfs:Resource } WHERE { ?u nco:fullname ?name FILTER (fn:starts-with (?name, 'group-19')) }")
+        self.bus.close ()
+
+    def reply_cb (self, i):
+        self.succeeded.append (i)
+        self.check_done ()
+
+    def error_cb (self, i, error):
+        self.failed.append (i)
+        self.check_done ()
+
+    def check_done (self):
+        if len (self.succeeded) + len (self.failed) == AMOUNT_OF_UPDATES:
+            self.main_loop.quit ()
+
+    def timeout_cb (self):
+        self.timed_out = True
+        self.main_loop.quit ()
+        return False
+
+    def send_updates (self, batch):
+        self.succeeded = []
+        self.failed = []
+        self.timed_out = False
+
+        start = time.time ()
+        for i in range (0, AMOUNT_OF_UPDATES):
+            if i % FAILING_UPDATE == FAILING_UPDATE - 1:
+                update = INVALID_UPDATE % (i, i)
+            else:
+                update = UPDATE % (i, i)
+
+            if batch:
+                method = self.resources.BatchSparqlUpdate
+            else:
+                method = self.resources.SparqlUpdate
+
+            method (update,
+                    reply_handler=lambda i=i: self.reply_cb (i),
+                    error_handler=lambda error, i=i: self.error_cb (i, error))
+
+        gobject.timeout_add_seconds (120, self.timeout_cb)
+        self.main_loop.run ()
+        elapsed = time.time () - start
+
+        self.assertFalse (self.timed_out)
+
+        print ""
+        print "%d %supdates in %.2f s (%.1f updates/s)" % \
+            (AMOUNT_OF_UPDATES, "batch " if batch else "", elapsed, AMOUNT_OF_UPDATES / elapsed)
+
+        # Only the invalid updates failed
+        self.assertEquals (sorted (self.failed),
+                           range (FAILING_UPDATE - 1, AMOUNT_OF_UPDATES, FAILING_UPDATE))
+
+        results = self.tracker.query ("SELECT COUNT (?u) WHERE { ?u nco:fullname ?name FILTER (fn:starts-with (?name, 'group-19')) }")
+        self.assertEquals (int (results[0][0]), AMOUNT_OF_UPDATES - AMOUNT_OF_UPDATES / FAILING_UPDATE)
+
+    def test_group_commit (self):
+        self.send_updates (False)
+
+    def test_group_commit_batch (self):
+        self.send_updates (True)
+
+if __name__ == "__main__":
+    ut.main ()
@@ -0,0 +1,234 @@
+#!/usr/bin/python
+#
+# Copyright (C) 2026, Pelagicore AB
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA  02110-1301, USA.
+
+"""
+Index files with embedded metadata extraction deferred, and check the
+file level data of every file is stored before the extractor data,
+which then gets added to the same resources. All files are copies of
+the same image, so most get their embedded metadata by fingerprint.
+"""
+import os
+import shutil
+
+import unittest2 as ut
+from common.utils import configuration as cfg
+from common.utils.helpers import MinerFsHelper, StoreHelper, ExtractorHelper, log
+from common.utils.system import TrackerSystemAbstraction
+
+MINER_TMP_DIR = cfg.TEST_MONITORED_TMP_DIR
+
+def get_test_path (filename):
+    return os.path.join (MINER_TMP_DIR, filename)
+
+def get_test_uri (filename):
+    return "file://" + os.path.join (MINER_TMP_DIR, filename)
+
+# More files than fit in one commit, so both phases span several batches
+AMOUNT_OF_FILES = 250
+
+TEST_IMAGE = "test-image-1.jpg"
+TEST_IMAGE_WIDTH = 699
+
+OTHER_IMAGE = "roi.jpg"
+OTHER_IMAGE_WIDTH = 128
+
+CONF_OPTIONS = [
+    (cfg.DCONF_MINER_SCHEMA, "enable-writeback", "false"),
+    (cfg.DCONF_MINER_SCHEMA, "index-recursive-directories", [os.path.join (MINER_TMP_DIR, "test-deferred")]),
+    (cfg.DCONF_MINER_SCHEMA, "index-single-directories", "[]"),
+    (cfg.DCONF_MINER_SCHEMA, "index-optical-discs", "false"),
+    (cfg.DCONF_MINER_SCHEMA, "index-removable-devices", "false"),
+    (cfg.DCONF_MINER_SCHEMA, "defer-embedded-metadata", "true"),
+    (cfg.DCONF_MINER_SCHEMA, "enable-content-fingerprint", "true"),
+    (cfg.DCONF_MINER_SCHEMA, "commit-batch-max", 100),
+    (cfg.DCONF_MINER_SCHEMA, "throttle", 0)
+    ]
+
+
+class MinerDeferredExtractionTest (ut.TestCase):
+
+    @classmethod
+    def __prepare_directories (self):
+        if (os.path.exists (os.getcwd () + "/test-extraction-data")):
+            # Use local directory if available
+            data_path = os.getcwd () + "/test-extraction-data"
+        else:
+            data_path = os.path.join (cfg.DATADIR, "tracker-tests",
+                                      "test-extraction-data")
+        self.data_path = data_path
+
+        directory = get_test_path ("test-deferred")
+        if os.path.exists (directory):
+            shutil.rmtree (directory)
+        os.makedirs (directory)
+
+        for i in range (AMOUNT_OF_FILES):
+            shutil.copyfile (os.path.join (data_path, "images", TEST_IMAGE),
+                             os.path.join (directory, "image-%d.jpg" % i))
+
+    @classmethod
+    def setUpClass (self):
+        self.__prepare_directories ()
+
+        self.system = TrackerSystemAbstraction ()
+        self.system.set_up_environment (CONF_OPTIONS, None)
+        self.store = StoreHelper ()
+        self.store.start ()
+        self.extractor = ExtractorHelper ()
+        self.extractor.start ()
+
+        # Look at the store when the miner reports the second phase
+        self.extraction_statuses = []
+        self.files_on_extraction = None
+        self.extracted_on_extraction = None
+
+        status_match = self.store.bus.add_signal_receiver (self._miner_progress_cb,
+                                                           signal_name="Progress",
+                                                           path=cfg.MINERFS_OBJ_PATH,
+                                                           dbus_interface=cfg.MINER_IFACE)
+
+        # Returns once the extraction queue is empty too
+        self.miner_fs = MinerFsHelper ()
+        self.miner_fs.start ()
+
+        self.store.bus._clean_up_signal_match (status_match)
+
+    @classmethod
+    def tearDownClass (self):
+        self.miner_fs.stop ()
+        self.extractor.stop ()
+        self.store.stop ()
+        self.system.unset_up_environment ()
+
+    @classmethod
+    def _count_files (self):
+        return int (self.store.query ("""
+          SELECT COUNT(?f) WHERE {
+              ?f a ivi:File ;
+                 ivi:fileurl ?url .
+              FILTER (fn:starts-with (?url, "%s"))
+          }
+          """ % get_test_uri ("test-deferred/"))[0][0])
+
+    @classmethod
+    def _count_extracted (self):
+        return int (self.store.query ("""
+          SELECT COUNT(?f) WHERE {
+              ?f a ivi:File, ivi:Image ;
+                 ivi:fileurl ?url ;
+                 ivi:imagewidth %d .
+              FILTER (fn:starts-with (?url, "%s"))
+          }
+          """ % (TEST_IMAGE_WIDTH, get_test_uri ("test-deferred/")))[0][0])
+
+    @classmethod
+    def _count_fingerprinted (self):
+        return int (self.store.query ("""
+          SELECT COUNT(?f) WHERE {
+              ?f a ivi:File ;
+                 ivi:fileurl ?url ;
+                 ivi:filefingerprint ?fingerprint .
+              FILTER (fn:starts-with (?url, "%s"))
+          }
+          """ % get_test_uri ("test-deferred/"))[0][0])
+
+    @classmethod
+    def _miner_progress_cb (self, status, progress, remaining_time):
+        if not status.startswith ("Extracting metadata"):
+            return
+
+        self.extraction_statuses.append (progress)
+
+        if self.files_on_extraction is None:
+            self.files_on_extraction = self._count_files ()
+            self.extracted_on_extraction = self._count_extracted ()
+            log ("Extraction started with %d files, %d extracted" %
+                 (self.files_on_extraction, self.extracted_on_extraction))
+
+    def test_01_file_data_first (self):
+        """
+        All files are in the store before extraction starts
+        """
+        self.assertTrue (len (self.extraction_statuses) > 0)
+        self.assertEquals (self.files_on_extraction, AMOUNT_OF_FILES)
+        self.assertTrue (self.extracted_on_extraction < AMOUNT_OF_FILES)
+
+    def test_02_extraction_progress (self):
+        """
+        Progress counts extracted files, between the special values
+        """
+        for progress in self.extraction_statuses:
+            self.assertTrue (progress > 0.0 and progress < 1.0)
+
+        self.assertEquals (self.extraction_statuses,
+                           sorted (self.extraction_statuses))
+
+    def test_03_extractor_data_follows (self):
+        """
+        Embedded metadata is added to the existing resources
+        """
+        self.assertEquals (self._count_files (), AMOUNT_OF_FILES)
+        self.assertEquals (self._count_extracted (), AMOUNT_OF_FILES)
+
+        # Not a second resource per file
+        result = self.store.query ("""
+          SELECT COUNT(?f) WHERE {
+              ?f ivi:fileurl "%s"
+          }
+          """ % get_test_uri ("test-deferred/image-0.jpg"))
+        self.assertEquals (int (result[0][0]), 1)
+
+        # Fingerprints are stored on the deferred path too
+        self.assertEquals (self._count_fingerprinted (), AMOUNT_OF_FILES)
+
+    def test_04_changed_file (self):
+        """
+        A file changed once indexed gets both phases again
+        """
+        path = get_test_path ("test-deferred/image-0.jpg")
+        os.remove (path)
+        self.miner_fs.wait_for_idle ()
+        self.assertEquals (self._count_files (), AMOUNT_OF_FILES - 1)
+
+        shutil.copyfile (get_test_path ("test-deferred/image-1.jpg"), path)
+        self.miner_fs.wait_for_idle ()
+
+        self.assertEquals (self._count_files (), AMOUNT_OF_FILES)
+        self.assertEquals (self._count_extracted (), AMOUNT_OF_FILES)
+
+    def test_05_rewritten_file (self):
+        """
+        Embedded metadata of a file rewritten in place replaces the old one
+        """
+        path = get_test_path ("test-deferred/image-2.jpg")
+        shutil.copyfile (os.path.join (self.data_path, "images", OTHER_IMAGE), path)
+        self.miner_fs.wait_for_idle ()
+
+        result = self.store.query ("""
+          SELECT ?width WHERE {
+              ?f ivi:fileurl "%s" ;
+                 ivi:imagewidth ?width
+          }
+          """ % get_test_uri ("test-deferred/image-2.jpg"))
+        self.assertEquals (len (result), 1)
+        self.assertEquals (int (result[0][0]), OTHER_IMAGE_WIDTH)
+
+
+if __name__ == "__main__":
+    ut.main ()
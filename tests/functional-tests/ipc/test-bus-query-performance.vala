@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+using Tracker;
+using Tracker.Sparql;
+
+// Measures time-to-first-row, CPU time per row and peak memory of the
+// client when browsing a large number of tracks through the bus
+// connection, with each result format, and with the results of the
+// blocks format read from the pipe or from shared memory. Run with
+// G_MESSAGES_DEBUG=all to also get the bytes read for each format.
+// Tracks are inserted first and removed afterwards.
+
+const int n_tracks = 50000;
+const int batch_size = 1000;
+
+// result formats and transports compared
+const int[] formats = { 1, 2, 2 };
+const string[] transports = { "pipe", "pipe", "shared" };
+
+const string browse_query = """
+SELECT ?u ?title ?n WHERE {
+	?u a nmm:MusicPiece ;
+	   nie:title ?title ;
+	   nmm:trackNumber ?n .
+	FILTER (fn:starts-with (?title, 'bus-query-performance'))
+} ORDER BY ?title
+""";
+
+// Peak resident set size of the process, in kB
+int get_peak_rss () {
+	string contents;
+
+	try {
+		FileUtils.get_contents ("/proc/self/status", out contents);
+	} catch (FileError e) {
+		return -1;
+	}
+
+	foreach (string line in contents.split ("\n")) {
+		if (line.has_prefix ("VmHWM:")) {
+			return int.parse (line.substring ("VmHWM:".length).strip ());
+		}
+	}
+
+	return -1;
+}
+
+int main (string[] args) {
+	Sparql.Connection con;
+
+	try {
+		con = new Tracker.Bus.Connection ();
+
+		for (int i = 0; i < n_tracks; i += batch_size) {
+			var query = new StringBuilder ("INSERT {");
+			for (int j = i; j < i + batch_size; j++) {
+				query.append_printf ("<bus-query-performance:%d> a nmm:MusicPiece ; nie:title 'bus-query-performance %06d' ; nmm:trackNumber %d .", j, j, j % 20);
+			}
+			query.append ("}");
+			con.update (query.str, Priority.LOW);
+		}
+	} catch (GLib.Error e) {
+		warning ("Couldn't insert tracks: %s", e.message);
+		return -1;
+	}
+
+	for (int i = 0; i < formats.length; i++) {
+		int format = formats[i];
+		string transport = transports[i];
+		Environment.set_variable ("TRACKER_BUS_RESULT_FORMAT", format.to_string (), true);
+		Environment.set_variable ("TRACKER_BUS_RESULT_TRANSPORT", transport, true);
+
+		int rss_before = get_peak_rss ();
+		var timer = new Timer ();
+		double first_row = -1;
+		int n_rows = 0;
+		int64 sum = 0;
+		Posix.clock_t cpu_start = Posix.clock ();
+
+		try {
+			var browse_con = new Tracker.Bus.Connection ();
+			var cursor = browse_con.query (browse_query);
+
+			while (cursor.next ()) {
+				if (n_rows++ == 0) {
+					first_row = timer.elapsed ();
+				}
+
+				cursor.get_string (0);
+				cursor.get_string (1);
+				sum += cursor.get_integer (2);
+			}
+		} catch (GLib.Error e) {
+			warning ("Couldn't browse tracks: %s", e.message);
+			return -1;
+		}
+
+		double last_row = timer.elapsed ();
+		double cpu = (double) (Posix.clock () - cpu_start) / Posix.CLOCKS_PER_SEC;
+
+		print ("Format %d, %s: %d rows, first row after %.3f s, last row after %.3f s, %.2f us CPU per row\n",
+		       format, transport, n_rows, first_row, last_row, 1000000 * cpu / n_rows);
+		print ("Format %d, %s: peak RSS %d kB before the query, %d kB after\n", format, transport, rss_before, get_peak_rss ());
+
+		if (n_rows != n_tracks || sum != n_tracks / 20 * 190) {
+			warning ("Unexpected results with format %d, %s", format, transport);
+			return -1;
+		}
+	}
+
+	try {
+		con.update ("DELETE { ?u a rdfs:Resource } WHERE { ?u nie:title ?title FILTER (fn:starts-with (?title, 'bus-query-performance')) }");
+	} catch (GLib.Error e) {
+		warning ("Couldn't delete tracks: %s", e.message);
+	}
+
+	return 0;
+}
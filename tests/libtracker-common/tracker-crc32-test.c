@@ -33,6 +33,115 @@ test_crc32_calculate ()
         g_assert_cmpint (expected, ==, result);
 }
 
+static const gchar *impl_names[] = { "table", "slicing-by-8", "hardware" };
+
+static void
+test_crc32c_calculate ()
+{
+        g_assert_cmphex (tracker_crc32 ("123456789", 9), ==, 0xCBF43926);
+        g_assert_cmphex (tracker_crc32c ("123456789", 9), ==, 0xE3069283);
+        g_assert_cmphex (tracker_crc32c ("", 0), ==, 0);
+}
+
+/* All implementations must agree, at any alignment and length */
+static void
+test_crc32_implementations ()
+{
+        TrackerCrc32Type type;
+        TrackerCrc32Impl impl, best;
+        guint8 data[256 + 8];
+        guint32 expected[8][64];
+        gint i, j;
+
+        for (i = 0; i < sizeof (data); i++) {
+                data[i] = g_test_rand_int ();
+        }
+
+        for (type = TRACKER_CRC32_IEEE; type <= TRACKER_CRC32_CASTAGNOLI; type++) {
+                best = tracker_crc32_get_impl (type);
+                g_assert (best != TRACKER_CRC32_IMPL_TABLE);
+
+                for (impl = TRACKER_CRC32_IMPL_TABLE; impl <= TRACKER_CRC32_IMPL_HARDWARE; impl++) {
+                        if (!tracker_crc32_set_impl (type, impl)) {
+                                g_assert (impl == TRACKER_CRC32_IMPL_HARDWARE);
+                                g_test_message ("No hardware CRC for type %d", type);
+                                continue;
+                        }
+
+                        for (i = 0; i < 8; i++) {
+                                for (j = 0; j < 64; j++) {
+                                        guint32 crc;
+
+                                        crc = (type == TRACKER_CRC32_IEEE ?
+                                               tracker_crc32 (data + i, j * 4 + i) :
+                                               tracker_crc32c (data + i, j * 4 + i));
+
+                                        if (impl == TRACKER_CRC32_IMPL_TABLE) {
+                                                expected[i][j] = crc;
+                                        } else {
+                                                g_assert_cmphex (crc, ==, expected[i][j]);
+                                        }
+                                }
+                        }
+                }
+
+                g_assert (tracker_crc32_set_impl (type, best));
+        }
+}
+
+static void
+test_crc32_benchmark ()
+{
+        TrackerCrc32Type type;
+        TrackerCrc32Impl impl, best;
+        gsize sizes[] = { 256, 4096, 1024 * 1024 };
+        guint8 *data;
+        gint i, j, n;
+
+        data = g_malloc (sizes[G_N_ELEMENTS (sizes) - 1]);
+
+        for (i = 0; i < sizes[G_N_ELEMENTS (sizes) - 1]; i++) {
+                data[i] = g_test_rand_int ();
+        }
+
+        for (type = TRACKER_CRC32_IEEE; type <= TRACKER_CRC32_CASTAGNOLI; type++) {
+                best = tracker_crc32_get_impl (type);
+
+                for (impl = TRACKER_CRC32_IMPL_TABLE; impl <= TRACKER_CRC32_IMPL_HARDWARE; impl++) {
+                        if (!tracker_crc32_set_impl (type, impl)) {
+                                continue;
+                        }
+
+                        for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+                                gdouble elapsed;
+
+                                /* 256 MB of data for each size */
+                                n = 256 * 1024 * 1024 / sizes[i];
+
+                                g_test_timer_start ();
+
+                                for (j = 0; j < n; j++) {
+                                        if (type == TRACKER_CRC32_IEEE) {
+                                                tracker_crc32 (data, sizes[i]);
+                                        } else {
+                                                tracker_crc32c (data, sizes[i]);
+                                        }
+                                }
+
+                                elapsed = g_test_timer_elapsed ();
+                                g_test_maximized_result (256 / elapsed,
+                                                         "%s %s, %" G_GSIZE_FORMAT " bytes: %.0f MB/s",
+                                                         type == TRACKER_CRC32_IEEE ? "crc32" : "crc32c",
+                                                         impl_names[impl], sizes[i], 256 / elapsed);
+                        }
+                }
+
+                tracker_crc32_set_impl (type, best);
+        }
+
+        g_free (data);
+}
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -40,6 +149,15 @@ main (gint argc, gchar **argv)
 
         g_test_add_func ("/libtracker-common/crc32/calculate",
                          test_crc32_calculate);
+        g_test_add_func ("/libtracker-common/crc32/calculate-crc32c",
+                         test_crc32c_calculate);
+        g_test_add_func ("/libtracker-common/crc32/implementations",
+                         test_crc32_implementations);
+
+        if (g_test_perf ()) {
+                g_test_add_func ("/libtracker-common/crc32/benchmark",
+                                 test_crc32_benchmark);
+        }
 
         return g_test_run ();
 }
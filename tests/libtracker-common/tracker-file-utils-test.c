@@ -241,6 +241,81 @@ test_file_get_mime_type (void)
 
 }
 
+static gchar *
+fingerprint_for_contents (const gchar *contents,
+                          gssize       length)
+{
+	GFile *f;
+	gchar *result;
+
+	g_assert (g_file_set_contents ("./fingerprint-test", contents, length, NULL));
+
+	f = g_file_new_for_path ("./fingerprint-test");
+	result = tracker_file_get_content_fingerprint (f, NULL, NULL);
+	g_assert (result != NULL);
+	g_object_unref (f);
+
+	remove_file ("./fingerprint-test");
+
+	return result;
+}
+
+static void
+test_file_get_content_fingerprint (void)
+{
+	gchar *contents, *one, *two;
+	GError *error = NULL;
+	gsize length;
+	GFile *f;
+
+	/* Small files are hashed whole */
+	one = fingerprint_for_contents ("Just some stuff", -1);
+	g_assert (g_str_has_prefix (one, "15-"));
+	two = fingerprint_for_contents ("Just some stuff", -1);
+	g_assert_cmpstr (one, ==, two);
+	g_free (two);
+	two = fingerprint_for_contents ("Just some stuf!", -1);
+	g_assert_cmpstr (one, !=, two);
+	g_free (one);
+	g_free (two);
+
+	/* Large files only on their head and tail */
+	length = 4 * TRACKER_FILE_FINGERPRINT_BLOCK;
+	contents = g_malloc0 (length);
+	one = fingerprint_for_contents (contents, length);
+	g_assert (g_str_has_prefix (one, "262144-"));
+
+	contents[length / 2] = 'x';
+	two = fingerprint_for_contents (contents, length);
+	g_assert_cmpstr (one, ==, two);
+	g_free (two);
+
+	contents[length - 1] = 'x';
+	two = fingerprint_for_contents (contents, length);
+	g_assert_cmpstr (one, !=, two);
+	g_free (two);
+
+	contents[length - 1] = '\0';
+	contents[0] = 'x';
+	two = fingerprint_for_contents (contents, length);
+	g_assert_cmpstr (one, !=, two);
+	g_free (two);
+
+	/* Same head and tail, different size */
+	two = fingerprint_for_contents (contents, length - 1);
+	g_assert_cmpstr (one, !=, two);
+	g_free (two);
+	g_free (one);
+	g_free (contents);
+
+	f = g_file_new_for_path ("./file-does-NOT-exist");
+	one = tracker_file_get_content_fingerprint (f, NULL, &error);
+	g_assert (one == NULL);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_error_free (error);
+	g_object_unref (f);
+}
+
 #define assert_filename_match(a, b) { \
 	g_assert_cmpint (tracker_filename_casecmp_without_extension (a, b), ==, TRUE); \
 	g_assert_cmpint (tracker_filename_casecmp_without_extension (b, a), ==, TRUE); }
@@ -484,6 +559,8 @@ main (int argc, char **argv)
 	                 test_path_list_filter_duplicates_with_exceptions);
 	g_test_add_func ("/libtracker-common/file-utils/file_get_mime_type",
 	                 test_file_get_mime_type);
+	g_test_add_func ("/libtracker-common/file-utils/file_get_content_fingerprint",
+	                 test_file_get_content_fingerprint);
 	g_test_add_func ("/libtracker-common/file-utils/case_match_filename_without_extension",
 	                 test_case_match_filename_without_extension);
 
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <glib.h>
+#include <libtracker-common/tracker-memfd.h>
+
+#define RESULTS "results written by the store"
+
+static void
+test_memfd_seal (void)
+{
+	gchar *mapped;
+	gint fd;
+
+	fd = tracker_memfd_create ("tracker-memfd-test");
+	if (fd < 0) {
+		g_print ("(memfds not supported, skipped) ");
+		return;
+	}
+
+	/* Grows as it is written */
+	g_assert_cmpint (write (fd, RESULTS, strlen (RESULTS)), ==, strlen (RESULTS));
+	g_assert (!tracker_memfd_is_sealed (fd));
+
+	g_assert (tracker_memfd_seal (fd));
+	g_assert (tracker_memfd_is_sealed (fd));
+
+	/* Neither its size nor its contents can change anymore */
+	g_assert_cmpint (write (fd, RESULTS, strlen (RESULTS)), <, 0);
+	g_assert_cmpint (ftruncate (fd, 0), <, 0);
+
+	mapped = mmap (NULL, strlen (RESULTS), PROT_READ, MAP_PRIVATE, fd, 0);
+	g_assert (mapped != MAP_FAILED);
+	g_assert (strncmp (mapped, RESULTS, strlen (RESULTS)) == 0);
+
+	munmap (mapped, strlen (RESULTS));
+	close (fd);
+}
+
+static void
+test_memfd_not_sealed (void)
+{
+	gint fds[2];
+
+	/* Only memfds can be sealed */
+	g_assert (pipe (fds) == 0);
+	g_assert (!tracker_memfd_is_sealed (fds[0]));
+
+	close (fds[0]);
+	close (fds[1]);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-common/memfd/seal",
+	                 test_memfd_seal);
+	g_test_add_func ("/libtracker-common/memfd/not-sealed",
+	                 test_memfd_not_sealed);
+
+	return g_test_run ();
+}
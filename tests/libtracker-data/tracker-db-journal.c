@@ -357,6 +357,92 @@ test_read_functions (void)
 	g_free (path);
 }
 
+#define BENCHMARK_TRANSACTIONS 10000
+#define BENCHMARK_STATEMENTS 50
+
+/* Time taken to read and verify a journal with each CRC implementation */
+static void
+test_replay_benchmark (void)
+{
+	static const gchar *impl_names[] = { "table", "slicing-by-8", "hardware" };
+	TrackerCrc32Impl impl, best[2];
+	GError *error = NULL;
+	gchar *path, *object;
+	gint i, j, n_entries;
+	gsize size;
+
+	path = g_build_filename (TOP_BUILDDIR, "tests", "libtracker-db", "tracker-store-benchmark.journal", NULL);
+	g_unlink (path);
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+	tracker_db_journal_init (path, FALSE, &error);
+	g_assert_no_error (error);
+
+	for (i = 0; i < BENCHMARK_TRANSACTIONS; i++) {
+		tracker_db_journal_start_transaction (time (NULL));
+		tracker_db_journal_append_resource (100000 + i, "file:///media/music/Artist/Album/Track.mp3");
+
+		for (j = 0; j < BENCHMARK_STATEMENTS; j++) {
+			object = g_strdup_printf ("Value %d of resource %d", j, i);
+			tracker_db_journal_append_insert_statement (0, 100000 + i, 100 + j, object);
+			g_free (object);
+		}
+
+		tracker_db_journal_commit_db_transaction (&error);
+		g_assert_no_error (error);
+	}
+
+	size = tracker_db_journal_get_size ();
+
+	tracker_db_journal_shutdown (&error);
+	g_assert_no_error (error);
+
+	best[TRACKER_CRC32_IEEE] = tracker_crc32_get_impl (TRACKER_CRC32_IEEE);
+	best[TRACKER_CRC32_CASTAGNOLI] = tracker_crc32_get_impl (TRACKER_CRC32_CASTAGNOLI);
+
+	for (impl = TRACKER_CRC32_IMPL_TABLE; impl <= TRACKER_CRC32_IMPL_HARDWARE; impl++) {
+		gdouble elapsed;
+		gboolean ieee, castagnoli;
+
+		/* the journal may use either */
+		ieee = tracker_crc32_set_impl (TRACKER_CRC32_IEEE, impl);
+		castagnoli = tracker_crc32_set_impl (TRACKER_CRC32_CASTAGNOLI, impl);
+
+		if (!ieee && !castagnoli) {
+			continue;
+		}
+
+		g_test_timer_start ();
+
+		tracker_db_journal_reader_init (path, &error);
+		g_assert_no_error (error);
+
+		n_entries = 0;
+
+		while (tracker_db_journal_reader_next (&error)) {
+			n_entries++;
+		}
+
+		g_assert_no_error (error);
+		tracker_db_journal_reader_shutdown ();
+
+		elapsed = g_test_timer_elapsed ();
+
+		g_assert_cmpint (n_entries, ==, BENCHMARK_TRANSACTIONS * (BENCHMARK_STATEMENTS + 3));
+		g_test_minimized_result (elapsed,
+		                         "Replayed %" G_GSIZE_FORMAT " bytes of journal with %s crc32/crc32c: %s/%s in %f seconds",
+		                         size, impl_names[impl],
+		                         ieee ? "yes" : "no", castagnoli ? "yes" : "no",
+		                         elapsed);
+	}
+
+	tracker_crc32_set_impl (TRACKER_CRC32_IEEE, best[TRACKER_CRC32_IEEE]);
+	tracker_crc32_set_impl (TRACKER_CRC32_CASTAGNOLI, best[TRACKER_CRC32_CASTAGNOLI]);
+
+	g_unlink (path);
+	g_free (path);
+}
+
 #endif /* DISABLE_JOURNAL */
 
 int
@@ -375,6 +461,11 @@ main (int argc, char **argv)
 	                 test_write_functions);
 	g_test_add_func ("/libtracker-db/tracker-db-journal/read-functions",
 	                 test_read_functions);
+
+	if (g_test_perf ()) {
+		g_test_add_func ("/libtracker-db/tracker-db-journal/replay-benchmark",
+		                 test_replay_benchmark);
+	}
 #endif /* DISABLE_JOURNAL */
 
 	result = g_test_run ();
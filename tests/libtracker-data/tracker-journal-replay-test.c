@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-data/tracker-data-manager.h>
+#include <libtracker-data/tracker-data-query.h>
+#include <libtracker-data/tracker-data-update.h>
+#include <libtracker-data/tracker-data.h>
+
+#ifndef DISABLE_JOURNAL
+
+/* 10 statements for each file, 1M statements in all */
+#define BENCHMARK_N_FILES 100000
+#define BENCHMARK_STATEMENTS_PER_FILE 10
+#define BENCHMARK_BATCH_SIZE 100
+
+static const gchar *dump_query =
+	"SELECT ?u ?url ?name ?tag WHERE { "
+	"?u a nfo:FileDataObject ; nie:url ?url ; nfo:fileName ?name . "
+	"OPTIONAL { ?u nao:hasTag ?t . ?t nao:prefLabel ?tag } "
+	"} ORDER BY ?url ?tag";
+
+static void
+delete_db (gboolean del_journal)
+{
+	gchar *meta_db, *db_location;
+
+	db_location = g_build_path (G_DIR_SEPARATOR_S, g_get_current_dir (), "tracker", NULL);
+	meta_db = g_build_path (G_DIR_SEPARATOR_S, db_location, "meta.db", NULL);
+	g_unlink (meta_db);
+	g_free (meta_db);
+
+	if (del_journal) {
+		meta_db = g_build_path (G_DIR_SEPARATOR_S, db_location, "data", "tracker-store.journal", NULL);
+		g_unlink (meta_db);
+		g_free (meta_db);
+	}
+
+	meta_db = g_build_path (G_DIR_SEPARATOR_S, db_location, "data", ".meta.isrunning", NULL);
+	g_unlink (meta_db);
+	g_free (meta_db);
+
+	g_free (db_location);
+}
+
+static gchar *
+query_results (const gchar *query)
+{
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+	GString *results;
+	gint col;
+
+	cursor = tracker_data_query_sparql_cursor (query, &error);
+	g_assert_no_error (error);
+
+	results = g_string_new ("");
+
+	while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+		for (col = 0; col < tracker_db_cursor_get_n_columns (cursor); col++) {
+			if (col > 0) {
+				g_string_append (results, "\t");
+			}
+
+			g_string_append (results, tracker_db_cursor_get_string (cursor, col, NULL));
+		}
+
+		g_string_append (results, "\n");
+	}
+
+	g_assert_no_error (error);
+	g_object_unref (cursor);
+
+	return g_string_free (results, FALSE);
+}
+
+static gint
+count_indexes (void)
+{
+	TrackerDBInterface *iface;
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+	gint count;
+
+	iface = tracker_db_manager_get_db_interface ();
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &error,
+	                                              "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index'");
+	g_assert_no_error (error);
+
+	cursor = tracker_db_statement_start_cursor (stmt, &error);
+	g_assert_no_error (error);
+	g_object_unref (stmt);
+
+	g_assert (tracker_db_cursor_iter_next (cursor, NULL, &error));
+	count = tracker_db_cursor_get_int (cursor, 0);
+	g_object_unref (cursor);
+
+	return count;
+}
+
+static void
+busy_cb (const gchar *status,
+         gdouble      progress,
+         gpointer     user_data)
+{
+	gboolean *creating_indexes = user_data;
+
+	if (g_str_has_suffix (status, "Creating indexes")) {
+		*creating_indexes = TRUE;
+	}
+}
+
+static gboolean
+replay_journal (gboolean bulk)
+{
+	gboolean creating_indexes = FALSE;
+	GError *error = NULL;
+	gboolean first_time;
+
+	delete_db (FALSE);
+
+	tracker_data_update_set_bulk_replay (bulk);
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (0, NULL, &first_time, TRUE, FALSE,
+	                           100, 100, busy_cb, &creating_indexes, "Replaying",
+	                           &error);
+	g_assert_no_error (error);
+	g_assert (first_time);
+
+	tracker_data_update_set_bulk_replay (TRUE);
+
+	return creating_indexes;
+}
+
+static void
+update (const gchar *update)
+{
+	GError *error = NULL;
+
+	tracker_data_update_sparql (update, &error);
+	g_assert_no_error (error);
+}
+
+static void
+test_journal_replay (void)
+{
+	GError *error = NULL;
+	gchar *results, *replayed;
+	gint n_indexes;
+
+	delete_db (TRUE);
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL, NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL,
+	                           &error);
+	g_assert_no_error (error);
+
+	update ("INSERT { <urn:tag:1> a nao:Tag ; nao:prefLabel 'red' . "
+	        "<urn:tag:2> a nao:Tag ; nao:prefLabel 'blue' }");
+	update ("INSERT { <urn:file:1> a nfo:FileDataObject ; nie:url 'file:///a' ; nfo:fileName 'a' ; "
+	        "nao:hasTag <urn:tag:1>, <urn:tag:2> . "
+	        "<urn:file:2> a nfo:FileDataObject ; nie:url 'file:///b' ; nfo:fileName 'b' }");
+	update ("INSERT OR REPLACE { <urn:file:2> nfo:fileName 'c' ; nao:hasTag <urn:tag:1> }");
+	update ("DELETE { <urn:file:1> nao:hasTag <urn:tag:2> }");
+	update ("INSERT { <urn:file:3> a nfo:FileDataObject ; nie:url 'file:///d' ; nfo:fileName 'd' }");
+	update ("DELETE { <urn:file:3> a rdfs:Resource }");
+
+	/* Rejected, must not be replayed */
+	tracker_data_update_sparql ("INSERT { <urn:file:1> nfo:fileName 'e', 'f' }", &error);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	results = query_results (dump_query);
+	n_indexes = count_indexes ();
+
+	tracker_data_manager_shutdown ();
+
+	/* Indexes are created again after bulk replay */
+	g_assert (replay_journal (TRUE));
+
+	replayed = query_results (dump_query);
+	g_assert_cmpstr (replayed, ==, results);
+	g_assert_cmpint (count_indexes (), ==, n_indexes);
+	g_free (replayed);
+
+	tracker_data_manager_shutdown ();
+
+	/* Same as replaying statement by statement */
+	g_assert (!replay_journal (FALSE));
+
+	replayed = query_results (dump_query);
+	g_assert_cmpstr (replayed, ==, results);
+	g_assert_cmpint (count_indexes (), ==, n_indexes);
+	g_free (replayed);
+
+	tracker_data_manager_shutdown ();
+
+	g_free (results);
+}
+
+static void
+test_journal_replay_interrupted (void)
+{
+	TrackerDBInterface *iface;
+	gboolean creating_indexes = FALSE;
+	GError *error = NULL;
+	gboolean first_time;
+	gint n_indexes;
+
+	delete_db (TRUE);
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL, NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL,
+	                           &error);
+	g_assert_no_error (error);
+	g_assert (!tracker_db_manager_get_indexes_pending ());
+
+	update ("INSERT { <urn:file:1> a nfo:FileDataObject ; nie:url 'file:///a' ; nfo:fileName 'a' ; "
+	        "nfo:fileLastModified '2026-01-01T00:00:00Z' }");
+
+	n_indexes = count_indexes ();
+
+	/* Left as by a bulk replay killed before creating indexes */
+	tracker_db_manager_set_indexes_pending (TRUE);
+
+	iface = tracker_db_manager_get_db_interface ();
+	tracker_db_interface_execute_query (iface, &error, "DROP INDEX \"nfo:FileDataObject_nfo:fileLastModified\"");
+	g_assert_no_error (error);
+	g_assert_cmpint (count_indexes (), ==, n_indexes - 1);
+
+	tracker_data_manager_shutdown ();
+
+	/* Created on the next start, without replaying */
+	tracker_data_manager_init (0, NULL, &first_time, FALSE, FALSE,
+	                           100, 100, busy_cb, &creating_indexes, "Starting",
+	                           &error);
+	g_assert_no_error (error);
+	g_assert (!first_time);
+	g_assert (creating_indexes);
+
+	g_assert_cmpint (count_indexes (), ==, n_indexes);
+	g_assert (!tracker_db_manager_get_indexes_pending ());
+
+	tracker_data_manager_shutdown ();
+
+	/* Only once */
+	creating_indexes = FALSE;
+	tracker_data_manager_init (0, NULL, &first_time, FALSE, FALSE,
+	                           100, 100, busy_cb, &creating_indexes, "Starting",
+	                           &error);
+	g_assert_no_error (error);
+	g_assert (!creating_indexes);
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_journal_replay_benchmark (void)
+{
+	GError *error = NULL;
+	GString *update = NULL;
+	gdouble elapsed;
+	gint i;
+
+	delete_db (TRUE);
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL, NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL,
+	                           &error);
+	g_assert_no_error (error);
+
+	for (i = 0; i < BENCHMARK_N_FILES; i++) {
+		if (i % BENCHMARK_BATCH_SIZE == 0) {
+			update = g_string_new ("INSERT {");
+		}
+
+		g_string_append_printf (update,
+		                        " <urn:file:%d> a nfo:FileDataObject, nmm:MusicPiece ;"
+		                        " nie:url 'file:///media/music/Artist %d/Track %06d.mp3' ;"
+		                        " nfo:fileName 'Track %06d.mp3' ; nie:title 'Track %d' ;"
+		                        " nfo:fileSize %d ; nfo:fileLastModified '2026-01-01T00:00:00Z' ;"
+		                        " nie:mimeType 'audio/mpeg' ; nmm:trackNumber %d ;"
+		                        " nie:isStoredAs <urn:file:%d> .",
+		                        i, i % 100, i, i, i, 1000 + i, i % 20, i);
+
+		if (i % BENCHMARK_BATCH_SIZE == BENCHMARK_BATCH_SIZE - 1) {
+			g_string_append (update, " }");
+			tracker_data_update_sparql (update->str, &error);
+			g_assert_no_error (error);
+			g_string_free (update, TRUE);
+		}
+	}
+
+	tracker_data_manager_shutdown ();
+
+	g_test_timer_start ();
+	replay_journal (FALSE);
+	elapsed = g_test_timer_elapsed ();
+	tracker_data_manager_shutdown ();
+
+	g_test_minimized_result (elapsed,
+	                         "Replayed %d statements one transaction at a time in %f seconds",
+	                         BENCHMARK_N_FILES * BENCHMARK_STATEMENTS_PER_FILE, elapsed);
+
+	g_test_timer_start ();
+	replay_journal (TRUE);
+	elapsed = g_test_timer_elapsed ();
+	tracker_data_manager_shutdown ();
+
+	g_test_minimized_result (elapsed,
+	                         "Replayed %d statements in bulk in %f seconds",
+	                         BENCHMARK_N_FILES * BENCHMARK_STATEMENTS_PER_FILE, elapsed);
+}
+
+#endif /* DISABLE_JOURNAL */
+
+int
+main (int argc, char **argv)
+{
+	gint result;
+	gchar *current_dir;
+
+	g_test_init (&argc, &argv, NULL);
+
+	current_dir = g_get_current_dir ();
+
+	g_setenv ("XDG_DATA_HOME", current_dir, TRUE);
+	g_setenv ("XDG_CACHE_HOME", current_dir, TRUE);
+	g_setenv ("TRACKER_DB_ONTOLOGIES_DIR", TOP_SRCDIR "/data/ontologies/", TRUE);
+
+	g_free (current_dir);
+
+#ifndef DISABLE_JOURNAL
+	g_test_add_func ("/libtracker-data/journal-replay/replay", test_journal_replay);
+	g_test_add_func ("/libtracker-data/journal-replay/interrupted", test_journal_replay_interrupted);
+
+	if (g_test_perf ()) {
+		g_test_add_func ("/libtracker-data/journal-replay/benchmark", test_journal_replay_benchmark);
+	}
+#endif /* DISABLE_JOURNAL */
+
+	/* run tests */
+
+	result = g_test_run ();
+
+	/* clean up */
+	g_print ("Removing temporary data\n");
+	g_spawn_command_line_sync ("rm -R tracker/", NULL, NULL, NULL, NULL);
+
+	return result;
+}
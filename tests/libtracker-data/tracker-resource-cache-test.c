@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libtracker-data/tracker-data-manager.h>
+#include <libtracker-data/tracker-data-query.h>
+#include <libtracker-data/tracker-data-update.h>
+#include <libtracker-data/tracker-data.h>
+
+#define BENCHMARK_N_FILES 100000
+#define BENCHMARK_BATCH_SIZE 1000
+
+static gchar *
+file_uri (gint i)
+{
+	return g_strdup_printf ("file:///media/music/Artist %d/Album %d/Track %06d.mp3",
+	                        i % 100, i % 1000, i);
+}
+
+static void
+test_resource_cache_lookup (void)
+{
+	TrackerResourceCache *cache;
+	TrackerResourceCacheStats stats;
+	gint id;
+
+	cache = tracker_resource_cache_new (64 * 1024);
+
+	g_assert (!tracker_resource_cache_lookup (cache, "urn:test:1", &id));
+	tracker_resource_cache_queried (cache, "urn:test:1", 0);
+	g_assert (!tracker_resource_cache_lookup (cache, "urn:test:1", &id));
+
+	tracker_resource_cache_queried (cache, "urn:test:1", 1001);
+	tracker_resource_cache_insert (cache, "urn:test:2", 1002);
+
+	g_assert (tracker_resource_cache_lookup (cache, "urn:test:1", &id));
+	g_assert_cmpint (id, ==, 1001);
+	g_assert (tracker_resource_cache_lookup (cache, "urn:test:2", &id));
+	g_assert_cmpint (id, ==, 1002);
+	g_assert (!tracker_resource_cache_lookup (cache, "urn:test:", &id));
+
+	tracker_resource_cache_get_stats (cache, &stats);
+	g_assert_cmpuint (stats.hits, ==, 2);
+	g_assert_cmpuint (stats.misses, ==, 3);
+	g_assert_cmpuint (stats.n_entries, ==, 2);
+
+	/* Rolled back, IDs are gone */
+	tracker_resource_cache_clear (cache);
+	g_assert (!tracker_resource_cache_lookup (cache, "urn:test:1", &id));
+
+	tracker_resource_cache_free (cache);
+}
+
+static void
+test_resource_cache_size (void)
+{
+	TrackerResourceCache *cache;
+	TrackerResourceCacheStats stats;
+	gint i, id;
+
+	cache = tracker_resource_cache_new (64 * 1024);
+
+	tracker_resource_cache_insert (cache, "file:///media/music", 1);
+
+	for (i = 2; i <= 10000; i++) {
+		gchar *uri = file_uri (i);
+
+		tracker_resource_cache_insert (cache, uri, i);
+		g_free (uri);
+
+		/* The first one is in use, it must stay */
+		g_assert (tracker_resource_cache_lookup (cache, "file:///media/music", &id));
+		g_assert_cmpint (id, ==, 1);
+	}
+
+	tracker_resource_cache_get_stats (cache, &stats);
+	g_assert_cmpuint (stats.size, <=, 64 * 1024);
+	g_assert_cmpuint (stats.evictions, >, 0);
+	g_assert_cmpuint (stats.n_entries + stats.evictions, >=, 10000);
+
+	/* Latest ones are still there */
+	for (i = 9900; i <= 10000; i++) {
+		gchar *uri = file_uri (i);
+
+		g_assert (tracker_resource_cache_lookup (cache, uri, &id));
+		g_assert_cmpint (id, ==, i);
+		g_free (uri);
+	}
+
+	tracker_resource_cache_free (cache);
+}
+
+static void
+test_resource_cache_filter (void)
+{
+	TrackerResourceCache *cache;
+	TrackerResourceCacheStats stats;
+	gint i, id;
+
+	cache = tracker_resource_cache_new (64 * 1024);
+
+	tracker_resource_cache_set_filter (cache, 1000);
+	g_assert (tracker_resource_cache_has_filter (cache));
+
+	for (i = 0; i < 1000; i++) {
+		gchar *uri = file_uri (i);
+
+		tracker_resource_cache_filter_add (cache, uri);
+		g_free (uri);
+	}
+
+	tracker_resource_cache_insert (cache, "urn:test:new", 1001);
+	tracker_resource_cache_clear (cache);
+
+	/* Stored resources are never filtered */
+	for (i = 0; i < 1000; i++) {
+		gchar *uri = file_uri (i);
+
+		g_assert (!tracker_resource_cache_lookup (cache, uri, &id));
+		g_free (uri);
+	}
+
+	g_assert (!tracker_resource_cache_lookup (cache, "urn:test:new", &id));
+
+	/* Most new ones are */
+	for (i = 1000; i < 2000; i++) {
+		gchar *uri = file_uri (i);
+
+		if (!tracker_resource_cache_lookup (cache, uri, &id)) {
+			tracker_resource_cache_queried (cache, uri, 0);
+		} else {
+			g_assert_cmpint (id, ==, 0);
+		}
+
+		g_free (uri);
+	}
+
+	tracker_resource_cache_get_stats (cache, &stats);
+	g_assert_cmpuint (stats.filtered + stats.false_positives, ==, 1000);
+	g_assert_cmpuint (stats.false_positives, <, 50);
+
+	/* Too many new ones, it has to be built again */
+	for (i = 2000; i < 2000 + (gint) stats.filter_size * 8 / 10; i++) {
+		gchar *uri = file_uri (i);
+
+		tracker_resource_cache_insert (cache, uri, i);
+		g_free (uri);
+	}
+
+	g_assert (!tracker_resource_cache_has_filter (cache));
+
+	tracker_resource_cache_free (cache);
+}
+
+static void
+test_resource_cache_rollback (void)
+{
+	GError *error = NULL;
+	gint id;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL, NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL,
+	                           &error);
+	g_assert_no_error (error);
+
+	tracker_data_update_sparql ("INSERT { <urn:test:stored> a nfo:FileDataObject }", &error);
+	g_assert_no_error (error);
+	id = tracker_data_query_resource_id ("urn:test:stored");
+	g_assert_cmpint (id, >, 0);
+
+	/* IDs given in a failed update must not be reused */
+	tracker_data_update_sparql ("INSERT { <urn:test:rolled-back> a nfo:FileDataObject ; nie:title 'a', 'b' }", &error);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+	g_assert_cmpint (tracker_data_query_resource_id ("urn:test:rolled-back"), ==, 0);
+
+	tracker_data_update_sparql ("INSERT { <urn:test:rolled-back> nie:title 'a' . "
+	                            "<urn:test:stored> nie:title 'b' }", &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (tracker_data_query_resource_id ("urn:test:rolled-back"), >, 0);
+	g_assert_cmpint (tracker_data_query_resource_id ("urn:test:stored"), ==, id);
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_resource_cache_startup (void)
+{
+	TrackerResourceCacheStats stats;
+	GError *error = NULL;
+	guint64 filtered;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL, NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL,
+	                           &error);
+	g_assert_no_error (error);
+
+	tracker_data_update_sparql ("INSERT { <urn:test:startup> a nfo:FileDataObject }", &error);
+	g_assert_no_error (error);
+
+	tracker_data_manager_shutdown ();
+
+	tracker_data_manager_init (0, NULL, NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL,
+	                           &error);
+	g_assert_no_error (error);
+
+	/* The filter is ready before the first update */
+	tracker_data_update_get_resource_cache_stats (&stats);
+	g_assert_cmpuint (stats.filter_size, >, 0);
+	filtered = stats.filtered;
+
+	tracker_data_update_sparql ("INSERT { <urn:test:startup-new> a nfo:FileDataObject . "
+	                            "<urn:test:startup> nfo:fileName 'stored' }", &error);
+	g_assert_no_error (error);
+
+	tracker_data_update_get_resource_cache_stats (&stats);
+	g_assert_cmpuint (stats.filtered, >, filtered);
+	g_assert_cmpint (tracker_data_query_resource_id ("urn:test:startup-new"), >, 0);
+
+	tracker_data_manager_shutdown ();
+}
+
+static gdouble
+benchmark_insert (gint first)
+{
+	GError *error = NULL;
+	GString *update = NULL;
+	gint i;
+
+	g_test_timer_start ();
+
+	for (i = first; i < first + BENCHMARK_N_FILES; i++) {
+		gchar *uri;
+
+		if ((i - first) % BENCHMARK_BATCH_SIZE == 0) {
+			update = g_string_new ("INSERT {");
+		}
+
+		uri = file_uri (i);
+		g_string_append_printf (update,
+		                        " <urn:file:%d> a nfo:FileDataObject, nmm:MusicPiece ;"
+		                        " nie:url '%s' ; nfo:fileName 'Track %06d.mp3' ;"
+		                        " nie:isStoredAs <urn:file:%d> .",
+		                        i, uri, i, i);
+		g_free (uri);
+
+		if ((i - first) % BENCHMARK_BATCH_SIZE == BENCHMARK_BATCH_SIZE - 1) {
+			g_string_append (update, " }");
+			tracker_data_update_sparql (update->str, &error);
+			g_assert_no_error (error);
+			g_string_free (update, TRUE);
+		}
+	}
+
+	return g_test_timer_elapsed ();
+}
+
+static void
+test_resource_cache_benchmark (void)
+{
+	TrackerResourceCacheStats stats;
+	GError *error = NULL;
+	gdouble elapsed;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL, NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL,
+	                           &error);
+	g_assert_no_error (error);
+
+	/* Every new file is queried */
+	tracker_data_update_reset_resource_cache (FALSE);
+	elapsed = benchmark_insert (0);
+	tracker_data_update_get_resource_cache_stats (&stats);
+	g_test_message ("Without filter: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses",
+	                stats.hits, stats.misses);
+	g_test_minimized_result (elapsed,
+	                         "Inserted %d new files without filter in %f seconds",
+	                         BENCHMARK_N_FILES, elapsed);
+
+	tracker_data_update_reset_resource_cache (TRUE);
+	elapsed = benchmark_insert (BENCHMARK_N_FILES);
+	tracker_data_update_get_resource_cache_stats (&stats);
+	g_test_message ("With filter: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses, "
+	                "%" G_GUINT64_FORMAT " filtered, %" G_GUINT64_FORMAT " false positives, "
+	                "%" G_GUINT64_FORMAT " evictions, %" G_GSIZE_FORMAT " + %" G_GSIZE_FORMAT " bytes",
+	                stats.hits, stats.misses, stats.filtered, stats.false_positives,
+	                stats.evictions, stats.size, stats.filter_size);
+	g_test_minimized_result (elapsed,
+	                         "Inserted %d new files with filter in %f seconds",
+	                         BENCHMARK_N_FILES, elapsed);
+
+	g_assert_cmpuint (stats.filtered, >=, BENCHMARK_N_FILES * 9 / 10);
+
+	tracker_data_manager_shutdown ();
+}
+
+int
+main (int argc, char **argv)
+{
+	gint result;
+	gchar *current_dir;
+
+	g_test_init (&argc, &argv, NULL);
+
+	current_dir = g_get_current_dir ();
+
+	g_setenv ("XDG_DATA_HOME", current_dir, TRUE);
+	g_setenv ("XDG_CACHE_HOME", current_dir, TRUE);
+	g_setenv ("TRACKER_DB_ONTOLOGIES_DIR", TOP_SRCDIR "/data/ontologies/", TRUE);
+
+	g_free (current_dir);
+
+	g_test_add_func ("/libtracker-data/resource-cache/lookup", test_resource_cache_lookup);
+	g_test_add_func ("/libtracker-data/resource-cache/size", test_resource_cache_size);
+	g_test_add_func ("/libtracker-data/resource-cache/filter", test_resource_cache_filter);
+	g_test_add_func ("/libtracker-data/resource-cache/rollback", test_resource_cache_rollback);
+	g_test_add_func ("/libtracker-data/resource-cache/startup", test_resource_cache_startup);
+
+	if (g_test_perf ()) {
+		g_test_add_func ("/libtracker-data/resource-cache/benchmark", test_resource_cache_benchmark);
+	}
+
+	/* run tests */
+
+	result = g_test_run ();
+
+	/* clean up */
+	g_print ("Removing temporary data\n");
+	g_spawn_command_line_sync ("rm -R tracker/", NULL, NULL, NULL, NULL);
+
+	return result;
+}
@@ -317,6 +317,220 @@ test_sparql_query (gconstpointer test_data)
 	tracker_data_manager_shutdown ();
 }
 
+static gint
+count_rows (TrackerDBCursor *cursor)
+{
+	GError *error = NULL;
+	gint n_rows = 0;
+
+	while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+		n_rows++;
+	}
+
+	g_assert_no_error (error);
+
+	return n_rows;
+}
+
+static void
+test_sparql_statement (void)
+{
+	TrackerSparqlQuery *query;
+	TrackerDBCursor *cursor;
+	GHashTable *parameters;
+	GError *error = NULL;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	tracker_data_update_sparql ("INSERT {"
+	                            "  <urn:album:1> a nmm:MusicAlbum ; nmm:albumTitle 'First' ."
+	                            "  <urn:album:2> a nmm:MusicAlbum ; nmm:albumTitle 'Second' ."
+	                            "  <urn:song:1> a nmm:MusicPiece ; nmm:musicAlbum <urn:album:1> ; nmm:trackNumber 1 ."
+	                            "  <urn:song:2> a nmm:MusicPiece ; nmm:musicAlbum <urn:album:1> ; nmm:trackNumber 2 ."
+	                            "  <urn:song:3> a nmm:MusicPiece ; nmm:musicAlbum <urn:album:2> ; nmm:trackNumber 1 ."
+	                            "}",
+	                            &error);
+	g_assert_no_error (error);
+
+	query = tracker_sparql_query_new ("SELECT ?song WHERE {"
+	                                  "  ?song nmm:musicAlbum ?album ; nmm:trackNumber ?n ."
+	                                  "  ?album nmm:albumTitle ~title"
+	                                  "  FILTER (?n >= ~track)"
+	                                  "}");
+	tracker_sparql_query_prepare (query, &error);
+	g_assert_no_error (error);
+
+	parameters = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                    NULL, (GDestroyNotify) g_variant_unref);
+
+	/* Every parameter needs a value */
+	g_hash_table_insert (parameters, "title", g_variant_ref_sink (g_variant_new_string ("First")));
+	cursor = tracker_sparql_query_execute_prepared (query, parameters, FALSE, &error);
+	g_assert (cursor == NULL);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	g_hash_table_insert (parameters, "track", g_variant_ref_sink (g_variant_new_int64 (1)));
+	cursor = tracker_sparql_query_execute_prepared (query, parameters, FALSE, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (count_rows (cursor), ==, 2);
+	g_object_unref (cursor);
+
+	/* Same translation, other values */
+	g_hash_table_insert (parameters, "track", g_variant_ref_sink (g_variant_new_int64 (2)));
+	cursor = tracker_sparql_query_execute_prepared (query, parameters, FALSE, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (count_rows (cursor), ==, 1);
+	g_object_unref (cursor);
+
+	g_hash_table_insert (parameters, "title", g_variant_ref_sink (g_variant_new_string ("Second")));
+	g_hash_table_insert (parameters, "track", g_variant_ref_sink (g_variant_new_string ("1")));
+	cursor = tracker_sparql_query_execute_prepared (query, parameters, FALSE, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (count_rows (cursor), ==, 1);
+	g_object_unref (cursor);
+
+	g_hash_table_unref (parameters);
+	g_object_unref (query);
+
+	tracker_data_manager_shutdown ();
+}
+
+static gint
+count_query_rows (const gchar *sparql)
+{
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+	gint n_rows;
+
+	cursor = tracker_data_query_sparql_cursor (sparql, &error);
+	g_assert_no_error (error);
+
+	n_rows = count_rows (cursor);
+	g_object_unref (cursor);
+
+	return n_rows;
+}
+
+static void
+test_sparql_translation_cache (void)
+{
+	guint size, hits, misses, uncacheable, evictions;
+	guint base_hits, base_misses, base_uncacheable;
+	GError *error = NULL;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	/* Initializing starts with an empty cache */
+	tracker_sparql_query_get_cache_statistics (&size, &base_hits, &base_misses, &base_uncacheable, &evictions);
+	g_assert_cmpuint (size, ==, 0);
+
+	tracker_data_update_sparql ("INSERT {"
+	                            "  <urn:album:1> a nmm:MusicAlbum ; nmm:albumTitle 'First' ."
+	                            "  <urn:album:2> a nmm:MusicAlbum ; nmm:albumTitle 'Second' ."
+	                            "  <urn:song:1> a nmm:MusicPiece ; nmm:musicAlbum <urn:album:1> ; nmm:trackNumber 1 ."
+	                            "  <urn:song:2> a nmm:MusicPiece ; nmm:musicAlbum <urn:album:1> ; nmm:trackNumber 2 ."
+	                            "  <urn:song:3> a nmm:MusicPiece ; nmm:musicAlbum <urn:album:2> ; nmm:trackNumber 1 ."
+	                            "}",
+	                            &error);
+	g_assert_no_error (error);
+
+	/* Queries only differing in string literals and spacing share
+	 * the translation, and still get their own results.
+	 */
+	g_assert_cmpint (count_query_rows ("SELECT ?song WHERE { ?song nmm:musicAlbum ?album . ?album nmm:albumTitle 'First' }"), ==, 2);
+	g_assert_cmpint (count_query_rows ("SELECT ?song WHERE {\n  ?song nmm:musicAlbum ?album .\n  ?album nmm:albumTitle \"Second\"\n}"), ==, 1);
+	g_assert_cmpint (count_query_rows ("SELECT ?song WHERE { ?song nmm:musicAlbum ?album . ?album nmm:albumTitle 'Third' }"), ==, 0);
+
+	tracker_sparql_query_get_cache_statistics (&size, &hits, &misses, &uncacheable, &evictions);
+	g_assert_cmpuint (size, ==, 1);
+	g_assert_cmpuint (misses - base_misses, ==, 1);
+	g_assert_cmpuint (hits - base_hits, ==, 2);
+
+	/* Literals affecting the translation are part of the key */
+	g_assert_cmpint (count_query_rows ("SELECT ?a WHERE { ?a nmm:albumTitle ?t FILTER (fn:starts-with (?t, 'Fir')) }"), ==, 1);
+	g_assert_cmpint (count_query_rows ("SELECT ?a WHERE { ?a nmm:albumTitle ?t FILTER (fn:starts-with (?t, 'Sec')) }"), ==, 1);
+	g_assert_cmpint (count_query_rows ("SELECT ?a WHERE { ?a nmm:albumTitle ?t FILTER (fn:starts-with (?t, 'Fir')) }"), ==, 1);
+
+	tracker_sparql_query_get_cache_statistics (&size, &hits, &misses, &uncacheable, &evictions);
+	g_assert_cmpuint (size, ==, 3);
+	g_assert_cmpuint (misses - base_misses, ==, 3);
+	g_assert_cmpuint (hits - base_hits, ==, 3);
+
+	/* Queries which aren't cached by the database aren't either */
+	g_assert_cmpint (count_query_rows ("SELECT ?a WHERE { ?a nmm:albumTitle ?t FILTER (regex (?t, '^F')) }"), ==, 1);
+	g_assert_cmpint (count_query_rows ("SELECT ?a WHERE { ?a nmm:albumTitle ?t FILTER (regex (?t, '^F')) }"), ==, 1);
+
+	tracker_sparql_query_get_cache_statistics (&size, &hits, &misses, &uncacheable, &evictions);
+	g_assert_cmpuint (size, ==, 3);
+	g_assert_cmpuint (uncacheable - base_uncacheable, ==, 2);
+
+	tracker_sparql_query_clear_cache ();
+	tracker_sparql_query_get_cache_statistics (&size, &hits, &misses, &uncacheable, &evictions);
+	g_assert_cmpuint (size, ==, 0);
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_sparql_update_prologues (void)
+{
+	GError *error = NULL;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	/* Updates joined the way the store merges update_array
+	 * batches, each one with its own prologue and a trailing
+	 * comment.
+	 */
+	tracker_data_update_sparql ("PREFIX ex: <urn:ex:> "
+	                            "INSERT { ex:album1 a nmm:MusicAlbum ; nmm:albumTitle 'First' } # one\n"
+	                            "BASE <urn:base/> "
+	                            "PREFIX ex: <urn:other:> "
+	                            "INSERT { ex:album2 a nmm:MusicAlbum ; nmm:albumTitle 'Second' } # two\n"
+	                            "INSERT { ex:album3 a nmm:MusicAlbum ; nmm:albumTitle 'Third' }\n",
+	                            &error);
+	g_assert_no_error (error);
+
+	g_assert_cmpint (count_query_rows ("SELECT ?a WHERE { ?a a nmm:MusicAlbum }"), ==, 3);
+	g_assert_cmpint (count_query_rows ("SELECT ?t WHERE { <urn:ex:album1> nmm:albumTitle ?t }"), ==, 1);
+	g_assert_cmpint (count_query_rows ("SELECT ?t WHERE { <urn:other:album2> nmm:albumTitle ?t }"), ==, 1);
+
+	/* Prefixes stay declared for the following operations */
+	g_assert_cmpint (count_query_rows ("SELECT ?t WHERE { <urn:other:album3> nmm:albumTitle ?t }"), ==, 1);
+
+	/* One failing operation rolls back the whole update */
+	tracker_data_update_sparql ("PREFIX ex: <urn:ex:> "
+	                            "INSERT { ex:album4 a nmm:MusicAlbum }\n"
+	                            "PREFIX ex: <urn:ex:> "
+	                            "INSERT { ex:album5 a nmm:MusicAlbum ; nmm:albumTitle 'a', 'b' }\n",
+	                            &error);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	g_assert_cmpint (count_query_rows ("SELECT ?a WHERE { ?a a nmm:MusicAlbum }"), ==, 3);
+
+	tracker_data_manager_shutdown ();
+}
+
 int
 main (int argc, char **argv)
 {
@@ -356,6 +570,10 @@ main (int argc, char **argv)
 		g_free (testpath);
 	}
 
+	g_test_add_func ("/libtracker-data/sparql/statement", test_sparql_statement);
+	g_test_add_func ("/libtracker-data/sparql/translation-cache", test_sparql_translation_cache);
+	g_test_add_func ("/libtracker-data/sparql/update-prologues", test_sparql_update_prologues);
+
 	/* run tests */
 	result = g_test_run ();
 
@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-data/tracker-data-manager.h>
+#include <libtracker-data/tracker-data-query.h>
+#include <libtracker-data/tracker-data-update.h>
+#include <libtracker-data/tracker-data.h>
+
+/* More columns than plans have bits for */
+#define WIDE_N_PROPERTIES 300
+
+static gchar *test_schemas[5] = { NULL, NULL, NULL, NULL, NULL };
+
+static void
+delete_db (void)
+{
+	gchar *meta_db, *db_location;
+
+	db_location = g_build_path (G_DIR_SEPARATOR_S, g_get_current_dir (), "tracker", NULL);
+	meta_db = g_build_path (G_DIR_SEPARATOR_S, db_location, "meta.db", NULL);
+	g_unlink (meta_db);
+	g_free (meta_db);
+
+	meta_db = g_build_path (G_DIR_SEPARATOR_S, db_location, "data", "tracker-store.journal", NULL);
+	g_unlink (meta_db);
+	g_free (meta_db);
+
+	meta_db = g_build_path (G_DIR_SEPARATOR_S, db_location, "data", ".meta.isrunning", NULL);
+	g_unlink (meta_db);
+	g_free (meta_db);
+
+	g_free (db_location);
+}
+
+/* Writes an ontology with a class of @n_properties single valued
+ * properties, example:p0 and on. A new @version is seen as an
+ * ontology change.
+ */
+static void
+init_ontology (gint n_properties,
+               gint version)
+{
+	GError *error = NULL;
+	GString *ontology;
+	gchar *path;
+	gint i;
+
+	ontology = g_string_new ("@prefix example: <http://example/> .\n"
+	                         "@prefix rdf: <http://www.w3.org/1999/02/22-rdf-syntax-ns#> .\n"
+	                         "@prefix rdfs: <http://www.w3.org/2000/01/rdf-schema#> .\n"
+	                         "@prefix tracker: <http://www.tracker-project.org/ontologies/tracker#> .\n"
+	                         "@prefix xsd: <http://www.w3.org/2001/XMLSchema#> .\n"
+	                         "@prefix nao: <http://www.semanticdesktop.org/ontologies/2007/08/15/nao#> .\n"
+	                         "@prefix nrl: <http://www.semanticdesktop.org/ontologies/2007/08/15/nrl#> .\n\n");
+
+	g_string_append_printf (ontology,
+	                        "example: a tracker:Namespace, tracker:Ontology ;\n"
+	                        "\tnao:lastModified \"2010-03-23T11:00:%02dZ\" ;\n"
+	                        "\ttracker:prefix \"example\" .\n\n"
+	                        "example:A a rdfs:Class ;\n"
+	                        "\trdfs:subClassOf rdfs:Resource .\n\n",
+	                        version);
+
+	for (i = 0; i < n_properties; i++) {
+		g_string_append_printf (ontology,
+		                        "example:p%d a rdf:Property ;\n"
+		                        "\trdfs:domain example:A ;\n"
+		                        "\trdfs:range xsd:string ;\n"
+		                        "\tnrl:maxCardinality 1 .\n\n",
+		                        i);
+	}
+
+	path = g_strconcat (test_schemas[3], ".ontology", NULL);
+	g_file_set_contents (path, ontology->str, -1, &error);
+	g_assert_no_error (error);
+	g_string_free (ontology, TRUE);
+	g_free (path);
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (0, (const gchar **) test_schemas,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+}
+
+static void
+update (const gchar *update)
+{
+	GError *error = NULL;
+
+	tracker_data_update_sparql (update, &error);
+	g_assert_no_error (error);
+}
+
+static void
+assert_value (const gchar *subject,
+              gint         property,
+              const gchar *value)
+{
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+	gchar *query;
+
+	query = g_strdup_printf ("SELECT ?v WHERE { <%s> example:p%d ?v }", subject, property);
+	cursor = tracker_data_query_sparql_cursor (query, &error);
+	g_assert_no_error (error);
+	g_free (query);
+
+	g_assert (tracker_db_cursor_iter_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpstr (tracker_db_cursor_get_string (cursor, 0, NULL), ==, value);
+	g_assert (!tracker_db_cursor_iter_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+
+	g_object_unref (cursor);
+}
+
+static void
+test_update_plans_column_order (void)
+{
+	guint size, hits, misses, uncacheable;
+	guint base_size, base_hits, base_misses, base_uncacheable;
+
+	delete_db ();
+	init_ontology (3, 1);
+
+	update ("INSERT { <urn:a:1> a example:A ; example:p0 'a0' ; example:p1 'a1' ; example:p2 'a2' }");
+
+	tracker_data_update_get_plan_statistics (&base_size, &base_hits, &base_misses, &base_uncacheable);
+	g_assert_cmpuint (base_size, >, 0);
+
+	/* Same columns, another plan isn't needed whatever their order,
+	 * and the values are bound to the right ones.
+	 */
+	update ("INSERT { <urn:a:2> a example:A ; example:p2 'b2' ; example:p0 'b0' ; example:p1 'b1' }");
+	update ("INSERT { <urn:a:3> a example:A ; example:p1 'c1' ; example:p2 'c2' ; example:p0 'c0' }");
+
+	tracker_data_update_get_plan_statistics (&size, &hits, &misses, &uncacheable);
+	g_assert_cmpuint (size, ==, base_size);
+	g_assert_cmpuint (misses, ==, base_misses);
+	g_assert_cmpuint (uncacheable, ==, base_uncacheable);
+	g_assert_cmpuint (hits, >, base_hits);
+
+	assert_value ("urn:a:1", 0, "a0");
+	assert_value ("urn:a:1", 2, "a2");
+	assert_value ("urn:a:2", 0, "b0");
+	assert_value ("urn:a:2", 1, "b1");
+	assert_value ("urn:a:2", 2, "b2");
+	assert_value ("urn:a:3", 0, "c0");
+	assert_value ("urn:a:3", 1, "c1");
+	assert_value ("urn:a:3", 2, "c2");
+
+	/* Other columns get their own plan */
+	update ("INSERT OR REPLACE { <urn:a:1> example:p1 'd1' }");
+
+	tracker_data_update_get_plan_statistics (&size, &hits, &misses, &uncacheable);
+	g_assert_cmpuint (size, >, base_size);
+	g_assert_cmpuint (misses, >, base_misses);
+
+	assert_value ("urn:a:1", 0, "a0");
+	assert_value ("urn:a:1", 1, "d1");
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_update_plans_wide_table (void)
+{
+	guint size, hits, misses, uncacheable;
+	guint base_size, base_hits, base_misses, base_uncacheable;
+	GString *sparql;
+	gint i;
+
+	delete_db ();
+	init_ontology (WIDE_N_PROPERTIES, 1);
+
+	tracker_data_update_get_plan_statistics (&base_size, &base_hits, &base_misses, &base_uncacheable);
+
+	/* Too many columns for a plan, the statement cache is used */
+	sparql = g_string_new ("INSERT { <urn:wide:1> a example:A");
+
+	for (i = 0; i < WIDE_N_PROPERTIES; i++) {
+		g_string_append_printf (sparql, " ; example:p%d 'w%d'", i, i);
+	}
+
+	g_string_append (sparql, " }");
+	update (sparql->str);
+	g_string_free (sparql, TRUE);
+
+	tracker_data_update_get_plan_statistics (&size, &hits, &misses, &uncacheable);
+	g_assert_cmpuint (uncacheable - base_uncacheable, ==, 1);
+
+	assert_value ("urn:wide:1", 0, "w0");
+	assert_value ("urn:wide:1", 255, "w255");
+	assert_value ("urn:wide:1", 256, "w256");
+	assert_value ("urn:wide:1", WIDE_N_PROPERTIES - 1, "w299");
+
+	/* Rows of the same table within the limit still get plans */
+	update ("INSERT { <urn:wide:2> a example:A ; example:p1 'v1' ; example:p0 'v0' }");
+	update ("INSERT { <urn:wide:3> a example:A ; example:p0 'x0' ; example:p1 'x1' }");
+
+	base_uncacheable = uncacheable;
+	base_misses = misses;
+	tracker_data_update_get_plan_statistics (&size, &hits, &misses, &uncacheable);
+	g_assert_cmpuint (uncacheable, ==, base_uncacheable);
+	g_assert_cmpuint (misses - base_misses, ==, 1);
+
+	assert_value ("urn:wide:2", 0, "v0");
+	assert_value ("urn:wide:2", 1, "v1");
+	assert_value ("urn:wide:3", 0, "x0");
+	assert_value ("urn:wide:3", 1, "x1");
+
+	/* Columns past the limit never do */
+	update ("INSERT OR REPLACE { <urn:wide:2> example:p299 'v299' }");
+
+	tracker_data_update_get_plan_statistics (&size, &hits, &misses, &uncacheable);
+	g_assert_cmpuint (uncacheable - base_uncacheable, ==, 1);
+
+	assert_value ("urn:wide:2", 0, "v0");
+	assert_value ("urn:wide:2", WIDE_N_PROPERTIES - 1, "v299");
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_update_plans_duplicate_property (void)
+{
+	guint size, hits, misses, uncacheable;
+	guint base_size, base_hits, base_misses, base_uncacheable;
+
+	delete_db ();
+	init_ontology (2, 1);
+
+	update ("INSERT { <urn:a:1> a example:A ; example:p0 'a0' ; example:p1 'a1' }");
+
+	tracker_data_update_get_plan_statistics (&base_size, &base_hits, &base_misses, &base_uncacheable);
+
+	/* Replaced twice in the same row, the last value is kept */
+	update ("INSERT OR REPLACE { <urn:a:1> example:p0 'b0' ; example:p0 'c0' }");
+
+	tracker_data_update_get_plan_statistics (&size, &hits, &misses, &uncacheable);
+	g_assert_cmpuint (uncacheable - base_uncacheable, ==, 1);
+
+	assert_value ("urn:a:1", 0, "c0");
+	assert_value ("urn:a:1", 1, "a1");
+
+	/* The plan for writing the property once isn't affected */
+	update ("INSERT OR REPLACE { <urn:a:1> example:p0 'd0' }");
+	update ("INSERT OR REPLACE { <urn:a:1> example:p0 'e0' }");
+
+	base_uncacheable = uncacheable;
+	tracker_data_update_get_plan_statistics (&size, &hits, &misses, &uncacheable);
+	g_assert_cmpuint (uncacheable, ==, base_uncacheable);
+
+	assert_value ("urn:a:1", 0, "e0");
+	assert_value ("urn:a:1", 1, "a1");
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_update_plans_ontology_change (void)
+{
+	guint size, hits, misses, uncacheable;
+	guint base_misses;
+
+	delete_db ();
+	init_ontology (2, 1);
+
+	update ("INSERT { <urn:a:1> a example:A ; example:p0 'a0' ; example:p1 'a1' }");
+
+	tracker_data_update_get_plan_statistics (&size, &hits, &base_misses, &uncacheable);
+	g_assert_cmpuint (size, >, 0);
+
+	tracker_data_manager_shutdown ();
+
+	/* A property is added to the table, plans start over */
+	init_ontology (3, 2);
+
+	tracker_data_update_get_plan_statistics (&size, &hits, &misses, &uncacheable);
+	g_assert_cmpuint (size, ==, 0);
+
+	base_misses = misses;
+	update ("INSERT { <urn:a:2> a example:A ; example:p2 'b2' ; example:p0 'b0' ; example:p1 'b1' }");
+	update ("INSERT { <urn:a:3> a example:A ; example:p0 'c0' ; example:p1 'c1' }");
+
+	tracker_data_update_get_plan_statistics (&size, &hits, &misses, &uncacheable);
+	g_assert_cmpuint (size, >, 0);
+	g_assert_cmpuint (misses, >, base_misses);
+
+	assert_value ("urn:a:1", 0, "a0");
+	assert_value ("urn:a:1", 1, "a1");
+	assert_value ("urn:a:2", 0, "b0");
+	assert_value ("urn:a:2", 1, "b1");
+	assert_value ("urn:a:2", 2, "b2");
+	assert_value ("urn:a:3", 0, "c0");
+	assert_value ("urn:a:3", 1, "c1");
+
+	tracker_data_manager_shutdown ();
+}
+
+int
+main (int argc, char **argv)
+{
+	gint result;
+	gchar *current_dir, *prefix, *ontology_dir, *ontology_file;
+
+	g_test_init (&argc, &argv, NULL);
+
+	current_dir = g_get_current_dir ();
+
+	g_setenv ("XDG_DATA_HOME", current_dir, TRUE);
+	g_setenv ("XDG_CACHE_HOME", current_dir, TRUE);
+	g_setenv ("TRACKER_DB_ONTOLOGIES_DIR", TOP_SRCDIR "/data/ontologies/", TRUE);
+
+	prefix = g_build_path (G_DIR_SEPARATOR_S, TOP_SRCDIR, "tests", "libtracker-data", NULL);
+	ontology_dir = g_build_path (G_DIR_SEPARATOR_S, current_dir, "test-plans-ontologies", NULL);
+	g_mkdir_with_parents (ontology_dir, 0777);
+
+	test_schemas[0] = g_build_path (G_DIR_SEPARATOR_S, prefix, "ontologies", "20-dc", NULL);
+	test_schemas[1] = g_build_path (G_DIR_SEPARATOR_S, prefix, "ontologies", "31-nao", NULL);
+	test_schemas[2] = g_build_path (G_DIR_SEPARATOR_S, prefix, "ontologies", "90-tracker", NULL);
+	test_schemas[3] = g_build_path (G_DIR_SEPARATOR_S, ontology_dir, "99-example", NULL);
+
+	g_free (current_dir);
+
+	g_test_add_func ("/libtracker-data/update-plans/column-order", test_update_plans_column_order);
+	g_test_add_func ("/libtracker-data/update-plans/wide-table", test_update_plans_wide_table);
+	g_test_add_func ("/libtracker-data/update-plans/duplicate-property", test_update_plans_duplicate_property);
+	g_test_add_func ("/libtracker-data/update-plans/ontology-change", test_update_plans_ontology_change);
+
+	/* run tests */
+
+	result = g_test_run ();
+
+	/* clean up */
+	g_print ("Removing temporary data\n");
+	g_spawn_command_line_sync ("rm -R tracker/", NULL, NULL, NULL, NULL);
+
+	ontology_file = g_strconcat (test_schemas[3], ".ontology", NULL);
+	g_unlink (ontology_file);
+	g_rmdir (ontology_dir);
+	g_free (ontology_file);
+
+	g_free (test_schemas[0]);
+	g_free (test_schemas[1]);
+	g_free (test_schemas[2]);
+	g_free (test_schemas[3]);
+	g_free (ontology_dir);
+	g_free (prefix);
+
+	return result;
+}
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-common/tracker-ontologies.h>
+#include <libtracker-data/tracker-data-manager.h>
+#include <libtracker-data/tracker-data-query.h>
+#include <libtracker-data/tracker-data-update.h>
+#include <libtracker-data/tracker-data.h>
+
+#define VOLUME_UUID "0a1b2c3d-DEAD-beef"
+
+static void
+init_db (gboolean first_time)
+{
+	GError *error = NULL;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init ((first_time ? TRACKER_DB_MANAGER_FORCE_REINDEX : 0) |
+	                           TRACKER_DB_MANAGER_VOLUME_DATABASES,
+	                           NULL, NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL,
+	                           &error);
+	g_assert_no_error (error);
+}
+
+static void
+update (const gchar *update)
+{
+	GError *error = NULL;
+
+	tracker_data_update_sparql (update, &error);
+	g_assert_no_error (error);
+}
+
+static gchar *
+query_results (const gchar *query)
+{
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+	GString *results;
+	gint col;
+
+	cursor = tracker_data_query_sparql_cursor (query, &error);
+	g_assert_no_error (error);
+
+	results = g_string_new ("");
+
+	while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+		for (col = 0; col < tracker_db_cursor_get_n_columns (cursor); col++) {
+			if (col > 0) {
+				g_string_append (results, "\t");
+			}
+
+			g_string_append (results, tracker_db_cursor_get_string (cursor, col, NULL));
+		}
+
+		g_string_append (results, "\n");
+	}
+
+	g_assert_no_error (error);
+	g_object_unref (cursor);
+
+	return g_string_free (results, FALSE);
+}
+
+static void
+assert_query (const gchar *query,
+              const gchar *expected)
+{
+	gchar *results;
+
+	results = query_results (query);
+	g_assert_cmpstr (results, ==, expected);
+	g_free (results);
+}
+
+static void
+test_volumes_attach_forget (void)
+{
+	const gchar *files_query =
+		"SELECT ?name WHERE { ?u a nfo:FileDataObject ; nfo:fileName ?name } ORDER BY ?name";
+	GError *error = NULL;
+	const gchar *schema;
+
+	init_db (TRUE);
+
+	g_assert (tracker_db_manager_attach_volume (VOLUME_UUID, &error));
+	g_assert_no_error (error);
+
+	/* Attaching twice is harmless */
+	g_assert (tracker_db_manager_attach_volume (VOLUME_UUID, &error));
+	g_assert_no_error (error);
+
+	schema = tracker_db_manager_get_volume_schema (TRACKER_DATASOURCE_URN_PREFIX VOLUME_UUID);
+	g_assert (schema != NULL);
+	g_assert (tracker_db_manager_get_volume_schema (TRACKER_DATASOURCE_URN_PREFIX "0a1b2c3d-dead-beef") == NULL);
+
+	update ("INSERT { <" TRACKER_DATASOURCE_URN_PREFIX VOLUME_UUID "> a tracker:Volume . "
+	        "<file:///media/a> a nfo:FileDataObject ; nfo:fileName 'a' ; "
+	        "nie:dataSource <" TRACKER_DATASOURCE_URN_PREFIX VOLUME_UUID "> . "
+	        "<file:///home/b> a nfo:FileDataObject ; nfo:fileName 'b' }");
+
+	/* Properties added later go to the same database */
+	update ("INSERT { <file:///media/a> nie:url 'file:///media/a' }");
+
+	assert_query (files_query, "a\nb\n");
+	assert_query ("SELECT ?url WHERE { <file:///media/a> nie:url ?url }",
+	              "file:///media/a\n");
+
+	/* Volume databases are attached again on startup */
+	tracker_data_manager_shutdown ();
+	init_db (FALSE);
+
+	assert_query (files_query, "a\nb\n");
+
+	g_assert (tracker_data_forget_volume (VOLUME_UUID, &error));
+	g_assert_no_error (error);
+
+	assert_query (files_query, "b\n");
+	g_assert (tracker_db_manager_get_volume_schema (TRACKER_DATASOURCE_URN_PREFIX VOLUME_UUID) == NULL);
+
+	/* Nothing left to forget */
+	g_assert (!tracker_data_forget_volume (VOLUME_UUID, &error));
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	/* Resources are stored in the main database without it */
+	update ("INSERT { <file:///media/c> a nfo:FileDataObject ; nfo:fileName 'c' ; "
+	        "nie:dataSource <" TRACKER_DATASOURCE_URN_PREFIX VOLUME_UUID "> }");
+	assert_query (files_query, "b\nc\n");
+
+	tracker_data_manager_shutdown ();
+}
+
+#ifndef DISABLE_JOURNAL
+
+static void
+replay_journal (void)
+{
+	GError *error = NULL;
+	gchar *db_location, *path;
+	gboolean first_time;
+
+	db_location = g_build_path (G_DIR_SEPARATOR_S, g_get_current_dir (), "tracker", NULL);
+
+	path = g_build_path (G_DIR_SEPARATOR_S, db_location, "meta.db", NULL);
+	g_unlink (path);
+	g_free (path);
+
+	path = g_build_path (G_DIR_SEPARATOR_S, db_location, "data", ".meta.isrunning", NULL);
+	g_unlink (path);
+	g_free (path);
+
+	g_free (db_location);
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_VOLUME_DATABASES,
+	                           NULL, &first_time, TRUE, FALSE,
+	                           100, 100, NULL, NULL, NULL,
+	                           &error);
+	g_assert_no_error (error);
+	g_assert (first_time);
+}
+
+static void
+test_volumes_forget_replay (void)
+{
+	const gchar *files_query =
+		"SELECT ?name WHERE { ?u a nfo:FileDataObject ; nfo:fileName ?name } ORDER BY ?name";
+	GError *error = NULL;
+
+	init_db (TRUE);
+
+	g_assert (tracker_db_manager_attach_volume (VOLUME_UUID, &error));
+	g_assert_no_error (error);
+
+	update ("INSERT { <" TRACKER_DATASOURCE_URN_PREFIX VOLUME_UUID "> a tracker:Volume . "
+	        "<file:///media/a> a nfo:FileDataObject ; nfo:fileName 'a' ; "
+	        "nie:dataSource <" TRACKER_DATASOURCE_URN_PREFIX VOLUME_UUID "> . "
+	        "<file:///home/b> a nfo:FileDataObject ; nfo:fileName 'b' }");
+
+	g_assert_cmpint (tracker_data_query_resource_id ("file:///media/a"), !=, 0);
+
+	g_assert (tracker_data_forget_volume (VOLUME_UUID, &error));
+	g_assert_no_error (error);
+
+	/* No ID is left behind for the resources of the volume */
+	g_assert_cmpint (tracker_data_query_resource_id ("file:///media/a"), ==, 0);
+	g_assert_cmpint (tracker_data_query_resource_id ("file:///home/b"), !=, 0);
+
+	/* Indexed again after the forget */
+	update ("INSERT { <file:///media/c> a nfo:FileDataObject ; nfo:fileName 'c' ; "
+	        "nie:dataSource <" TRACKER_DATASOURCE_URN_PREFIX VOLUME_UUID "> }");
+	assert_query (files_query, "b\nc\n");
+
+	tracker_data_manager_shutdown ();
+
+	/* The forget is replayed where it happened */
+	replay_journal ();
+
+	assert_query (files_query, "b\nc\n");
+	g_assert_cmpint (tracker_data_query_resource_id ("file:///media/a"), ==, 0);
+
+	tracker_data_manager_shutdown ();
+}
+
+#endif /* DISABLE_JOURNAL */
+
+static void
+test_volumes_invalid_uuid (void)
+{
+	const gchar *invalid[] = {
+		"",
+		"../meta",
+		"a/b",
+		"a'b",
+		"a\"b",
+		"a b",
+		"a;DETACH main",
+		"volume.db",
+		NULL
+	};
+	GError *error = NULL;
+	gchar *too_long;
+	gint i;
+
+	init_db (TRUE);
+
+	for (i = 0; invalid[i]; i++) {
+		g_assert (!tracker_db_manager_volume_uuid_is_valid (invalid[i]));
+
+		g_assert (!tracker_db_manager_attach_volume (invalid[i], &error));
+		g_assert (error != NULL);
+		g_clear_error (&error);
+
+		g_assert (!tracker_data_forget_volume (invalid[i], &error));
+		g_assert (error != NULL);
+		g_clear_error (&error);
+	}
+
+	too_long = g_strnfill (1024, 'a');
+	g_assert (!tracker_db_manager_volume_uuid_is_valid (too_long));
+	g_free (too_long);
+
+	g_assert (tracker_db_manager_volume_uuid_is_valid (VOLUME_UUID));
+	g_assert (tracker_db_manager_get_volume_schemas () == NULL);
+
+	tracker_data_manager_shutdown ();
+}
+
+int
+main (int argc, char **argv)
+{
+	gint result;
+	gchar *current_dir;
+
+	g_test_init (&argc, &argv, NULL);
+
+	current_dir = g_get_current_dir ();
+
+	g_setenv ("XDG_DATA_HOME", current_dir, TRUE);
+	g_setenv ("XDG_CACHE_HOME", current_dir, TRUE);
+	g_setenv ("TRACKER_DB_ONTOLOGIES_DIR", TOP_SRCDIR "/data/ontologies/", TRUE);
+
+	g_free (current_dir);
+
+	g_test_add_func ("/libtracker-data/volumes/attach-forget", test_volumes_attach_forget);
+#ifndef DISABLE_JOURNAL
+	g_test_add_func ("/libtracker-data/volumes/forget-replay", test_volumes_forget_replay);
+#endif /* DISABLE_JOURNAL */
+	g_test_add_func ("/libtracker-data/volumes/invalid-uuid", test_volumes_invalid_uuid);
+
+	/* run tests */
+
+	result = g_test_run ();
+
+	/* clean up */
+	g_print ("Removing temporary data\n");
+	g_spawn_command_line_sync ("rm -R tracker/", NULL, NULL, NULL, NULL);
+
+	return result;
+}
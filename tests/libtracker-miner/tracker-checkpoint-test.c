@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ */
+#include <string.h>
+#include <utime.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <libtracker-miner/tracker-checkpoint.h>
+
+typedef struct {
+	gchar *root_path;
+	gchar *dir_path;
+	gchar *checkpoint_path;
+	GFile *root;
+} CheckpointFixture;
+
+static void
+fixture_setup (CheckpointFixture *fixture,
+               gconstpointer      data)
+{
+	gchar *dir;
+
+	dir = g_dir_make_tmp ("tracker-checkpoint-test-XXXXXX", NULL);
+	g_assert (dir != NULL);
+
+	fixture->root_path = g_build_filename (dir, "root", NULL);
+	fixture->checkpoint_path = g_build_filename (dir, "cache", "test.checkpoint", NULL);
+	fixture->dir_path = g_build_filename (fixture->root_path, "dir", NULL);
+	g_mkdir (fixture->root_path, 0700);
+	g_mkdir (fixture->dir_path, 0700);
+	fixture->root = g_file_new_for_path (fixture->root_path);
+
+	g_free (dir);
+}
+
+static void
+fixture_teardown (CheckpointFixture *fixture,
+                  gconstpointer      data)
+{
+	gchar *dir;
+
+	g_unlink (fixture->checkpoint_path);
+	dir = g_path_get_dirname (fixture->checkpoint_path);
+	g_rmdir (dir);
+	g_free (dir);
+
+	g_rmdir (fixture->dir_path);
+	g_rmdir (fixture->root_path);
+	dir = g_path_get_dirname (fixture->root_path);
+	g_rmdir (dir);
+	g_free (dir);
+
+	g_object_unref (fixture->root);
+	g_free (fixture->root_path);
+	g_free (fixture->dir_path);
+	g_free (fixture->checkpoint_path);
+}
+
+static void
+collect_foreach (TrackerCheckpointEvent  event,
+                 GFile                  *file,
+                 GFile                  *source_file,
+                 gpointer                user_data)
+{
+	GString *str = user_data;
+	gchar *basename;
+
+	basename = g_file_get_basename (file);
+	g_string_append_printf (str, "%d:%s", event, basename);
+	g_free (basename);
+
+	if (source_file) {
+		basename = g_file_get_basename (source_file);
+		g_string_append_printf (str, "<%s", basename);
+		g_free (basename);
+	}
+
+	g_string_append_c (str, ' ');
+}
+
+static GFile *
+child (CheckpointFixture *fixture,
+       const gchar       *name)
+{
+	return g_file_get_child (fixture->root, name);
+}
+
+static void
+write_checkpoint (CheckpointFixture *fixture,
+                  gboolean           finished)
+{
+	TrackerCheckpoint *checkpoint;
+	GFile *dir, *a, *b, *c, *d, *e;
+	GStatBuf st;
+
+	dir = child (fixture, "dir");
+	a = child (fixture, "a");
+	b = child (fixture, "b");
+	c = child (fixture, "c");
+	d = child (fixture, "d");
+	e = child (fixture, "e");
+
+	g_assert_cmpint (g_stat (fixture->dir_path, &st), ==, 0);
+
+	checkpoint = tracker_checkpoint_new (fixture->checkpoint_path);
+
+	tracker_checkpoint_root_started (checkpoint, fixture->root);
+	tracker_checkpoint_add_directory (checkpoint, dir, st.st_mtime);
+	tracker_checkpoint_add_item (checkpoint, TRACKER_CHECKPOINT_CREATED, a, NULL);
+	tracker_checkpoint_add_item (checkpoint, TRACKER_CHECKPOINT_UPDATED, b, NULL);
+	tracker_checkpoint_add_item (checkpoint, TRACKER_CHECKPOINT_DELETED, c, NULL);
+	tracker_checkpoint_add_item (checkpoint, TRACKER_CHECKPOINT_UPDATED, a, NULL);
+	tracker_checkpoint_add_item (checkpoint, TRACKER_CHECKPOINT_MOVED, d, e);
+	tracker_checkpoint_item_done (checkpoint, b);
+
+	if (finished) {
+		tracker_checkpoint_root_finished (checkpoint, fixture->root);
+	}
+
+	tracker_checkpoint_free (checkpoint);
+
+	g_object_unref (dir);
+	g_object_unref (a);
+	g_object_unref (b);
+	g_object_unref (c);
+	g_object_unref (d);
+	g_object_unref (e);
+}
+
+static gboolean
+resume (CheckpointFixture  *fixture,
+        gchar             **events)
+{
+	TrackerCheckpoint *checkpoint;
+	GString *str;
+	gboolean resumed;
+
+	str = g_string_new (NULL);
+	checkpoint = tracker_checkpoint_new (fixture->checkpoint_path);
+	resumed = tracker_checkpoint_resume (checkpoint, fixture->root,
+	                                     collect_foreach, str);
+	tracker_checkpoint_free (checkpoint);
+
+	*events = g_string_free (str, FALSE);
+
+	return resumed;
+}
+
+static void
+test_checkpoint_resume (CheckpointFixture *fixture,
+                        gconstpointer      data)
+{
+	TrackerCheckpoint *checkpoint;
+	GString *str;
+
+	write_checkpoint (fixture, TRUE);
+
+	str = g_string_new (NULL);
+	checkpoint = tracker_checkpoint_new (fixture->checkpoint_path);
+
+	g_assert (tracker_checkpoint_resume (checkpoint, fixture->root,
+	                                     collect_foreach, str));
+	g_assert_cmpstr (str->str, ==, "0:dir 1:a 3:c 4:d<e ");
+
+	/* State is consumed once resumed */
+	g_string_truncate (str, 0);
+	g_assert (!tracker_checkpoint_resume (checkpoint, fixture->root,
+	                                      collect_foreach, str));
+	g_assert_cmpstr (str->str, ==, "");
+
+	tracker_checkpoint_free (checkpoint);
+	g_string_free (str, TRUE);
+}
+
+static void
+test_checkpoint_resume_survives_restart (CheckpointFixture *fixture,
+                                         gconstpointer      data)
+{
+	TrackerCheckpoint *checkpoint;
+	gchar *events;
+
+	write_checkpoint (fixture, TRUE);
+
+	/* A run that didn't get to resume the root
+	 * must leave its state in place.
+	 */
+	checkpoint = tracker_checkpoint_new (fixture->checkpoint_path);
+	tracker_checkpoint_free (checkpoint);
+
+	g_assert (resume (fixture, &events));
+	g_assert_cmpstr (events, ==, "0:dir 1:a 3:c 4:d<e ");
+	g_free (events);
+}
+
+static void
+test_checkpoint_unfinished (CheckpointFixture *fixture,
+                            gconstpointer      data)
+{
+	gchar *events;
+
+	write_checkpoint (fixture, FALSE);
+
+	g_assert (!resume (fixture, &events));
+	g_assert_cmpstr (events, ==, "");
+	g_free (events);
+}
+
+static void
+test_checkpoint_stale_mtime (CheckpointFixture *fixture,
+                             gconstpointer      data)
+{
+	struct utimbuf buf = { 1000, 1000 };
+	gchar *events;
+
+	write_checkpoint (fixture, TRUE);
+	g_utime (fixture->root_path, &buf);
+
+	g_assert (!resume (fixture, &events));
+	g_assert_cmpstr (events, ==, "");
+	g_free (events);
+}
+
+static void
+test_checkpoint_directory_changed (CheckpointFixture *fixture,
+                                   gconstpointer      data)
+{
+	struct utimbuf buf = { 1000, 1000 };
+	gchar *events;
+
+	write_checkpoint (fixture, TRUE);
+
+	/* Contents changed after it was crawled, it
+	 * must be checked against the store again.
+	 */
+	g_utime (fixture->dir_path, &buf);
+
+	g_assert (resume (fixture, &events));
+	g_assert_cmpstr (events, ==, "5:dir 1:a 3:c 4:d<e ");
+	g_free (events);
+}
+
+static void
+test_checkpoint_modified_in_place (CheckpointFixture *fixture,
+                                   gconstpointer      data)
+{
+	struct utimbuf buf = { 1000, 1000 };
+	struct utimbuf dir_buf;
+	gchar *edited, *untouched, *events;
+	GStatBuf st;
+
+	edited = g_build_filename (fixture->dir_path, "edited", NULL);
+	untouched = g_build_filename (fixture->dir_path, "untouched", NULL);
+	g_assert (g_file_set_contents (edited, "old", -1, NULL));
+	g_assert (g_file_set_contents (untouched, "old", -1, NULL));
+	g_utime (edited, &buf);
+	g_utime (untouched, &buf);
+
+	write_checkpoint (fixture, TRUE);
+
+	/* Written in place, the directory mtime stays */
+	g_assert_cmpint (g_stat (fixture->dir_path, &st), ==, 0);
+	dir_buf.actime = st.st_atime;
+	dir_buf.modtime = st.st_mtime;
+	g_assert (g_file_set_contents (edited, "new", -1, NULL));
+	g_utime (edited, NULL);
+	g_utime (fixture->dir_path, &dir_buf);
+
+	g_assert (resume (fixture, &events));
+	g_assert_cmpstr (events, ==, "0:dir 2:edited 1:a 3:c 4:d<e ");
+	g_free (events);
+
+	g_unlink (edited);
+	g_unlink (untouched);
+	g_free (edited);
+	g_free (untouched);
+}
+
+static void
+test_checkpoint_compact (CheckpointFixture *fixture,
+                         gconstpointer      data)
+{
+	TrackerCheckpoint *checkpoint;
+	GFile *a, *b;
+	gchar *events;
+	GStatBuf st;
+	guint i;
+
+	a = child (fixture, "a");
+	b = child (fixture, "b");
+
+	checkpoint = tracker_checkpoint_new (fixture->checkpoint_path);
+	tracker_checkpoint_root_started (checkpoint, fixture->root);
+
+	/* Around 5MB worth of records cancelling each other */
+	for (i = 0; i < 40000; i++) {
+		tracker_checkpoint_add_item (checkpoint, TRACKER_CHECKPOINT_CREATED, a, NULL);
+		tracker_checkpoint_item_done (checkpoint, a);
+
+		if (i % 100 == 0) {
+			tracker_checkpoint_flush (checkpoint);
+		}
+	}
+
+	tracker_checkpoint_add_item (checkpoint, TRACKER_CHECKPOINT_CREATED, b, NULL);
+	tracker_checkpoint_root_finished (checkpoint, fixture->root);
+	tracker_checkpoint_free (checkpoint);
+
+	g_assert_cmpint (g_stat (fixture->checkpoint_path, &st), ==, 0);
+	g_assert_cmpint (st.st_size, <, 2 * 1024 * 1024);
+
+	g_assert (resume (fixture, &events));
+	g_assert_cmpstr (events, ==, "1:b ");
+	g_free (events);
+
+	g_object_unref (a);
+	g_object_unref (b);
+}
+
+static void
+test_checkpoint_torn_record (CheckpointFixture *fixture,
+                             gconstpointer      data)
+{
+	gchar *contents, *torn, *uri;
+	gchar *events;
+
+	write_checkpoint (fixture, TRUE);
+
+	/* Power cut in the middle of a record */
+	g_assert (g_file_get_contents (fixture->checkpoint_path, &contents, NULL, NULL));
+	uri = g_file_get_uri (fixture->root);
+	torn = g_strdup_printf ("%sD %s/a", contents, uri);
+	g_assert (g_file_set_contents (fixture->checkpoint_path, torn, -1, NULL));
+	g_free (contents);
+	g_free (torn);
+	g_free (uri);
+
+	g_assert (resume (fixture, &events));
+	g_assert_cmpstr (events, ==, "0:dir 1:a 3:c 4:d<e ");
+	g_free (events);
+}
+
+static void
+test_checkpoint_clear (CheckpointFixture *fixture,
+                       gconstpointer      data)
+{
+	TrackerCheckpoint *checkpoint;
+	gchar *events;
+
+	write_checkpoint (fixture, TRUE);
+
+	checkpoint = tracker_checkpoint_new (fixture->checkpoint_path);
+	tracker_checkpoint_clear (checkpoint);
+	tracker_checkpoint_free (checkpoint);
+
+	g_assert (!resume (fixture, &events));
+	g_assert_cmpstr (events, ==, "");
+	g_free (events);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/libtracker-miner/tracker-checkpoint/resume",
+	            CheckpointFixture, NULL,
+	            fixture_setup, test_checkpoint_resume, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-checkpoint/resume-survives-restart",
+	            CheckpointFixture, NULL,
+	            fixture_setup, test_checkpoint_resume_survives_restart, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-checkpoint/unfinished",
+	            CheckpointFixture, NULL,
+	            fixture_setup, test_checkpoint_unfinished, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-checkpoint/stale-mtime",
+	            CheckpointFixture, NULL,
+	            fixture_setup, test_checkpoint_stale_mtime, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-checkpoint/directory-changed",
+	            CheckpointFixture, NULL,
+	            fixture_setup, test_checkpoint_directory_changed, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-checkpoint/modified-in-place",
+	            CheckpointFixture, NULL,
+	            fixture_setup, test_checkpoint_modified_in_place, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-checkpoint/compact",
+	            CheckpointFixture, NULL,
+	            fixture_setup, test_checkpoint_compact, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-checkpoint/torn-record",
+	            CheckpointFixture, NULL,
+	            fixture_setup, test_checkpoint_torn_record, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-checkpoint/clear",
+	            CheckpointFixture, NULL,
+	            fixture_setup, test_checkpoint_clear, fixture_teardown);
+
+	return g_test_run ();
+}
@@ -94,4 +94,24 @@ public class TrackerMockConnection : Sparql.Connection {
         this.results = results;
     }
 
+    /* Time in milliseconds each update of an array takes */
+    public uint update_cost { get; set; default = 0; }
+    public uint n_update_arrays { get; private set; default = 0; }
+
+    public async override GenericArray<Sparql.Error?>? update_array_async (string[] sparql, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null)
+    throws Sparql.Error, IOError, DBusError {
+        var errors = new GenericArray<Sparql.Error?> ();
+
+        n_update_arrays++;
+
+        Timeout.add (update_cost * sparql.length, update_array_async.callback);
+        yield;
+
+        for (int i = 0; i < sparql.length; i++) {
+            errors.add (null);
+        }
+
+        return errors;
+    }
+
 }
@@ -33,6 +33,7 @@ struct CrawlerTest {
 	guint n_check_directory;
 	guint n_check_directory_contents;
 	guint n_check_file;
+	guint n_directory_contents_crawled;
 };
 
 static void
@@ -69,6 +70,37 @@ crawler_directory_crawled_cb (TrackerCrawler *crawler,
 	g_assert_cmpint (g_node_n_nodes (tree, G_TRAVERSE_ALL), ==, directories_found + files_found);
 }
 
+static void
+crawler_directory_streamed_cb (TrackerCrawler *crawler,
+                               GFile          *directory,
+                               GNode          *tree,
+                               guint           directories_found,
+                               guint           directories_ignored,
+                               guint           files_found,
+                               guint           files_ignored,
+                               gpointer        user_data)
+{
+	CrawlerTest *test = user_data;
+
+	test->directories_found = directories_found;
+	test->files_found = files_found;
+
+	/* Files were handed over along the way */
+	g_assert_cmpint (g_node_n_nodes (tree, G_TRAVERSE_ALL), ==, directories_found);
+}
+
+static void
+crawler_directory_contents_crawled_cb (TrackerCrawler *crawler,
+                                       GFile          *directory,
+                                       GNode          *node,
+                                       gpointer        user_data)
+{
+	CrawlerTest *test = user_data;
+
+	g_assert (g_file_equal (directory, node->data));
+	test->n_directory_contents_crawled++;
+}
+
 static gboolean
 crawler_check_directory_cb (TrackerCrawler *crawler,
 			    GFile          *file,
@@ -315,6 +347,123 @@ test_crawler_crawl_n_signals_non_recursive (void)
 	g_object_unref (file);
 }
 
+static void
+test_crawler_crawl_prune (void)
+{
+	TrackerCrawler *crawler;
+	CrawlerTest test = { 0 };
+	GFile *file, *dir;
+
+	test.main_loop = g_main_loop_new (NULL, FALSE);
+
+	crawler = tracker_crawler_new ();
+	g_signal_connect (crawler, "finished",
+			  G_CALLBACK (crawler_finished_cb), &test);
+	g_signal_connect (crawler, "directory-crawled",
+			  G_CALLBACK (crawler_directory_crawled_cb), &test);
+
+	file = g_file_new_for_path (TEST_DATA_DIR);
+	dir = g_file_get_child (file, "dir");
+
+	/* Nothing to prune if not crawling */
+	g_assert_cmpuint (tracker_crawler_prune (crawler, dir), ==, 0);
+
+	tracker_crawler_start (crawler, file, TRUE);
+
+	/* The root itself can't be pruned */
+	g_assert_cmpuint (tracker_crawler_prune (crawler, file), ==, 0);
+
+	/* Nothing found there yet */
+	g_assert_cmpuint (tracker_crawler_prune (crawler, dir), ==, 0);
+
+	g_main_loop_run (test.main_loop);
+
+	/* Only the root and empty-dir, with its hidden file, and file1 */
+	g_assert_cmpint (test.interrupted, ==, 0);
+	g_assert_cmpint (test.directories_found, ==, 2);
+	g_assert_cmpint (test.files_found, ==, 2);
+
+	g_main_loop_unref (test.main_loop);
+	g_object_unref (crawler);
+	g_object_unref (file);
+	g_object_unref (dir);
+}
+
+static void
+test_crawler_crawl_streaming (void)
+{
+	TrackerCrawler *crawler;
+	CrawlerTest test = { 0 };
+	GFile *file;
+	guint n_nodes, peak;
+
+	test.main_loop = g_main_loop_new (NULL, FALSE);
+
+	crawler = tracker_crawler_new ();
+	g_signal_connect (crawler, "finished",
+			  G_CALLBACK (crawler_finished_cb), &test);
+	g_signal_connect (crawler, "directory-crawled",
+			  G_CALLBACK (crawler_directory_streamed_cb), &test);
+	g_signal_connect (crawler, "directory-contents-crawled",
+			  G_CALLBACK (crawler_directory_contents_crawled_cb), &test);
+
+	tracker_crawler_set_streaming (crawler, TRUE);
+	g_assert (tracker_crawler_get_streaming (crawler));
+
+	file = g_file_new_for_path (TEST_DATA_DIR);
+
+	tracker_crawler_start (crawler, file, TRUE);
+
+	g_main_loop_run (test.main_loop);
+
+	g_assert_cmpint (test.interrupted, ==, 0);
+	g_assert_cmpint (test.directories_found, ==, 4);
+	g_assert_cmpint (test.files_found, ==, 5);
+	g_assert_cmpint (test.n_directory_contents_crawled, ==, 4);
+
+	/* Never held every file at once */
+	n_nodes = tracker_crawler_get_n_nodes (crawler, &peak);
+	g_assert_cmpuint (n_nodes, ==, 0);
+	g_assert_cmpuint (peak, >, 0);
+	g_assert_cmpuint (peak, <, test.directories_found + test.files_found);
+
+	g_main_loop_unref (test.main_loop);
+	g_object_unref (crawler);
+	g_object_unref (file);
+}
+
+static void
+test_crawler_crawl_n_nodes (void)
+{
+	TrackerCrawler *crawler;
+	CrawlerTest test = { 0 };
+	GFile *file;
+	guint n_nodes, peak;
+
+	test.main_loop = g_main_loop_new (NULL, FALSE);
+
+	crawler = tracker_crawler_new ();
+	g_signal_connect (crawler, "finished",
+			  G_CALLBACK (crawler_finished_cb), &test);
+	g_signal_connect (crawler, "directory-crawled",
+			  G_CALLBACK (crawler_directory_crawled_cb), &test);
+
+	file = g_file_new_for_path (TEST_DATA_DIR);
+
+	tracker_crawler_start (crawler, file, TRUE);
+
+	g_main_loop_run (test.main_loop);
+
+	/* Whole tree held until the root is done */
+	n_nodes = tracker_crawler_get_n_nodes (crawler, &peak);
+	g_assert_cmpuint (n_nodes, ==, 0);
+	g_assert_cmpuint (peak, ==, test.directories_found + test.files_found);
+
+	g_main_loop_unref (test.main_loop);
+	g_object_unref (crawler);
+	g_object_unref (file);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -340,5 +489,13 @@ main (int    argc,
 	g_test_add_func ("/libtracker-miner/tracker-crawler/crawl-n-signals-non-recursive",
 	                 test_crawler_crawl_n_signals_non_recursive);
 
+	g_test_add_func ("/libtracker-miner/tracker-crawler/crawl-prune",
+	                 test_crawler_crawl_prune);
+
+	g_test_add_func ("/libtracker-miner/tracker-crawler/crawl-streaming",
+	                 test_crawler_crawl_streaming);
+	g_test_add_func ("/libtracker-miner/tracker-crawler/crawl-n-nodes",
+	                 test_crawler_crawl_n_nodes);
+
 	return g_test_run ();
 }
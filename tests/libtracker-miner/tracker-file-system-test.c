@@ -231,6 +231,45 @@ test_file_system_properties (TestCommonContext *fixture,
 	g_assert (ret_value == NULL);
 }
 
+static void
+test_file_system_n_files (TestCommonContext *fixture,
+                          gconstpointer      data)
+{
+	GFile *file, *dir;
+	gchar *uri;
+	guint n_files, peak, i;
+
+	g_assert_cmpuint (tracker_file_system_get_n_files (fixture->file_system,
+	                                                   &peak), ==, 0);
+	g_assert_cmpuint (peak, ==, 0);
+
+	file = g_file_new_for_uri ("file:///aaa/");
+	dir = tracker_file_system_get_file (fixture->file_system, file,
+					    G_FILE_TYPE_DIRECTORY, NULL);
+	g_object_unref (file);
+
+	for (i = 0; i < 3; i++) {
+		uri = g_strdup_printf ("file:///aaa/%u", i);
+		file = g_file_new_for_uri (uri);
+		tracker_file_system_get_file (fixture->file_system, file,
+					      G_FILE_TYPE_REGULAR, dir);
+		g_object_unref (file);
+		g_free (uri);
+	}
+
+	n_files = tracker_file_system_get_n_files (fixture->file_system, &peak);
+	g_assert_cmpuint (n_files, ==, 4);
+	g_assert_cmpuint (peak, ==, 4);
+
+	/* Regular files go away, the peak stays */
+	tracker_file_system_forget_files (fixture->file_system, dir,
+					  G_FILE_TYPE_REGULAR);
+
+	n_files = tracker_file_system_get_n_files (fixture->file_system, &peak);
+	g_assert_cmpuint (n_files, ==, 1);
+	g_assert_cmpuint (peak, ==, 4);
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -249,6 +288,8 @@ main (gint    argc,
 		  test_file_system_reparenting);
 	test_add ("/libtracker-miner/file-system/file-properties",
 	          test_file_system_properties);
+	test_add ("/libtracker-miner/file-system/n-files",
+	          test_file_system_n_files);
 
 	return g_test_run ();
 }
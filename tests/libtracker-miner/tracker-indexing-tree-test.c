@@ -943,6 +943,190 @@ test_indexing_tree_030 (TestCommonContext *fixture,
 	ASSERT_INDEXABLE (fixture, TEST_DIRECTORY_ABA);
 }
 
+#define ASSERT_FILE_MATCHES(fixture, type, path, expected)	  \
+	G_STMT_START { \
+		GFile *__file = g_file_new_for_path (path); \
+		g_assert (tracker_indexing_tree_file_matches_filter (fixture->tree, \
+		                                                     type, \
+		                                                     __file) == expected); \
+		g_object_unref (__file); \
+	} G_STMT_END
+
+/* Filters of all kinds: exact names, suffixes, other globs and
+ * absolute paths, applying only to the given filter type.
+ */
+static void
+test_indexing_tree_filters (TestCommonContext *fixture,
+                            gconstpointer      data)
+{
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "Makefile");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "*.o");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "*~");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "*.vm*");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "core.?");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "/A/B");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_DIRECTORY, "CVS");
+
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/Makefile", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/Makefile.am", FALSE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/foo.o", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/foo.ogg", FALSE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/.o", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/o", FALSE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/foo.txt~", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/disk.vmdk", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/disk.vm", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/disk.v", FALSE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/core.1", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/core.12", FALSE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/B", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/B/foo", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/BB", FALSE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/CVS", FALSE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_DIRECTORY, "/A/CVS", TRUE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_DIRECTORY, "/A/foo.o", FALSE);
+
+	/* Filters added after matching must be taken into account */
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "*.ogg");
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/foo.ogg", TRUE);
+
+	tracker_indexing_tree_clear_filters (fixture->tree, TRACKER_FILTER_FILE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/foo.o", FALSE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_FILE, "/A/Makefile", FALSE);
+	ASSERT_FILE_MATCHES (fixture, TRACKER_FILTER_DIRECTORY, "/A/CVS", TRUE);
+}
+
+/* Roots must be resolved to the deepest configured
+ * directory, also after removing and adding them.
+ */
+static void
+test_indexing_tree_roots (TestCommonContext *fixture,
+                          gconstpointer      data)
+{
+	TrackerDirectoryFlags flags;
+	GFile *root, *file;
+
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_A],
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_AAA],
+	                           TRACKER_DIRECTORY_FLAG_MONITOR);
+
+	root = tracker_indexing_tree_get_root (fixture->tree,
+	                                       fixture->test_dir[TEST_DIRECTORY_AAAB],
+	                                       &flags);
+	g_assert (root != NULL);
+	g_assert (g_file_equal (root, fixture->test_dir[TEST_DIRECTORY_AAA]));
+	g_assert_cmpint (flags, ==, TRACKER_DIRECTORY_FLAG_MONITOR);
+
+	root = tracker_indexing_tree_get_root (fixture->tree,
+	                                       fixture->test_dir[TEST_DIRECTORY_AAB],
+	                                       &flags);
+	g_assert (root != NULL);
+	g_assert (g_file_equal (root, fixture->test_dir[TEST_DIRECTORY_A]));
+	g_assert_cmpint (flags, ==, TRACKER_DIRECTORY_FLAG_RECURSE);
+
+	/* Sibling with a common name prefix is not contained */
+	file = g_file_new_for_path ("/AB");
+	g_assert (tracker_indexing_tree_get_root (fixture->tree, file, NULL) == NULL);
+	g_object_unref (file);
+
+	g_assert (tracker_indexing_tree_file_is_root (fixture->tree,
+	                                              fixture->test_dir[TEST_DIRECTORY_AAA]));
+	g_assert (!tracker_indexing_tree_file_is_root (fixture->tree,
+	                                               fixture->test_dir[TEST_DIRECTORY_AA]));
+
+	tracker_indexing_tree_remove (fixture->tree,
+	                              fixture->test_dir[TEST_DIRECTORY_AAA]);
+
+	root = tracker_indexing_tree_get_root (fixture->tree,
+	                                       fixture->test_dir[TEST_DIRECTORY_AAAB],
+	                                       NULL);
+	g_assert (root != NULL);
+	g_assert (g_file_equal (root, fixture->test_dir[TEST_DIRECTORY_A]));
+	g_assert (!tracker_indexing_tree_file_is_root (fixture->tree,
+	                                               fixture->test_dir[TEST_DIRECTORY_AAA]));
+}
+
+/* Default ignored-files setting of tracker-miner-fs */
+static const gchar *benchmark_file_filters[] = {
+	"*~", "*.o", "*.la", "*.lo", "*.loT", "*.in", "*.csproj", "*.m4",
+	"*.rej", "*.gmo", "*.orig", "*.pc", "*.omf", "*.aux", "*.tmp",
+	"*.po", "*.vmdk", "*.vm*", "*.nvram", "*.part", "*.rcore", "*.lzo",
+	"autom4te", "conftest", "confstat", "Makefile", "SCCS", "ltmain.sh",
+	"libtool", "config.status", "confdefs.h", "configure", NULL
+};
+
+static const gchar *benchmark_basenames[] = {
+	"track%d.mp3", "IMG_%04d.JPG", "clip-%d.mp4", "notes %d.txt",
+	"backup%d.txt~", "part%d.part", "playlist%d.m3u", "cover%d.png",
+	"main%d.o", "disk%d.vmdk", "Makefile", "README.%d", NULL
+};
+
+#define BENCHMARK_N_PATHS 100000
+
+static void
+test_indexing_tree_benchmark (TestCommonContext *fixture,
+                              gconstpointer      data)
+{
+	GPtrArray *files;
+	guint i, n_indexable = 0;
+	gdouble elapsed;
+
+	for (i = 0; benchmark_file_filters[i]; i++) {
+		tracker_indexing_tree_add_filter (fixture->tree,
+		                                  TRACKER_FILTER_FILE,
+		                                  benchmark_file_filters[i]);
+	}
+
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_DIRECTORY, "po");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_DIRECTORY, "CVS");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_DIRECTORY, "core-dumps");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_DIRECTORY, "lost+found");
+
+	/* A few roots, like with several mounted volumes */
+	for (i = 0; i < TEST_DIRECTORY_LAST; i++) {
+		tracker_indexing_tree_add (fixture->tree,
+		                           fixture->test_dir[i],
+		                           TRACKER_DIRECTORY_FLAG_RECURSE |
+		                           TRACKER_DIRECTORY_FLAG_MONITOR);
+	}
+
+	files = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (i = 0; i < BENCHMARK_N_PATHS; i++) {
+		gchar *basename, *path;
+		const gchar *format;
+
+		format = benchmark_basenames[i % (G_N_ELEMENTS (benchmark_basenames) - 1)];
+		basename = g_strdup_printf (format, i);
+		path = g_strdup_printf ("/A/%s/Music/Artist %d/Album %d/%s",
+		                        (i % 2) ? "A/A" : "B",
+		                        i % 100, i % 1000, basename);
+		g_ptr_array_add (files, g_file_new_for_path (path));
+		g_free (basename);
+		g_free (path);
+	}
+
+	g_test_timer_start ();
+
+	for (i = 0; i < files->len; i++) {
+		if (tracker_indexing_tree_file_is_indexable (fixture->tree,
+		                                             g_ptr_array_index (files, i),
+		                                             G_FILE_TYPE_REGULAR)) {
+			n_indexable++;
+		}
+	}
+
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed,
+	                         "Checked %d paths (%d indexable) in %f seconds",
+	                         files->len, n_indexable, elapsed);
+
+	g_ptr_array_unref (files);
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -981,6 +1165,12 @@ main (gint    argc,
 	test_add ("/libtracker-miner/indexing-tree/028", test_indexing_tree_028);
 	test_add ("/libtracker-miner/indexing-tree/029", test_indexing_tree_029);
 	test_add ("/libtracker-miner/indexing-tree/030", test_indexing_tree_030);
+	test_add ("/libtracker-miner/indexing-tree/filters", test_indexing_tree_filters);
+	test_add ("/libtracker-miner/indexing-tree/roots", test_indexing_tree_roots);
+
+	if (g_test_perf ()) {
+		test_add ("/libtracker-miner/indexing-tree/benchmark", test_indexing_tree_benchmark);
+	}
 
 	return g_test_run ();
 }
@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <libtracker-miner/tracker-io-pressure.h>
+
+/* Long enough to make the stall times below meaningful */
+#define SAMPLE_WAIT (G_USEC_PER_SEC / 10)
+
+typedef struct {
+	gchar *dir;
+	gchar *psi_path;
+	gchar *diskstats_path;
+	gchar *self_io_path;
+	gchar *helper_io_path;
+} IOPressureFixture;
+
+static void
+fixture_setup (IOPressureFixture *fixture,
+               gconstpointer      data)
+{
+	fixture->dir = g_dir_make_tmp ("tracker-io-pressure-test-XXXXXX", NULL);
+	g_assert (fixture->dir != NULL);
+
+	fixture->psi_path = g_build_filename (fixture->dir, "io", NULL);
+	fixture->diskstats_path = g_build_filename (fixture->dir, "diskstats", NULL);
+	fixture->self_io_path = g_build_filename (fixture->dir, "self-io", NULL);
+	fixture->helper_io_path = g_build_filename (fixture->dir, "helper-io", NULL);
+}
+
+static void
+fixture_teardown (IOPressureFixture *fixture,
+                  gconstpointer      data)
+{
+	g_unlink (fixture->psi_path);
+	g_unlink (fixture->diskstats_path);
+	g_unlink (fixture->self_io_path);
+	g_unlink (fixture->helper_io_path);
+	g_rmdir (fixture->dir);
+
+	g_free (fixture->psi_path);
+	g_free (fixture->diskstats_path);
+	g_free (fixture->self_io_path);
+	g_free (fixture->helper_io_path);
+	g_free (fixture->dir);
+}
+
+static void
+write_psi (IOPressureFixture *fixture,
+           guint64            total)
+{
+	gchar *contents;
+
+	contents = g_strdup_printf ("some avg10=0.00 avg60=0.00 avg300=0.00 total=%" G_GUINT64_FORMAT "\n"
+	                            "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n",
+	                            total);
+	g_assert (g_file_set_contents (fixture->psi_path, contents, -1, NULL));
+	g_free (contents);
+}
+
+static void
+write_diskstats (IOPressureFixture *fixture,
+                 guint64            io_ticks,
+                 guint64            sectors)
+{
+	struct stat st;
+	gchar *contents;
+
+	g_assert (g_stat (fixture->dir, &st) == 0);
+
+	contents = g_strdup_printf ("   7       0 loop0 0 0 0 0 0 0 0 0 0 5000 0\n"
+	                            " %4u %7u test0 10 0 %" G_GUINT64_FORMAT " 4 10 0 0 4 0 %" G_GUINT64_FORMAT " 8\n",
+	                            major (st.st_dev), minor (st.st_dev),
+	                            sectors, io_ticks);
+	g_assert (g_file_set_contents (fixture->diskstats_path, contents, -1, NULL));
+	g_free (contents);
+}
+
+static void
+write_process_io (const gchar *path,
+                  guint64      bytes)
+{
+	gchar *contents;
+
+	contents = g_strdup_printf ("rchar: 0\n"
+	                            "wchar: 0\n"
+	                            "syscr: 0\n"
+	                            "syscw: 0\n"
+	                            "read_bytes: %" G_GUINT64_FORMAT "\n"
+	                            "write_bytes: 0\n"
+	                            "cancelled_write_bytes: 0\n",
+	                            bytes);
+	g_assert (g_file_set_contents (path, contents, -1, NULL));
+	g_free (contents);
+}
+
+static void
+test_io_pressure_psi (IOPressureFixture *fixture,
+                      gconstpointer      data)
+{
+	TrackerIOPressure *pressure;
+	guint64 total = 0;
+
+	write_psi (fixture, total);
+	pressure = tracker_io_pressure_new_for_paths (fixture->psi_path, NULL, NULL);
+
+	/* First sample is just the baseline */
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), ==, 0);
+
+	/* Stalled for the whole interval, throttle goes up */
+	g_usleep (SAMPLE_WAIT);
+	total += SAMPLE_WAIT;
+	write_psi (fixture, total);
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_pressure (pressure), >, 0.2);
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), >, 0.09);
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), <, 0.11);
+
+	g_usleep (SAMPLE_WAIT);
+	total += SAMPLE_WAIT;
+	write_psi (fixture, total);
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), >, 0.19);
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), <, 0.21);
+
+	/* No stalls, it comes back down slower */
+	g_usleep (SAMPLE_WAIT);
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_pressure (pressure), ==, 0);
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), >, 0.14);
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), <, 0.16);
+
+	g_object_unref (pressure);
+}
+
+static void
+test_io_pressure_diskstats (IOPressureFixture *fixture,
+                            gconstpointer      data)
+{
+	TrackerIOPressure *pressure;
+	GFile *dir;
+
+	write_diskstats (fixture, 1000, 80);
+	pressure = tracker_io_pressure_new_for_paths (fixture->psi_path,
+	                                              fixture->diskstats_path,
+	                                              NULL);
+
+	/* No PSI, and no devices to look up */
+	g_assert (!tracker_io_pressure_sample (pressure));
+
+	dir = g_file_new_for_path (fixture->dir);
+	tracker_io_pressure_add_device (pressure, dir);
+	g_object_unref (dir);
+
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), ==, 0);
+
+	/* Device busy for longer than the interval */
+	g_usleep (SAMPLE_WAIT);
+	write_diskstats (fixture, 1000 + 10 * SAMPLE_WAIT / 1000, 160);
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_pressure (pressure), ==, 1);
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), >, 0.09);
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), <, 0.11);
+
+	g_object_unref (pressure);
+}
+
+static void
+test_io_pressure_own_io (IOPressureFixture *fixture,
+                         gconstpointer      data)
+{
+	TrackerIOPressure *pressure;
+	guint64 total = 0;
+	GFile *dir;
+
+	write_psi (fixture, total);
+	write_diskstats (fixture, 1000, 1000);
+	write_process_io (fixture->self_io_path, 0);
+	pressure = tracker_io_pressure_new_for_paths (fixture->psi_path,
+	                                              fixture->diskstats_path,
+	                                              fixture->self_io_path);
+
+	dir = g_file_new_for_path (fixture->dir);
+	tracker_io_pressure_add_device (pressure, dir);
+	g_object_unref (dir);
+
+	g_assert (tracker_io_pressure_sample (pressure));
+
+	/* Stalled, but all of the device I/O was ours */
+	g_usleep (SAMPLE_WAIT);
+	total += SAMPLE_WAIT;
+	write_psi (fixture, total);
+	write_diskstats (fixture, 1000, 2000);
+	write_process_io (fixture->self_io_path, 1000 * 512);
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_pressure (pressure), >, 0.2);
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), ==, 0);
+
+	/* Stalled, with most of the device I/O from elsewhere */
+	g_usleep (SAMPLE_WAIT);
+	total += SAMPLE_WAIT;
+	write_psi (fixture, total);
+	write_diskstats (fixture, 1000, 3000);
+	write_process_io (fixture->self_io_path, 1100 * 512);
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), >, 0);
+
+	g_object_unref (pressure);
+}
+
+static void
+test_io_pressure_helper_io (IOPressureFixture *fixture,
+                            gconstpointer      data)
+{
+	TrackerIOPressure *pressure;
+	guint64 total = 0;
+	GFile *dir;
+
+	write_psi (fixture, total);
+	write_diskstats (fixture, 1000, 1000);
+	write_process_io (fixture->self_io_path, 0);
+	write_process_io (fixture->helper_io_path, 0);
+	pressure = tracker_io_pressure_new_for_paths (fixture->psi_path,
+	                                              fixture->diskstats_path,
+	                                              fixture->self_io_path);
+	tracker_io_pressure_set_helper (pressure, "helper", fixture->helper_io_path);
+
+	dir = g_file_new_for_path (fixture->dir);
+	tracker_io_pressure_add_device (pressure, dir);
+	g_object_unref (dir);
+
+	g_assert (tracker_io_pressure_sample (pressure));
+
+	/* Stalled, with most of the device I/O done by the helper */
+	g_usleep (SAMPLE_WAIT);
+	total += SAMPLE_WAIT;
+	write_psi (fixture, total);
+	write_diskstats (fixture, 1000, 2000);
+	write_process_io (fixture->self_io_path, 100 * 512);
+	write_process_io (fixture->helper_io_path, 800 * 512);
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_pressure (pressure), >, 0.2);
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), ==, 0);
+
+	/* Same again once the helper is gone */
+	tracker_io_pressure_set_helper (pressure, "helper", NULL);
+
+	g_usleep (SAMPLE_WAIT);
+	total += SAMPLE_WAIT;
+	write_psi (fixture, total);
+	write_diskstats (fixture, 1000, 3000);
+	write_process_io (fixture->self_io_path, 200 * 512);
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), >, 0);
+
+	g_object_unref (pressure);
+}
+
+static void
+test_io_pressure_unavailable (IOPressureFixture *fixture,
+                              gconstpointer      data)
+{
+	TrackerIOPressure *pressure;
+
+	pressure = tracker_io_pressure_new_for_paths (fixture->psi_path,
+	                                              fixture->diskstats_path,
+	                                              NULL);
+
+	g_assert (!tracker_io_pressure_sample (pressure));
+
+	/* Nothing to sample, so it doesn't even start */
+	tracker_io_pressure_start (pressure);
+	g_assert (!tracker_io_pressure_is_running (pressure));
+
+	g_object_unref (pressure);
+}
+
+static void
+test_io_pressure_stop (IOPressureFixture *fixture,
+                       gconstpointer      data)
+{
+	TrackerIOPressure *pressure;
+
+	write_psi (fixture, 0);
+	pressure = tracker_io_pressure_new_for_paths (fixture->psi_path, NULL, NULL);
+
+	tracker_io_pressure_start (pressure);
+	g_assert (tracker_io_pressure_is_running (pressure));
+
+	g_usleep (SAMPLE_WAIT);
+	write_psi (fixture, SAMPLE_WAIT);
+	g_assert (tracker_io_pressure_sample (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), >, 0);
+
+	/* Stopping resets the throttle */
+	tracker_io_pressure_stop (pressure);
+	g_assert (!tracker_io_pressure_is_running (pressure));
+	g_assert_cmpfloat (tracker_io_pressure_get_throttle (pressure), ==, 0);
+
+	g_object_unref (pressure);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/libtracker-miner/tracker-io-pressure/psi",
+	            IOPressureFixture, NULL,
+	            fixture_setup, test_io_pressure_psi, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-io-pressure/diskstats",
+	            IOPressureFixture, NULL,
+	            fixture_setup, test_io_pressure_diskstats, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-io-pressure/own-io",
+	            IOPressureFixture, NULL,
+	            fixture_setup, test_io_pressure_own_io, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-io-pressure/helper-io",
+	            IOPressureFixture, NULL,
+	            fixture_setup, test_io_pressure_helper_io, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-io-pressure/unavailable",
+	            IOPressureFixture, NULL,
+	            fixture_setup, test_io_pressure_unavailable, fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-io-pressure/stop",
+	            IOPressureFixture, NULL,
+	            fixture_setup, test_io_pressure_stop, fixture_teardown);
+
+	return g_test_run ();
+}
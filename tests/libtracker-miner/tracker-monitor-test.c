@@ -17,6 +17,7 @@
  * 02110-1301, USA.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -25,10 +26,13 @@
 
 /* Special case, the monitor header is not normally exported */
 #include <libtracker-miner/tracker-monitor.h>
+#include <libtracker-miner/tracker-monitor-fanotify.h>
 
 /* -------------- COMMON FOR ALL FILE EVENT TESTS ----------------- */
 
 #define TEST_TIMEOUT 5 /* seconds */
+/* Busy directories are notified once quiet, or after 30 seconds */
+#define CONTENTS_CHANGED_TIMEOUT 35 /* seconds */
 
 typedef enum {
 	MONITOR_SIGNAL_NONE                   = 0,
@@ -37,7 +41,8 @@ typedef enum {
 	MONITOR_SIGNAL_ITEM_ATTRIBUTE_UPDATED = 1 << 2,
 	MONITOR_SIGNAL_ITEM_DELETED           = 1 << 3,
 	MONITOR_SIGNAL_ITEM_MOVED_FROM        = 1 << 4,
-	MONITOR_SIGNAL_ITEM_MOVED_TO          = 1 << 5
+	MONITOR_SIGNAL_ITEM_MOVED_TO          = 1 << 5,
+	MONITOR_SIGNAL_CONTENTS_CHANGED       = 1 << 6
 } MonitorSignal;
 
 /* Fixture object type */
@@ -198,6 +203,26 @@ test_monitor_events_moved_cb (TrackerMonitor *monitor,
 	           MONITOR_SIGNAL_ITEM_MOVED_TO);
 }
 
+static void
+test_monitor_events_contents_changed_cb (TrackerMonitor *monitor,
+                                         GFile          *directory,
+                                         gpointer        user_data)
+{
+	gchar *path;
+
+	g_assert (directory != NULL);
+	path = g_file_get_path (directory);
+	g_assert (path != NULL);
+
+	g_debug ("***** '%s' (DIR) (CONTENTS CHANGED)", path);
+
+	g_free (path);
+
+	add_event ((GHashTable *) user_data,
+	           directory,
+	           MONITOR_SIGNAL_CONTENTS_CHANGED);
+}
+
 static void
 test_monitor_common_setup (TrackerMonitorTestFixture *fixture,
                            gconstpointer              data)
@@ -229,6 +254,9 @@ test_monitor_common_setup (TrackerMonitorTestFixture *fixture,
 	g_signal_connect (fixture->monitor, "item-moved",
 	                  G_CALLBACK (test_monitor_events_moved_cb),
 	                  fixture->events);
+	g_signal_connect (fixture->monitor, "directory-contents-changed",
+	                  G_CALLBACK (test_monitor_events_contents_changed_cb),
+	                  fixture->events);
 
 	/* Initially, set it disabled */
 	tracker_monitor_set_enabled (fixture->monitor, FALSE);
@@ -363,14 +391,16 @@ print_file_events_cb (gpointer key,
 	         "   ATTRIBUTE UPDATED: %s\n"
 	         "   DELETED:           %s\n"
 	         "   MOVED_FROM:        %s\n"
-	         "   MOVED_TO:          %s\n",
+	         "   MOVED_TO:          %s\n"
+	         "   CONTENTS CHANGED:  %s\n",
 	         uri,
 	         events & MONITOR_SIGNAL_ITEM_CREATED ? "yes" : "no",
 	         events & MONITOR_SIGNAL_ITEM_UPDATED ? "yes" : "no",
 	         events & MONITOR_SIGNAL_ITEM_ATTRIBUTE_UPDATED ? "yes" : "no",
 	         events & MONITOR_SIGNAL_ITEM_DELETED ? "yes" : "no",
 	         events & MONITOR_SIGNAL_ITEM_MOVED_FROM ? "yes" : "no",
-	         events & MONITOR_SIGNAL_ITEM_MOVED_TO ? "yes" : "no");
+	         events & MONITOR_SIGNAL_ITEM_MOVED_TO ? "yes" : "no",
+	         events & MONITOR_SIGNAL_CONTENTS_CHANGED ? "yes" : "no");
 
 	g_free (uri);
 }
@@ -1790,6 +1820,174 @@ test_monitor_directory_event_moved_from_not_monitored (TrackerMonitorTestFixture
 	g_free (dest_path);
 }
 
+static void
+test_monitor_directory_event_contents_changed (TrackerMonitorTestFixture *fixture,
+                                               gconstpointer              data)
+{
+	GPtrArray *test_files;
+	guint file_events;
+	guint n_created = 0;
+	guint timeout_id;
+	gulong handler_id;
+	guint i;
+
+	/* Set up environment */
+	tracker_monitor_set_enabled (fixture->monitor, TRUE);
+
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (fixture->monitored_directory_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+
+	/* Create way more files than the monitor handles one by one */
+	test_files = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (i = 0; i < 500; i++) {
+		GFile *test_file;
+		gchar *basename;
+
+		basename = g_strdup_printf ("burst-%d.txt", i);
+		set_file_contents (fixture->monitored_directory, basename, "foo", &test_file);
+		g_assert (test_file != NULL);
+		g_hash_table_insert (fixture->events,
+		                     g_object_ref (test_file),
+		                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+		g_ptr_array_add (test_files, test_file);
+		g_free (basename);
+	}
+
+	/* Wait for the directory to get quiet and be notified as
+	 * changed, which may take longer than other events.
+	 */
+	timeout_id = g_timeout_add_seconds (CONTENTS_CHANGED_TIMEOUT, timeout_cb, fixture->main_loop);
+	handler_id = g_signal_connect_swapped (fixture->monitor, "directory-contents-changed",
+	                                       G_CALLBACK (g_main_loop_quit), fixture->main_loop);
+	g_main_loop_run (fixture->main_loop);
+	g_signal_handler_disconnect (fixture->monitor, handler_id);
+
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events,
+	                                                     fixture->monitored_directory_file));
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_CONTENTS_CHANGED), >, 0);
+
+	/* Not timed out then */
+	g_source_remove (timeout_id);
+
+	/* Let the remaining file events through, if any */
+	events_wait (fixture);
+
+	/* And most files must not have been notified on their own */
+	for (i = 0; i < test_files->len; i++) {
+		file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events,
+		                                                     g_ptr_array_index (test_files, i)));
+		g_assert_cmpuint ((file_events & MONITOR_SIGNAL_CONTENTS_CHANGED), ==, 0);
+
+		if (file_events & MONITOR_SIGNAL_ITEM_CREATED) {
+			n_created++;
+		}
+	}
+
+	g_assert_cmpuint (n_created, <, test_files->len);
+
+	/* Cleanup environment */
+	tracker_monitor_set_enabled (fixture->monitor, FALSE);
+
+	for (i = 0; i < test_files->len; i++) {
+		g_assert_cmpint (g_file_delete (g_ptr_array_index (test_files, i), NULL, NULL), ==, TRUE);
+	}
+
+	g_ptr_array_unref (test_files);
+}
+
+static void
+test_monitor_event_cache_overflow (TrackerMonitorTestFixture *fixture,
+                                   gconstpointer              data)
+{
+	GPtrArray *test_dirs;
+	GPtrArray *test_files;
+	guint file_events;
+	guint i, j;
+
+	/* Set up environment */
+	tracker_monitor_set_enabled (fixture->monitor, TRUE);
+
+	/* Spread the files over several directories, so
+	 * none of them gets collapsed into a single
+	 * DIRECTORY_CONTENTS_CHANGED.
+	 */
+	test_dirs = g_ptr_array_new_with_free_func (g_object_unref);
+	test_files = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (i = 0; i < 50; i++) {
+		GFile *test_dir;
+		gchar *basename;
+		gchar *path;
+
+		basename = g_strdup_printf ("overflow-%d", i);
+		create_directory (fixture->monitored_directory, basename, &test_dir);
+		g_assert_cmpint (tracker_monitor_add (fixture->monitor, test_dir), ==, TRUE);
+		g_ptr_array_add (test_dirs, test_dir);
+		g_free (basename);
+
+		path = g_file_get_path (test_dir);
+
+		for (j = 0; j < 50; j++) {
+			GFile *test_file;
+
+			basename = g_strdup_printf ("file-%d.txt", j);
+			set_file_contents (path, basename, "foo", &test_file);
+			g_assert (test_file != NULL);
+			g_hash_table_insert (fixture->events,
+			                     g_object_ref (test_file),
+			                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+			g_ptr_array_add (test_files, test_file);
+			g_free (basename);
+		}
+
+		g_free (path);
+	}
+
+	/* Every file takes two ring slots (CREATED, then moved
+	 * to the tail on CHANGES_DONE_HINT), so the ring gets
+	 * full of holes. Delete some of the files, those
+	 * CREATED events are pending still and must just be
+	 * dropped, not flushed to make room.
+	 */
+	for (i = 0; i < test_files->len; i += 5) {
+		g_assert_cmpint (g_file_delete (g_ptr_array_index (test_files, i), NULL, NULL), ==, TRUE);
+	}
+
+	/* Wait for events */
+	events_wait (fixture);
+
+	for (i = 0; i < test_files->len; i++) {
+		file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events,
+		                                                     g_ptr_array_index (test_files, i)));
+
+		if (i % 5 == 0) {
+			g_assert_cmpuint (file_events, ==, MONITOR_SIGNAL_NONE);
+		} else {
+			/* No pending CREATED may be lost */
+			g_assert_cmpuint (file_events, ==, MONITOR_SIGNAL_ITEM_CREATED);
+		}
+	}
+
+	/* Cleanup environment */
+	tracker_monitor_set_enabled (fixture->monitor, FALSE);
+
+	for (i = 0; i < test_files->len; i++) {
+		if (i % 5 != 0) {
+			g_assert_cmpint (g_file_delete (g_ptr_array_index (test_files, i), NULL, NULL), ==, TRUE);
+		}
+	}
+
+	for (i = 0; i < test_dirs->len; i++) {
+		g_assert_cmpint (tracker_monitor_remove (fixture->monitor, g_ptr_array_index (test_dirs, i)), ==, TRUE);
+		g_assert_cmpint (g_file_delete (g_ptr_array_index (test_dirs, i), NULL, NULL), ==, TRUE);
+	}
+
+	g_ptr_array_unref (test_files);
+	g_ptr_array_unref (test_dirs);
+}
+
 /* ----------------------------- BASIC API TESTS --------------------------------- */
 
 static void
@@ -1870,6 +2068,191 @@ test_monitor_basic (void)
 	g_object_unref (monitor);
 }
 
+static void
+test_monitor_fanotify_fallback (void)
+{
+	TrackerMonitorFanotify *fanotify;
+	TrackerMonitor *monitor;
+	gchar *basename;
+	gchar *path_for_monitor;
+	GFile *file_for_monitor;
+
+	basename = g_strdup_printf ("monitor-test-%d", getpid ());
+	path_for_monitor = g_build_path (G_DIR_SEPARATOR_S, g_get_tmp_dir (), basename, NULL);
+	g_free (basename);
+	g_assert_cmpint (g_mkdir_with_parents (path_for_monitor, 00755), ==, 0);
+
+	file_for_monitor = g_file_new_for_path (path_for_monitor);
+
+	fanotify = tracker_monitor_fanotify_new ();
+
+	if (fanotify) {
+		GFileMonitor *file_monitor;
+		GError *error = NULL;
+
+		/* The backend is only given when filesystem marks
+		 * are permitted, other filesystems may still be
+		 * unsupported.
+		 */
+		file_monitor = tracker_monitor_fanotify_monitor_directory (fanotify,
+		                                                           file_for_monitor,
+		                                                           &error);
+		g_assert (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED));
+		g_assert ((file_monitor != NULL) == (error == NULL));
+		g_clear_error (&error);
+
+		if (file_monitor) {
+			g_assert_cmpuint (tracker_monitor_fanotify_get_n_directories (fanotify), ==, 1);
+			g_file_monitor_cancel (file_monitor);
+			g_object_unref (file_monitor);
+		}
+
+		tracker_monitor_fanotify_free (fanotify);
+	} else {
+		g_test_message ("fanotify not available or not permitted, "
+		                "checking the Inotify fallback only");
+	}
+
+	/* Directories are monitored either way */
+	monitor = tracker_monitor_new ();
+	tracker_monitor_set_enabled (monitor, TRUE);
+	g_assert_cmpint (tracker_monitor_add (monitor, file_for_monitor), ==, TRUE);
+	g_assert_cmpint (tracker_monitor_is_watched (monitor, file_for_monitor), ==, TRUE);
+	g_assert_cmpint (tracker_monitor_remove (monitor, file_for_monitor), ==, TRUE);
+	g_object_unref (monitor);
+
+	g_assert_cmpint (g_rmdir (path_for_monitor), ==, 0);
+	g_object_unref (file_for_monitor);
+	g_free (path_for_monitor);
+}
+
+typedef struct {
+	GFile *file;
+	guint events; /* 1 << GFileMonitorEvent */
+	gboolean timed_out;
+} FanotifyEventsData;
+
+static void
+fanotify_events_changed_cb (GFileMonitor      *file_monitor,
+                            GFile             *file,
+                            GFile             *other_file,
+                            GFileMonitorEvent  event_type,
+                            gpointer           user_data)
+{
+	FanotifyEventsData *data = user_data;
+
+	if (g_file_equal (file, data->file)) {
+		data->events |= 1 << event_type;
+	}
+}
+
+static gboolean
+fanotify_events_timeout_cb (gpointer user_data)
+{
+	FanotifyEventsData *data = user_data;
+
+	data->timed_out = TRUE;
+
+	return FALSE;
+}
+
+static void
+fanotify_events_wait (FanotifyEventsData *data,
+                      GFileMonitorEvent   event_type)
+{
+	guint timeout_id;
+
+	data->timed_out = FALSE;
+	timeout_id = g_timeout_add_seconds (TEST_TIMEOUT, fanotify_events_timeout_cb, data);
+
+	while (!data->timed_out && (data->events & (1 << event_type)) == 0) {
+		g_main_context_iteration (NULL, TRUE);
+	}
+
+	if (!data->timed_out) {
+		g_source_remove (timeout_id);
+	}
+
+	g_assert (data->events & (1 << event_type));
+}
+
+static void
+test_monitor_fanotify_events (void)
+{
+	TrackerMonitorFanotify *fanotify;
+	FanotifyEventsData data = { 0 };
+	GFileMonitor *file_monitor;
+	GError *error = NULL;
+	gchar *basename, *current_dir, *path_for_monitor, *path;
+	GFile *file_for_monitor;
+	FILE *fp;
+
+	fanotify = tracker_monitor_fanotify_new ();
+
+	if (!fanotify) {
+#if GLIB_CHECK_VERSION (2,38,0)
+		g_test_skip ("fanotify filesystem marks need CAP_SYS_ADMIN");
+#else  /* GLIB_CHECK_VERSION (2,38,0) */
+		g_test_message ("fanotify filesystem marks need CAP_SYS_ADMIN, skipping");
+#endif /* GLIB_CHECK_VERSION (2,38,0) */
+		return;
+	}
+
+	/* Temporary directories are often on tmpfs, which
+	 * may not provide file handles.
+	 */
+	basename = g_strdup_printf ("monitor-fanotify-test-%d", getpid ());
+	current_dir = g_get_current_dir ();
+	path_for_monitor = g_build_path (G_DIR_SEPARATOR_S, current_dir, basename, NULL);
+	g_free (current_dir);
+	g_free (basename);
+	g_assert_cmpint (g_mkdir_with_parents (path_for_monitor, 00755), ==, 0);
+
+	file_for_monitor = g_file_new_for_path (path_for_monitor);
+	file_monitor = tracker_monitor_fanotify_monitor_directory (fanotify,
+	                                                           file_for_monitor,
+	                                                           &error);
+	g_assert_no_error (error);
+	g_assert (file_monitor != NULL);
+
+	g_signal_connect (file_monitor, "changed",
+	                  G_CALLBACK (fanotify_events_changed_cb), &data);
+
+	path = g_build_path (G_DIR_SEPARATOR_S, path_for_monitor, "written", NULL);
+	data.file = g_file_new_for_path (path);
+
+	fp = g_fopen (path, "w");
+	g_assert (fp != NULL);
+	fanotify_events_wait (&data, G_FILE_MONITOR_EVENT_CREATED);
+
+	/* Writes are seen before the file is closed */
+	g_assert_cmpint (fputs ("first", fp), >=, 0);
+	g_assert_cmpint (fflush (fp), ==, 0);
+	fanotify_events_wait (&data, G_FILE_MONITOR_EVENT_CHANGED);
+	g_assert ((data.events & (1 << G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT)) == 0);
+
+	/* Further writes are coalesced until the close */
+	data.events = 0;
+	g_assert_cmpint (fputs ("second", fp), >=, 0);
+	g_assert_cmpint (fflush (fp), ==, 0);
+	g_assert_cmpint (fclose (fp), ==, 0);
+	fanotify_events_wait (&data, G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT);
+	g_assert ((data.events & (1 << G_FILE_MONITOR_EVENT_CHANGED)) == 0);
+
+	g_assert_cmpint (g_unlink (path), ==, 0);
+	fanotify_events_wait (&data, G_FILE_MONITOR_EVENT_DELETED);
+
+	g_file_monitor_cancel (file_monitor);
+	g_object_unref (file_monitor);
+	tracker_monitor_fanotify_free (fanotify);
+
+	g_assert_cmpint (g_rmdir (path_for_monitor), ==, 0);
+	g_object_unref (data.file);
+	g_object_unref (file_for_monitor);
+	g_free (path_for_monitor);
+	g_free (path);
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -1879,6 +2262,10 @@ main (gint    argc,
 	g_test_message ("Testing filesystem monitor");
 
 	/* Basic API tests */
+	g_test_add_func ("/libtracker-miner/tracker-monitor/fanotify-fallback",
+	                 test_monitor_fanotify_fallback);
+	g_test_add_func ("/libtracker-miner/tracker-monitor/fanotify-events",
+	                 test_monitor_fanotify_events);
 	g_test_add_func ("/libtracker-miner/tracker-monitor/basic",
 	                 test_monitor_basic);
 
@@ -2013,6 +2400,18 @@ main (gint    argc,
 	            test_monitor_common_setup,
 		    test_monitor_directory_event_moved_from_not_monitored,
 	            test_monitor_common_teardown);
+	g_test_add ("/libtracker-miner/tracker-monitor/directory-event/contents-changed",
+	            TrackerMonitorTestFixture,
+	            NULL,
+	            test_monitor_common_setup,
+	            test_monitor_directory_event_contents_changed,
+	            test_monitor_common_teardown);
+	g_test_add ("/libtracker-miner/tracker-monitor/event-cache/overflow",
+	            TrackerMonitorTestFixture,
+	            NULL,
+	            test_monitor_common_setup,
+	            test_monitor_event_cache_overflow,
+	            test_monitor_common_teardown);
 
 	return g_test_run ();
 }
@@ -180,6 +180,59 @@ test_priority_queue_foreach_remove (void)
         tracker_priority_queue_unref (queue);
 }
 
+static gboolean
+boost_prefix_cb (gconstpointer data,
+                 gconstpointer user_data)
+{
+        return g_str_has_prefix (data, user_data);
+}
+
+static void
+test_priority_queue_boost (void)
+{
+        TrackerPriorityQueue *queue;
+        const gchar          *expected[] = { "b1", "b2", "b3", "a2", "a1", "c1", "c2", "d1" };
+        const gint            expected_priority[] = { 1, 1, 1, 1, 1, 3, 3, 3 };
+        gchar                *result;
+        gint                  priority, i;
+
+        queue = tracker_priority_queue_new ();
+
+        /* Nothing to boost on an empty queue */
+        g_assert_cmpint (tracker_priority_queue_boost (queue, (GEqualFunc) boost_prefix_cb, "b", 1), ==, 0);
+
+        tracker_priority_queue_add (queue, g_strdup ("a1"), 1);
+        tracker_priority_queue_add (queue, g_strdup ("b1"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("c1"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("b2"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("a2"), 10);
+        tracker_priority_queue_add (queue, g_strdup ("b3"), 10);
+        tracker_priority_queue_add (queue, g_strdup ("c2"), 10);
+
+        /* Boosted elements go first as a block, elements
+         * already at the priority stay where they are.
+         */
+        g_assert_cmpint (tracker_priority_queue_boost (queue, (GEqualFunc) boost_prefix_cb, "a", 1), ==, 1);
+        g_assert_cmpint (tracker_priority_queue_boost (queue, (GEqualFunc) boost_prefix_cb, "b", 1), ==, 3);
+
+        /* Emptied segments go away, a new one is created in between */
+        g_assert_cmpint (tracker_priority_queue_boost (queue, (GEqualFunc) boost_prefix_cb, "c", 3), ==, 2);
+
+        /* Elements added later go after the boosted ones */
+        tracker_priority_queue_add (queue, g_strdup ("d1"), 3);
+        g_assert_cmpint (tracker_priority_queue_get_length (queue), ==, 8);
+
+        for (i = 0; i < G_N_ELEMENTS (expected); i++) {
+                result = tracker_priority_queue_pop (queue, &priority);
+                g_assert_cmpstr (result, ==, expected[i]);
+                g_assert_cmpint (priority, ==, expected_priority[i]);
+                g_free (result);
+        }
+
+        g_assert (tracker_priority_queue_is_empty (queue));
+        tracker_priority_queue_unref (queue);
+}
+
 static void
 test_priority_queue_branches (void)
 {
@@ -241,6 +294,8 @@ main (int    argc,
 	                 test_priority_queue_foreach);
 	g_test_add_func ("/libtracker-miner/tracker-priority-queue/foreach_remove",
 	                 test_priority_queue_foreach_remove);
+	g_test_add_func ("/libtracker-miner/tracker-priority-queue/boost",
+	                 test_priority_queue_boost);
 
         g_test_add_func ("/libtracker-miner/tracker-priority-queue/branches",
                          test_priority_queue_branches);
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <libtracker-miner/tracker-sparql-buffer.h>
+
+#include "tracker-miner-mock.h"
+
+#define POOL_LIMIT 10000
+#define MIN_BATCH_SIZE 10
+#define MAX_BATCH_SIZE 1000
+
+/* Milliseconds */
+#define TARGET_LATENCY 100
+
+/* Smaller bounds, so slow commits stay short */
+#define BOUNDS_MAX_BATCH_SIZE 100
+#define BOUNDS_TARGET_LATENCY 20
+
+typedef struct {
+	TrackerMockConnection *connection;
+	TrackerSparqlBuffer *buffer;
+	GMainLoop *main_loop;
+	guint n_pending;
+	guint n_task;
+} BufferFixture;
+
+static void
+fixture_setup (BufferFixture *fixture,
+               gconstpointer  data)
+{
+	fixture->connection = tracker_mock_connection_new ();
+	fixture->buffer = tracker_sparql_buffer_new (TRACKER_SPARQL_CONNECTION (fixture->connection),
+	                                             POOL_LIMIT);
+	fixture->main_loop = g_main_loop_new (NULL, FALSE);
+
+	tracker_sparql_buffer_set_batch_limits (fixture->buffer,
+	                                        MIN_BATCH_SIZE,
+	                                        MAX_BATCH_SIZE,
+	                                        TARGET_LATENCY);
+}
+
+static void
+fixture_teardown (BufferFixture *fixture,
+                  gconstpointer  data)
+{
+	g_main_loop_unref (fixture->main_loop);
+	g_object_unref (fixture->buffer);
+	g_object_unref (fixture->connection);
+}
+
+static void
+task_done_cb (GObject      *object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+	BufferFixture *fixture = user_data;
+
+	g_assert (!g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), NULL));
+
+	if (--fixture->n_pending == 0) {
+		g_main_loop_quit (fixture->main_loop);
+	}
+}
+
+/* Pushes a full batch, and returns the batch size
+ * once the commit is done.
+ */
+static guint
+run_commit (BufferFixture *fixture)
+{
+	guint i, batch_size;
+
+	batch_size = tracker_sparql_buffer_get_batch_size (fixture->buffer);
+	g_assert_cmpuint (batch_size, >=, MIN_BATCH_SIZE);
+	g_assert_cmpuint (batch_size, <=, MAX_BATCH_SIZE);
+
+	fixture->n_pending = batch_size;
+
+	for (i = 0; i < batch_size; i++) {
+		TrackerTask *task;
+		GFile *file;
+		gchar *uri;
+
+		uri = g_strdup_printf ("file:///test/%u", fixture->n_task);
+		file = g_file_new_for_uri (uri);
+		task = tracker_sparql_task_new_take_sparql_str (file,
+		                                                g_strdup_printf ("INSERT { <%s> a rdfs:Resource }",
+		                                                                 uri));
+		tracker_sparql_buffer_push (fixture->buffer, task,
+		                            G_PRIORITY_DEFAULT,
+		                            task_done_cb, fixture);
+		g_object_unref (file);
+		g_free (uri);
+
+		fixture->n_task++;
+	}
+
+	/* The last task fills the batch */
+	g_assert (fixture->n_pending == batch_size);
+	g_main_loop_run (fixture->main_loop);
+
+	g_assert_cmpint (tracker_sparql_buffer_get_last_latency (fixture->buffer), >=, 0);
+
+	return tracker_sparql_buffer_get_batch_size (fixture->buffer);
+}
+
+/* Runs commits until the batch size settles, checking each
+ * commit at most doubles or halves it.
+ */
+static guint
+run_commits (BufferFixture *fixture,
+             guint          n_commits)
+{
+	guint i, before, after;
+
+	after = tracker_sparql_buffer_get_batch_size (fixture->buffer);
+
+	for (i = 0; i < n_commits; i++) {
+		before = after;
+		after = run_commit (fixture);
+
+		g_assert_cmpuint (after, <=, MAX (before * 2, MIN_BATCH_SIZE));
+		g_assert_cmpuint (after, >=, MAX (before / 2, MIN_BATCH_SIZE));
+	}
+
+	return after;
+}
+
+static void
+test_sparql_buffer_batch_size_adapts (BufferFixture *fixture,
+                                      gconstpointer  data)
+{
+	guint batch_size, n_commits;
+
+	/* Starts at the minimum */
+	g_assert_cmpuint (tracker_sparql_buffer_get_batch_size (fixture->buffer), ==, MIN_BATCH_SIZE);
+
+	/* 1 ms per update, grows up to about 100 per commit */
+	tracker_mock_connection_set_update_cost (fixture->connection, 1);
+	batch_size = run_commits (fixture, 8);
+	g_assert_cmpuint (batch_size, >, 50);
+	g_assert_cmpuint (batch_size, <=, 100);
+
+	/* 4 ms per update, shrinks down to about 25 per commit */
+	tracker_mock_connection_set_update_cost (fixture->connection, 4);
+	batch_size = run_commits (fixture, 10);
+	g_assert_cmpuint (batch_size, <, 40);
+	g_assert_cmpuint (batch_size, >=, MIN_BATCH_SIZE);
+
+	/* Only whole batches were committed */
+	n_commits = tracker_mock_connection_get_n_update_arrays (fixture->connection);
+	g_assert_cmpuint (n_commits, ==, 18);
+}
+
+static void
+test_sparql_buffer_batch_size_bounds (BufferFixture *fixture,
+                                      gconstpointer  data)
+{
+	guint batch_size;
+
+	tracker_sparql_buffer_set_batch_limits (fixture->buffer,
+	                                        MIN_BATCH_SIZE,
+	                                        BOUNDS_MAX_BATCH_SIZE,
+	                                        BOUNDS_TARGET_LATENCY);
+
+	/* Instant updates, doubles up to the maximum */
+	tracker_mock_connection_set_update_cost (fixture->connection, 0);
+	batch_size = run_commits (fixture, 6);
+	g_assert_cmpuint (batch_size, ==, BOUNDS_MAX_BATCH_SIZE);
+
+	batch_size = run_commits (fixture, 2);
+	g_assert_cmpuint (batch_size, ==, BOUNDS_MAX_BATCH_SIZE);
+
+	/* A single update takes half the target, halves
+	 * down to the minimum.
+	 */
+	tracker_mock_connection_set_update_cost (fixture->connection, BOUNDS_TARGET_LATENCY / 2);
+	batch_size = run_commits (fixture, 6);
+	g_assert_cmpuint (batch_size, ==, MIN_BATCH_SIZE);
+}
+
+static void
+test_sparql_buffer_batch_size_disabled (BufferFixture *fixture,
+                                        gconstpointer  data)
+{
+	tracker_sparql_buffer_set_batch_limits (fixture->buffer,
+	                                        MIN_BATCH_SIZE,
+	                                        MAX_BATCH_SIZE,
+	                                        0);
+	g_assert_cmpuint (tracker_sparql_buffer_get_batch_size (fixture->buffer), ==, 0);
+
+	/* Enabling it again starts from the minimum */
+	tracker_sparql_buffer_set_batch_limits (fixture->buffer,
+	                                        MIN_BATCH_SIZE * 2,
+	                                        MAX_BATCH_SIZE,
+	                                        TARGET_LATENCY);
+	g_assert_cmpuint (tracker_sparql_buffer_get_batch_size (fixture->buffer), ==, MIN_BATCH_SIZE * 2);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_message ("Testing SPARQL buffer");
+
+	g_test_add ("/libtracker-miner/tracker-sparql-buffer/batch-size-adapts",
+	            BufferFixture, NULL,
+	            fixture_setup,
+	            test_sparql_buffer_batch_size_adapts,
+	            fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-sparql-buffer/batch-size-bounds",
+	            BufferFixture, NULL,
+	            fixture_setup,
+	            test_sparql_buffer_batch_size_bounds,
+	            fixture_teardown);
+	g_test_add ("/libtracker-miner/tracker-sparql-buffer/batch-size-disabled",
+	            BufferFixture, NULL,
+	            fixture_setup,
+	            test_sparql_buffer_batch_size_disabled,
+	            fixture_teardown);
+
+	return g_test_run ();
+}
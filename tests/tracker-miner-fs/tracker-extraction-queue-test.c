@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2026, Pelagicore AB
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "tracker-extraction-queue.h"
+
+typedef struct {
+	TrackerExtractionQueue *queue;
+	TrackerExtractionItem item;
+	gboolean released;
+} TestItem;
+
+static void
+item_cancelled_cb (GCancellable *cancellable,
+                   TestItem     *test_item)
+{
+	/* Like the miner does, requests complete
+	 * and get freed as soon as cancelled.
+	 */
+	tracker_extraction_queue_release (test_item->queue, &test_item->item);
+	test_item->released = TRUE;
+}
+
+static TestItem *
+test_item_new (TrackerExtractionQueue *queue,
+               const gchar            *mount_uuid)
+{
+	TestItem *test_item;
+
+	test_item = g_new0 (TestItem, 1);
+	test_item->queue = queue;
+	test_item->item.cancellable = g_cancellable_new ();
+	g_signal_connect (test_item->item.cancellable, "cancelled",
+	                  G_CALLBACK (item_cancelled_cb), test_item);
+
+	tracker_extraction_queue_add (queue, &test_item->item, mount_uuid);
+
+	return test_item;
+}
+
+static void
+test_item_free (TestItem *test_item)
+{
+	if (!test_item->released) {
+		tracker_extraction_queue_release (test_item->queue, &test_item->item);
+	}
+
+	g_object_unref (test_item->item.cancellable);
+	g_free (test_item);
+}
+
+static gboolean
+test_item_is_cancelled (TestItem *test_item)
+{
+	return g_cancellable_is_cancelled (test_item->item.cancellable);
+}
+
+static void
+test_extraction_queue_remove_mount (void)
+{
+	TrackerExtractionQueue *queue;
+	TestItem *a1, *a2, *a3, *b, *local;
+
+	queue = tracker_extraction_queue_new ();
+	g_assert (tracker_extraction_queue_is_empty (queue));
+
+	a1 = test_item_new (queue, "mount-a");
+	b = test_item_new (queue, "mount-b");
+	a2 = test_item_new (queue, "mount-a");
+	local = test_item_new (queue, NULL);
+	a3 = test_item_new (queue, "mount-a");
+
+	g_assert_cmpuint (tracker_extraction_queue_get_n_for_mount (queue, "mount-a"), ==, 3);
+	g_assert_cmpuint (tracker_extraction_queue_get_n_for_mount (queue, "mount-b"), ==, 1);
+
+	/* Done with the first phase, waiting for failsafe extraction */
+	tracker_extraction_queue_remove (queue, &a3->item);
+	g_assert_cmpuint (tracker_extraction_queue_get_n_for_mount (queue, "mount-a"), ==, 3);
+
+	/* Items release themselves while being cancelled */
+	g_assert_cmpuint (tracker_extraction_queue_cancel_for_mount (queue, "mount-a"), ==, 3);
+
+	g_assert (test_item_is_cancelled (a1));
+	g_assert (test_item_is_cancelled (a2));
+	g_assert (test_item_is_cancelled (a3));
+	g_assert (!test_item_is_cancelled (b));
+	g_assert (!test_item_is_cancelled (local));
+
+	g_assert_cmpuint (tracker_extraction_queue_get_n_for_mount (queue, "mount-a"), ==, 0);
+	g_assert_cmpuint (tracker_extraction_queue_get_n_for_mount (queue, "mount-b"), ==, 1);
+	g_assert (!tracker_extraction_queue_is_empty (queue));
+
+	/* Nothing left in there */
+	g_assert_cmpuint (tracker_extraction_queue_cancel_for_mount (queue, "mount-a"), ==, 0);
+
+	tracker_extraction_queue_remove (queue, &b->item);
+	tracker_extraction_queue_remove (queue, &local->item);
+	g_assert (tracker_extraction_queue_is_empty (queue));
+
+	test_item_free (a1);
+	test_item_free (a2);
+	test_item_free (a3);
+	test_item_free (b);
+	test_item_free (local);
+
+	g_assert_cmpuint (tracker_extraction_queue_get_n_for_mount (queue, "mount-b"), ==, 0);
+
+	tracker_extraction_queue_free (queue);
+}
+
+static void
+test_extraction_queue_unknown_mount (void)
+{
+	TrackerExtractionQueue *queue;
+	TestItem *item;
+
+	queue = tracker_extraction_queue_new ();
+	item = test_item_new (queue, "mount-a");
+
+	g_assert_cmpuint (tracker_extraction_queue_cancel_for_mount (queue, "mount-b"), ==, 0);
+	g_assert (!test_item_is_cancelled (item));
+
+	test_item_free (item);
+	g_assert (tracker_extraction_queue_is_empty (queue));
+
+	tracker_extraction_queue_free (queue);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/tracker-miner-fs/extraction-queue/remove-mount",
+	                 test_extraction_queue_remove_mount);
+	g_test_add_func ("/tracker-miner-fs/extraction-queue/unknown-mount",
+	                 test_extraction_queue_unknown_mount);
+
+	return g_test_run ();
+}
@@ -346,6 +346,131 @@ test_tracker_sparql_update_array_async (void)
 
 }
 
+/* Must be larger than 2, so failing items end up in different halves */
+#define UPDATE_ARRAY_SIZE 16
+
+typedef struct {
+	GMainLoop *main_loop;
+	GPtrArray *errors;
+} UpdateArrayData;
+
+static void
+update_array_isolate_callback (GObject      *source_object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+	UpdateArrayData *data = user_data;
+	GError *error = NULL;
+
+	data->errors = tracker_sparql_connection_update_array_finish (connection, result, &error);
+	g_assert_no_error (error);
+
+	g_main_loop_quit (data->main_loop);
+}
+
+static void
+test_tracker_sparql_update_array_isolate (void)
+{
+	TrackerSparqlCursor *cursor;
+	UpdateArrayData data;
+	GError *error = NULL;
+	gchar *queries[UPDATE_ARRAY_SIZE + 1] = { NULL };
+	gint i, n_items;
+
+	tracker_sparql_connection_update (connection,
+	                                  "DELETE { ?m a rdfs:Resource } WHERE { "
+	                                  "  ?m a nmo:Message ; nie:title ?t . "
+	                                  "  FILTER (fn:starts-with (?t, 'update-array ')) "
+	                                  "}",
+	                                  0, NULL, &error);
+	g_assert_no_error (error);
+
+	/* Every item has its own prologue, like independent
+	 * updates merged by a client would.
+	 */
+	for (i = 0; i < UPDATE_ARRAY_SIZE; i++) {
+		if (i == 3) {
+			/* Fails parsing */
+			queries[i] = g_strdup_printf ("PREFIX ex: <urn:update-array:> "
+			                              "INSERT { ex:item%d syntax error }", i);
+		} else if (i == 12) {
+			/* Fails applying, after inserting the resource */
+			queries[i] = g_strdup_printf ("PREFIX ex: <urn:update-array:> "
+			                              "INSERT { ex:item%d a nmo:Message ; "
+			                              "nie:title 'update-array %d', 'update-array' }", i, i);
+		} else {
+			queries[i] = g_strdup_printf ("PREFIX ex: <urn:update-array:> "
+			                              "INSERT { ex:item%d a nmo:Message ; "
+			                              "nie:title 'update-array %d' } # item %d", i, i, i);
+		}
+	}
+
+	data.main_loop = g_main_loop_new (NULL, FALSE);
+	data.errors = NULL;
+
+	tracker_sparql_connection_update_array_async (connection,
+	                                              queries,
+	                                              UPDATE_ARRAY_SIZE,
+	                                              0,
+	                                              NULL,
+	                                              update_array_isolate_callback,
+	                                              &data);
+
+	g_main_loop_run (data.main_loop);
+
+	/* Only the failing items report an error */
+	g_assert_cmpint (data.errors->len, ==, UPDATE_ARRAY_SIZE);
+
+	for (i = 0; i < UPDATE_ARRAY_SIZE; i++) {
+		if (i == 3 || i == 12) {
+			g_assert (g_ptr_array_index (data.errors, i) != NULL);
+		} else {
+			g_assert (g_ptr_array_index (data.errors, i) == NULL);
+		}
+	}
+
+	/* And all the others are applied */
+	cursor = tracker_sparql_connection_query (connection,
+	                                          "SELECT ?m WHERE { "
+	                                          "  ?m a nmo:Message ; nie:title ?t . "
+	                                          "  FILTER (fn:starts-with (?t, 'update-array ')) "
+	                                          "} ORDER BY ?m",
+	                                          NULL, &error);
+	g_assert_no_error (error);
+
+	n_items = 0;
+
+	while (tracker_sparql_cursor_next (cursor, NULL, &error)) {
+		const gchar *urn;
+
+		urn = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+		g_assert (g_str_has_prefix (urn, "urn:update-array:item"));
+		g_assert_cmpstr (urn, !=, "urn:update-array:item3");
+		g_assert_cmpstr (urn, !=, "urn:update-array:item12");
+		n_items++;
+	}
+
+	g_assert_no_error (error);
+	g_assert_cmpint (n_items, ==, UPDATE_ARRAY_SIZE - 2);
+	g_object_unref (cursor);
+
+	/* The rolled back item left nothing behind */
+	cursor = tracker_sparql_connection_query (connection,
+	                                          "ASK { <urn:update-array:item12> a rdfs:Resource }",
+	                                          NULL, &error);
+	g_assert_no_error (error);
+	g_assert (tracker_sparql_cursor_next (cursor, NULL, NULL));
+	g_assert (!tracker_sparql_cursor_get_boolean (cursor, 0));
+	g_object_unref (cursor);
+
+	g_ptr_array_unref (data.errors);
+	g_main_loop_unref (data.main_loop);
+
+	for (i = 0; i < UPDATE_ARRAY_SIZE; i++) {
+		g_free (queries[i]);
+	}
+}
+
 static void
 test_tracker_sparql_update_fast_error ()
 {
@@ -690,6 +815,7 @@ main (gint argc, gchar **argv)
 	g_test_add_func ("/steroids/tracker/tracker_sparql_update_async_cancel", test_tracker_sparql_update_async_cancel);
 	g_test_add_func ("/steroids/tracker/tracker_sparql_update_blank_async", test_tracker_sparql_update_blank_async);
 	g_test_add_func ("/steroids/tracker/tracker_sparql_update_array_async", test_tracker_sparql_update_array_async);
+	g_test_add_func ("/steroids/tracker/tracker_sparql_update_array_isolate", test_tracker_sparql_update_array_isolate);
 
 	return g_test_run ();
 }